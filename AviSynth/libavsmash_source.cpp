@@ -211,6 +211,7 @@ LSMASHVideoSource::LSMASHVideoSource
     enum AVPixelFormat  pixel_format,
     const char         *preferred_decoder_names,
     int                 prefer_hw_decoder,
+    int                 preview,
     IScriptEnvironment *env
 ) : LSMASHVideoSource{}
 {
@@ -222,6 +223,7 @@ LSMASHVideoSource::LSMASHVideoSource
     libavsmash_video_set_forward_seek_threshold ( vdhp, forward_seek_threshold );
     libavsmash_video_set_preferred_decoder_names( vdhp, tokenize_preferred_decoder_names() );
     libavsmash_video_set_prefer_hw_decoder      ( vdhp, prefer_hw_decoder );
+    libavsmash_video_set_preview                ( vdhp, preview );
     vohp->vfr2cfr = (fps_num > 0 && fps_den > 0);
     vohp->cfr_num = (uint32_t)fps_num;
     vohp->cfr_den = (uint32_t)fps_den;
@@ -502,21 +504,23 @@ AVSValue __cdecl CreateLSMASHVideoSource( AVSValue args, void *user_data, IScrip
     int         threads                 = args[2].AsInt( 0 );
     int         seek_mode               = args[3].AsInt( 0 );
     uint32_t    forward_seek_threshold  = args[4].AsInt( 10 );
-    int         direct_rendering        = args[5].AsBool( false ) ? 1 : 0;
+    int         direct_rendering        = args[5].Defined() ? (args[5].AsBool() ? 1 : 0) : -1;
     int         fps_num                 = args[6].AsInt( 0 );
     int         fps_den                 = args[7].AsInt( 1 );
     enum AVPixelFormat pixel_format     = get_av_output_pixel_format( args[8].AsString( nullptr ) );
     const char *preferred_decoder_names = args[9].AsString( nullptr );
     int         prefer_hw_decoder       = args[10].AsInt( 0 );
     int         ff_loglevel             = args[11].AsInt( 0 );
+    int         preview                 = args[12].AsInt( 0 );
     threads                = threads >= 0 ? threads : 0;
     seek_mode              = CLIP_VALUE( seek_mode, 0, 2 );
     forward_seek_threshold = CLIP_VALUE( forward_seek_threshold, 1, 999 );
-    direct_rendering      &= (pixel_format == AV_PIX_FMT_NONE);
+    direct_rendering       = pixel_format == AV_PIX_FMT_NONE ? direct_rendering : 0;
     prefer_hw_decoder      = CLIP_VALUE( prefer_hw_decoder, 0, 3 );
+    preview                = CLIP_VALUE( preview, 0, 4 );
     set_av_log_level( ff_loglevel );
     return new LSMASHVideoSource( source, track_number, threads, seek_mode, forward_seek_threshold,
-                                  direct_rendering, fps_num, fps_den, pixel_format, preferred_decoder_names, prefer_hw_decoder, env );
+                                  direct_rendering, fps_num, fps_den, pixel_format, preferred_decoder_names, prefer_hw_decoder, preview, env );
 }
 
 AVSValue __cdecl CreateLSMASHAudioSource( AVSValue args, void *user_data, IScriptEnvironment *env )
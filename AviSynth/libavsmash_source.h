@@ -75,6 +75,7 @@ public:
         enum AVPixelFormat  pixel_format,
         const char         *preferred_decoder_names,
         int                 prefer_hw_decoder,
+        int                 preview,
         IScriptEnvironment *env
     );
     ~LSMASHVideoSource();
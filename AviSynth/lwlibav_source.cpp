@@ -113,10 +113,13 @@ LWLibavVideoSource::LWLibavVideoSource
     lwlibav_option_t   *opt,
     int                 seek_mode,
     uint32_t            forward_seek_threshold,
+    int                 adaptive_seek,
     int                 direct_rendering,
     enum AVPixelFormat  pixel_format,
     const char         *preferred_decoder_names,
     int                 prefer_hw_decoder,
+    size_t              packet_cache_size,
+    int                 preview,
     IScriptEnvironment *env
 ) : LWLibavVideoSource{}
 {
@@ -127,8 +130,11 @@ LWLibavVideoSource::LWLibavVideoSource
     set_preferred_decoder_names( preferred_decoder_names );
     lwlibav_video_set_seek_mode              ( vdhp, seek_mode );
     lwlibav_video_set_forward_seek_threshold ( vdhp, forward_seek_threshold );
+    lwlibav_video_set_adaptive_seek          ( vdhp, adaptive_seek );
     lwlibav_video_set_preferred_decoder_names( vdhp, tokenize_preferred_decoder_names() );
     lwlibav_video_set_prefer_hw_decoder      ( vdhp, prefer_hw_decoder);
+    lwlibav_video_set_packet_cache_size      ( vdhp, packet_cache_size );
+    lwlibav_video_set_preview                ( vdhp, preview );
     as_video_output_handler_t *as_vohp = (as_video_output_handler_t *)lw_malloc_zero( sizeof(as_video_output_handler_t) );
     if( !as_vohp )
         env->ThrowError( "LWLibavVideoSource: failed to allocate the AviSynth video output handler." );
@@ -361,8 +367,8 @@ AVSValue __cdecl CreateLWLibavVideoSource( AVSValue args, void *user_data, IScri
     int         no_create_index         = args[3].AsBool( true ) ? 0 : 1;
     const char *index_file_path         = args[4].AsString( nullptr );
     int         seek_mode               = args[5].AsInt( 0 );
-    uint32_t    forward_seek_threshold  = args[6].AsInt( 10 );
-    int         direct_rendering        = args[7].AsBool( false ) ? 1 : 0;
+    int         forward_seek_threshold  = args[6].AsInt( -1 );
+    int         direct_rendering        = args[7].Defined() ? (args[7].AsBool() ? 1 : 0) : -1;
     int         fps_num                 = args[8].AsInt( 0 );
     int         fps_den                 = args[9].AsInt( 1 );
     int         apply_repeat_flag       = args[10].AsBool( true ) ? 1 : 0;
@@ -372,6 +378,9 @@ AVSValue __cdecl CreateLWLibavVideoSource( AVSValue args, void *user_data, IScri
     int         prefer_hw_decoder       = args[14].AsInt( 0 );
     int         ff_loglevel             = args[15].AsInt( 0 );
     const char* cdir                    = args[16].AsString( nullptr );
+    int         packet_cache            = args[17].AsInt( 64 );
+    int         preview                 = args[18].AsInt( 0 );
+    int         use_mmap                = args[19].AsBool( false ) ? 1 : 0;
     /* Set LW-Libav options. */
     lwlibav_option_t opt;
     opt.file_path         = source;
@@ -389,13 +398,20 @@ AVSValue __cdecl CreateLWLibavVideoSource( AVSValue args, void *user_data, IScri
     opt.vfr2cfr.active    = fps_num > 0 && fps_den > 0 ? 1 : 0;
     opt.vfr2cfr.fps_num   = fps_num;
     opt.vfr2cfr.fps_den   = fps_den;
+    opt.io_callbacks      = nullptr;
+    opt.io_flags          = use_mmap ? LW_IO_FLAG_MMAP : 0;
+    /* A negative seek_threshold lets the decoder decide by the measured seek and decoding costs. */
+    int adaptive_seek      = forward_seek_threshold < 0;
     seek_mode              = CLIP_VALUE( seek_mode, 0, 2 );
-    forward_seek_threshold = CLIP_VALUE( forward_seek_threshold, 1, 999 );
-    direct_rendering      &= (pixel_format == AV_PIX_FMT_NONE);
+    forward_seek_threshold = adaptive_seek ? 10 : CLIP_VALUE( forward_seek_threshold, 1, 999 );
+    direct_rendering       = pixel_format == AV_PIX_FMT_NONE ? direct_rendering : 0;
     prefer_hw_decoder      = CLIP_VALUE( prefer_hw_decoder, 0, 3 );
+    packet_cache           = CLIP_VALUE( packet_cache, 0, 4096 );
+    preview                = CLIP_VALUE( preview, 0, 4 );
     set_av_log_level( ff_loglevel );
-    return new LWLibavVideoSource( &opt, seek_mode, forward_seek_threshold,
-                                   direct_rendering, pixel_format, preferred_decoder_names, prefer_hw_decoder, env );
+    return new LWLibavVideoSource( &opt, seek_mode, forward_seek_threshold, adaptive_seek,
+                                   direct_rendering, pixel_format, preferred_decoder_names, prefer_hw_decoder,
+                                   (size_t)packet_cache << 20, preview, env );
 }
 
 AVSValue __cdecl CreateLWLibavAudioSource( AVSValue args, void *user_data, IScriptEnvironment *env )
@@ -410,6 +426,7 @@ AVSValue __cdecl CreateLWLibavAudioSource( AVSValue args, void *user_data, IScri
     const char *preferred_decoder_names = args[7].AsString( nullptr );
     int         ff_loglevel             = args[8].AsInt( 0 );
     const char* cdir                    = args[9].AsString( nullptr );
+    int         use_mmap                = args[10].AsBool( false ) ? 1 : 0;
     /* Set LW-Libav options. */
     lwlibav_option_t opt;
     opt.file_path         = source;
@@ -427,6 +444,8 @@ AVSValue __cdecl CreateLWLibavAudioSource( AVSValue args, void *user_data, IScri
     opt.vfr2cfr.active    = 0;
     opt.vfr2cfr.fps_num   = 0;
     opt.vfr2cfr.fps_den   = 0;
+    opt.io_callbacks      = nullptr;
+    opt.io_flags          = use_mmap ? LW_IO_FLAG_MMAP : 0;
     uint64_t channel_layout = layout_string ? av_get_channel_layout( layout_string ) : 0;
     set_av_log_level( ff_loglevel );
     return new LWLibavAudioSource( &opt, channel_layout, sample_rate, preferred_decoder_names, env );
@@ -63,10 +63,13 @@ public:
         lwlibav_option_t   *opt,
         int                 seek_mode,
         uint32_t            forward_seek_threshold,
+        int                 adaptive_seek,
         int                 direct_rendering,
         enum AVPixelFormat  pixel_format,
         const char         *preferred_decoder_names,
         int                 prefer_hw_decoder,
+        size_t              packet_cache_size,
+        int                 preview,
         IScriptEnvironment *env
     );
     ~LWLibavVideoSource();
@@ -30,17 +30,6 @@
 
 #include "lsmashsource.h"
 
-#if _MSC_VER >= 1700
-#define VC_HAS_AVX2 1
-#else
-#define VC_HAS_AVX2 0
-#endif
-
-#include <emmintrin.h>  /* SSE2 */
-#if VC_HAS_AVX2
-#include <immintrin.h>  /* AVX, AVX2 */
-#endif
-
 extern "C"
 {
 #include <libavformat/avformat.h>
@@ -51,146 +40,131 @@ extern "C"
 #include <libavutil/mastering_display_metadata.h>
 }
 
-#include "../common/lwsimd.h"
-
 #include "video_output.h"
+#include "../common/lwconvert.h"
 
-static inline __m128i _MM_PACKUS_EPI32( const __m128i &low, const __m128i &high )
-{
-    const __m128i val_32 = _mm_set1_epi32( 0x8000 );
-    const __m128i val_16 = _mm_set1_epi16( 0x8000 );
-    const __m128i low1   = _mm_sub_epi32( low, val_32 );
-    const __m128i high1  = _mm_sub_epi32( high, val_32 );
-    return _mm_add_epi16( _mm_packs_epi32( low1, high1 ), val_16 );
-}
-
-static void make_black_background_planar_yuv
+/* Return the pattern for lw_fill_plane() which repeats 'value' of a sample. */
+static inline uint32_t get_fill_pattern
 (
-    PVideoFrame &frame,
-    int          bitdepth_minus_8
+    int value,
+    int bitdepth_minus_8
 )
 {
-    memset( frame->GetWritePtr( PLANAR_Y ), 0x00,                   frame->GetPitch( PLANAR_Y ) * frame->GetHeight( PLANAR_Y ) );
-    memset( frame->GetWritePtr( PLANAR_U ), 0x80<<bitdepth_minus_8, frame->GetPitch( PLANAR_U ) * frame->GetHeight( PLANAR_U ) );
-    memset( frame->GetWritePtr( PLANAR_V ), 0x80<<bitdepth_minus_8, frame->GetPitch( PLANAR_V ) * frame->GetHeight( PLANAR_V ) );
+    return bitdepth_minus_8 ? (uint32_t)value * 0x00010001U : (uint32_t)value * 0x01010101U;
 }
 
-static void make_black_background_planar_yuva
+/* Fill the plane out of the picture of width x height placed at the top-left corner with 'pattern'. */
+static void fill_plane_border
 (
-    PVideoFrame &frame,
-    int          bitdepth_minus_8
+    PVideoFrame                     &frame,
+    const as_video_output_handler_t *as_vohp,
+    int                              plane,
+    int                              width,
+    int                              height,
+    uint32_t                         pattern
 )
 {
-    memset( frame->GetWritePtr( PLANAR_Y ), 0x00,                   frame->GetPitch( PLANAR_Y ) * frame->GetHeight( PLANAR_Y ) );
-    memset( frame->GetWritePtr( PLANAR_U ), 0x80<<bitdepth_minus_8, frame->GetPitch( PLANAR_U ) * frame->GetHeight( PLANAR_U ) );
-    memset( frame->GetWritePtr( PLANAR_V ), 0x80<<bitdepth_minus_8, frame->GetPitch( PLANAR_V ) * frame->GetHeight( PLANAR_V ) );
-    memset( frame->GetWritePtr( PLANAR_A ), 0xff,                   frame->GetPitch( PLANAR_A ) * frame->GetHeight( PLANAR_A ) );
+    int plane_width = as_vohp->vi->width;
+    if( plane == PLANAR_U || plane == PLANAR_V )
+    {
+        plane_width >>= as_vohp->sub_width;
+        width  = AV_CEIL_RSHIFT( width,  as_vohp->sub_width  );
+        height = AV_CEIL_RSHIFT( height, as_vohp->sub_height );
+    }
+    int row_size        = frame->GetRowSize( plane );
+    int bytes_per_pixel = row_size / plane_width;
+    lw_fill_plane_border( frame->GetWritePtr( plane ), frame->GetPitch( plane ),
+                          row_size, frame->GetHeight( plane ),
+                          width * bytes_per_pixel, height, pattern );
 }
 
-static void make_black_background_planar_yuv_interleaved
+static void make_black_background_planar_yuv
 (
-    PVideoFrame &frame,
-    int          bitdepth_minus_8
+    PVideoFrame                     &frame,
+    const as_video_output_handler_t *as_vohp,
+    int                              width,
+    int                              height
 )
 {
-    memset( frame->GetWritePtr( PLANAR_Y ), 0x00, frame->GetPitch( PLANAR_Y ) * frame->GetHeight( PLANAR_Y ) );
-    uint8_t msb  = (uint8_t)((0x80U << bitdepth_minus_8) >> 8);
-    int     size = frame->GetPitch( PLANAR_U ) * frame->GetHeight( PLANAR_U );
-    for( int i = 0; i < size; i++ )
-        if( i & 1 )
-        {
-            *(frame->GetWritePtr( PLANAR_U ) + i) = msb;
-            *(frame->GetWritePtr( PLANAR_V ) + i) = msb;
-        }
-        else
-        {
-            *(frame->GetWritePtr( PLANAR_U ) + i) = 0x00;
-            *(frame->GetWritePtr( PLANAR_V ) + i) = 0x00;
-        }
+    int bitdepth_minus_8 = as_vohp->bitdepth_minus_8;
+    fill_plane_border( frame, as_vohp, PLANAR_Y, width, height, 0x00000000 );
+    fill_plane_border( frame, as_vohp, PLANAR_U, width, height, get_fill_pattern( 0x80 << bitdepth_minus_8, bitdepth_minus_8 ) );
+    fill_plane_border( frame, as_vohp, PLANAR_V, width, height, get_fill_pattern( 0x80 << bitdepth_minus_8, bitdepth_minus_8 ) );
 }
 
-static void make_black_background_planar_yuva_interleaved
+static void make_black_background_planar_yuva
 (
-    PVideoFrame &frame,
-    int          bitdepth_minus_8
+    PVideoFrame                     &frame,
+    const as_video_output_handler_t *as_vohp,
+    int                              width,
+    int                              height
 )
 {
-    memset( frame->GetWritePtr( PLANAR_Y ), 0x00, frame->GetPitch( PLANAR_Y ) * frame->GetHeight( PLANAR_Y ) );
-    memset( frame->GetWritePtr( PLANAR_A ), 0xff, frame->GetPitch( PLANAR_A ) * frame->GetHeight( PLANAR_A ) );
-    uint8_t msb  = (uint8_t)((0x80U << bitdepth_minus_8) >> 8);
-    int     size = frame->GetPitch( PLANAR_U ) * frame->GetHeight( PLANAR_U );
-    for( int i = 0; i < size; i++ )
-        if( i & 1 )
-        {
-            *(frame->GetWritePtr( PLANAR_U ) + i) = msb;
-            *(frame->GetWritePtr( PLANAR_V ) + i) = msb;
-        }
-        else
-        {
-            *(frame->GetWritePtr( PLANAR_U ) + i) = 0x00;
-            *(frame->GetWritePtr( PLANAR_V ) + i) = 0x00;
-        }
+    int bitdepth_minus_8 = as_vohp->bitdepth_minus_8;
+    make_black_background_planar_yuv( frame, as_vohp, width, height );
+    fill_plane_border( frame, as_vohp, PLANAR_A, width, height, get_fill_pattern( (0x100 << bitdepth_minus_8) - 1, bitdepth_minus_8 ) );
 }
 
 static void make_black_background_packed_yuv422
 (
-    PVideoFrame &frame,
-    int          bitdepth_minus_8
+    PVideoFrame                     &frame,
+    const as_video_output_handler_t *as_vohp,
+    int                              width,
+    int                              height
 )
 {
-    uint32_t *dst = (uint32_t *)frame->GetWritePtr();
-    int num_loops = frame->GetPitch() * frame->GetHeight() / 4;
-    for( int i = 0; i < num_loops; i++ )
-        *dst++ = 0x00800080;
+    /* Y, U, Y and V in the little-endian. A pair of pixels shares the chroma. */
+    fill_plane_border( frame, as_vohp, 0, (width + 1) & ~1, height, 0x80008000 );
 }
 
 static void make_black_background_packed_all_zero
 (
-    PVideoFrame &frame,
-    int          bitdepth_minus_8
+    PVideoFrame                     &frame,
+    const as_video_output_handler_t *as_vohp,
+    int                              width,
+    int                              height
 )
 {
-    memset( frame->GetWritePtr(), 0x00, frame->GetPitch() * frame->GetHeight() );
+    fill_plane_border( frame, as_vohp, 0, width, height, 0x00000000 );
 }
 
 static void make_black_background_planar_rgb
 (
-    PVideoFrame &frame,
-    int          bitdepth_minus_8
+    PVideoFrame                     &frame,
+    const as_video_output_handler_t *as_vohp,
+    int                              width,
+    int                              height
 )
 {
-    memset( frame->GetWritePtr( PLANAR_G ), 0x00, frame->GetPitch( PLANAR_G ) * frame->GetHeight( PLANAR_G ) );
-    memset( frame->GetWritePtr( PLANAR_B ), 0x00, frame->GetPitch( PLANAR_B ) * frame->GetHeight( PLANAR_B ) );
-    memset( frame->GetWritePtr( PLANAR_R ), 0x00, frame->GetPitch( PLANAR_R ) * frame->GetHeight( PLANAR_R ) );
+    fill_plane_border( frame, as_vohp, PLANAR_G, width, height, 0x00000000 );
+    fill_plane_border( frame, as_vohp, PLANAR_B, width, height, 0x00000000 );
+    fill_plane_border( frame, as_vohp, PLANAR_R, width, height, 0x00000000 );
 }
 
 static void make_black_background_planar_rgba
 (
-    PVideoFrame &frame,
-    int          bitdepth_minus_8
+    PVideoFrame                     &frame,
+    const as_video_output_handler_t *as_vohp,
+    int                              width,
+    int                              height
 )
 {
-    memset( frame->GetWritePtr( PLANAR_G ), 0x00, frame->GetPitch( PLANAR_G ) * frame->GetHeight( PLANAR_G ) );
-    memset( frame->GetWritePtr( PLANAR_B ), 0x00, frame->GetPitch( PLANAR_B ) * frame->GetHeight( PLANAR_B ) );
-    memset( frame->GetWritePtr( PLANAR_R ), 0x00, frame->GetPitch( PLANAR_R ) * frame->GetHeight( PLANAR_R ) );
-    memset( frame->GetWritePtr( PLANAR_A ), 0xff, frame->GetPitch( PLANAR_A ) * frame->GetHeight( PLANAR_A ) );
+    int bitdepth_minus_8 = as_vohp->bitdepth_minus_8;
+    make_black_background_planar_rgb( frame, as_vohp, width, height );
+    fill_plane_border( frame, as_vohp, PLANAR_A, width, height, get_fill_pattern( (0x100 << bitdepth_minus_8) - 1, bitdepth_minus_8 ) );
 }
 
 /* This source filter always uses lines aligned to an address dividable by 32.
  * Furthermore it seems Avisynth bulit-in BitBlt is slow.
- * So, I think it's OK that we always use swscale instead. */
+ * So, I think it's OK that we always use our own kernels or swscale instead. */
 static inline int convert_av_pixel_format
 (
-    struct SwsContext *sws_ctx,
-    int                height,
-    AVFrame           *av_frame,
-    as_picture_t      *as_picture
+    lw_video_scaler_handler_t *vshp,
+    AVFrame                   *av_frame,
+    as_picture_t              *as_picture
 )
 {
-    int ret = sws_scale( sws_ctx,
-                         (const uint8_t * const *)av_frame->data, av_frame->linesize,
-                         0, height,
-                         as_picture->data, as_picture->linesize );
+    int ret = convert_video_picture( vshp, av_frame, as_picture->data, as_picture->linesize );
     return ret > 0 ? ret : -1;
 }
 
@@ -209,63 +183,7 @@ static int make_frame_planar_yuv
     as_picture.linesize[0] = as_frame->GetPitch   ( PLANAR_Y );
     as_picture.linesize[1] = as_frame->GetPitch   ( PLANAR_U );
     as_picture.linesize[2] = as_frame->GetPitch   ( PLANAR_V );
-    if( vohp->scaler.input_pixel_format == AV_PIX_FMT_P010LE && vohp->scaler.output_pixel_format == AV_PIX_FMT_YUV420P10LE )
-    {
-        const int width_y       = as_frame->GetRowSize( PLANAR_Y ) / sizeof( uint16_t );
-        const int width_uv      = as_frame->GetRowSize( PLANAR_U ) / sizeof( uint16_t );
-        const int height_y      = as_frame->GetHeight( PLANAR_Y );
-        const int height_uv     = as_frame->GetHeight( PLANAR_U );
-        const int src_pitch_y   = av_frame->linesize[0] / sizeof( uint16_t );
-        const int src_pitch_uv  = av_frame->linesize[1] / sizeof( uint16_t );
-        const int dst_pitch_y   = as_picture.linesize[0] / sizeof( uint16_t );
-        const int dst_pitch_uv  = as_picture.linesize[1] / sizeof( uint16_t );
-        uint16_t *srcp_y        = (uint16_t *)av_frame->data[0];
-        uint16_t *srcp_uv       = (uint16_t *)av_frame->data[1];
-        uint16_t *dstp_y        = (uint16_t *)as_picture.data[0];
-        uint16_t *dstp_u        = (uint16_t *)as_picture.data[1];
-        uint16_t *dstp_v        = (uint16_t *)as_picture.data[2];
-
-        for( int y = 0; y < height_y; y++ )
-        {
-            for( int x = 0; x < width_y; x += 8 )
-            {
-                __m128i yy = _mm_load_si128( (const __m128i *)(srcp_y + x) );
-                yy         = _mm_srli_epi16( yy, 6 );
-                _mm_stream_si128( (__m128i *)(dstp_y + x), yy );
-            }
-            srcp_y += src_pitch_y;
-            dstp_y += dst_pitch_y;
-        }
-
-        const __m128i mask = _mm_set1_epi32(0x0000FFFF);
-        for( int y = 0; y < height_uv; y++ )
-        {
-            for( int x = 0; x < width_uv; x += 8 )
-            {
-                __m128i uv_low  = _mm_load_si128( (__m128i *)((uint32_t *)srcp_uv + x + 0) );
-                __m128i uv_high = _mm_load_si128( (__m128i *)((uint32_t *)srcp_uv + x + 4) );
-
-                __m128i u_low  = _mm_and_si128( uv_low, mask );
-                __m128i u_high = _mm_and_si128( uv_high, mask );
-                __m128i u      = _MM_PACKUS_EPI32( u_low, u_high );
-                u              = _mm_srli_epi16( u, 6 );
-                _mm_stream_si128( (__m128i *)(dstp_u + x), u );
-
-                __m128i v_low  = _mm_srli_epi32( uv_low, 16 );
-                __m128i v_high = _mm_srli_epi32( uv_high, 16 );
-                __m128i v      = _MM_PACKUS_EPI32( v_low, v_high );
-                v              = _mm_srli_epi16( v, 6 );
-                _mm_stream_si128( (__m128i *)(dstp_v + x), v );
-            }
-            srcp_uv += src_pitch_uv;
-            dstp_u  += dst_pitch_uv;
-            dstp_v  += dst_pitch_uv;
-        }
-
-        return height_y;
-    }
-    else
-        return convert_av_pixel_format( vohp->scaler.sws_ctx, height, av_frame, &as_picture );
+    return convert_av_pixel_format( &vohp->scaler, av_frame, &as_picture );
 }
 
 static int make_frame_planar_yuva
@@ -285,7 +203,7 @@ static int make_frame_planar_yuva
     as_picture.linesize[1] = as_frame->GetPitch   ( PLANAR_U );
     as_picture.linesize[2] = as_frame->GetPitch   ( PLANAR_V );
     as_picture.linesize[3] = as_frame->GetPitch   ( PLANAR_A );
-    return convert_av_pixel_format( vohp->scaler.sws_ctx, height, av_frame, &as_picture );
+    return convert_av_pixel_format( &vohp->scaler, av_frame, &as_picture );
 }
 
 static int make_frame_packed_yuv
@@ -299,7 +217,7 @@ static int make_frame_packed_yuv
     as_picture_t as_picture = { { NULL } };
     as_picture.data    [0] = as_frame->GetWritePtr();
     as_picture.linesize[0] = as_frame->GetPitch   ();
-    return convert_av_pixel_format( vohp->scaler.sws_ctx, height, av_frame, &as_picture );
+    return convert_av_pixel_format( &vohp->scaler, av_frame, &as_picture );
 }
 
 static int make_frame_packed_rgb
@@ -313,7 +231,7 @@ static int make_frame_packed_rgb
     as_picture_t as_picture = { { NULL } };
     as_picture.data    [0] = as_frame->GetWritePtr() + as_frame->GetPitch() * (as_frame->GetHeight() - 1);
     as_picture.linesize[0] = -as_frame->GetPitch();
-    return convert_av_pixel_format( vohp->scaler.sws_ctx, height, av_frame, &as_picture );
+    return convert_av_pixel_format( &vohp->scaler, av_frame, &as_picture );
 }
 
 static int make_frame_planar_rgb
@@ -331,7 +249,7 @@ static int make_frame_planar_rgb
     as_picture.linesize[0] = as_frame->GetPitch   ( PLANAR_G );
     as_picture.linesize[1] = as_frame->GetPitch   ( PLANAR_B );
     as_picture.linesize[2] = as_frame->GetPitch   ( PLANAR_R );
-    return convert_av_pixel_format( vohp->scaler.sws_ctx, height, av_frame, &as_picture );
+    return convert_av_pixel_format( &vohp->scaler, av_frame, &as_picture );
 }
 
 static int make_frame_planar_rgba
@@ -351,7 +269,7 @@ static int make_frame_planar_rgba
     as_picture.linesize[1] = as_frame->GetPitch   ( PLANAR_B );
     as_picture.linesize[2] = as_frame->GetPitch   ( PLANAR_R );
     as_picture.linesize[3] = as_frame->GetPitch   ( PLANAR_A );
-    return convert_av_pixel_format( vohp->scaler.sws_ctx, height, av_frame, &as_picture );
+    return convert_av_pixel_format( &vohp->scaler, av_frame, &as_picture );
 }
 
 enum AVPixelFormat get_av_output_pixel_format
@@ -609,7 +527,7 @@ static int determine_colorspace_conversion
         case AV_PIX_FMT_YUV444P12LE:
         case AV_PIX_FMT_YUV444P14LE:
         case AV_PIX_FMT_YUV444P16LE:
-            as_vohp->make_black_background = make_black_background_planar_yuv_interleaved;
+            as_vohp->make_black_background = make_black_background_planar_yuv;
             as_vohp->make_frame            = make_frame_planar_yuv;
             return 0;
         case AV_PIX_FMT_YUYV422:
@@ -630,7 +548,7 @@ static int determine_colorspace_conversion
         case AV_PIX_FMT_YUVA444P10LE:
         case AV_PIX_FMT_YUVA444P12LE:
         case AV_PIX_FMT_YUVA444P16LE:
-            as_vohp->make_black_background = make_black_background_planar_yuva_interleaved;
+            as_vohp->make_black_background = make_black_background_planar_yuva;
             as_vohp->make_frame            = make_frame_planar_yuva;
             return 0;
         case AV_PIX_FMT_GRAY8:
@@ -689,8 +607,7 @@ int make_frame
      * We don't change the presentation resolution. */
     as_video_output_handler_t *as_vohp = (as_video_output_handler_t *)vohp->private_handler;
     as_frame = env->NewVideoFrame( *as_vohp->vi, 32 );
-    if( vohp->output_width  != av_frame->width || vohp->output_height != av_frame->height )
-        as_vohp->make_black_background( as_frame, as_vohp->bitdepth_minus_8 );
+    as_vohp->make_black_background( as_frame, as_vohp, av_frame->width, av_frame->height );
     return as_vohp->make_frame( vohp, av_frame->height, av_frame, as_frame );
 }
 
@@ -765,6 +682,7 @@ static int as_video_get_buffer
     int             flags
 )
 {
+    av_frame->opaque = NULL;
     lw_video_output_handler_t *lw_vohp = (lw_video_output_handler_t *)ctx->opaque;
     as_video_output_handler_t *as_vohp = (as_video_output_handler_t *)lw_vohp->private_handler;
     lw_video_scaler_handler_t *vshp    = &lw_vohp->scaler;
@@ -774,6 +692,16 @@ static int as_video_get_buffer
     if( vshp->output_pixel_format != pix_fmt
      || !as_check_dr_available( ctx, pix_fmt ) )
         return avcodec_default_get_buffer2( ctx, av_frame, 0 );
+    /* The decoder may write the padding up to the aligned size.
+     * Fall back to the decoder's own buffers if the output frame can't hold it,
+     * e.g. the resolution got larger than the initial one. */
+    int aligned_width  = av_frame->width;
+    int aligned_height = av_frame->height;
+    int linesize_align[AV_NUM_DATA_POINTERS];
+    avcodec_align_dimensions2( ctx, &aligned_width, &aligned_height, linesize_align );
+    if( aligned_width  > lw_vohp->output_width
+     || aligned_height > lw_vohp->output_height )
+        return avcodec_default_get_buffer2( ctx, av_frame, 0 );
     /* New AviSynth video frame buffer. */
     as_video_buffer_handler_t *as_vbhp = new as_video_buffer_handler_t;
     if( !as_vbhp )
@@ -781,13 +709,16 @@ static int as_video_get_buffer
         av_frame_unref( av_frame );
         return AVERROR( ENOMEM );
     }
-    av_frame->opaque = as_vbhp;
     as_vbhp->as_frame_buffer = as_vohp->env->NewVideoFrame( *as_vohp->vi, 32 );
-    int aligned_width  = ctx->width << (as_vohp->bitdepth_minus_8 ? 1 : 0);
-    int aligned_height = ctx->height;
-    avcodec_align_dimensions2( ctx, &aligned_width, &aligned_height, av_frame->linesize );
-    if( lw_vohp->output_width != aligned_width || lw_vohp->output_height != aligned_height )
-        as_vohp->make_black_background( as_vbhp->as_frame_buffer, as_vohp->bitdepth_minus_8 );
+    if( as_vbhp->as_frame_buffer->GetPitch() % linesize_align[0] )
+    {
+        /* The decoder requires the larger stride alignment than AviSynth's. */
+        delete as_vbhp;
+        return avcodec_default_get_buffer2( ctx, av_frame, 0 );
+    }
+    av_frame->opaque = as_vbhp;
+    /* The decoder overwrites the border as far as it writes the padding of the picture. */
+    as_vohp->make_black_background( as_vbhp->as_frame_buffer, as_vohp, ctx->width, ctx->height );
     /* Create frame buffers for the decoder.
      * The callback as_video_release_buffer_handler() shall be called when no reference to the video buffer handler is present.
      * The callback as_video_unref_buffer_handler() decrements the reference-counter by 1. */
@@ -873,7 +804,14 @@ void as_setup_video_rendering
     vohp->scaler.output_pixel_format = output_pixel_format;
     enum AVPixelFormat input_pixel_format = ctx->pix_fmt;
     avoid_yuv_scale_conversion( &input_pixel_format );
-    direct_rendering &= as_check_dr_available( ctx, input_pixel_format );
+    if( direct_rendering < 0 )
+        /* RGB is excluded because AviSynth stores packed RGB upside down. */
+        direct_rendering = input_pixel_format == output_pixel_format
+                        && as_check_dr_available( ctx, input_pixel_format )
+                        && !vi->IsRGB()
+                        && check_dr_exact( ctx, output_pixel_format, output_width, output_height );
+    else
+        direct_rendering &= as_check_dr_available( ctx, input_pixel_format );
     int (*dr_get_buffer)( struct AVCodecContext *, AVFrame *, int ) = direct_rendering ? as_video_get_buffer : NULL;
     setup_video_rendering( vohp, SWS_FAST_BILINEAR,
                            output_width, output_height, output_pixel_format,
@@ -29,10 +29,15 @@ typedef struct
     int      linesize[4];
 } as_picture_t;
 
+typedef struct as_video_output_handler_tag as_video_output_handler_t;
+
+/* Fill the area of the frame out of the picture of width x height placed at the top-left corner with black. */
 typedef void func_make_black_background
 (
-    PVideoFrame &frame,
-    int          bitdepth_minus_8
+    PVideoFrame                     &frame,
+    const as_video_output_handler_t *as_vohp,
+    int                              width,
+    int                              height
 );
 
 typedef int func_make_frame
@@ -43,7 +48,7 @@ typedef int func_make_frame
     PVideoFrame               &as_frame
 );
 
-typedef struct
+struct as_video_output_handler_tag
 {
     func_make_black_background *make_black_background;
     func_make_frame            *make_frame;
@@ -53,7 +58,7 @@ typedef struct
     int                         sub_width;
     int                         sub_height;
     as_picture_t                scaled;
-} as_video_output_handler_t;
+};
 
 typedef struct
 {
@@ -1,24 +0,0 @@
-/*****************************************************************************
- * lwcolor_simd.h
- *****************************************************************************
- * Copyright (C) 2013-2015 L-SMASH Works project
- *
- * Authors: rigaya <rigaya34589@live.jp>
- *
- * Permission to use, copy, modify, and/or distribute this software for any
- * purpose with or without fee is hereby granted, provided that the above
- * copyright notice and this permission notice appear in all copies.
- *
- * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
- * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
- * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
- * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
- * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
- * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
- * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
- *****************************************************************************/
-
-/* This file is available under an ISC license. */
-
-void convert_lw48_to_yuy2_sse41( int thread_id, int thread_num, void *param1, void *param2 );
-void convert_lw48_to_rgb24_sse41( int thread_id, int thread_num, void *param1, void *param2 );
@@ -214,6 +214,8 @@ static void *open_file( char *file_path, reader_option_t *opt )
     lwlibav_opt.vfr2cfr.active    = opt->video_opt.vfr2cfr.active;
     lwlibav_opt.vfr2cfr.fps_num   = opt->video_opt.vfr2cfr.framerate_num;
     lwlibav_opt.vfr2cfr.fps_den   = opt->video_opt.vfr2cfr.framerate_den;
+    lwlibav_opt.io_callbacks      = NULL;
+    lwlibav_opt.io_flags          = 0;
     lwlibav_video_set_preferred_decoder_names( hp->vdhp, opt->preferred_decoder_names );
     lwlibav_audio_set_preferred_decoder_names( hp->adhp, opt->preferred_decoder_names );
     /* Set up progress indicator. */
@@ -44,6 +44,7 @@ typedef struct
     lsmash_file_parameters_t           file_param;
     AVFormatContext                   *format_ctx;
     char preferred_decoder_names_buf[PREFERRED_DECODER_NAMES_BUFSIZE];
+    int64_t                            keyframes;
 } lsmas_handler_t;
 
 /* Deallocate the handler of this plugin. */
@@ -211,6 +212,12 @@ static int prepare_video_decoding
     }
     else
         libavsmash_video_clear_error( vdhp );
+    /* Output only keyframes. The frame rate is kept as the one of the whole track. */
+    if( hp->keyframes && libavsmash_video_setup_keyframe_only( vdhp, vohp ) < 0 )
+    {
+        set_error_on_init( out, vsapi, "lsmas: failed to set up the keyframe-only mode." );
+        return -1;
+    }
     /* Find the first valid video sample. */
     if( libavsmash_video_find_first_valid_frame( vdhp ) < 0 )
     {
@@ -226,12 +233,7 @@ static int prepare_video_decoding
     {
         hp->vi[1] = hp->vi[0];
         hp->vi[1].format = vsapi->registerFormat( cmGray, hp->vi[0].format->sampleType, hp->vi[0].format->bitsPerSample, 0, 0, core );
-        vs_vohp->background_frame[1] = vsapi->newVideoFrame( hp->vi[1].format, hp->vi[1].width, hp->vi[1].height, NULL, core );
-        if( !vs_vohp->background_frame[1] )
-        {
-            set_error_on_init( out, vsapi, "lsmas: failed to allocate memory for the alpha frame data." );
-            return -1;
-        }
+        vs_vohp->output_format[1] = hp->vi[1].format;
     }
     /* Force seeking at the first reading. */
     libavsmash_video_force_seek( vdhp );
@@ -273,28 +275,12 @@ static const VSFrameRef *VS_CC vs_filter_get_frame( int n, int activation_reason
     /* Output video frame. */
     AVFrame    *av_frame = libavsmash_video_get_frame_buffer( vdhp );
     int output_index = vsapi->getOutputIndex( frame_ctx );
-    VSFrameRef *vs_frame = make_frame( vohp, av_frame, output_index );
+    VSFrameRef *vs_frame = make_output_frame( vohp, av_frame, n, output_index );
     if( !vs_frame )
     {
         vsapi->setFilterError( "lsmas: failed to output a video frame.", frame_ctx );
         return NULL;
     }
-    AVCodecContext *ctx = libavsmash_video_get_codec_context( vdhp );
-    if ( output_index == 0 && ( av_pix_fmt_desc_get( ctx->pix_fmt )->flags & AV_PIX_FMT_FLAG_ALPHA) )
-    {
-        /* api4 compat: save alpha clip into the _Alpha property */
-        VSFrameRef *vs_frame2 = make_frame( vohp, av_frame, 1 );
-        if( !vs_frame2 )
-        {
-            vsapi->setFilterError( "lsmas: failed to output an alpha video frame.", frame_ctx );
-            return NULL;
-        }
-        VSMap *props = vsapi->getFramePropsRW( vs_frame2 );
-        vsapi->propSetInt( props, "_ColorRange", 0, paReplace ); // alpha clip always full range
-        props = vsapi->getFramePropsRW( vs_frame );
-        vsapi->propSetFrame( props, "_Alpha", vs_frame2, paAppend );
-        vsapi->freeFrame( vs_frame2 );
-    }
     int top = -1;
     if ( vohp->repeat_control && vohp->repeat_requested )
     {
@@ -307,7 +293,20 @@ static const VSFrameRef *VS_CC vs_filter_get_frame( int n, int activation_reason
         bottom = ( vohp->frame_order_list[n].bottom == vohp->frame_order_list[sample_number].bottom ) ? vohp->frame_order_list[n - 1].bottom :
             vohp->frame_order_list[n].bottom;
     }
-    set_frame_properties( vdhp, n, vi, av_frame, vs_frame, sample_number, top, bottom, vsapi );
+    if( hp->keyframes )
+    {
+        /* Attach the number and time of the keyframe in the whole track. */
+        uint32_t source_sample_number;
+        double   source_time;
+        libavsmash_video_get_source_frame_info( vdhp, sample_number, &source_sample_number, &source_time );
+        set_frame_properties( vdhp, n, vi, av_frame, vs_frame, source_sample_number, top, bottom, vsapi );
+        VSMap *props = vsapi->getFramePropsRW( vs_frame );
+        vsapi->propSetInt( props, "_LwSourceFrame", (int64_t)source_sample_number - 1, paReplace );
+        if( source_time >= 0.0 )
+            vsapi->propSetFloat( props, "_AbsoluteTime", source_time, paReplace );
+    }
+    else
+        set_frame_properties( vdhp, n, vi, av_frame, vs_frame, sample_number, top, bottom, vsapi );
     return vs_frame;
 }
 
@@ -379,6 +378,8 @@ void VS_CC vs_libavsmashsource_create( const VSMap *in, VSMap *out, void *user_d
     int64_t fps_den;
     int64_t prefer_hw_decoder;
     int64_t ff_loglevel;
+    int64_t preview;
+    int64_t output_threads;
     const char *format;
     const char *preferred_decoder_names;
     set_option_int64 ( &track_number,            0,    "track",          in, vsapi );
@@ -386,11 +387,14 @@ void VS_CC vs_libavsmashsource_create( const VSMap *in, VSMap *out, void *user_d
     set_option_int64 ( &seek_mode,               0,    "seek_mode",      in, vsapi );
     set_option_int64 ( &seek_threshold,          10,   "seek_threshold", in, vsapi );
     set_option_int64 ( &variable_info,           0,    "variable",       in, vsapi );
-    set_option_int64 ( &direct_rendering,        0,    "dr",             in, vsapi );
+    set_option_int64 ( &direct_rendering,        -1,   "dr",             in, vsapi );
     set_option_int64 ( &fps_num,                 0,    "fpsnum",         in, vsapi );
     set_option_int64 ( &fps_den,                 1,    "fpsden",         in, vsapi );
     set_option_int64 ( &prefer_hw_decoder,       0,    "prefer_hw",      in, vsapi );
     set_option_int64 ( &ff_loglevel,             0,    "ff_loglevel",    in, vsapi );
+    set_option_int64 ( &hp->keyframes,           0,    "keyframes",      in, vsapi );
+    set_option_int64 ( &preview,                 0,    "preview",        in, vsapi );
+    set_option_int64 ( &output_threads,          0,    "output_threads", in, vsapi );
     set_option_string( &format,                  NULL, "format",         in, vsapi );
     set_option_string( &preferred_decoder_names, NULL, "decoder",        in, vsapi );
     set_preferred_decoder_names_on_buf( hp->preferred_decoder_names_buf, preferred_decoder_names );
@@ -398,11 +402,13 @@ void VS_CC vs_libavsmashsource_create( const VSMap *in, VSMap *out, void *user_d
     libavsmash_video_set_forward_seek_threshold ( vdhp, CLIP_VALUE( seek_threshold, 1, 999 ) );
     libavsmash_video_set_preferred_decoder_names( vdhp, tokenize_preferred_decoder_names( hp->preferred_decoder_names_buf ) );
     libavsmash_video_set_prefer_hw_decoder      ( vdhp, CLIP_VALUE( prefer_hw_decoder, 0, 3 ) );
+    libavsmash_video_set_preview                ( vdhp, (int)CLIP_VALUE( preview, 0, 4 ) );
+    vohp->scaler.threads = (int)CLIP_VALUE( output_threads, 0, 64 );
     vohp->vfr2cfr = (fps_num > 0 && fps_den > 0);
     vohp->cfr_num = (uint32_t)fps_num;
     vohp->cfr_den = (uint32_t)fps_den;
     vs_vohp->variable_info               = CLIP_VALUE( variable_info,  0, 1 );
-    vs_vohp->direct_rendering            = CLIP_VALUE( direct_rendering,  0, 1 ) && !format;
+    vs_vohp->direct_rendering            = direct_rendering < 0 ? -1 : CLIP_VALUE( direct_rendering,  0, 1 ) && !format;
     vs_vohp->vs_output_pixel_format = vs_vohp->variable_info ? pfNone : get_vs_output_pixel_format( format );
     if( ff_loglevel <= 0 )
         av_log_set_level( AV_LOG_QUIET );
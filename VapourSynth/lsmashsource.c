@@ -99,7 +99,7 @@ VS_EXTERNAL_API(void) VapourSynthPluginInit( VSConfigPlugin config_func, VSRegis
     register_func
     (
         "LibavSMASHSource",
-        "source:data;track:int:opt;" COMMON_OPTS "ff_loglevel:int:opt;",
+        "source:data;track:int:opt;" COMMON_OPTS "ff_loglevel:int:opt;keyframes:int:opt;preview:int:opt;output_threads:int:opt;",
         vs_libavsmashsource_create,
         NULL,
         plugin
@@ -107,7 +107,7 @@ VS_EXTERNAL_API(void) VapourSynthPluginInit( VSConfigPlugin config_func, VSRegis
     register_func
     (
         "LWLibavSource",
-        "source:data;stream_index:int:opt;cache:int:opt;cachefile:data:opt;" COMMON_OPTS "repeat:int:opt;dominance:int:opt;ff_loglevel:int:opt;cachedir:data:opt;soft_reset:int:opt;framelist:int:opt;",
+        "source:data;stream_index:int:opt;cache:int:opt;cachefile:data:opt;" COMMON_OPTS "repeat:int:opt;dominance:int:opt;ff_loglevel:int:opt;cachedir:data:opt;soft_reset:int:opt;framelist:int:opt;stats:int:opt;packet_cache:int:opt;buffer:data:opt;streaming:int:opt;frames:int:opt;lookback:int:opt;thread_switch:int:opt;thread_budget:int:opt;keyframes:int:opt;preview:int:opt;output_threads:int:opt;mmap:int:opt;",
         vs_lwlibavsource_create,
         NULL,
         plugin
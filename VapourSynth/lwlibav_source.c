@@ -70,6 +70,7 @@ void lw_cleanup_audio_output_handler( lw_audio_output_handler_t *aohp ){ }
 #endif
 
 #include <stdio.h>
+#include <limits.h>
 #include <string.h>
 #include "lsmashsource.h"
 #include "video_output.h"
@@ -80,6 +81,7 @@ void lw_cleanup_audio_output_handler( lw_audio_output_handler_t *aohp ){ }
 #include "../common/lwlibav_video_internal.h"
 #include "../common/lwlibav_audio.h"
 #include "../common/lwindex.h"
+#include "../common/lwthreads.h"
 
 typedef struct
 {
@@ -91,6 +93,12 @@ typedef struct
     lwlibav_audio_output_handler_t *aohp;
     char preferred_decoder_names_buf[PREFERRED_DECODER_NAMES_BUFSIZE];
     int64_t framelist;
+    int64_t stats;
+    int64_t keyframes;
+    /* the source on memory given by 'buffer' */
+    uint8_t          *buffer;
+    lw_io_memory_t    memory;
+    lw_io_callbacks_t io_callbacks;
 } lwlibav_handler_t;
 
 /* Deallocate the handler of this plugin. */
@@ -108,6 +116,7 @@ static void free_handler
     lwlibav_audio_free_decode_handler( hp->adhp );
     lwlibav_audio_free_output_handler( hp->aohp );
     lw_free( hp->lwh.file_path );
+    lw_free( hp->buffer );
     lw_free( hp );
 }
 
@@ -157,20 +166,59 @@ static void VS_CC vs_filter_init( VSMap *in, VSMap *out, void **instance_data, V
 
 static void set_frame_properties
 (
-    int          n,
-    VSVideoInfo *vi,
-    AVFrame     *av_frame,
-    AVStream    *stream,
-    VSFrameRef  *vs_frame,
-    int          top,
-    int          bottom,
-    const VSAPI *vsapi
+    int                        n,
+    VSVideoInfo               *vi,
+    AVFrame                   *av_frame,
+    const vs_hdr_properties_t *stream_hdr,
+    VSFrameRef                *vs_frame,
+    int                        top,
+    int                        bottom,
+    const VSAPI               *vsapi
 )
 {
     /* Variable Frame Rate is not supported yet. */
     int64_t duration_num = vi->fpsDen;
     int64_t duration_den = vi->fpsNum;
-    vs_set_frame_properties( n, av_frame, stream, duration_num, duration_den, vs_frame, top, bottom, vsapi );
+    vs_set_frame_properties( n, av_frame, stream_hdr, duration_num, duration_den, vs_frame, top, bottom, vsapi );
+}
+
+static void set_source_frame_properties
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    uint32_t                        frame_number,
+    VSFrameRef                     *vs_frame,
+    const VSAPI                    *vsapi
+)
+{
+    uint32_t source_frame_number;
+    double   source_time;
+    lwlibav_video_get_source_frame_info( vdhp, frame_number, &source_frame_number, &source_time );
+    VSMap *props = vsapi->getFramePropsRW( vs_frame );
+    vsapi->propSetInt( props, "_LwSourceFrame", (int64_t)source_frame_number - 1, paReplace );
+    if( source_time >= 0.0 )
+        vsapi->propSetFloat( props, "_AbsoluteTime", source_time, paReplace );
+}
+
+static void set_stats_properties
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    VSFrameRef                     *vs_frame,
+    const VSAPI                    *vsapi
+)
+{
+    lwlibav_video_stats_t stats;
+    lwlibav_video_get_stats( vdhp, &stats );
+    VSMap *props = vsapi->getFramePropsRW( vs_frame );
+    vsapi->propSetInt( props, "_LwDecodeCost",  stats.decode_cost,  paReplace );
+    vsapi->propSetInt( props, "_LwSeekCost",    stats.seek_cost,    paReplace );
+    vsapi->propSetInt( props, "_LwForwardCost", stats.forward_cost, paReplace );
+    vsapi->propSetInt( props, "_LwReseekCost",  stats.reseek_cost,  paReplace );
+    vsapi->propSetInt( props, "_LwSeeked",      stats.seeked,       paReplace );
+    vsapi->propSetInt( props, "_LwReadCount",   stats.read_count,   paReplace );
+    vsapi->propSetInt( props, "_LwReadBytes",   stats.read_bytes,   paReplace );
+    vsapi->propSetInt( props, "_LwSeekCount",   stats.seek_count,   paReplace );
+    vsapi->propSetInt( props, "_LwThreadMode",  stats.thread_mode,  paReplace );
+    vsapi->propSetInt( props, "_LwThreadSwitchThreshold", stats.thread_switch_threshold, paReplace );
 }
 
 static int prepare_video_decoding
@@ -209,17 +257,13 @@ static int prepare_video_decoding
         set_error_on_init( out, vsapi, "lsmas: failed to allocate the first valid video frame." );
         return -1;
     }
+    vs_get_stream_hdr_properties( &vs_vohp->stream_hdr, vdhp->format->streams[vdhp->stream_index] );
     if( (av_pix_fmt_desc_get( ctx->pix_fmt )->flags & AV_PIX_FMT_FLAG_ALPHA)
      && hp->vi[0].format )
     {
         hp->vi[1] = hp->vi[0];
         hp->vi[1].format = vsapi->registerFormat( cmGray, hp->vi[0].format->sampleType, hp->vi[0].format->bitsPerSample, 0, 0, core );
-        vs_vohp->background_frame[1] = vsapi->newVideoFrame( hp->vi[1].format, hp->vi[1].width, hp->vi[1].height, NULL, core );
-        if( !vs_vohp->background_frame[1] )
-        {
-            set_error_on_init( out, vsapi, "lsmas: failed to allocate memory for the alpha frame data." );
-            return -1;
-        }
+        vs_vohp->output_format[1] = hp->vi[1].format;
     }
     /* Force seeking at the first reading. */
     lwlibav_video_force_seek( vdhp );
@@ -261,28 +305,12 @@ static const VSFrameRef *VS_CC vs_filter_get_frame( int n, int activation_reason
     /* Output the video frame. */
     AVFrame    *av_frame = lwlibav_video_get_frame_buffer( vdhp );
     int output_index = vsapi->getOutputIndex( frame_ctx );
-    VSFrameRef *vs_frame = make_frame( vohp, av_frame, output_index );
+    VSFrameRef *vs_frame = make_output_frame( vohp, av_frame, n, output_index );
     if( !vs_frame )
     {
         vsapi->setFilterError( "lsmas: failed to output a video frame.", frame_ctx );
         return NULL;
     }
-    AVCodecContext *ctx = lwlibav_video_get_codec_context( vdhp );
-    if ( output_index == 0 && ( av_pix_fmt_desc_get( ctx->pix_fmt )->flags & AV_PIX_FMT_FLAG_ALPHA ) )
-    {
-        /* api4 compat: save alpha clip into the _Alpha property */
-        VSFrameRef *vs_frame2 = make_frame( vohp, av_frame, 1 );
-        if( !vs_frame2 )
-        {
-            vsapi->setFilterError( "lsmas: failed to output an alpha video frame.", frame_ctx );
-            return NULL;
-        }
-        VSMap *props = vsapi->getFramePropsRW( vs_frame2 );
-        vsapi->propSetInt( props, "_ColorRange", 0, paReplace ); // alpha clip always full range
-        props = vsapi->getFramePropsRW( vs_frame );
-        vsapi->propSetFrame( props, "_Alpha", vs_frame2, paAppend );
-        vsapi->freeFrame( vs_frame2 );
-    }
     int top = -1;
     if ( vohp->repeat_control && vohp->repeat_requested )
     {
@@ -295,8 +323,12 @@ static const VSFrameRef *VS_CC vs_filter_get_frame( int n, int activation_reason
         bottom = ( vohp->frame_order_list[n].bottom == vohp->frame_order_list[frame_number].bottom ) ? vohp->frame_order_list[n - 1].bottom :
             vohp->frame_order_list[n].bottom;
     }
-    set_frame_properties( n, vi, av_frame, vdhp->format->streams[vdhp->stream_index], vs_frame, top, bottom,vsapi );
-    if ( n == 0 && hp->framelist )
+    set_frame_properties( n, vi, av_frame, &vs_vohp->stream_hdr, vs_frame, top, bottom, vsapi );
+    if( hp->keyframes )
+        set_source_frame_properties( vdhp, frame_number, vs_frame, vsapi );
+    if( hp->stats )
+        set_stats_properties( vdhp, vs_frame, vsapi );
+    if ( n == 0 && hp->framelist && hp->vdhp->frame_list )
     {
         const char *ftype = "IPB";
         int cnt[3] = {0, 0, 0};
@@ -384,6 +416,15 @@ void VS_CC vs_lwlibavsource_create( const VSMap *in, VSMap *out, void *user_data
     int64_t field_dominance;
     int64_t ff_loglevel;
     int64_t soft_reset;
+    int64_t packet_cache;
+    int64_t streaming;
+    int64_t frames;
+    int64_t lookback;
+    int64_t thread_switch;
+    int64_t thread_budget;
+    int64_t preview;
+    int64_t output_threads;
+    int64_t use_mmap;
     const char *index_file_path;
     const char *format;
     const char *preferred_decoder_names;
@@ -392,9 +433,9 @@ void VS_CC vs_lwlibavsource_create( const VSMap *in, VSMap *out, void *user_data
     set_option_int64 ( &threads,                 0,    "threads",        in, vsapi );
     set_option_int64 ( &cache_index,             1,    "cache",          in, vsapi );
     set_option_int64 ( &seek_mode,               0,    "seek_mode",      in, vsapi );
-    set_option_int64 ( &seek_threshold,          10,   "seek_threshold", in, vsapi );
+    set_option_int64 ( &seek_threshold,          -1,   "seek_threshold", in, vsapi );
     set_option_int64 ( &variable_info,           0,    "variable",       in, vsapi );
-    set_option_int64 ( &direct_rendering,        0,    "dr",             in, vsapi );
+    set_option_int64 ( &direct_rendering,        -1,   "dr",             in, vsapi );
     set_option_int64 ( &fps_num,                 0,    "fpsnum",         in, vsapi );
     set_option_int64 ( &fps_den,                 1,    "fpsden",         in, vsapi );
     set_option_int64 ( &prefer_hw_decoder,       0,    "prefer_hw",      in, vsapi );
@@ -403,11 +444,40 @@ void VS_CC vs_lwlibavsource_create( const VSMap *in, VSMap *out, void *user_data
     set_option_int64 ( &ff_loglevel,             0,    "ff_loglevel",    in, vsapi );
     set_option_int64 ( &soft_reset,              1,    "soft_reset",     in, vsapi );
     set_option_int64 ( &hp->framelist,           0,    "framelist",      in, vsapi );
+    set_option_int64 ( &hp->stats,               0,    "stats",          in, vsapi );
+    set_option_int64 ( &hp->keyframes,           0,    "keyframes",      in, vsapi );
+    set_option_int64 ( &packet_cache,            64,   "packet_cache",   in, vsapi );
+    set_option_int64 ( &streaming,               0,    "streaming",      in, vsapi );
+    set_option_int64 ( &frames,                  0,    "frames",         in, vsapi );
+    set_option_int64 ( &lookback,                16,   "lookback",       in, vsapi );
+    set_option_int64 ( &thread_switch,           0,    "thread_switch",  in, vsapi );
+    set_option_int64 ( &thread_budget,           -1,   "thread_budget",  in, vsapi );
+    set_option_int64 ( &preview,                 0,    "preview",        in, vsapi );
+    set_option_int64 ( &output_threads,          0,    "output_threads", in, vsapi );
+    set_option_int64 ( &use_mmap,                0,    "mmap",           in, vsapi );
     set_option_string( &index_file_path,         NULL, "cachefile",      in, vsapi );
     set_option_string( &format,                  NULL, "format",         in, vsapi );
     set_option_string( &preferred_decoder_names, NULL, "decoder",        in, vsapi );
     set_option_string( &cache_dir,               DEFAULT_CACHEDIR,  "cachedir",       in, vsapi );
     set_preferred_decoder_names_on_buf( hp->preferred_decoder_names_buf, preferred_decoder_names );
+    /* Read the source from memory instead of the file if given. */
+    int buffer_error;
+    const char *buffer = vsapi->propGetData( in, "buffer", 0, &buffer_error );
+    if( !buffer_error )
+    {
+        int buffer_size = vsapi->propGetDataSize( in, "buffer", 0, NULL );
+        hp->buffer = (uint8_t *)lw_malloc_zero( MAX( buffer_size, 1 ) );
+        if( !hp->buffer )
+        {
+            free_handler( &hp );
+            vsapi->setError( out, "lsmas: failed to allocate the source buffer." );
+            return;
+        }
+        memcpy( hp->buffer, buffer, buffer_size );
+        hp->memory.data = hp->buffer;
+        hp->memory.size = buffer_size;
+        lw_io_set_memory_callbacks( &hp->io_callbacks, &hp->memory );
+    }
     /* Set options. */
     lwlibav_option_t opt;
     opt.file_path         = file_path;
@@ -425,13 +495,23 @@ void VS_CC vs_lwlibavsource_create( const VSMap *in, VSMap *out, void *user_data
     opt.vfr2cfr.active    = fps_num > 0 && fps_den > 0 ? 1 : 0;
     opt.vfr2cfr.fps_num   = fps_num;
     opt.vfr2cfr.fps_den   = fps_den;
+    opt.io_callbacks      = hp->buffer ? &hp->io_callbacks : NULL;
+    opt.io_flags          = use_mmap ? LW_IO_FLAG_MMAP : 0;
     lwlibav_video_set_seek_mode              ( vdhp, CLIP_VALUE( seek_mode,      0, 2 ) );
-    lwlibav_video_set_forward_seek_threshold ( vdhp, CLIP_VALUE( seek_threshold, 1, 999 ) );
+    /* A negative seek_threshold lets the decoder decide by the measured seek and decoding costs. */
+    lwlibav_video_set_adaptive_seek          ( vdhp, seek_threshold < 0 );
+    lwlibav_video_set_forward_seek_threshold ( vdhp, seek_threshold < 0 ? 10 : CLIP_VALUE( seek_threshold, 1, 999 ) );
     lwlibav_video_set_preferred_decoder_names( vdhp, tokenize_preferred_decoder_names( hp->preferred_decoder_names_buf ) );
     lwlibav_video_set_prefer_hw_decoder      ( vdhp, CLIP_VALUE( prefer_hw_decoder, 0, 3 ) );
     lwlibav_video_set_soft_reset             ( vdhp, CLIP_VALUE( soft_reset, 0, 1 ) );
+    lwlibav_video_set_packet_cache_size      ( vdhp, (size_t)CLIP_VALUE( packet_cache, 0, 4096 ) << 20 );
+    lwlibav_video_set_thread_switch_threshold( vdhp, (uint32_t)CLIP_VALUE( thread_switch, 0, UINT32_MAX ) );
+    lwlibav_video_set_preview                ( vdhp, (int)CLIP_VALUE( preview, 0, 4 ) );
+    if( thread_budget >= 0 )
+        lw_thread_budget_set_max_threads( (int)MIN( thread_budget, 1024 ) );
+    vohp->scaler.threads = (int)CLIP_VALUE( output_threads, 0, 64 );
     vs_vohp->variable_info          = CLIP_VALUE( variable_info,     0, 1 );
-    vs_vohp->direct_rendering       = CLIP_VALUE( direct_rendering,  0, 1 ) && !format;
+    vs_vohp->direct_rendering       = direct_rendering < 0 ? -1 : CLIP_VALUE( direct_rendering,  0, 1 ) && !format;
     vs_vohp->vs_output_pixel_format = vs_vohp->variable_info ? pfNone : get_vs_output_pixel_format( format );
     if( ff_loglevel <= 0 )
         av_log_set_level( AV_LOG_QUIET );
@@ -456,39 +536,76 @@ void VS_CC vs_lwlibavsource_create( const VSMap *in, VSMap *out, void *user_data
     indicator.open   = NULL;
     indicator.update = update_indicator;
     indicator.close  = close_indicator;
-    /* Construct index. */
-    int ret = lwlibav_construct_index( lwhp, vdhp, vohp, hp->adhp, hp->aohp, &lh, &opt, &indicator, NULL );
-    lwlibav_audio_free_decode_handler_ptr( &hp->adhp );
-    lwlibav_audio_free_output_handler_ptr( &hp->aohp );
-    if( ret < 0 )
-    {
-        free_handler( &hp );
-        set_error_on_init( out, vsapi, "lsmas: failed to construct index for %s.", opt.file_path );
-        return;
-    }
-    /* Eliminate silent failure: if apply_repeat_flag == 1, then fail if repeat is not applied. */
-    if ( opt.apply_repeat_flag == 1 )
+    if( streaming )
     {
-        if ( vohp->repeat_requested && !vohp->repeat_control )
+        /* The frame rate conversion and the repeat flags need the index, so refuse them instead of ignoring.
+         * 'repeat' is refused only if given explicitly since it is on by default. */
+        if( opt.vfr2cfr.active || (apply_repeat_flag && vsapi->propNumElements( in, "repeat" ) > 0) )
+        {
+            free_handler( &hp );
+            set_error_on_init( out, vsapi, "lsmas: %s is not available in the streaming mode.",
+                               opt.vfr2cfr.active ? "'fpsnum'" : "'repeat'" );
+            return;
+        }
+        /* Open the source without the index and decode it strictly forward. */
+        lwlibav_audio_free_decode_handler_ptr( &hp->adhp );
+        lwlibav_audio_free_output_handler_ptr( &hp->aohp );
+        lwlibav_video_set_log_handler( vdhp, &lh );
+        lwlibav_video_set_stream_lookback( vdhp, CLIP_VALUE( lookback, 1, 1024 ) );
+        if( lwlibav_video_open_stream( file_path, opt.io_callbacks, opt.io_flags, vdhp, vohp, stream_index, CLIP_VALUE( frames, 0, INT_MAX ), opt.threads ) < 0 )
         {
             free_handler( &hp );
-            set_error_on_init( out, vsapi, "lsmas: repeat requested for %d frames by input video, but unable to obey (try repeat=0 to get a VFR clip).", vohp->repeat_requested );
+            set_error_on_init( out, vsapi, "lsmas: failed to open %s in the streaming mode.", file_path );
             return;
         }
     }
-    /* Get the desired video track. */
-    lwlibav_video_set_log_handler( vdhp, &lh );
-    if( lwlibav_video_get_desired_track( lwhp->file_path, vdhp, lwhp->threads ) < 0 )
+    else
     {
-        free_handler( &hp );
-        vsapi->setError( out, "lsmas: failed to get video track." );
-        return;
+        /* Construct index. */
+        int ret = lwlibav_construct_index( lwhp, vdhp, vohp, hp->adhp, hp->aohp, &lh, &opt, &indicator, NULL );
+        lwlibav_audio_free_decode_handler_ptr( &hp->adhp );
+        lwlibav_audio_free_output_handler_ptr( &hp->aohp );
+        if( ret < 0 )
+        {
+            free_handler( &hp );
+            set_error_on_init( out, vsapi, "lsmas: failed to construct index for %s.", opt.file_path );
+            return;
+        }
+        /* Eliminate silent failure: if apply_repeat_flag == 1, then fail if repeat is not applied. */
+        if ( opt.apply_repeat_flag == 1 )
+        {
+            if ( vohp->repeat_requested && !vohp->repeat_control )
+            {
+                free_handler( &hp );
+                set_error_on_init( out, vsapi, "lsmas: repeat requested for %d frames by input video, but unable to obey (try repeat=0 to get a VFR clip).", vohp->repeat_requested );
+                return;
+            }
+        }
+        /* Get the desired video track. */
+        lwlibav_video_set_log_handler( vdhp, &lh );
+        if( lwlibav_video_get_desired_track( lwhp->file_path, vdhp, lwhp->threads ) < 0 )
+        {
+            free_handler( &hp );
+            vsapi->setError( out, "lsmas: failed to get video track." );
+            return;
+        }
     }
     /* Set average framerate. */
     hp->vi[0].numFrames = vohp->frame_count;
     hp->vi[0].fpsNum    = 25;
     hp->vi[0].fpsDen    = 1;
     lwlibav_video_setup_timestamp_info( lwhp, vdhp, vohp, &hp->vi[0].fpsNum, &hp->vi[0].fpsDen, opt.apply_repeat_flag );
+    if( hp->keyframes )
+    {
+        /* Output only keyframes. The frame rate is kept as the one of the whole stream. */
+        if( lwlibav_video_setup_keyframe_only( vdhp, vohp ) < 0 )
+        {
+            free_handler( &hp );
+            set_error_on_init( out, vsapi, "lsmas: failed to set up the keyframe-only mode for %s.", file_path );
+            return;
+        }
+        hp->vi[0].numFrames = vohp->frame_count;
+    }
     /* Set up decoders for this stream. */
     if( prepare_video_decoding( hp, out, core, vsapi ) < 0 )
     {
@@ -37,74 +37,76 @@
 
 #include "lsmashsource.h"
 #include "video_output.h"
+#include "../common/lwconvert.h"
 #include <VSHelper.h>
 
-#include <emmintrin.h>
-
 typedef struct
 {
     uint8_t *data    [4];
     int      linesize[4];
 } vs_picture_t;
 
-static inline __m128i _MM_PACKUS_EPI32( const __m128i *low, const __m128i *high )
-{
-    const __m128i val_32 = _mm_set1_epi32( 0x8000 );
-    const __m128i val_16 = _mm_set1_epi16( 0x8000 );
-    const __m128i low1   = _mm_sub_epi32( *low, val_32 );
-    const __m128i high1  = _mm_sub_epi32( *high, val_32 );
-    return _mm_add_epi16( _mm_packs_epi32( low1, high1 ), val_16 );
-}
-
-static void make_black_background_planar_yuv8
+/* Fill the plane out of the picture of width x height placed at the top-left corner with 'value'. */
+static void fill_plane_border
 (
     VSFrameRef  *vs_frame,
+    int          plane,
+    int          width,
+    int          height,
+    int          value,
     const VSAPI *vsapi
 )
 {
-    for( int i = 0; i < 3; i++ )
-        memset( vsapi->getWritePtr( vs_frame, i ), i ? 0x80 : 0x00, vsapi->getStride( vs_frame, i ) * vsapi->getFrameHeight( vs_frame, i ) );
+    const VSFormat *format = vsapi->getFrameFormat( vs_frame );
+    if( plane )
+    {
+        width  = AV_CEIL_RSHIFT( width,  format->subSamplingW );
+        height = AV_CEIL_RSHIFT( height, format->subSamplingH );
+    }
+    uint32_t pattern = format->bytesPerSample == 2 ? (uint32_t)value * 0x00010001U : (uint32_t)value * 0x01010101U;
+    lw_fill_plane_border( vsapi->getWritePtr( vs_frame, plane ),
+                          vsapi->getStride( vs_frame, plane ),
+                          vsapi->getFrameWidth( vs_frame, plane ) * format->bytesPerSample,
+                          vsapi->getFrameHeight( vs_frame, plane ),
+                          width * format->bytesPerSample,
+                          height,
+                          pattern );
 }
 
-static void make_black_background_planar_yuv16
+static void make_black_background_planar_yuv
 (
     VSFrameRef  *vs_frame,
+    int          width,
+    int          height,
     const VSAPI *vsapi
 )
 {
     int shift = vsapi->getFrameFormat( vs_frame )->bitsPerSample - 8;
     for( int i = 0; i < 3; i++ )
-    {
-        int v = i ? 0x00000080 << shift : 0x00000000;
-        uint8_t *data = vsapi->getWritePtr( vs_frame, i );
-        uint8_t *end  = data + vsapi->getStride( vs_frame, i ) * vsapi->getFrameHeight( vs_frame, i );
-        while( data < end )
-        {
-            /* Assume little endianess. */
-            data[0] = v;
-            data[1] = v >> 8;
-            data += 2;
-        }
-    }
+        fill_plane_border( vs_frame, i, width, height, i ? 0x80 << shift : 0x00, vsapi );
 }
 
 static void make_black_background_planar_gray
 (
     VSFrameRef  *vs_frame,
+    int          width,
+    int          height,
     const VSAPI *vsapi
 )
 {
-    memset( vsapi->getWritePtr( vs_frame, 0 ), 0x00, vsapi->getStride( vs_frame, 0 ) * vsapi->getFrameHeight( vs_frame, 0 ) );
+    fill_plane_border( vs_frame, 0, width, height, 0x00, vsapi );
 }
 
 static void make_black_background_planar_rgb
 (
     VSFrameRef  *vs_frame,
+    int          width,
+    int          height,
     const VSAPI *vsapi
 )
 {
     for( int i = 0; i < 3; i++ )
-        memset( vsapi->getWritePtr( vs_frame, i ), 0x00, vsapi->getStride( vs_frame, i ) * vsapi->getFrameHeight( vs_frame, i ) );
+        fill_plane_border( vs_frame, i, width, height, 0x00, vsapi );
 }
 
 static void make_frame_planar_yuv
@@ -134,61 +136,7 @@ static void make_frame_planar_yuv
             0
         }
     };
-    if( vshp->input_pixel_format == AV_PIX_FMT_P010LE && vshp->output_pixel_format == AV_PIX_FMT_YUV420P10LE )
-    {
-        const int width_y       = vsapi->getFrameWidth( vs_frame, 0 );
-        const int width_uv      = vsapi->getFrameWidth( vs_frame, 1 );
-        const int height_y      = vsapi->getFrameHeight( vs_frame, 0 );
-        const int height_uv     = vsapi->getFrameHeight( vs_frame, 1 );
-        const int src_stride_y  = av_picture->linesize[0] / sizeof( uint16_t );
-        const int src_stride_uv = av_picture->linesize[1] / sizeof( uint16_t );
-        const int dst_stride_y  = vs_picture.linesize[0] / sizeof( uint16_t );
-        const int dst_stride_uv = vs_picture.linesize[1] / sizeof( uint16_t );
-        uint16_t *srcp_y        = (uint16_t *)av_picture->data[0];
-        uint16_t *srcp_uv       = (uint16_t *)av_picture->data[1];
-        uint16_t *dstp_y        = (uint16_t *)vs_picture.data[0];
-        uint16_t *dstp_u        = (uint16_t *)vs_picture.data[1];
-        uint16_t *dstp_v        = (uint16_t *)vs_picture.data[2];
-
-        for( int y = 0; y < height_y; y++ )
-        {
-            for( int x = 0; x < width_y; x += 8 )
-            {
-                __m128i yy = _mm_load_si128( (const __m128i *)(srcp_y + x) );
-                yy         = _mm_srli_epi16( yy, 6 );
-                _mm_stream_si128( (__m128i *)(dstp_y + x), yy );
-            }
-            srcp_y += src_stride_y;
-            dstp_y += dst_stride_y;
-        }
-
-        const __m128i mask = _mm_set1_epi32(0x0000FFFF);
-        for( int y = 0; y < height_uv; y++ )
-        {
-            for( int x = 0; x < width_uv; x += 8 )
-            {
-                __m128i uv_low  = _mm_load_si128( (__m128i *)((uint32_t *)srcp_uv + x + 0) );
-                __m128i uv_high = _mm_load_si128( (__m128i *)((uint32_t *)srcp_uv + x + 4) );
-
-                __m128i u_low  = _mm_and_si128( uv_low, mask );
-                __m128i u_high = _mm_and_si128( uv_high, mask );
-                __m128i u      = _MM_PACKUS_EPI32( &u_low, &u_high );
-                u              = _mm_srli_epi16( u, 6 );
-                _mm_stream_si128( (__m128i *)(dstp_u + x), u );
-
-                __m128i v_low  = _mm_srli_epi32( uv_low, 16 );
-                __m128i v_high = _mm_srli_epi32( uv_high, 16 );
-                __m128i v      = _MM_PACKUS_EPI32( &v_low, &v_high );
-                v              = _mm_srli_epi16( v, 6 );
-                _mm_stream_si128( (__m128i *)(dstp_v + x), v );
-            }
-            srcp_uv += src_stride_uv;
-            dstp_u  += dst_stride_uv;
-            dstp_v  += dst_stride_uv;
-        }
-    }
-    else
-        sws_scale( vshp->sws_ctx, (const uint8_t* const*)av_picture->data, av_picture->linesize, 0, av_picture->height, vs_picture.data, vs_picture.linesize );
+    convert_video_picture( vshp, av_picture, vs_picture.data, vs_picture.linesize );
 }
 
 static void make_frame_planar_gray
@@ -218,7 +166,7 @@ static void make_frame_planar_gray
             0
         }
     };
-    sws_scale( vshp->sws_ctx, (const uint8_t* const*)av_picture->data, av_picture->linesize, 0, av_picture->height, vs_picture.data, vs_picture.linesize );
+    convert_video_picture( vshp, av_picture, vs_picture.data, vs_picture.linesize );
 }
 
 static void make_frame_planar_rgb
@@ -249,7 +197,7 @@ static void make_frame_planar_rgb
         }
 
     };
-    sws_scale( vshp->sws_ctx, (const uint8_t* const*)av_picture->data, av_picture->linesize, 0, av_picture->height, vs_picture.data, vs_picture.linesize );
+    convert_video_picture( vshp, av_picture, vs_picture.data, vs_picture.linesize );
 }
 
 static void make_frame_planar_alpha
@@ -280,22 +228,13 @@ static void make_frame_planar_alpha8
     const VSAPI               *vsapi
 )
 {
-    uint8_t *vs_frame_data = vsapi->getWritePtr( vs_frame, 0 );
-    int vs_frame_linesize = vsapi->getStride( vs_frame, 0 );
-    int vs_pixel_offset   = 0;
-    int av_pixel_offset   = 0;
-    for( int i = 0; i < av_picture->height; i++ )
-    {
-        uint8_t *av_pixel = av_picture->data[0] + av_pixel_offset + component_reorder[3];
-        uint8_t *vs_pixel = vs_frame_data + vs_pixel_offset;
-        for( int j = 0; j < av_picture->width; j++ )
-        {
-            *(vs_pixel++) = *av_pixel;
-            av_pixel += 4;
-        }
-        av_pixel_offset += av_picture->linesize[0];
-        vs_pixel_offset += vs_frame_linesize;
-    }
+    lw_extract_packed_component8( vsapi->getWritePtr( vs_frame, 0 ),
+                                  vsapi->getStride( vs_frame, 0 ),
+                                  av_picture->data[0],
+                                  av_picture->linesize[0],
+                                  av_picture->width,
+                                  av_picture->height,
+                                  component_reorder[3] );
 }
 
 static void make_frame_planar_alpha16
@@ -308,23 +247,14 @@ static void make_frame_planar_alpha16
     const VSAPI               *vsapi
 )
 {
-    uint8_t *vs_frame_data = vsapi->getWritePtr( vs_frame, 0 );
-    int vs_frame_linesize = vsapi->getStride( vs_frame, 0 );
-    int vs_pixel_offset   = 0;
-    int av_pixel_offset   = 0;
-    const int be = component_reorder_is_bigendian(component_reorder[3]);
-    for( int i = 0; i < av_picture->height; i++ )
-    {
-        uint16_t *av_pixel = (uint16_t *)(av_picture->data[0] + av_pixel_offset) + component_reorder_get_order(component_reorder[3]);
-        uint16_t *vs_pixel = (uint16_t *)(vs_frame_data + vs_pixel_offset);
-        for( int j = 0; j < av_picture->width; j++ )
-        {
-            *(vs_pixel++) = be ? ((*av_pixel >> 8) | ((*av_pixel & 0xff) << 8)) : *av_pixel;
-            av_pixel += 4;
-        }
-        av_pixel_offset += av_picture->linesize[0];
-        vs_pixel_offset += vs_frame_linesize;
-    }
+    lw_extract_packed_component16( vsapi->getWritePtr( vs_frame, 0 ),
+                                   vsapi->getStride( vs_frame, 0 ),
+                                   av_picture->data[0],
+                                   av_picture->linesize[0],
+                                   av_picture->width,
+                                   av_picture->height,
+                                   component_reorder_get_order( component_reorder[3] ),
+                                   component_reorder_is_bigendian( component_reorder[3] ) );
 }
 
 VSPresetFormat get_vs_output_pixel_format( const char *format_name )
@@ -513,51 +443,51 @@ static inline int set_frame_maker
         func_make_frame            *func_make_frame;
     } frame_maker_table[] =
         {
-            { pfYUV420P8,  0, make_black_background_planar_yuv8,  make_frame_planar_yuv     },
-            { pfYUV422P8,  0, make_black_background_planar_yuv8,  make_frame_planar_yuv     },
-            { pfYUV444P8,  0, make_black_background_planar_yuv8,  make_frame_planar_yuv     },
-            { pfYUV410P8,  0, make_black_background_planar_yuv8,  make_frame_planar_yuv     },
-            { pfYUV411P8,  0, make_black_background_planar_yuv8,  make_frame_planar_yuv     },
-            { pfYUV440P8,  0, make_black_background_planar_yuv8,  make_frame_planar_yuv     },
-            { pfYUV420P9,  0, make_black_background_planar_yuv16, make_frame_planar_yuv     },
-            { pfYUV422P9,  0, make_black_background_planar_yuv16, make_frame_planar_yuv     },
-            { pfYUV444P9,  0, make_black_background_planar_yuv16, make_frame_planar_yuv     },
-            { pfYUV420P10, 0, make_black_background_planar_yuv16, make_frame_planar_yuv     },
-            { pfYUV422P10, 0, make_black_background_planar_yuv16, make_frame_planar_yuv     },
-            { pfYUV444P10, 0, make_black_background_planar_yuv16, make_frame_planar_yuv     },
-            { pfYUV420P12, 0, make_black_background_planar_yuv16, make_frame_planar_yuv     },
-            { pfYUV422P12, 0, make_black_background_planar_yuv16, make_frame_planar_yuv     },
-            { pfYUV444P12, 0, make_black_background_planar_yuv16, make_frame_planar_yuv     },
-            { pfYUV420P14, 0, make_black_background_planar_yuv16, make_frame_planar_yuv     },
-            { pfYUV422P14, 0, make_black_background_planar_yuv16, make_frame_planar_yuv     },
-            { pfYUV444P14, 0, make_black_background_planar_yuv16, make_frame_planar_yuv     },
-            { pfYUV420P16, 0, make_black_background_planar_yuv16, make_frame_planar_yuv     },
-            { pfYUV422P16, 0, make_black_background_planar_yuv16, make_frame_planar_yuv     },
-            { pfYUV444P16, 0, make_black_background_planar_yuv16, make_frame_planar_yuv     },
-            { pfYUV420P8,  1, NULL,                               make_frame_planar_alpha   },
-            { pfYUV422P8,  1, NULL,                               make_frame_planar_alpha   },
-            { pfYUV444P8,  1, NULL,                               make_frame_planar_alpha   },
-            { pfYUV420P9,  1, NULL,                               make_frame_planar_alpha   },
-            { pfYUV422P9,  1, NULL,                               make_frame_planar_alpha   },
-            { pfYUV444P9,  1, NULL,                               make_frame_planar_alpha   },
-            { pfYUV420P10, 1, NULL,                               make_frame_planar_alpha   },
-            { pfYUV422P10, 1, NULL,                               make_frame_planar_alpha   },
-            { pfYUV444P10, 1, NULL,                               make_frame_planar_alpha   },
-            { pfYUV422P12, 1, NULL,                               make_frame_planar_alpha   },
-            { pfYUV444P12, 1, NULL,                               make_frame_planar_alpha   },
-            { pfYUV420P16, 1, NULL,                               make_frame_planar_alpha   },
-            { pfYUV422P16, 1, NULL,                               make_frame_planar_alpha   },
-            { pfYUV444P16, 1, NULL,                               make_frame_planar_alpha   },
-            { pfGray8,     0, make_black_background_planar_gray,  make_frame_planar_gray    },
-            { pfGray16,    0, make_black_background_planar_gray,  make_frame_planar_gray    },
-            { pfRGB24,     0, make_black_background_planar_rgb,   make_frame_planar_rgb     },
-            { pfRGB27,     0, make_black_background_planar_rgb,   make_frame_planar_rgb     },
-            { pfRGB30,     0, make_black_background_planar_rgb,   make_frame_planar_rgb     },
-            { pfRGB48,     0, make_black_background_planar_rgb,   make_frame_planar_rgb     },
-            { pfRGB24,     1, NULL,                               make_frame_planar_alpha8  },
-            { pfRGB30,     1, NULL,                               make_frame_planar_alpha16 },
-            { pfRGB48,     1, NULL,                               make_frame_planar_alpha16 },
-            { pfNone,      0, NULL,                               NULL                      }
+            { pfYUV420P8,  0, make_black_background_planar_yuv,  make_frame_planar_yuv     },
+            { pfYUV422P8,  0, make_black_background_planar_yuv,  make_frame_planar_yuv     },
+            { pfYUV444P8,  0, make_black_background_planar_yuv,  make_frame_planar_yuv     },
+            { pfYUV410P8,  0, make_black_background_planar_yuv,  make_frame_planar_yuv     },
+            { pfYUV411P8,  0, make_black_background_planar_yuv,  make_frame_planar_yuv     },
+            { pfYUV440P8,  0, make_black_background_planar_yuv,  make_frame_planar_yuv     },
+            { pfYUV420P9,  0, make_black_background_planar_yuv,  make_frame_planar_yuv     },
+            { pfYUV422P9,  0, make_black_background_planar_yuv,  make_frame_planar_yuv     },
+            { pfYUV444P9,  0, make_black_background_planar_yuv,  make_frame_planar_yuv     },
+            { pfYUV420P10, 0, make_black_background_planar_yuv,  make_frame_planar_yuv     },
+            { pfYUV422P10, 0, make_black_background_planar_yuv,  make_frame_planar_yuv     },
+            { pfYUV444P10, 0, make_black_background_planar_yuv,  make_frame_planar_yuv     },
+            { pfYUV420P12, 0, make_black_background_planar_yuv,  make_frame_planar_yuv     },
+            { pfYUV422P12, 0, make_black_background_planar_yuv,  make_frame_planar_yuv     },
+            { pfYUV444P12, 0, make_black_background_planar_yuv,  make_frame_planar_yuv     },
+            { pfYUV420P14, 0, make_black_background_planar_yuv,  make_frame_planar_yuv     },
+            { pfYUV422P14, 0, make_black_background_planar_yuv,  make_frame_planar_yuv     },
+            { pfYUV444P14, 0, make_black_background_planar_yuv,  make_frame_planar_yuv     },
+            { pfYUV420P16, 0, make_black_background_planar_yuv,  make_frame_planar_yuv     },
+            { pfYUV422P16, 0, make_black_background_planar_yuv,  make_frame_planar_yuv     },
+            { pfYUV444P16, 0, make_black_background_planar_yuv,  make_frame_planar_yuv     },
+            { pfYUV420P8,  1, make_black_background_planar_gray, make_frame_planar_alpha   },
+            { pfYUV422P8,  1, make_black_background_planar_gray, make_frame_planar_alpha   },
+            { pfYUV444P8,  1, make_black_background_planar_gray, make_frame_planar_alpha   },
+            { pfYUV420P9,  1, make_black_background_planar_gray, make_frame_planar_alpha   },
+            { pfYUV422P9,  1, make_black_background_planar_gray, make_frame_planar_alpha   },
+            { pfYUV444P9,  1, make_black_background_planar_gray, make_frame_planar_alpha   },
+            { pfYUV420P10, 1, make_black_background_planar_gray, make_frame_planar_alpha   },
+            { pfYUV422P10, 1, make_black_background_planar_gray, make_frame_planar_alpha   },
+            { pfYUV444P10, 1, make_black_background_planar_gray, make_frame_planar_alpha   },
+            { pfYUV422P12, 1, make_black_background_planar_gray, make_frame_planar_alpha   },
+            { pfYUV444P12, 1, make_black_background_planar_gray, make_frame_planar_alpha   },
+            { pfYUV420P16, 1, make_black_background_planar_gray, make_frame_planar_alpha   },
+            { pfYUV422P16, 1, make_black_background_planar_gray, make_frame_planar_alpha   },
+            { pfYUV444P16, 1, make_black_background_planar_gray, make_frame_planar_alpha   },
+            { pfGray8,     0, make_black_background_planar_gray, make_frame_planar_gray    },
+            { pfGray16,    0, make_black_background_planar_gray, make_frame_planar_gray    },
+            { pfRGB24,     0, make_black_background_planar_rgb,  make_frame_planar_rgb     },
+            { pfRGB27,     0, make_black_background_planar_rgb,  make_frame_planar_rgb     },
+            { pfRGB30,     0, make_black_background_planar_rgb,  make_frame_planar_rgb     },
+            { pfRGB48,     0, make_black_background_planar_rgb,  make_frame_planar_rgb     },
+            { pfRGB24,     1, make_black_background_planar_gray, make_frame_planar_alpha8  },
+            { pfRGB30,     1, make_black_background_planar_gray, make_frame_planar_alpha16 },
+            { pfRGB48,     1, make_black_background_planar_gray, make_frame_planar_alpha16 },
+            { pfNone,      0, NULL,                              NULL                      }
         };
     for( int i = 0; frame_maker_table[i].vs_output_pixel_format != pfNone; i++ )
         if( vs_vohp->vs_output_pixel_format == frame_maker_table[i].vs_output_pixel_format
@@ -737,7 +667,7 @@ typedef struct
 
 static VSFrameRef *new_output_video_frame
 (
-    vs_video_output_handler_t *vs_vohp,
+    lw_video_output_handler_t *vohp,
     const AVFrame             *av_frame,
     int                        output_index,
     enum AVPixelFormat        *output_pixel_format,
@@ -747,6 +677,7 @@ static VSFrameRef *new_output_video_frame
     const VSAPI               *vsapi
 )
 {
+    vs_video_output_handler_t *vs_vohp = (vs_video_output_handler_t *)vohp->private_handler;
     if( vs_vohp->variable_info )
     {
         if( !av_frame->opaque
@@ -761,7 +692,8 @@ static VSFrameRef *new_output_video_frame
          && input_pix_fmt_change
          && determine_colorspace_conversion( vs_vohp, output_index, av_frame->format, output_pixel_format ) < 0 )
             goto fail;
-        return vsapi->copyFrame( vs_vohp->background_frame[output_index], core );
+        /* The area out of the picture is filled by the caller if any. */
+        return vsapi->newVideoFrame( vs_vohp->output_format[output_index], vohp->output_width, vohp->output_height, NULL, core );
     }
 fail:
     if( frame_ctx )
@@ -789,19 +721,75 @@ VSFrameRef *make_frame
     }
     /* Make video frame.
      * Convert pixel format if needed. We don't change the presentation resolution. */
-    VSFrameRef *vs_frame = new_output_video_frame( vs_vohp, av_frame, output_index,
+    VSFrameRef *vs_frame = new_output_video_frame( vohp, av_frame, output_index,
                                                   &vshp->output_pixel_format,
                                                   !!(vshp->frame_prop_change_flags & LW_FRAME_PROP_CHANGE_FLAG_PIXEL_FORMAT),
                                                   frame_ctx, core, vsapi );
     if( !vs_vohp->make_frame[output_index] )
         return NULL;
     if( vs_frame )
+    {
         vs_vohp->make_frame[output_index]( vshp, av_frame, vs_vohp->component_reorder[output_index], vs_frame, frame_ctx, vsapi );
+        if( !vs_vohp->variable_info )
+            vs_vohp->make_black_background[output_index]( vs_frame, av_frame->width, av_frame->height, vsapi );
+    }
     else if( frame_ctx )
         vsapi->setFilterError( "lsmas: failed to allocate a output video frame.", frame_ctx );
     return vs_frame;
 }
 
+static const VSFrameRef *get_alpha_frame
+(
+    lw_video_output_handler_t *vohp,
+    AVFrame                   *av_frame,
+    int                        n
+)
+{
+    vs_video_output_handler_t *vs_vohp = (vs_video_output_handler_t *)vohp->private_handler;
+    const VSAPI *vsapi = vs_vohp->vsapi;
+    if( vs_vohp->alpha_frame && vs_vohp->alpha_frame_number == n )
+        return vs_vohp->alpha_frame;
+    VSFrameRef *alpha_frame = make_frame( vohp, av_frame, 1 );
+    if( !alpha_frame )
+        return NULL;
+    vsapi->propSetInt( vsapi->getFramePropsRW( alpha_frame ), "_ColorRange", 0, paReplace );   /* alpha clip always full range */
+    if( vs_vohp->alpha_frame )
+        vsapi->freeFrame( vs_vohp->alpha_frame );
+    vs_vohp->alpha_frame        = alpha_frame;
+    vs_vohp->alpha_frame_number = n;
+    return alpha_frame;
+}
+
+VSFrameRef *make_output_frame
+(
+    lw_video_output_handler_t *vohp,
+    AVFrame                   *av_frame,
+    int                        n,
+    int                        output_index
+)
+{
+    vs_video_output_handler_t *vs_vohp = (vs_video_output_handler_t *)vohp->private_handler;
+    const VSAPI *vsapi = vs_vohp->vsapi;
+    if( output_index == 1 )
+    {
+        /* The copy shares the planes with the cached frame and has its own properties. */
+        const VSFrameRef *alpha_frame = get_alpha_frame( vohp, av_frame, n );
+        return alpha_frame ? vsapi->copyFrame( alpha_frame, vs_vohp->core ) : NULL;
+    }
+    VSFrameRef *vs_frame = make_frame( vohp, av_frame, 0 );
+    if( !vs_frame || !vs_vohp->has_alpha )
+        return vs_frame;
+    /* api4 compat: save alpha clip into the _Alpha property */
+    const VSFrameRef *alpha_frame = get_alpha_frame( vohp, av_frame, n );
+    if( !alpha_frame )
+    {
+        vsapi->freeFrame( vs_frame );
+        return NULL;
+    }
+    vsapi->propSetFrame( vsapi->getFramePropsRW( vs_frame ), "_Alpha", alpha_frame, paAppend );
+    return vs_frame;
+}
+
 static int vs_check_dr_available
 (
     AVCodecContext    *ctx,
@@ -918,6 +906,18 @@ static int vs_video_get_buffer
     if( (!vs_vohp->variable_info && lw_vohp->scaler.output_pixel_format != pix_fmt)
      || !vs_check_dr_available( ctx, pix_fmt ) )
         return avcodec_default_get_buffer2( ctx, av_frame, flags );
+    /* The decoder may write the padding up to the aligned size.
+     * With the fixed output resolution, fall back to the decoder's own buffers if the output frame can't hold it,
+     * e.g. the resolution got larger than the initial one. */
+    int width  = av_frame->width;
+    int height = av_frame->height;
+    int linesize_align[AV_NUM_DATA_POINTERS];
+    avcodec_align_dimensions2( ctx, &width, &height, linesize_align );
+    const VSAPI *vsapi = vs_vohp->vsapi;
+    if( !vs_vohp->variable_info
+     && (width  > lw_vohp->output_width
+      || height > lw_vohp->output_height) )
+        return avcodec_default_get_buffer2( ctx, av_frame, flags );
     /* New VapourSynth video frame buffer. */
     vs_video_buffer_handler_t *vs_vbhp = (vs_video_buffer_handler_t *)malloc( sizeof(vs_video_buffer_handler_t) );
     if( !vs_vbhp )
@@ -925,16 +925,31 @@ static int vs_video_get_buffer
         av_frame_unref( av_frame );
         return AVERROR( ENOMEM );
     }
-    av_frame->opaque = vs_vbhp;
-    avcodec_align_dimensions2( ctx, &av_frame->width, &av_frame->height, av_frame->linesize );
-    VSFrameRef *vs_frame_buffer = new_output_video_frame( vs_vohp, av_frame, 0, NULL, 0,
-                                                          vs_vohp->frame_ctx, vs_vohp->core, vs_vohp->vsapi );
+    int unaligned_width  = av_frame->width;
+    int unaligned_height = av_frame->height;
+    av_frame->width  = width;
+    av_frame->height = height;
+    VSFrameRef *vs_frame_buffer = new_output_video_frame( lw_vohp, av_frame, 0, NULL, 0,
+                                                          vs_vohp->frame_ctx, vs_vohp->core, vsapi );
     if( !vs_frame_buffer )
     {
         free( vs_vbhp );
         av_frame_unref( av_frame );
         return AVERROR( ENOMEM );
     }
+    if( vsapi->getStride( vs_frame_buffer, 0 ) % linesize_align[0] )
+    {
+        /* The decoder requires the larger stride alignment than VapourSynth's. */
+        vsapi->freeFrame( vs_frame_buffer );
+        free( vs_vbhp );
+        av_frame->width  = unaligned_width;
+        av_frame->height = unaligned_height;
+        return avcodec_default_get_buffer2( ctx, av_frame, flags );
+    }
+    if( !vs_vohp->variable_info )
+        /* The decoder writes the aligned picture only. */
+        vs_vohp->make_black_background[0]( vs_frame_buffer, width, height, vsapi );
+    av_frame->opaque = vs_vbhp;
     vs_vbhp->vs_frame_buffer = vs_frame_buffer;
     vs_vbhp->vsapi           = vs_vohp->vsapi;
     /* Create frame buffers for the decoder.
@@ -983,13 +998,26 @@ int vs_setup_video_rendering
         set_error_on_init( out, vsapi, "lsmas: %s is not supported", av_get_pix_fmt_name( ctx->pix_fmt ) );
         return -1;
     }
-    if( av_pix_fmt_desc_get( ctx->pix_fmt )->flags & AV_PIX_FMT_FLAG_ALPHA &&
+    vs_vohp->has_alpha = !!(av_pix_fmt_desc_get( ctx->pix_fmt )->flags & AV_PIX_FMT_FLAG_ALPHA);
+    if( vs_vohp->has_alpha &&
         determine_colorspace_conversion( vs_vohp, 1, ctx->pix_fmt, &alpha_pixel_format ) )
     {
         set_error_on_init( out, vsapi, "lsmas: %s's alpha format is not supported", av_get_pix_fmt_name( ctx->pix_fmt ) );
         return -1;
     }
-    vs_vohp->direct_rendering &= vs_check_dr_available( ctx, ctx->pix_fmt );
+    if( vs_vohp->direct_rendering < 0 )
+    {
+        /* Frames can't be cropped without copying, so the padded heights of H.264 and of non-mod32 heights
+         * such as 1080 and 2160 keep the copy. */
+        enum AVPixelFormat input_pixel_format = ctx->pix_fmt;
+        avoid_yuv_scale_conversion( &input_pixel_format );
+        vs_vohp->direct_rendering = !vs_vohp->variable_info
+                                 && input_pixel_format == output_pixel_format
+                                 && vs_check_dr_available( ctx, input_pixel_format )
+                                 && check_dr_exact( ctx, output_pixel_format, width, height ) ? -1 : 0;
+    }
+    else
+        vs_vohp->direct_rendering &= vs_check_dr_available( ctx, ctx->pix_fmt );
     int (*dr_get_buffer)( struct AVCodecContext *, AVFrame *, int ) = vs_vohp->direct_rendering ? vs_video_get_buffer : NULL;
     setup_video_rendering( lw_vohp,
                            SWS_FULL_CHR_H_INT | SWS_FULL_CHR_H_INP | SWS_ACCURATE_RND | SWS_BICUBIC,
@@ -1009,13 +1037,7 @@ int vs_setup_video_rendering
         vi->format = vsapi->getFormatPreset( vs_vohp->vs_output_pixel_format, vs_vohp->core );
         vi->width  = lw_vohp->output_width;
         vi->height = lw_vohp->output_height;
-        vs_vohp->background_frame[0] = vsapi->newVideoFrame( vi->format, vi->width, vi->height, NULL, vs_vohp->core );
-        if( !vs_vohp->background_frame[0] )
-        {
-            set_error_on_init( out, vsapi, "lsmas: failed to allocate memory for the background black frame data." );
-            return -1;
-        }
-        vs_vohp->make_black_background[0]( vs_vohp->background_frame[0], vsapi );
+        vs_vohp->output_format[0] = vi->format;
     }
     return 0;
 }
@@ -1028,9 +1050,8 @@ static void vs_free_video_output_handler
     vs_video_output_handler_t *vs_vohp = (vs_video_output_handler_t *)private_handler;
     if( !vs_vohp )
         return;
-    if( vs_vohp->vsapi && vs_vohp->vsapi->freeFrame )
-        for( int i = 0; i < 2; i++ )
-            vs_vohp->vsapi->freeFrame( vs_vohp->background_frame[i] );
+    if( vs_vohp->alpha_frame )
+        vs_vohp->vsapi->freeFrame( vs_vohp->alpha_frame );
     lw_free( vs_vohp );
 }
 
@@ -1047,17 +1068,79 @@ vs_video_output_handler_t *vs_allocate_video_output_handler
     return vs_vohp;
 }
 
+static void get_mastering_display_properties
+(
+    vs_hdr_properties_t              *hdr,
+    const AVMasteringDisplayMetadata *mastering_display
+)
+{
+    if( (hdr->has_primaries = mastering_display->has_primaries) )
+    {
+        for( int i = 0; i < 3; i++ )
+        {
+            hdr->display_primaries_x[i] = av_q2d( mastering_display->display_primaries[i][0] );
+            hdr->display_primaries_y[i] = av_q2d( mastering_display->display_primaries[i][1] );
+        }
+        hdr->white_point_x = av_q2d( mastering_display->white_point[0] );
+        hdr->white_point_y = av_q2d( mastering_display->white_point[1] );
+    }
+    if( (hdr->has_luminance = mastering_display->has_luminance) )
+    {
+        hdr->min_luminance = av_q2d( mastering_display->min_luminance );
+        hdr->max_luminance = av_q2d( mastering_display->max_luminance );
+    }
+}
+
+static void get_content_light_properties
+(
+    vs_hdr_properties_t          *hdr,
+    const AVContentLightMetadata *content_light
+)
+{
+    if( (hdr->has_light_level = content_light->MaxCLL || content_light->MaxFALL) )
+    {
+        hdr->max_content_light_level       = content_light->MaxCLL;
+        hdr->max_frame_average_light_level = content_light->MaxFALL;
+    }
+}
+
+void vs_get_stream_hdr_properties
+(
+    vs_hdr_properties_t *stream_hdr,
+    const AVStream      *stream
+)
+{
+    memset( stream_hdr, 0, sizeof(vs_hdr_properties_t) );
+    if( !stream )
+        return;
+    int has_mastering_display = 0;
+    int has_content_light     = 0;
+    for( int i = 0; i < stream->nb_side_data; i++ )
+    {
+        if( stream->side_data[i].type == AV_PKT_DATA_MASTERING_DISPLAY_METADATA && !has_mastering_display )
+        {
+            get_mastering_display_properties( stream_hdr, (const AVMasteringDisplayMetadata *)stream->side_data[i].data );
+            has_mastering_display = 1;
+        }
+        else if( stream->side_data[i].type == AV_PKT_DATA_CONTENT_LIGHT_LEVEL && !has_content_light )
+        {
+            get_content_light_properties( stream_hdr, (const AVContentLightMetadata *)stream->side_data[i].data );
+            has_content_light = 1;
+        }
+    }
+}
+
 void vs_set_frame_properties
 (
-    int             n,
-    AVFrame        *av_frame,
-    AVStream       *stream,
-    int64_t         duration_num,
-    int64_t         duration_den,
-    VSFrameRef     *vs_frame,
-    int             top,
-    int             bottom,
-    const VSAPI    *vsapi
+    int                        n,
+    AVFrame                   *av_frame,
+    const vs_hdr_properties_t *stream_hdr,
+    int64_t                    duration_num,
+    int64_t                    duration_den,
+    VSFrameRef                *vs_frame,
+    int                        top,
+    int                        bottom,
+    const VSAPI               *vsapi
 )
 {
     VSMap *props = vsapi->getFramePropsRW( vs_frame );
@@ -1094,86 +1177,33 @@ void vs_set_frame_properties
     vsapi->propSetInt(props, "_EncodedFrameTop", top > -1 ? top : n, paReplace);
     vsapi->propSetInt(props, "_EncodedFrameBottom", top > -1 ? bottom : n, paReplace);
 
-    /* Mastering display color volume */
-    int frame_has_primaries = 0, frame_has_luminance = 0;
+    /* HDR metadata
+     * The side data of the frame takes precedence over the one of the stream. */
+    vs_hdr_properties_t frame_hdr = { 0 };
     const AVFrameSideData *mastering_display_side_data = av_frame_get_side_data( av_frame, AV_FRAME_DATA_MASTERING_DISPLAY_METADATA );
     if( mastering_display_side_data )
-    {
-        const AVMasteringDisplayMetadata *mastering_display = (const AVMasteringDisplayMetadata *)mastering_display_side_data->data;
-        if( (frame_has_primaries = mastering_display->has_primaries) )
-        {
-            double display_primaries_x[3], display_primaries_y[3];
-            for( int i = 0; i < 3; i++ )
-            {
-                display_primaries_x[i] = av_q2d( mastering_display->display_primaries[i][0] );
-                display_primaries_y[i] = av_q2d( mastering_display->display_primaries[i][1] );
-            }
-            vsapi->propSetFloatArray( props, "MasteringDisplayPrimariesX", display_primaries_x, 3 );
-            vsapi->propSetFloatArray( props, "MasteringDisplayPrimariesY", display_primaries_y, 3 );
-            vsapi->propSetFloat( props, "MasteringDisplayWhitePointX", av_q2d( mastering_display->white_point[0] ), paReplace );
-            vsapi->propSetFloat( props, "MasteringDisplayWhitePointY", av_q2d( mastering_display->white_point[1] ), paReplace );
-        }
-        if( (frame_has_luminance = mastering_display->has_luminance) )
-        {
-            vsapi->propSetFloat( props, "MasteringDisplayMinLuminance", av_q2d( mastering_display->min_luminance ), paReplace );
-            vsapi->propSetFloat( props, "MasteringDisplayMaxLuminance", av_q2d( mastering_display->max_luminance ), paReplace );
-        }
-    }
-    if( stream && (!frame_has_primaries || !frame_has_luminance) )
-    {
-        for( int i = 0; i < stream->nb_side_data; i++ )
-        {
-            if( stream->side_data[i].type == AV_PKT_DATA_MASTERING_DISPLAY_METADATA )
-            {
-                const AVMasteringDisplayMetadata *mastering_display = (const AVMasteringDisplayMetadata *)stream->side_data[i].data;
-                if( mastering_display->has_primaries && !frame_has_primaries )
-                {
-                    double display_primaries_x[3], display_primaries_y[3];
-                    for( int i = 0; i < 3; i++ )
-                    {
-                        display_primaries_x[i] = av_q2d( mastering_display->display_primaries[i][0] );
-                        display_primaries_y[i] = av_q2d( mastering_display->display_primaries[i][1] );
-                    }
-                    vsapi->propSetFloatArray( props, "MasteringDisplayPrimariesX", display_primaries_x, 3 );
-                    vsapi->propSetFloatArray( props, "MasteringDisplayPrimariesY", display_primaries_y, 3 );
-                    vsapi->propSetFloat( props, "MasteringDisplayWhitePointX", av_q2d( mastering_display->white_point[0] ), paReplace );
-                    vsapi->propSetFloat( props, "MasteringDisplayWhitePointY", av_q2d( mastering_display->white_point[1] ), paReplace );
-                }
-                if( mastering_display->has_luminance && !frame_has_luminance )
-                {
-                    vsapi->propSetFloat( props, "MasteringDisplayMinLuminance", av_q2d( mastering_display->min_luminance ), paReplace );
-                    vsapi->propSetFloat( props, "MasteringDisplayMaxLuminance", av_q2d( mastering_display->max_luminance ), paReplace );
-                }
-                break;
-            }
-        }
-    }
-    /* Content light level */
-    int frame_has_light_level = 0;
+        get_mastering_display_properties( &frame_hdr, (const AVMasteringDisplayMetadata *)mastering_display_side_data->data );
     const AVFrameSideData *content_light_side_data = av_frame_get_side_data( av_frame, AV_FRAME_DATA_CONTENT_LIGHT_LEVEL );
     if( content_light_side_data )
+        get_content_light_properties( &frame_hdr, (const AVContentLightMetadata *)content_light_side_data->data );
+    const vs_hdr_properties_t *hdr = frame_hdr.has_primaries || !stream_hdr ? &frame_hdr : stream_hdr;
+    if( hdr->has_primaries )
     {
-        const AVContentLightMetadata *content_light = (const AVContentLightMetadata *)content_light_side_data->data;
-        if( (frame_has_light_level = content_light->MaxCLL || content_light->MaxFALL) )
-        {
-            vsapi->propSetInt( props, "ContentLightLevelMax", content_light->MaxCLL, paReplace );
-            vsapi->propSetInt( props, "ContentLightLevelAverage", content_light->MaxFALL, paReplace );
-        }
+        vsapi->propSetFloatArray( props, "MasteringDisplayPrimariesX", hdr->display_primaries_x, 3 );
+        vsapi->propSetFloatArray( props, "MasteringDisplayPrimariesY", hdr->display_primaries_y, 3 );
+        vsapi->propSetFloat( props, "MasteringDisplayWhitePointX", hdr->white_point_x, paReplace );
+        vsapi->propSetFloat( props, "MasteringDisplayWhitePointY", hdr->white_point_y, paReplace );
     }
-    if( stream && !frame_has_light_level )
+    hdr = frame_hdr.has_luminance || !stream_hdr ? &frame_hdr : stream_hdr;
+    if( hdr->has_luminance )
     {
-        for( int i = 0; i < stream->nb_side_data; i++ )
-        {
-            if( stream->side_data[i].type == AV_PKT_DATA_CONTENT_LIGHT_LEVEL )
-            {
-                const AVContentLightMetadata *content_light = (const AVContentLightMetadata *)stream->side_data[i].data;
-                if( content_light->MaxCLL || content_light->MaxFALL )
-                {
-                    vsapi->propSetInt( props, "ContentLightLevelMax", content_light->MaxCLL, paReplace );
-                    vsapi->propSetInt( props, "ContentLightLevelAverage", content_light->MaxFALL, paReplace );
-                }
-                break;
-            }
-        }
+        vsapi->propSetFloat( props, "MasteringDisplayMinLuminance", hdr->min_luminance, paReplace );
+        vsapi->propSetFloat( props, "MasteringDisplayMaxLuminance", hdr->max_luminance, paReplace );
+    }
+    hdr = frame_hdr.has_light_level || !stream_hdr ? &frame_hdr : stream_hdr;
+    if( hdr->has_light_level )
+    {
+        vsapi->propSetInt( props, "ContentLightLevelMax", hdr->max_content_light_level, paReplace );
+        vsapi->propSetInt( props, "ContentLightLevelAverage", hdr->max_frame_average_light_level, paReplace );
     }
 }
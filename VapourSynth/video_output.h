@@ -27,9 +27,12 @@ enum { component_reorder_bigendian = 0x80 };
 #define component_reorder_get_order(order) ((order) & ~component_reorder_bigendian)
 #define component_reorder_is_bigendian(order) (!!((order) & component_reorder_bigendian))
 
+/* Fill the area of the frame out of the picture of width x height placed at the top-left corner with black. */
 typedef void func_make_black_background
 (
     VSFrameRef  *vs_frame,
+    int          width,
+    int          height,
     const VSAPI *vsapi
 );
 
@@ -43,15 +46,35 @@ typedef void func_make_frame
     const VSAPI               *vsapi
 );
 
+/* The HDR metadata in the form of the frame properties, converted once from the side data. */
+typedef struct
+{
+    int     has_primaries;
+    double  display_primaries_x[3];
+    double  display_primaries_y[3];
+    double  white_point_x;
+    double  white_point_y;
+    int     has_luminance;
+    double  min_luminance;
+    double  max_luminance;
+    int     has_light_level;
+    int64_t max_content_light_level;
+    int64_t max_frame_average_light_level;
+} vs_hdr_properties_t;
+
 typedef struct
 {
     int                         variable_info;
-    int                         direct_rendering;
+    int                         direct_rendering;   /* 1: forced with the aligned output resolution, -1: only if no padding is needed, 0: off */
     const component_reorder_t  *component_reorder[2];
     VSPresetFormat              vs_output_pixel_format;
-    VSFrameRef                 *background_frame[2];
+    const VSFormat             *output_format[2];   /* the formats of the output frames unless variable_info */
     func_make_black_background *make_black_background[2];
     func_make_frame            *make_frame[2];
+    int                         has_alpha;          /* The second output is the alpha of the first one. */
+    const VSFrameRef           *alpha_frame;        /* the alpha frame of the last picture shared by both outputs */
+    int                         alpha_frame_number;
+    vs_hdr_properties_t         stream_hdr;         /* the HDR metadata of the stream, used unless frames have their own */
     VSFrameContext             *frame_ctx;
     VSCore                     *core;
     const VSAPI                *vsapi;
@@ -66,6 +89,17 @@ VSFrameRef *make_frame
     int                        output_index
 );
 
+/* Make the frame of the output frame 'n' for 'output_index'.
+ * With the alpha, the alpha frame is made once per picture and shared by the _Alpha property of the first output
+ * and the second output, so requesting both doesn't convert the picture again. */
+VSFrameRef *make_output_frame
+(
+    lw_video_output_handler_t *vohp,
+    AVFrame                   *av_frame,
+    int                        n,
+    int                        output_index
+);
+
 int vs_setup_video_rendering
 (
     lw_video_output_handler_t *lw_vohp,
@@ -81,15 +115,24 @@ vs_video_output_handler_t *vs_allocate_video_output_handler
     lw_video_output_handler_t *vohp
 );
 
+/* Get the HDR metadata from the side data of the stream, which is constant in the stream,
+ * so that every frame doesn't look it up and convert it again. */
+void vs_get_stream_hdr_properties
+(
+    vs_hdr_properties_t *stream_hdr,
+    const AVStream      *stream
+);
+
+/* 'stream_hdr' may be NULL if the stream has no HDR metadata apart from the frames. */
 void vs_set_frame_properties
 (
-    int             n,
-    AVFrame        *av_frame,
-    AVStream       *stream,
-    int64_t         duration_num,
-    int64_t         duration_den,
-    VSFrameRef     *vs_frame,
-    int             top,
-    int             bottom,
-    const VSAPI    *vsapi
+    int                        n,
+    AVFrame                   *av_frame,
+    const vs_hdr_properties_t *stream_hdr,
+    int64_t                    duration_num,
+    int64_t                    duration_den,
+    VSFrameRef                *vs_frame,
+    int                        top,
+    int                        bottom,
+    const VSAPI               *vsapi
 );
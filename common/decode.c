@@ -25,7 +25,6 @@ extern "C"
 {
 #endif  /* __cplusplus */
 #include <libavcodec/avcodec.h>
-#include <libavutil/opt.h>
 #ifdef __cplusplus
 }
 #endif  /* __cplusplus */
@@ -116,7 +115,9 @@ int open_decoder
     AVCodecContext         **ctx,
     const AVCodecParameters *codecpar,
     const AVCodec           *codec,
-    const int                thread_count
+    const int                thread_count,
+    const int                thread_type,
+    const int                preview
 )
 {
     AVCodecContext *c = avcodec_alloc_context3( codec );
@@ -131,13 +132,23 @@ int open_decoder
                                          * For instance, when stream is encoded as AC-3,
                                          * AVCodecContext.codec_id might have been set to AV_CODEC_ID_EAC3
                                          * while AVCodec.id is set to AV_CODEC_ID_AC3. */
-    if( !strcmp( codec->name, "libdav1d" )
-     && (ret = av_opt_set_int( c->priv_data, "framethreads", 1, 0 )) < 0 )
-        goto fail;
-    else if( !strcmp( codec->name, "vp9" )
-          && thread_count != 1
-          && av_cpu_count() > 1 )
-        c->thread_count = 2;
+    if( thread_type )
+    {
+        c->thread_type = thread_type;
+        /* libdav1d doesn't look at thread_type. Its frame threading is limited by the low delay flag instead. */
+        if( !(thread_type & FF_THREAD_FRAME)
+         && !strcmp( codec->name, "libdav1d" ) )
+            c->flags |= AV_CODEC_FLAG_LOW_DELAY;
+    }
+    if( preview > 0 )
+    {
+        /* Errors by skipping the loop filter propagate through references, but are acceptable for previews.
+         * Skipping the IDCT is limited to non-reference pictures since nothing refers to them. */
+        c->flags2          |= AV_CODEC_FLAG2_FAST;
+        c->skip_loop_filter = AVDISCARD_ALL;
+        c->skip_idct        = AVDISCARD_NONREF;
+        c->lowres           = preview - 1 < codec->max_lowres ? preview - 1 : codec->max_lowres;
+    }
     if( codec->id == AV_CODEC_ID_H264
      && c->has_b_frames < 15 )
         c->has_b_frames = 15; // The maximum possible for H264. Issue #10, EP01 frame 1507.
@@ -162,17 +173,21 @@ int find_and_open_decoder
     const AVCodecParameters *codecpar,
     const char             **preferred_decoder_names,
     const int                prefer_hw_decoder,
-    const int                thread_count
+    const int                thread_count,
+    const int                preview
 )
 {
     const AVCodec *codec = find_decoder( codecpar->codec_id, codecpar, preferred_decoder_names, prefer_hw_decoder );
     if( !codec )
         return -1;
-    return open_decoder( ctx, codecpar, codec, thread_count );
+    return open_decoder( ctx, codecpar, codec, thread_count, 0, preview );
 }
 
 /* An incomplete simulator of the old libavcodec video decoder API
- * Unlike the old, this function does not return consumed bytes of input packet on success. */
+ * Unlike the old, this function does not return consumed bytes of input packet on success.
+ * Return 0 if the packet is consumed or no packet is given.
+ * Return 1 if the packet is not consumed since the decoder holds output frames. Then, send the same packet at the next call.
+ * Return a negative value otherwise. */
 int decode_video_packet
 (
     AVCodecContext *ctx,
@@ -186,9 +201,25 @@ int decode_video_packet
     if( pkt )
     {
         ret = avcodec_send_packet( ctx, pkt );
-        if( ret < 0
-         && ret != AVERROR_EOF          /* No more packets can be sent if true. */
-         && ret != AVERROR( EAGAIN ) )  /* Must receive output frames before sending new packets if true. */
+        if( ret == AVERROR( EAGAIN ) )
+        {
+            /* A frame threaded decoder can hold several output frames at once.
+             * Receive one of them to make room and then send the packet again.
+             * The decoder shall output a frame here, otherwise the packet can't be sent at all. */
+            ret = avcodec_receive_frame( ctx, av_frame );
+            if( ret < 0 )
+                return ret;
+            *got_frame = 1;
+            ret = avcodec_send_packet( ctx, pkt );
+            if( ret == AVERROR( EAGAIN ) )
+                return 1;
+            if( ret < 0
+             && ret != AVERROR_EOF )
+                return ret;
+            return 0;
+        }
+        else if( ret < 0
+              && ret != AVERROR_EOF )   /* No more packets can be sent if true. */
             return ret;
     }
     ret = avcodec_receive_frame( ctx, av_frame );
@@ -36,12 +36,21 @@ const AVCodec *find_decoder
     const int                prefer_hw_decoder
 );
 
+/* The preview level trades the fidelity of decoded pictures for the decoding speed, e.g. for scrubbing in editors.
+ *   0 : Decode exactly.
+ *   1 : Allow non-spec-compliant speedups, skip the loop filter and skip the IDCT of non-reference pictures.
+ *   2+: Additionally decode at 1/2^(level - 1) resolution by lowres if the decoder supports it.
+ *       The resolution is limited by the decoder, so check AVCodecContext.lowres after opening. */
+#define LW_DECODER_PREVIEW_MAX 4
+
 int open_decoder
 (
     AVCodecContext         **ctx,
     const AVCodecParameters *codecpar,
     const AVCodec           *codec,
-    const int                thread_count
+    const int                thread_count,
+    const int                thread_type,   /* a combination of FF_THREAD_*s, or 0 to keep the default of libavcodec */
+    const int                preview        /* the preview level described above, 0 for the exact decoding */
 );
 
 int find_and_open_decoder
@@ -50,7 +59,8 @@ int find_and_open_decoder
     const AVCodecParameters *codecpar,
     const char             **preferred_decoder_names,
     const int                prefer_hw_decoder,
-    const int                thread_count
+    const int                thread_count,
+    const int                preview
 );
 
 int decode_video_packet
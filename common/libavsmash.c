@@ -458,7 +458,7 @@ int libavsmash_find_and_open_decoder
     const AVCodec *codec = libavsmash_find_decoder( config, codecpar->codec_id );
     if( !codec )
         return -1;
-    return open_decoder( &config->ctx, codecpar, codec, thread_count );
+    return open_decoder( &config->ctx, codecpar, codec, thread_count, 0, config->preview );
 }
 
 static lsmash_codec_specific_data_type get_codec_specific_data_type
@@ -804,7 +804,7 @@ void libavsmash_flush_buffers
     AVCodecParameters *codecpar     = avcodec_parameters_alloc();
     if( !codecpar
      || avcodec_parameters_from_context( codecpar, config->ctx ) < 0
-     || open_decoder( &ctx, codecpar, codec, config->ctx->thread_count ) < 0 )
+     || open_decoder( &ctx, codecpar, codec, config->ctx->thread_count, config->ctx->thread_type, config->preview ) < 0 )
     {
         avcodec_flush_buffers( config->ctx );
         config->error = 1;
@@ -910,7 +910,7 @@ void update_configuration
     /* Open an appropriate decoder.
      * Here, we force single threaded decoding since some decoder doesn't do its proper initialization with multi-threaded decoding. */
     AVCodecContext *ctx = NULL;
-    if( open_decoder( &ctx, codecpar, codec, 1 ) < 0 )
+    if( open_decoder( &ctx, codecpar, codec, 1, 0, config->preview ) < 0 )
     {
         strcpy( error_string, "Failed to open decoder.\n" );
         goto fail;
@@ -952,8 +952,9 @@ void update_configuration
                 av_frame_free( &picture );
                 goto fail;
             }
+            /* Resend the sample while the decoder refuses it. Every refusal outputs a frame, so this ends. */
             int dummy;
-            decode_video_packet( ctx, picture, &dummy, &pkt );
+            while( decode_video_packet( ctx, picture, &dummy, &pkt ) > 0 );
         } while( ctx->width == 0 || ctx->height == 0 || ctx->pix_fmt == AV_PIX_FMT_NONE );
     }
     else
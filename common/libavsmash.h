@@ -49,6 +49,7 @@ typedef struct
     AVCodecContext       *ctx;
     const char          **preferred_decoder_names;
     int                   prefer_hw_decoder;
+    int                   preview;  /* the preview level of the decoder, 0 for the exact decoding */
     libavsmash_summary_t *entries;
     extended_summary_t    prefer;
     lw_log_handler_t      lh;
@@ -23,7 +23,6 @@
 #include "cpp_compat.h"
 
 #include <inttypes.h>
-#include <float.h>
 
 #ifdef __cplusplus
 extern "C"
@@ -79,10 +78,12 @@ void libavsmash_video_free_decode_handler
     if( !vdhp )
         return;
     lw_freep( &vdhp->keyframe_list );
+    lw_freep( &vdhp->keyframe_only.frames );
     lw_freep( &vdhp->order_converter );
     av_frame_free( &vdhp->frame_buffer );
     av_frame_free( &vdhp->first_valid_frame );
     cleanup_configuration( &vdhp->config );
+    lw_thread_budget_leave( &vdhp->thread_budget );
     lw_free( vdhp );
 }
 
@@ -158,6 +159,15 @@ void libavsmash_video_set_seek_mode
     vdhp->seek_mode = seek_mode;
 }
 
+void libavsmash_video_set_preview
+(
+    libavsmash_video_decode_handler_t *vdhp,
+    int                                preview
+)
+{
+    vdhp->config.preview = CLIP_VALUE( preview, 0, LW_DECODER_PREVIEW_MAX );
+}
+
 void libavsmash_video_set_preferred_decoder_names
 (
     libavsmash_video_decode_handler_t *vdhp,
@@ -265,7 +275,10 @@ int libavsmash_video_get_max_width
     libavsmash_video_decode_handler_t *vdhp
 )
 {
-    return vdhp ? vdhp->config.prefer.width : 0;
+    if( !vdhp )
+        return 0;
+    /* Pictures are decoded at the reduced resolution by lowres. */
+    return vdhp->config.ctx ? AV_CEIL_RSHIFT( vdhp->config.prefer.width, vdhp->config.ctx->lowres ) : vdhp->config.prefer.width;
 }
 
 int libavsmash_video_get_max_height
@@ -273,7 +286,9 @@ int libavsmash_video_get_max_height
     libavsmash_video_decode_handler_t *vdhp
 )
 {
-    return vdhp ? vdhp->config.prefer.height : 0;
+    if( !vdhp )
+        return 0;
+    return vdhp->config.ctx ? AV_CEIL_RSHIFT( vdhp->config.prefer.height, vdhp->config.ctx->lowres ) : vdhp->config.prefer.height;
 }
 
 AVFrame *libavsmash_video_get_frame_buffer
@@ -316,6 +331,28 @@ uint64_t libavsmash_video_get_min_cts
     return vdhp ? vdhp->min_cts : 0;
 }
 
+void libavsmash_video_get_source_frame_info
+(
+    libavsmash_video_decode_handler_t *vdhp,
+    uint32_t                           frame_number,
+    uint32_t                          *source_frame_number,
+    double                            *source_time
+)
+{
+    libavsmash_keyframe_only_t *kfp = &vdhp->keyframe_only;
+    if( kfp->active )
+        frame_number = kfp->frames[ MIN( frame_number, kfp->count ) ];
+    *source_frame_number = frame_number;
+    uint64_t cts;
+    if( vdhp->media_timescale == 0
+     || lsmash_get_cts_from_media_timeline( vdhp->root, vdhp->track_id,
+                                            get_decoding_sample_number( vdhp->order_converter, frame_number ), &cts ) < 0
+     || cts < vdhp->min_cts )
+        *source_time = -1.0;
+    else
+        *source_time = (double)(cts - vdhp->min_cts) / vdhp->media_timescale;
+}
+
 /*****************************************************************************
  * Fetchers
  *****************************************************************************/
@@ -404,6 +441,11 @@ int libavsmash_video_initialize_decoder_configuration
     }
     /* libavcodec */
     AVCodecParameters *codecpar = format_ctx->streams[i]->codecpar;
+    /* The share of the thread budget is taken only here since the decoder is reopened with the same number of threads. */
+    lw_thread_budget_leave( &vdhp->thread_budget );
+    vdhp->thread_budget = lw_thread_budget_join( threads, codecpar->width, codecpar->height );
+    if( vdhp->thread_budget )
+        threads = lw_thread_budget_get_threads( vdhp->thread_budget );
     if( libavsmash_find_and_open_decoder( &vdhp->config, codecpar, threads ) < 0 )
     {
         strcpy( error_string, "Failed to find and open the video decoder.\n" );
@@ -431,6 +473,7 @@ void libavsmash_video_force_seek
 {
     /* Force seek before the next reading. */
     vdhp->last_sample_number = vdhp->sample_count + 1;
+    vdhp->keyframe_only.last_frame_number = 0;
 }
 
 static inline uint32_t get_decoding_sample_number
@@ -491,6 +534,30 @@ void libavsmash_video_close_codec_context
     avcodec_free_context( &vdhp->config.ctx );
 }
 
+static int create_vfr2cfr_map
+(
+    libavsmash_video_decode_handler_t *vdhp,
+    libavsmash_video_output_handler_t *vohp
+)
+{
+    lsmash_media_ts_list_t ts_list;
+    if( lsmash_get_media_timestamps( vdhp->root, vdhp->track_id, &ts_list ) < 0 )
+        return -1;
+    int64_t *ts = (int64_t *)lw_malloc_zero( (ts_list.sample_count + 1) * sizeof(int64_t) );
+    if( !ts )
+    {
+        lsmash_delete_media_timestamps( &ts_list );
+        return -1;
+    }
+    lsmash_sort_timestamps_composition_order( &ts_list );
+    for( uint32_t i = 0; i < ts_list.sample_count; i++ )
+        ts[i + 1] = (int64_t)(ts_list.timestamp[i].cts - vdhp->min_cts);
+    int ret = lw_create_vfr2cfr_map( vohp, ts, ts_list.sample_count, 1, vdhp->media_timescale );
+    lsmash_delete_media_timestamps( &ts_list );
+    lw_free( ts );
+    return ret;
+}
+
 int libavsmash_video_setup_timestamp_info
 (
     libavsmash_video_decode_handler_t *vdhp,
@@ -604,9 +671,19 @@ setup_finish:;
         vohp->frame_count = libavsmash_video_get_sample_count( vdhp );
     uint32_t min_cts_sample_number = get_decoding_sample_number( vdhp->order_converter, 1 );
     vdhp->config.error = lsmash_get_cts_from_media_timeline( vdhp->root, vdhp->track_id, min_cts_sample_number, &vdhp->min_cts );
+    if( vohp->vfr2cfr && !vdhp->config.error && create_vfr2cfr_map( vdhp, vohp ) < 0 )
+    {
+        lw_log_show( &vdhp->config.lh, LW_LOG_ERROR, "Failed to create the VFR->CFR conversion map." );
+        vdhp->config.error = -1;
+    }
     return err;
 }
 
+/* Return 0 if successful.
+ * Return 1 if the sample doesn't exist.
+ * Return 2 if the sample requires another decoder configuration.
+ * Return 3 if the decoder output a frame instead of accepting the sample. Then, feed the same sample again.
+ * Return -1 otherwise. */
 static int decode_video_sample
 (
     libavsmash_video_decode_handler_t *vdhp,
@@ -636,7 +713,7 @@ static int decode_video_sample
         lw_log_show( &config->lh, LW_LOG_WARNING, "Failed to decode a video frame." );
         return -1;
     }
-    return 0;
+    return ret > 0 ? 3 : 0;
 }
 
 static int find_random_accessible_point
@@ -731,6 +808,18 @@ static uint32_t seek_video
         if( config->index == config->queue.index )
             config->delay_count = MIN( decoder_delay, i - rap_number );
         int ret = decode_video_sample( vdhp, picture, &got_picture, i );
+        if( ret == 3 )
+        {
+            /* The sample is fed again. The frame came without it, so the goal becomes nearer. */
+            --i;
+            output_ready = 1;
+            if( decoder_delay )
+            {
+                --decoder_delay;
+                --goal;
+            }
+            continue;
+        }
         if( got_picture )
         {
             output_ready = 1;
@@ -784,6 +873,16 @@ static int get_picture
         else if( ret == 1 )
             /* Sample doesn't exist. */
             break;
+        else if( ret == 3 )
+        {
+            /* The sample is fed again. The frame came without it, so the goal becomes nearer. */
+            if( config->delay_count )
+            {
+                --config->delay_count;
+                --goal;
+            }
+            continue;
+        }
         ++current;
         if( config->update_pending )
             /* A new decoder configuration is needed. Anyway, stop getting picture. */
@@ -914,82 +1013,94 @@ video_fail:
 #undef MAX_ERROR_COUNT
 }
 
-static uint32_t libavsmash_vfr2cfr
+/* Decode the keyframe 'sample_number' in composition order by itself in the keyframe-only mode.
+ * Only its sample is fed to the decoder skipping non-keyframes, and then the decoder is drained,
+ * so neither pre-roll nor decoder delay is involved.
+ * Return 0 if successful.
+ * Return 1 if the decoder output nothing, e.g. the keyframe is not intra coded. Then, the caller should seek normally.
+ * Return a negative value otherwise. */
+static int decode_keyframe
 (
     libavsmash_video_decode_handler_t *vdhp,
-    libavsmash_video_output_handler_t *vohp,
+    AVFrame                           *picture,
     uint32_t                           sample_number
 )
 {
-    /* Convert VFR to CFR. */
-    double target_pts  = (double)((uint64_t)(sample_number - 1) * vohp->cfr_den) / vohp->cfr_num;
-    double current_pts = DBL_MAX;
-    lsmash_sample_t sample;
-    if( vdhp->last_sample_number <= vdhp->sample_count )
+    codec_configuration_t *config = &vdhp->config;
+    uint32_t decoding_sample_number = get_decoding_sample_number( vdhp->order_converter, sample_number );
+    if( config->update_pending )
+        update_configuration( vdhp->root, vdhp->track_id, config );
+    else
+        libavsmash_flush_buffers( config );
+    if( config->error )
+        return -1;
+    config->ctx->skip_frame = AVDISCARD_NONKEY;
+    int got_picture = 0;
+    int ret = decode_video_sample( vdhp, picture, &got_picture, decoding_sample_number );
+    if( ret == 2 )
     {
-        uint32_t last_decoding_sample_number = get_decoding_sample_number( vdhp->order_converter, vdhp->last_sample_number );
-        if( lsmash_get_sample_info_from_media_timeline( vdhp->root, vdhp->track_id, last_decoding_sample_number, &sample ) < 0 )
-            return 0;
-        current_pts = (double)(sample.cts - vdhp->min_cts) / vdhp->media_timescale;
-        if( target_pts == current_pts )
-            return vdhp->last_sample_number;
+        /* The keyframe requires another decoder configuration. The sample is queued until it's activated. */
+        update_configuration( vdhp->root, vdhp->track_id, config );
+        if( config->error )
+            return -1;
+        config->ctx->skip_frame = AVDISCARD_NONKEY;
+        ret = decode_video_sample( vdhp, picture, &got_picture, decoding_sample_number );
     }
-    uint32_t composition_sample_number = vdhp->last_sample_number;
-    double   prev_pts = current_pts;
-    if( target_pts < current_pts )
+    if( ret != 2 && !got_picture )
     {
-        for( composition_sample_number--;
-             composition_sample_number;
-             composition_sample_number-- )
-        {
-            uint32_t decoding_sample_number = get_decoding_sample_number( vdhp->order_converter, composition_sample_number );
-            if( lsmash_get_sample_info_from_media_timeline( vdhp->root, vdhp->track_id, decoding_sample_number, &sample ) < 0 )
-                return 0;
-            current_pts = (double)(sample.cts - vdhp->min_cts) / vdhp->media_timescale;
-            prev_pts = current_pts;
-            if( current_pts <= target_pts )
-                break;
-        }
-        if( composition_sample_number == 0 )
-            return 0;
+        /* Drain the decoder. */
+        AVPacket pkt = { 0 };
+        int64_t  pts = picture->pts;
+        av_frame_unref( picture );
+        if( decode_video_packet( config->ctx, picture, &got_picture, &pkt ) < 0 )
+            got_picture = 0;
+        picture->pts = pts;
+    }
+    config->ctx->skip_frame = AVDISCARD_DEFAULT;
+    if( ret == 2 )
+        return -1;
+    return got_picture ? 0 : 1;
+}
+
+static int get_keyframe
+(
+    libavsmash_video_decode_handler_t *vdhp,
+    uint32_t                           frame_number
+)
+{
+    libavsmash_keyframe_only_t *kfp = &vdhp->keyframe_only;
+    frame_number = MIN( frame_number, kfp->count );
+    if( frame_number == kfp->last_frame_number )
+        return 1;
+    codec_configuration_t *config = &vdhp->config;
+    uint32_t sample_number = kfp->frames[frame_number];
+    int ret = decode_keyframe( vdhp, vdhp->frame_buffer, sample_number );
+    if( ret < 0 )
+    {
+        lw_log_show( &config->lh, LW_LOG_WARNING, "Couldn't read the keyframe." );
+        return -1;
     }
-    double next_target_pts = (double)((uint64_t)sample_number * vohp->cfr_den) / vohp->cfr_num;
-    for( composition_sample_number++;
-         composition_sample_number <= vdhp->sample_count;
-         composition_sample_number++ )
+    else if( ret == 1 )
     {
-        uint32_t decoding_sample_number = get_decoding_sample_number( vdhp->order_converter, composition_sample_number );
-        if( lsmash_get_sample_info_from_media_timeline( vdhp->root, vdhp->track_id, decoding_sample_number, &sample ) < 0 )
-            return 0;
-        current_pts = (double)(sample.cts - vdhp->min_cts) / vdhp->media_timescale;
-        if( current_pts >= target_pts )
-        {
-            uint32_t prev_composition_sample_number = composition_sample_number - 1;
-            if( current_pts > next_target_pts )
-                /* Between the current target and the next target, there are no input samples.
-                 * Therefore, output the previous sample. This is absolutely correct. */
-                sample_number = prev_composition_sample_number;
-            else
-            {
-                if( current_pts > (next_target_pts + target_pts) / 2 )
-                    /* The current sample is far from the current target and should be a candidate for the next target. */
-                    sample_number = prev_composition_sample_number;
-                else
-                {
-                    /* Choose the nearest one. */
-                    if( current_pts - target_pts >= target_pts - prev_pts )
-                        sample_number = prev_composition_sample_number;
-                    else
-                        sample_number = composition_sample_number;
-                }
-            }
-            break;
-        }
-        prev_pts = current_pts;
+        /* The decoder doesn't regard the sample as a keyframe, e.g. a recovery point of H.264.
+         * Decode it in the usual way from the random accessible point. */
+        libavsmash_video_force_seek( vdhp );
+        if( get_requested_picture( vdhp, vdhp->frame_buffer, sample_number ) < 0 )
+            return -1;
+    }
+    else
+    {
+        /* Don't exceed the maximum presentation size specified for each sequence. */
+        extended_summary_t *extended = &config->entries[ config->index - 1 ].extended;
+        if( config->ctx->width > extended->width )
+            config->ctx->width = extended->width;
+        if( config->ctx->height > extended->height )
+            config->ctx->height = extended->height;
     }
-    if( composition_sample_number > vdhp->sample_count )
-        sample_number = vdhp->sample_count;
-    return sample_number;
+    /* Every keyframe is decoded from scratch, so never continue decoding from the last one. */
+    libavsmash_video_force_seek( vdhp );
+    kfp->last_frame_number = frame_number;
+    return 0;
 }
 
 /* Return 0 if successful.
@@ -1004,14 +1115,19 @@ int libavsmash_video_get_frame
 {
     if( vohp->vfr2cfr )
     {
-        sample_number = libavsmash_vfr2cfr( vdhp, vohp, sample_number );
+        sample_number = lw_vfr2cfr_get_source_frame_number( vohp, sample_number );
         if( sample_number == 0 )
             return -1;
     }
-    if( sample_number == vdhp->last_sample_number )
-        return 1;
+    lw_thread_budget_touch( vdhp->thread_budget );
     int ret;
-    if( (ret = get_requested_picture( vdhp, vdhp->frame_buffer, sample_number )) < 0
+    if( vdhp->keyframe_only.active )
+        ret = get_keyframe( vdhp, sample_number );
+    else if( sample_number == vdhp->last_sample_number )
+        return 1;
+    else
+        ret = get_requested_picture( vdhp, vdhp->frame_buffer, sample_number );
+    if( ret != 0
      || (ret = update_scaler_configuration_if_needed( &vohp->scaler, &vdhp->config.lh, vdhp->frame_buffer )) < 0 )
         return ret;
     return 0;
@@ -1069,6 +1185,43 @@ int libavsmash_video_create_keyframe_list
     return 0;
 }
 
+int libavsmash_video_setup_keyframe_only
+(
+    libavsmash_video_decode_handler_t *vdhp,
+    libavsmash_video_output_handler_t *vohp
+)
+{
+    if( !vdhp->keyframe_list && libavsmash_video_create_keyframe_list( vdhp ) < 0 )
+    {
+        lw_log_show( &vdhp->config.lh, LW_LOG_FATAL, "Failed to create the keyframe list." );
+        return -1;
+    }
+    libavsmash_keyframe_only_t *kfp = &vdhp->keyframe_only;
+    uint32_t count = 0;
+    for( uint32_t i = 1; i <= vdhp->sample_count; i++ )
+        count += vdhp->keyframe_list[i];
+    if( count == 0 )
+    {
+        lw_log_show( &vdhp->config.lh, LW_LOG_FATAL, "No keyframe is found in the video track." );
+        return -1;
+    }
+    kfp->frames = (uint32_t *)lw_malloc_zero( (count + 1) * sizeof(uint32_t) );
+    if( !kfp->frames )
+    {
+        lw_log_show( &vdhp->config.lh, LW_LOG_FATAL, "Failed to allocate the keyframe list." );
+        return -1;
+    }
+    /* Number keyframes in composition order. */
+    for( uint32_t i = 1; i <= vdhp->sample_count; i++ )
+        if( vdhp->keyframe_list[i] )
+            kfp->frames[ ++kfp->count ] = i;
+    kfp->active            = 1;
+    kfp->last_frame_number = 0;
+    vohp->frame_count      = kfp->count;
+    vohp->vfr2cfr          = 0;
+    return 0;
+}
+
 int libavsmash_video_is_keyframe
 (
     libavsmash_video_decode_handler_t *vdhp,
@@ -1076,7 +1229,13 @@ int libavsmash_video_is_keyframe
     uint32_t                           sample_number
 )
 {
+    if( vdhp->keyframe_only.active )
+        return 1;
     if( vohp->vfr2cfr )
-        sample_number = libavsmash_vfr2cfr( vdhp, vohp, sample_number );
+    {
+        sample_number = lw_vfr2cfr_get_source_frame_number( vohp, sample_number );
+        if( sample_number == 0 )
+            return 0;
+    }
     return vdhp->keyframe_list[sample_number];
 }
@@ -93,6 +93,15 @@ void libavsmash_video_set_seek_mode
     int                                seek_mode
 );
 
+/* Set the preview level of the decoder to trade the fidelity for the decoding speed. (see decode.h)
+ * With lowres, the maximum presentation size reported by the getters is reduced as well.
+ * This must be called before the decoder is opened. */
+void libavsmash_video_set_preview
+(
+    libavsmash_video_decode_handler_t *vdhp,
+    int                                preview
+);
+
 void libavsmash_video_set_preferred_decoder_names
 (
     libavsmash_video_decode_handler_t *vdhp,
@@ -195,6 +204,18 @@ uint64_t libavsmash_video_get_min_cts
     libavsmash_video_decode_handler_t *vdhp
 );
 
+/* Get the composition sample number in the source track of the output frame 'frame_number' and its presentation time
+ * in seconds from the first sample. Both are the ones of the keyframe in the keyframe-only mode.
+ * '*source_time' is set to a negative value if unknown.
+ * This function must be called after libavsmash_video_setup_timestamp_info(). */
+void libavsmash_video_get_source_frame_info
+(
+    libavsmash_video_decode_handler_t *vdhp,
+    uint32_t                           frame_number,
+    uint32_t                          *source_frame_number,
+    double                            *source_time
+);
+
 /*****************************************************************************
  * Others
  *****************************************************************************/
@@ -279,6 +300,18 @@ int libavsmash_video_create_keyframe_list
     libavsmash_video_decode_handler_t *vdhp
 );
 
+/* Switch to the keyframe-only mode, where only the keyframes of the track are output as frames.
+ * Each keyframe is decoded by feeding only its sample to the decoder, which skips any non-keyframe,
+ * so no pre-roll happens. This overrides the frame count and VFR->CFR conversion,
+ * so call this after libavsmash_video_setup_timestamp_info().
+ * Return 0 if successful.
+ * Return -1 otherwise. */
+int libavsmash_video_setup_keyframe_only
+(
+    libavsmash_video_decode_handler_t *vdhp,
+    libavsmash_video_output_handler_t *vohp
+);
+
 int libavsmash_video_is_keyframe
 (
     libavsmash_video_decode_handler_t *vdhp,
@@ -20,6 +20,8 @@
 
 /* This file is available under an ISC license. */
 
+#include "lwthreads.h"
+
 #define SEEK_MODE_NORMAL     0
 #define SEEK_MODE_UNSAFE     1
 #define SEEK_MODE_AGGRESSIVE 2
@@ -29,6 +31,14 @@ typedef struct
     uint32_t composition_to_decoding;
 } order_converter_t;
 
+typedef struct
+{
+    int       active;               /* if set to non-zero, only keyframes are output and each is decoded by itself */
+    uint32_t  count;                /* the number of output keyframes */
+    uint32_t *frames;               /* composition sample numbers of output keyframes indexed by output frame number */
+    uint32_t  last_frame_number;    /* the output frame number of the last requested keyframe */
+} libavsmash_keyframe_only_t;
+
 struct libavsmash_video_decode_handler_tag
 {
     lsmash_root_t        *root;
@@ -47,4 +57,6 @@ struct libavsmash_video_decode_handler_tag
     uint32_t              media_timescale;
     uint64_t              media_duration;
     uint64_t              min_cts;
+    libavsmash_keyframe_only_t keyframe_only;
+    lw_thread_budget_client_t *thread_budget;  /* the share of the process-wide budget of decoder threads */
 };
@@ -0,0 +1,826 @@
+/*****************************************************************************
+ * lwcolorspace.c
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+#include "cpp_compat.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "lwsimd.h"
+
+#include <emmintrin.h>  /* SSE2 */
+#include <tmmintrin.h>  /* SSSE3 */
+#include <smmintrin.h>  /* SSE4.1 */
+#if HAVE_AVX2_INTRINSICS
+#include <immintrin.h>  /* AVX2 */
+#endif
+
+#include "utils.h"
+#include "lwcolorspace.h"
+
+enum
+{
+    PACK48_LW48 = 0,
+    PACK48_YC48_LIMITED,
+    PACK48_YC48_FULL
+};
+
+typedef void yuy2_row_func( uint8_t *dst, const uint8_t *src_y, const uint8_t *src_u0, const uint8_t *src_u1,
+                            const uint8_t *src_v0, const uint8_t *src_v1, int weight, int width );
+typedef void upsample_row_func( uint16_t *dst, const uint16_t *src0, const uint16_t *src1, int weight, int shift, int width );
+typedef void shift_row_func( uint16_t *dst, const uint16_t *src, int shift, int width );
+typedef void pack48_row_func( uint8_t *dst, const uint16_t *src_y, const uint16_t *src_u, const uint16_t *src_v, int width, int mode );
+typedef void lw48_row_func( uint8_t *dst, const uint16_t *src, int width );
+
+/* The coefficients of YC48 in 16-bit fixed point and the offsets, the luma of which are applied to the samples
+ * biased by -32768 so that the SIMD versions can multiply them as signed 16-bit integers. */
+static const int yc48_y_coef     [2] = {  4788,   4770 };
+static const int yc48_y_offset   [2] = {  2095,   2086 };
+static const int yc48_uv_coef    [2] = {  4682,   4662 };
+static const int yc48_uv_offset  [2] = { 32768, 589824 };
+
+/* Get the two chroma rows to be interpolated into the chroma of the luma row 'y' of interlaced 4:2:0
+ * and the weight of the first one out of 8. The rows of the same field are weighted 5:3 and 7:1 for the top and the bottom
+ * between the chroma rows, and 1:7 and 3:5 on the other side. The rows out of the field are clipped to its edges. */
+static void get_interlaced_chroma_rows( int y, int height, int *row0, int *row1, int *weight )
+{
+    int field         = y & 1;
+    int field_row     = y >> 1;
+    int chroma_height = (height + 1) >> 1;
+    int last          = MAX( ((chroma_height - field + 1) >> 1) - 1, 0 );
+    int r0;
+    int r1;
+    if( field_row & 1 )
+    {
+        r0      = field_row >> 1;
+        r1      = r0 + 1;
+        *weight = field ? 7 : 5;
+    }
+    else
+    {
+        r1      = field_row >> 1;
+        r0      = r1 - 1;
+        *weight = field ? 3 : 1;
+    }
+    *row0 = MIN( 2 * CLIP_VALUE( r0, 0, last ) + field, chroma_height - 1 );
+    *row1 = MIN( 2 * CLIP_VALUE( r1, 0, last ) + field, chroma_height - 1 );
+}
+
+/*****************************************************************************
+ * C references
+ *****************************************************************************/
+static void yuy2_row_c( uint8_t *dst, const uint8_t *src_y, const uint8_t *src_u0, const uint8_t *src_u1,
+                        const uint8_t *src_v0, const uint8_t *src_v1, int weight, int width )
+{
+    for( int x = 0; x < width; x += 2 )
+    {
+        int c = x >> 1;
+        dst[2 * x    ] = src_y[x];
+        dst[2 * x + 1] = (weight * src_u0[c] + (8 - weight) * src_u1[c] + 4) >> 3;
+        dst[2 * x + 2] = src_y[x + 1 < width ? x + 1 : x];
+        dst[2 * x + 3] = (weight * src_v0[c] + (8 - weight) * src_v1[c] + 4) >> 3;
+    }
+}
+
+/* Interpolate two samples and scale the result from 'shift' bits under 16 bits to 16 bits. */
+static inline int interpolate_chroma16( int a, int b, int weight, int shift )
+{
+    int v = weight * a + (8 - weight) * b;
+    return shift < 3 ? (v + (1 << (2 - shift))) >> (3 - shift) : v << (shift - 3);
+}
+
+static void upsample_row_c( uint16_t *dst, const uint16_t *src0, const uint16_t *src1, int weight, int shift, int width )
+{
+    int chroma_width = (width + 1) >> 1;
+    int c = interpolate_chroma16( src0[0], src1[0], weight, shift );
+    for( int x = 0; x < chroma_width; x++ )
+    {
+        int next = x + 1 < chroma_width ? interpolate_chroma16( src0[x + 1], src1[x + 1], weight, shift ) : c;
+        dst[2 * x] = c;
+        if( 2 * x + 1 < width )
+            dst[2 * x + 1] = (c + next + 1) >> 1;
+        c = next;
+    }
+}
+
+static void shift_row_c( uint16_t *dst, const uint16_t *src, int shift, int width )
+{
+    for( int x = 0; x < width; x++ )
+        dst[x] = src[x] << shift;
+}
+
+static void pack48_row_c( uint8_t *dst, const uint16_t *src_y, const uint16_t *src_u, const uint16_t *src_v, int width, int mode )
+{
+    uint16_t *d = (uint16_t *)dst;
+    if( mode == PACK48_LW48 )
+        for( int x = 0; x < width; x++ )
+        {
+            d[3 * x    ] = src_y[x];
+            d[3 * x + 1] = src_u[x];
+            d[3 * x + 2] = src_v[x];
+        }
+    else
+    {
+        int full_range = mode == PACK48_YC48_FULL;
+        int y_coef     = yc48_y_coef   [full_range];
+        int uv_coef    = yc48_uv_coef  [full_range];
+        int uv_offset  = yc48_uv_offset[full_range];
+        for( int x = 0; x < width; x++ )
+        {
+            d[3 * x    ] = ((src_y[x] * y_coef) >> 16) - 299;
+            d[3 * x + 1] = ((src_u[x] - 32768) * uv_coef + uv_offset) >> 16;
+            d[3 * x + 2] = ((src_v[x] - 32768) * uv_coef + uv_offset) >> 16;
+        }
+    }
+}
+
+/* The chroma of a pair of pixels is the one of the first pixel. */
+static void lw48_to_yuy2_row_c( uint8_t *dst, const uint16_t *src, int width )
+{
+    for( int x = 0; x < width; x += 2 )
+    {
+        const uint16_t *s = src + 3 * x;
+        dst[2 * x    ] = s[0] >> 8;
+        dst[2 * x + 1] = s[1] >> 8;
+        dst[2 * x + 2] = s[x + 1 < width ? 3 : 0] >> 8;
+        dst[2 * x + 3] = s[2] >> 8;
+    }
+}
+
+/* BT.601 of the limited range in 21-bit fixed point. The intermediates fit in 32 bits for any 16-bit samples. */
+static void lw48_to_bgr24_row_c( uint8_t *dst, const uint16_t *src, int width )
+{
+    for( int x = 0; x < width; x++ )
+    {
+        int y  = (src[3 * x] - 4096) * 9539;
+        int cb = src[3 * x + 1] - 32768;
+        int cr = src[3 * x + 2] - 32768;
+        int b  = (y + 16531 * cb               + (1 << 20)) >> 21;
+        int g  = (y -  3203 * cb -  6808 * cr + (1 << 20)) >> 21;
+        int r  = (y               + 13074 * cr + (1 << 20)) >> 21;
+        dst[3 * x    ] = CLIP_VALUE( b, 0, 255 );
+        dst[3 * x + 1] = CLIP_VALUE( g, 0, 255 );
+        dst[3 * x + 2] = CLIP_VALUE( r, 0, 255 );
+    }
+}
+
+/*****************************************************************************
+ * SSSE3
+ *****************************************************************************/
+static LW_TARGET_SSSE3 void yuy2_row_ssse3( uint8_t *dst, const uint8_t *src_y, const uint8_t *src_u0, const uint8_t *src_u1,
+                                            const uint8_t *src_v0, const uint8_t *src_v1, int weight, int width )
+{
+    /* pmaddubsw of the interleaved pairs of the two rows and the pairs of the weights */
+    const __m128i w = _mm_set1_epi16( (short)(weight | ((8 - weight) << 8)) );
+    const __m128i r = _mm_set1_epi16( 4 );
+    int x = 0;
+    for( ; x <= width - 16; x += 16 )
+    {
+        __m128i u  = _mm_unpacklo_epi8( _mm_loadl_epi64( (const __m128i *)(src_u0 + x / 2) ),
+                                        _mm_loadl_epi64( (const __m128i *)(src_u1 + x / 2) ) );
+        __m128i v  = _mm_unpacklo_epi8( _mm_loadl_epi64( (const __m128i *)(src_v0 + x / 2) ),
+                                        _mm_loadl_epi64( (const __m128i *)(src_v1 + x / 2) ) );
+        u = _mm_srli_epi16( _mm_add_epi16( _mm_maddubs_epi16( u, w ), r ), 3 );
+        v = _mm_srli_epi16( _mm_add_epi16( _mm_maddubs_epi16( v, w ), r ), 3 );
+        __m128i uv = _mm_packus_epi16( u, v );
+        __m128i c  = _mm_unpacklo_epi8( uv, _mm_srli_si128( uv, 8 ) );
+        __m128i y  = _mm_loadu_si128( (const __m128i *)(src_y + x) );
+        _mm_storeu_si128( (__m128i *)(dst + 2 * x     ), _mm_unpacklo_epi8( y, c ) );
+        _mm_storeu_si128( (__m128i *)(dst + 2 * x + 16), _mm_unpackhi_epi8( y, c ) );
+    }
+    yuy2_row_c( dst + 2 * x, src_y + x, src_u0 + x / 2, src_u1 + x / 2, src_v0 + x / 2, src_v1 + x / 2, weight, width - x );
+}
+
+/* pshufb masks to interleave 8 samples of 16 bits of each of three planes into three vectors.
+ * The index of the first dimension is the output vector and the one of the second is the plane. */
+static const uint8_t LW_ALIGN(16) interleave3_mask[3][3][16] =
+{
+    {
+        {    0,    1, 0x80, 0x80, 0x80, 0x80,    2,    3, 0x80, 0x80, 0x80, 0x80,    4,    5, 0x80, 0x80 },
+        { 0x80, 0x80,    0,    1, 0x80, 0x80, 0x80, 0x80,    2,    3, 0x80, 0x80, 0x80, 0x80,    4,    5 },
+        { 0x80, 0x80, 0x80, 0x80,    0,    1, 0x80, 0x80, 0x80, 0x80,    2,    3, 0x80, 0x80, 0x80, 0x80 }
+    },
+    {
+        { 0x80, 0x80,    6,    7, 0x80, 0x80, 0x80, 0x80,    8,    9, 0x80, 0x80, 0x80, 0x80,   10,   11 },
+        { 0x80, 0x80, 0x80, 0x80,    6,    7, 0x80, 0x80, 0x80, 0x80,    8,    9, 0x80, 0x80, 0x80, 0x80 },
+        {    4,    5, 0x80, 0x80, 0x80, 0x80,    6,    7, 0x80, 0x80, 0x80, 0x80,    8,    9, 0x80, 0x80 }
+    },
+    {
+        { 0x80, 0x80, 0x80, 0x80,   12,   13, 0x80, 0x80, 0x80, 0x80,   14,   15, 0x80, 0x80, 0x80, 0x80 },
+        {   10,   11, 0x80, 0x80, 0x80, 0x80,   12,   13, 0x80, 0x80, 0x80, 0x80,   14,   15, 0x80, 0x80 },
+        { 0x80, 0x80,   10,   11, 0x80, 0x80, 0x80, 0x80,   12,   13, 0x80, 0x80, 0x80, 0x80,   14,   15 }
+    }
+};
+
+/* Multiply the signed samples by the 32-bit 'coef', the upper halves of which are 0, add 'offset' and take the upper 16 bits. */
+static LW_FORCEINLINE __m128i multiply_high_sse2( __m128i s, __m128i coef, __m128i offset )
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_srai_epi32( _mm_add_epi32( _mm_madd_epi16( _mm_unpacklo_epi16( s, zero ), coef ), offset ), 16 );
+    __m128i hi = _mm_srai_epi32( _mm_add_epi32( _mm_madd_epi16( _mm_unpackhi_epi16( s, zero ), coef ), offset ), 16 );
+    return _mm_packs_epi32( lo, hi );
+}
+
+static LW_TARGET_SSSE3 void pack48_row_ssse3( uint8_t *dst, const uint16_t *src_y, const uint16_t *src_u, const uint16_t *src_v, int width, int mode )
+{
+    const __m128i bias       = _mm_set1_epi16( (short)0x8000 );
+    const int     full_range = mode == PACK48_YC48_FULL;
+    const __m128i y_coef     = _mm_set1_epi32( yc48_y_coef   [full_range] );
+    const __m128i y_offset   = _mm_set1_epi16( (short)yc48_y_offset[full_range] );
+    const __m128i uv_coef    = _mm_set1_epi32( yc48_uv_coef  [full_range] );
+    const __m128i uv_offset  = _mm_set1_epi32( yc48_uv_offset[full_range] );
+    const __m128i zero       = _mm_setzero_si128();
+    int x = 0;
+    for( ; x <= width - 8; x += 8 )
+    {
+        __m128i s[3];
+        s[0] = _mm_loadu_si128( (const __m128i *)(src_y + x) );
+        s[1] = _mm_loadu_si128( (const __m128i *)(src_u + x) );
+        s[2] = _mm_loadu_si128( (const __m128i *)(src_v + x) );
+        if( mode != PACK48_LW48 )
+        {
+            s[0] = _mm_add_epi16( multiply_high_sse2( _mm_sub_epi16( s[0], bias ), y_coef, zero ), y_offset );
+            s[1] = multiply_high_sse2( _mm_sub_epi16( s[1], bias ), uv_coef, uv_offset );
+            s[2] = multiply_high_sse2( _mm_sub_epi16( s[2], bias ), uv_coef, uv_offset );
+        }
+        for( int i = 0; i < 3; i++ )
+        {
+            __m128i p = _mm_shuffle_epi8( s[0], _mm_load_si128( (const __m128i *)interleave3_mask[i][0] ) );
+            p = _mm_or_si128( p, _mm_shuffle_epi8( s[1], _mm_load_si128( (const __m128i *)interleave3_mask[i][1] ) ) );
+            p = _mm_or_si128( p, _mm_shuffle_epi8( s[2], _mm_load_si128( (const __m128i *)interleave3_mask[i][2] ) ) );
+            _mm_storeu_si128( (__m128i *)(dst + 6 * x + 16 * i), p );
+        }
+    }
+    pack48_row_c( dst + 6 * x, src_y + x, src_u + x, src_v + x, width - x, mode );
+}
+
+/* pshufb masks to gather the upper bytes of the samples of 8 pixels of LW48 in three vectors into YUY2. */
+static const uint8_t LW_ALIGN(16) lw48_to_yuy2_mask[3][16] =
+{
+    {    1,    3,    7,    5,   13,   15, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+    { 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,    3,    1,    9,   11,   15,   13, 0x80, 0x80, 0x80, 0x80 },
+    { 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,    5,    7,   11,    9 }
+};
+
+static LW_TARGET_SSSE3 void lw48_to_yuy2_row_ssse3( uint8_t *dst, const uint16_t *src, int width )
+{
+    const __m128i m0 = _mm_load_si128( (const __m128i *)lw48_to_yuy2_mask[0] );
+    const __m128i m1 = _mm_load_si128( (const __m128i *)lw48_to_yuy2_mask[1] );
+    const __m128i m2 = _mm_load_si128( (const __m128i *)lw48_to_yuy2_mask[2] );
+    int x = 0;
+    for( ; x <= width - 8; x += 8 )
+    {
+        const __m128i *s = (const __m128i *)(src + 3 * x);
+        __m128i p = _mm_shuffle_epi8( _mm_loadu_si128( s ), m0 );
+        p = _mm_or_si128( p, _mm_shuffle_epi8( _mm_loadu_si128( s + 1 ), m1 ) );
+        p = _mm_or_si128( p, _mm_shuffle_epi8( _mm_loadu_si128( s + 2 ), m2 ) );
+        _mm_storeu_si128( (__m128i *)(dst + 2 * x), p );
+    }
+    lw48_to_yuy2_row_c( dst + 2 * x, src + 3 * x, width - x );
+}
+
+/* pshufb masks to interleave 16 bytes of each of B, G and R into three vectors of BGR24.
+ * The index of the first dimension is the output vector and the one of the second is the component. */
+static const uint8_t LW_ALIGN(16) interleave3x8_mask[3][3][16] =
+{
+    {
+        {    0, 0x80, 0x80,    1, 0x80, 0x80,    2, 0x80, 0x80,    3, 0x80, 0x80,    4, 0x80, 0x80,    5 },
+        { 0x80,    0, 0x80, 0x80,    1, 0x80, 0x80,    2, 0x80, 0x80,    3, 0x80, 0x80,    4, 0x80, 0x80 },
+        { 0x80, 0x80,    0, 0x80, 0x80,    1, 0x80, 0x80,    2, 0x80, 0x80,    3, 0x80, 0x80,    4, 0x80 }
+    },
+    {
+        { 0x80, 0x80,    6, 0x80, 0x80,    7, 0x80, 0x80,    8, 0x80, 0x80,    9, 0x80, 0x80,   10, 0x80 },
+        {    5, 0x80, 0x80,    6, 0x80, 0x80,    7, 0x80, 0x80,    8, 0x80, 0x80,    9, 0x80, 0x80,   10 },
+        { 0x80,    5, 0x80, 0x80,    6, 0x80, 0x80,    7, 0x80, 0x80,    8, 0x80, 0x80,    9, 0x80, 0x80 }
+    },
+    {
+        { 0x80,   11, 0x80, 0x80,   12, 0x80, 0x80,   13, 0x80, 0x80,   14, 0x80, 0x80,   15, 0x80, 0x80 },
+        { 0x80, 0x80,   11, 0x80, 0x80,   12, 0x80, 0x80,   13, 0x80, 0x80,   14, 0x80, 0x80,   15, 0x80 },
+        {   10, 0x80, 0x80,   11, 0x80, 0x80,   12, 0x80, 0x80,   13, 0x80, 0x80,   14, 0x80, 0x80,   15 }
+    }
+};
+
+static LW_TARGET_SSSE3 LW_FORCEINLINE void store_bgr24_ssse3( uint8_t *dst, __m128i b, __m128i g, __m128i r )
+{
+    for( int i = 0; i < 3; i++ )
+    {
+        __m128i p = _mm_shuffle_epi8( b, _mm_load_si128( (const __m128i *)interleave3x8_mask[i][0] ) );
+        p = _mm_or_si128( p, _mm_shuffle_epi8( g, _mm_load_si128( (const __m128i *)interleave3x8_mask[i][1] ) ) );
+        p = _mm_or_si128( p, _mm_shuffle_epi8( r, _mm_load_si128( (const __m128i *)interleave3x8_mask[i][2] ) ) );
+        _mm_storeu_si128( (__m128i *)(dst + 16 * i), p );
+    }
+}
+
+/*****************************************************************************
+ * SSE4.1
+ *****************************************************************************/
+/* Interpolate 8 samples of two rows into 16 bits. The samples are biased by -32768 for pmaddwd. */
+static LW_TARGET_SSE41 LW_FORCEINLINE __m128i interpolate_chroma16_sse41( __m128i a, __m128i b, __m128i w, __m128i offset, __m128i count, int left )
+{
+    const __m128i bias = _mm_set1_epi16( (short)0x8000 );
+    a = _mm_sub_epi16( a, bias );
+    b = _mm_sub_epi16( b, bias );
+    __m128i lo = _mm_add_epi32( _mm_madd_epi16( _mm_unpacklo_epi16( a, b ), w ), offset );
+    __m128i hi = _mm_add_epi32( _mm_madd_epi16( _mm_unpackhi_epi16( a, b ), w ), offset );
+    lo = left ? _mm_sll_epi32( lo, count ) : _mm_srl_epi32( lo, count );
+    hi = left ? _mm_sll_epi32( hi, count ) : _mm_srl_epi32( hi, count );
+    return _mm_packus_epi32( lo, hi );
+}
+
+static LW_TARGET_SSE41 void upsample_row_sse41( uint16_t *dst, const uint16_t *src0, const uint16_t *src1, int weight, int shift, int width )
+{
+    const __m128i w            = _mm_set1_epi32( weight | ((8 - weight) << 16) );
+    const __m128i offset       = _mm_set1_epi32( 8 * 32768 + (shift < 3 ? 1 << (2 - shift) : 0) );
+    const __m128i count        = _mm_cvtsi32_si128( shift < 3 ? 3 - shift : shift - 3 );
+    const int     left         = shift >= 3;
+    const int     chroma_width = (width + 1) >> 1;
+    int x = 0;
+    /* The next sample of the last one is needed for the odd outputs. */
+    for( ; x + 8 < chroma_width; x += 8 )
+    {
+        __m128i c   = interpolate_chroma16_sse41( _mm_loadu_si128( (const __m128i *)(src0 + x    ) ),
+                                                  _mm_loadu_si128( (const __m128i *)(src1 + x    ) ), w, offset, count, left );
+        __m128i n   = interpolate_chroma16_sse41( _mm_loadu_si128( (const __m128i *)(src0 + x + 1) ),
+                                                  _mm_loadu_si128( (const __m128i *)(src1 + x + 1) ), w, offset, count, left );
+        __m128i avg = _mm_avg_epu16( c, n );
+        _mm_storeu_si128( (__m128i *)(dst + 2 * x    ), _mm_unpacklo_epi16( c, avg ) );
+        _mm_storeu_si128( (__m128i *)(dst + 2 * x + 8), _mm_unpackhi_epi16( c, avg ) );
+    }
+    upsample_row_c( dst + 2 * x, src0 + x, src1 + x, weight, shift, width - 2 * x );
+}
+
+static LW_TARGET_SSE41 void shift_row_sse41( uint16_t *dst, const uint16_t *src, int shift, int width )
+{
+    const __m128i count = _mm_cvtsi32_si128( shift );
+    int x = 0;
+    for( ; x <= width - 8; x += 8 )
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_sll_epi16( _mm_loadu_si128( (const __m128i *)(src + x) ), count ) );
+    shift_row_c( dst + x, src + x, shift, width - x );
+}
+
+/* pshufb masks to sort the samples of each component of 8 pixels of LW48 after pblendw. */
+static const uint8_t LW_ALIGN(16) lw48_deinterleave_mask[3][16] =
+{
+    { 0, 1, 6, 7, 12, 13,  2,  3,  8,  9, 14, 15,  4,  5, 10, 11 },
+    { 2, 3, 8, 9, 14, 15,  4,  5, 10, 11,  0,  1,  6,  7, 12, 13 },
+    { 4, 5, 10, 11, 0, 1,  6,  7, 12, 13,  2,  3,  8,  9, 14, 15 }
+};
+
+/* Convert Y, Cb and Cr of 8 pixels biased by -32768 into B, G and R of 16 bits in the same way as lw48_to_bgr24_row_c(). */
+static LW_TARGET_SSE41 LW_FORCEINLINE void lw48_to_bgr_sse41( __m128i y, __m128i cb, __m128i cr, __m128i *b, __m128i *g, __m128i *r )
+{
+    const __m128i y_offset = _mm_set1_epi16( 32768 - 4096 );
+    const __m128i y_coef   = _mm_set1_epi16( 9539 );
+    const __m128i b_coef   = _mm_set1_epi16( 16531 );
+    const __m128i g_coef   = _mm_set1_epi32( (int)((uint32_t)(uint16_t)-6808 << 16 | (uint16_t)-3203) );
+    const __m128i r_coef   = _mm_set1_epi16( 13074 );
+    const __m128i round    = _mm_set1_epi32( 1 << 20 );
+    /* (y - 4096) * 9539 = ((y - 32768) + (32768 - 4096)) * 9539 */
+    __m128i y_lo = _mm_add_epi32( _mm_madd_epi16( _mm_unpacklo_epi16( y, y_offset ), y_coef ), round );
+    __m128i y_hi = _mm_add_epi32( _mm_madd_epi16( _mm_unpackhi_epi16( y, y_offset ), y_coef ), round );
+    __m128i lo   = _mm_add_epi32( y_lo, _mm_madd_epi16( _mm_unpacklo_epi16( cb, cr ), g_coef ) );
+    __m128i hi   = _mm_add_epi32( y_hi, _mm_madd_epi16( _mm_unpackhi_epi16( cb, cr ), g_coef ) );
+    *g = _mm_packs_epi32( _mm_srai_epi32( lo, 21 ), _mm_srai_epi32( hi, 21 ) );
+    lo = _mm_add_epi32( y_lo, _mm_madd_epi16( _mm_unpacklo_epi16( cb, _mm_setzero_si128() ), b_coef ) );
+    hi = _mm_add_epi32( y_hi, _mm_madd_epi16( _mm_unpackhi_epi16( cb, _mm_setzero_si128() ), b_coef ) );
+    *b = _mm_packs_epi32( _mm_srai_epi32( lo, 21 ), _mm_srai_epi32( hi, 21 ) );
+    lo = _mm_add_epi32( y_lo, _mm_madd_epi16( _mm_unpacklo_epi16( cr, _mm_setzero_si128() ), r_coef ) );
+    hi = _mm_add_epi32( y_hi, _mm_madd_epi16( _mm_unpackhi_epi16( cr, _mm_setzero_si128() ), r_coef ) );
+    *r = _mm_packs_epi32( _mm_srai_epi32( lo, 21 ), _mm_srai_epi32( hi, 21 ) );
+}
+
+/* Load 8 pixels of LW48 into Y, Cb and Cr biased by -32768. */
+static LW_TARGET_SSE41 LW_FORCEINLINE void load_lw48_sse41( const uint16_t *src, __m128i *y, __m128i *cb, __m128i *cr )
+{
+    const __m128i bias = _mm_set1_epi16( (short)0x8000 );
+    __m128i a = _mm_loadu_si128( (const __m128i *)src     );
+    __m128i b = _mm_loadu_si128( (const __m128i *)src + 1 );
+    __m128i c = _mm_loadu_si128( (const __m128i *)src + 2 );
+    *y  = _mm_blend_epi16( _mm_blend_epi16( a, b, 0x92 ), c, 0x24 );
+    *cb = _mm_blend_epi16( _mm_blend_epi16( a, b, 0x24 ), c, 0x49 );
+    *cr = _mm_blend_epi16( _mm_blend_epi16( a, b, 0x49 ), c, 0x92 );
+    *y  = _mm_sub_epi16( _mm_shuffle_epi8( *y,  _mm_load_si128( (const __m128i *)lw48_deinterleave_mask[0] ) ), bias );
+    *cb = _mm_sub_epi16( _mm_shuffle_epi8( *cb, _mm_load_si128( (const __m128i *)lw48_deinterleave_mask[1] ) ), bias );
+    *cr = _mm_sub_epi16( _mm_shuffle_epi8( *cr, _mm_load_si128( (const __m128i *)lw48_deinterleave_mask[2] ) ), bias );
+}
+
+static LW_TARGET_SSE41 void lw48_to_bgr24_row_sse41( uint8_t *dst, const uint16_t *src, int width )
+{
+    int x = 0;
+    for( ; x <= width - 16; x += 16 )
+    {
+        __m128i y, cb, cr;
+        __m128i b0, g0, r0;
+        __m128i b1, g1, r1;
+        load_lw48_sse41( src + 3 * x, &y, &cb, &cr );
+        lw48_to_bgr_sse41( y, cb, cr, &b0, &g0, &r0 );
+        load_lw48_sse41( src + 3 * x + 24, &y, &cb, &cr );
+        lw48_to_bgr_sse41( y, cb, cr, &b1, &g1, &r1 );
+        store_bgr24_ssse3( dst + 3 * x, _mm_packus_epi16( b0, b1 ), _mm_packus_epi16( g0, g1 ), _mm_packus_epi16( r0, r1 ) );
+    }
+    lw48_to_bgr24_row_c( dst + 3 * x, src + 3 * x, width - x );
+}
+
+/*****************************************************************************
+ * AVX2
+ *****************************************************************************/
+#if HAVE_AVX2_INTRINSICS
+static LW_TARGET_AVX2 void yuy2_row_avx2( uint8_t *dst, const uint8_t *src_y, const uint8_t *src_u0, const uint8_t *src_u1,
+                                          const uint8_t *src_v0, const uint8_t *src_v1, int weight, int width )
+{
+    /* Interleave Cb and Cr within each lane after packuswb. */
+    const __m256i mask = _mm256_setr_epi8( 0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15,
+                                           0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15 );
+    const __m256i w = _mm256_set1_epi16( (short)(weight | ((8 - weight) << 8)) );
+    const __m256i r = _mm256_set1_epi16( 4 );
+    int x = 0;
+    for( ; x <= width - 32; x += 32 )
+    {
+        __m128i u0 = _mm_loadu_si128( (const __m128i *)(src_u0 + x / 2) );
+        __m128i u1 = _mm_loadu_si128( (const __m128i *)(src_u1 + x / 2) );
+        __m128i v0 = _mm_loadu_si128( (const __m128i *)(src_v0 + x / 2) );
+        __m128i v1 = _mm_loadu_si128( (const __m128i *)(src_v1 + x / 2) );
+        __m256i u  = _mm256_inserti128_si256( _mm256_castsi128_si256( _mm_unpacklo_epi8( u0, u1 ) ), _mm_unpackhi_epi8( u0, u1 ), 1 );
+        __m256i v  = _mm256_inserti128_si256( _mm256_castsi128_si256( _mm_unpacklo_epi8( v0, v1 ) ), _mm_unpackhi_epi8( v0, v1 ), 1 );
+        u = _mm256_srli_epi16( _mm256_add_epi16( _mm256_maddubs_epi16( u, w ), r ), 3 );
+        v = _mm256_srli_epi16( _mm256_add_epi16( _mm256_maddubs_epi16( v, w ), r ), 3 );
+        __m256i c  = _mm256_shuffle_epi8( _mm256_packus_epi16( u, v ), mask );
+        __m256i y  = _mm256_loadu_si256( (const __m256i *)(src_y + x) );
+        __m256i p0 = _mm256_unpacklo_epi8( y, c );
+        __m256i p1 = _mm256_unpackhi_epi8( y, c );
+        _mm256_storeu_si256( (__m256i *)(dst + 2 * x     ), _mm256_permute2x128_si256( p0, p1, 0x20 ) );
+        _mm256_storeu_si256( (__m256i *)(dst + 2 * x + 32), _mm256_permute2x128_si256( p0, p1, 0x31 ) );
+    }
+    yuy2_row_ssse3( dst + 2 * x, src_y + x, src_u0 + x / 2, src_u1 + x / 2, src_v0 + x / 2, src_v1 + x / 2, weight, width - x );
+}
+
+static LW_TARGET_AVX2 LW_FORCEINLINE __m256i interpolate_chroma16_avx2( __m256i a, __m256i b, __m256i w, __m256i offset, __m128i count, int left )
+{
+    const __m256i bias = _mm256_set1_epi16( (short)0x8000 );
+    a = _mm256_sub_epi16( a, bias );
+    b = _mm256_sub_epi16( b, bias );
+    __m256i lo = _mm256_add_epi32( _mm256_madd_epi16( _mm256_unpacklo_epi16( a, b ), w ), offset );
+    __m256i hi = _mm256_add_epi32( _mm256_madd_epi16( _mm256_unpackhi_epi16( a, b ), w ), offset );
+    lo = left ? _mm256_sll_epi32( lo, count ) : _mm256_srl_epi32( lo, count );
+    hi = left ? _mm256_sll_epi32( hi, count ) : _mm256_srl_epi32( hi, count );
+    return _mm256_packus_epi32( lo, hi );
+}
+
+static LW_TARGET_AVX2 void upsample_row_avx2( uint16_t *dst, const uint16_t *src0, const uint16_t *src1, int weight, int shift, int width )
+{
+    const __m256i w            = _mm256_set1_epi32( weight | ((8 - weight) << 16) );
+    const __m256i offset       = _mm256_set1_epi32( 8 * 32768 + (shift < 3 ? 1 << (2 - shift) : 0) );
+    const __m128i count        = _mm_cvtsi32_si128( shift < 3 ? 3 - shift : shift - 3 );
+    const int     left         = shift >= 3;
+    const int     chroma_width = (width + 1) >> 1;
+    int x = 0;
+    for( ; x + 16 < chroma_width; x += 16 )
+    {
+        __m256i c   = interpolate_chroma16_avx2( _mm256_loadu_si256( (const __m256i *)(src0 + x    ) ),
+                                                 _mm256_loadu_si256( (const __m256i *)(src1 + x    ) ), w, offset, count, left );
+        __m256i n   = interpolate_chroma16_avx2( _mm256_loadu_si256( (const __m256i *)(src0 + x + 1) ),
+                                                 _mm256_loadu_si256( (const __m256i *)(src1 + x + 1) ), w, offset, count, left );
+        __m256i avg = _mm256_avg_epu16( c, n );
+        __m256i p0  = _mm256_unpacklo_epi16( c, avg );
+        __m256i p1  = _mm256_unpackhi_epi16( c, avg );
+        _mm256_storeu_si256( (__m256i *)(dst + 2 * x     ), _mm256_permute2x128_si256( p0, p1, 0x20 ) );
+        _mm256_storeu_si256( (__m256i *)(dst + 2 * x + 16), _mm256_permute2x128_si256( p0, p1, 0x31 ) );
+    }
+    upsample_row_sse41( dst + 2 * x, src0 + x, src1 + x, weight, shift, width - 2 * x );
+}
+
+static LW_TARGET_AVX2 void shift_row_avx2( uint16_t *dst, const uint16_t *src, int shift, int width )
+{
+    const __m128i count = _mm_cvtsi32_si128( shift );
+    int x = 0;
+    for( ; x <= width - 16; x += 16 )
+        _mm256_storeu_si256( (__m256i *)(dst + x), _mm256_sll_epi16( _mm256_loadu_si256( (const __m256i *)(src + x) ), count ) );
+    shift_row_c( dst + x, src + x, shift, width - x );
+}
+
+static LW_TARGET_AVX2 LW_FORCEINLINE __m256i multiply_high_avx2( __m256i s, __m256i coef, __m256i offset )
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i lo = _mm256_srai_epi32( _mm256_add_epi32( _mm256_madd_epi16( _mm256_unpacklo_epi16( s, zero ), coef ), offset ), 16 );
+    __m256i hi = _mm256_srai_epi32( _mm256_add_epi32( _mm256_madd_epi16( _mm256_unpackhi_epi16( s, zero ), coef ), offset ), 16 );
+    return _mm256_packs_epi32( lo, hi );
+}
+
+static LW_TARGET_AVX2 void pack48_row_avx2( uint8_t *dst, const uint16_t *src_y, const uint16_t *src_u, const uint16_t *src_v, int width, int mode )
+{
+    const __m256i bias       = _mm256_set1_epi16( (short)0x8000 );
+    const int     full_range = mode == PACK48_YC48_FULL;
+    const __m256i y_coef     = _mm256_set1_epi32( yc48_y_coef   [full_range] );
+    const __m256i y_offset   = _mm256_set1_epi16( (short)yc48_y_offset[full_range] );
+    const __m256i uv_coef    = _mm256_set1_epi32( yc48_uv_coef  [full_range] );
+    const __m256i uv_offset  = _mm256_set1_epi32( yc48_uv_offset[full_range] );
+    const __m256i zero       = _mm256_setzero_si256();
+    int x = 0;
+    for( ; x <= width - 16; x += 16 )
+    {
+        __m256i s[3];
+        s[0] = _mm256_loadu_si256( (const __m256i *)(src_y + x) );
+        s[1] = _mm256_loadu_si256( (const __m256i *)(src_u + x) );
+        s[2] = _mm256_loadu_si256( (const __m256i *)(src_v + x) );
+        if( mode != PACK48_LW48 )
+        {
+            s[0] = _mm256_add_epi16( multiply_high_avx2( _mm256_sub_epi16( s[0], bias ), y_coef, zero ), y_offset );
+            s[1] = multiply_high_avx2( _mm256_sub_epi16( s[1], bias ), uv_coef, uv_offset );
+            s[2] = multiply_high_avx2( _mm256_sub_epi16( s[2], bias ), uv_coef, uv_offset );
+        }
+        /* Each lane makes 48 bytes of 8 pixels. */
+        __m256i p[3];
+        for( int i = 0; i < 3; i++ )
+        {
+            p[i] = _mm256_shuffle_epi8( s[0], _mm256_broadcastsi128_si256( _mm_load_si128( (const __m128i *)interleave3_mask[i][0] ) ) );
+            p[i] = _mm256_or_si256( p[i], _mm256_shuffle_epi8( s[1], _mm256_broadcastsi128_si256( _mm_load_si128( (const __m128i *)interleave3_mask[i][1] ) ) ) );
+            p[i] = _mm256_or_si256( p[i], _mm256_shuffle_epi8( s[2], _mm256_broadcastsi128_si256( _mm_load_si128( (const __m128i *)interleave3_mask[i][2] ) ) ) );
+        }
+        _mm256_storeu_si256( (__m256i *)(dst + 6 * x     ), _mm256_permute2x128_si256( p[0], p[1], 0x20 ) );
+        _mm256_storeu_si256( (__m256i *)(dst + 6 * x + 32), _mm256_permute2x128_si256( p[2], p[0], 0x30 ) );
+        _mm256_storeu_si256( (__m256i *)(dst + 6 * x + 64), _mm256_permute2x128_si256( p[1], p[2], 0x31 ) );
+    }
+    pack48_row_ssse3( dst + 6 * x, src_y + x, src_u + x, src_v + x, width - x, mode );
+}
+
+/* Load 16 pixels of LW48 so that each lane holds 8 of them in the same layout as the three vectors of SSE. */
+static LW_TARGET_AVX2 LW_FORCEINLINE __m256i load_lw48_lanes_avx2( const uint16_t *src, int i )
+{
+    return _mm256_inserti128_si256( _mm256_castsi128_si256( _mm_loadu_si128( (const __m128i *)src + i ) ),
+                                    _mm_loadu_si128( (const __m128i *)src + i + 3 ), 1 );
+}
+
+static LW_TARGET_AVX2 void lw48_to_yuy2_row_avx2( uint8_t *dst, const uint16_t *src, int width )
+{
+    int x = 0;
+    for( ; x <= width - 16; x += 16 )
+    {
+        __m256i p = _mm256_setzero_si256();
+        for( int i = 0; i < 3; i++ )
+            p = _mm256_or_si256( p, _mm256_shuffle_epi8( load_lw48_lanes_avx2( src + 3 * x, i ),
+                                                         _mm256_broadcastsi128_si256( _mm_load_si128( (const __m128i *)lw48_to_yuy2_mask[i] ) ) ) );
+        _mm256_storeu_si256( (__m256i *)(dst + 2 * x), p );
+    }
+    lw48_to_yuy2_row_ssse3( dst + 2 * x, src + 3 * x, width - x );
+}
+
+static LW_TARGET_AVX2 void lw48_to_bgr24_row_avx2( uint8_t *dst, const uint16_t *src, int width )
+{
+    const __m256i bias     = _mm256_set1_epi16( (short)0x8000 );
+    const __m256i y_offset = _mm256_set1_epi16( 32768 - 4096 );
+    const __m256i y_coef   = _mm256_set1_epi16( 9539 );
+    const __m256i b_coef   = _mm256_set1_epi16( 16531 );
+    const __m256i g_coef   = _mm256_set1_epi32( (int)((uint32_t)(uint16_t)-6808 << 16 | (uint16_t)-3203) );
+    const __m256i r_coef   = _mm256_set1_epi16( 13074 );
+    const __m256i round    = _mm256_set1_epi32( 1 << 20 );
+    const __m256i zero     = _mm256_setzero_si256();
+    int x = 0;
+    for( ; x <= width - 16; x += 16 )
+    {
+        __m256i a  = load_lw48_lanes_avx2( src + 3 * x, 0 );
+        __m256i b  = load_lw48_lanes_avx2( src + 3 * x, 1 );
+        __m256i c  = load_lw48_lanes_avx2( src + 3 * x, 2 );
+        __m256i y  = _mm256_blend_epi16( _mm256_blend_epi16( a, b, 0x92 ), c, 0x24 );
+        __m256i cb = _mm256_blend_epi16( _mm256_blend_epi16( a, b, 0x24 ), c, 0x49 );
+        __m256i cr = _mm256_blend_epi16( _mm256_blend_epi16( a, b, 0x49 ), c, 0x92 );
+        y  = _mm256_sub_epi16( _mm256_shuffle_epi8( y,  _mm256_broadcastsi128_si256( _mm_load_si128( (const __m128i *)lw48_deinterleave_mask[0] ) ) ), bias );
+        cb = _mm256_sub_epi16( _mm256_shuffle_epi8( cb, _mm256_broadcastsi128_si256( _mm_load_si128( (const __m128i *)lw48_deinterleave_mask[1] ) ) ), bias );
+        cr = _mm256_sub_epi16( _mm256_shuffle_epi8( cr, _mm256_broadcastsi128_si256( _mm_load_si128( (const __m128i *)lw48_deinterleave_mask[2] ) ) ), bias );
+        __m256i y_lo = _mm256_add_epi32( _mm256_madd_epi16( _mm256_unpacklo_epi16( y, y_offset ), y_coef ), round );
+        __m256i y_hi = _mm256_add_epi32( _mm256_madd_epi16( _mm256_unpackhi_epi16( y, y_offset ), y_coef ), round );
+        __m256i lo   = _mm256_add_epi32( y_lo, _mm256_madd_epi16( _mm256_unpacklo_epi16( cb, cr ), g_coef ) );
+        __m256i hi   = _mm256_add_epi32( y_hi, _mm256_madd_epi16( _mm256_unpackhi_epi16( cb, cr ), g_coef ) );
+        __m256i g    = _mm256_packs_epi32( _mm256_srai_epi32( lo, 21 ), _mm256_srai_epi32( hi, 21 ) );
+        lo = _mm256_add_epi32( y_lo, _mm256_madd_epi16( _mm256_unpacklo_epi16( cb, zero ), b_coef ) );
+        hi = _mm256_add_epi32( y_hi, _mm256_madd_epi16( _mm256_unpackhi_epi16( cb, zero ), b_coef ) );
+        b  = _mm256_packs_epi32( _mm256_srai_epi32( lo, 21 ), _mm256_srai_epi32( hi, 21 ) );
+        lo = _mm256_add_epi32( y_lo, _mm256_madd_epi16( _mm256_unpacklo_epi16( cr, zero ), r_coef ) );
+        hi = _mm256_add_epi32( y_hi, _mm256_madd_epi16( _mm256_unpackhi_epi16( cr, zero ), r_coef ) );
+        __m256i r = _mm256_packs_epi32( _mm256_srai_epi32( lo, 21 ), _mm256_srai_epi32( hi, 21 ) );
+        /* Each lane holds 8 pixels, so gather the lower halves after packuswb into 16 pixels. */
+        b = _mm256_permute4x64_epi64( _mm256_packus_epi16( b, b ), 0x08 );
+        g = _mm256_permute4x64_epi64( _mm256_packus_epi16( g, g ), 0x08 );
+        r = _mm256_permute4x64_epi64( _mm256_packus_epi16( r, r ), 0x08 );
+        store_bgr24_ssse3( dst + 3 * x, _mm256_castsi256_si128( b ), _mm256_castsi256_si128( g ), _mm256_castsi256_si128( r ) );
+    }
+    lw48_to_bgr24_row_sse41( dst + 3 * x, src + 3 * x, width - x );
+}
+#endif  /* HAVE_AVX2_INTRINSICS */
+
+/*****************************************************************************
+ * Dispatchers
+ *****************************************************************************/
+void LW_FUNC_ALIGN lw_convert_yuv420p_i_to_yuy2
+(
+    uint8_t               *dst,
+    int                    dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height
+)
+{
+    yuy2_row_func *yuy2_row = yuy2_row_c;
+    int simd_level = lw_get_simd_level();
+#if HAVE_AVX2_INTRINSICS
+    if( simd_level >= LW_SIMD_LEVEL_AVX2 )
+        yuy2_row = yuy2_row_avx2;
+    else
+#endif
+    if( simd_level >= LW_SIMD_LEVEL_SSSE3 )
+        yuy2_row = yuy2_row_ssse3;
+    for( int y = 0; y < height; y++ )
+    {
+        int row0;
+        int row1;
+        int weight;
+        get_interlaced_chroma_rows( y, height, &row0, &row1, &weight );
+        yuy2_row( dst + (ptrdiff_t)dst_linesize * y,
+                  src_data[0] + (ptrdiff_t)src_linesize[0] * y,
+                  src_data[1] + (ptrdiff_t)src_linesize[1] * row0,
+                  src_data[1] + (ptrdiff_t)src_linesize[1] * row1,
+                  src_data[2] + (ptrdiff_t)src_linesize[2] * row0,
+                  src_data[2] + (ptrdiff_t)src_linesize[2] * row1,
+                  weight, width );
+    }
+}
+
+void LW_FUNC_ALIGN lw_convert_yuv420p_i_to_yuv444p16
+(
+    uint8_t       * const *dst_data,
+    const int             *dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height,
+    int                    bit_depth
+)
+{
+    upsample_row_func *upsample_row = upsample_row_c;
+    shift_row_func    *shift_row    = shift_row_c;
+    int simd_level = lw_get_simd_level();
+#if HAVE_AVX2_INTRINSICS
+    if( simd_level >= LW_SIMD_LEVEL_AVX2 )
+    {
+        upsample_row = upsample_row_avx2;
+        shift_row    = shift_row_avx2;
+    }
+    else
+#endif
+    if( simd_level >= LW_SIMD_LEVEL_SSE41 )
+    {
+        upsample_row = upsample_row_sse41;
+        shift_row    = shift_row_sse41;
+    }
+    const int shift = 16 - bit_depth;
+    for( int y = 0; y < height; y++ )
+    {
+        const uint16_t *src = (const uint16_t *)(src_data[0] + (ptrdiff_t)src_linesize[0] * y);
+        uint16_t       *dst = (uint16_t *)(dst_data[0] + (ptrdiff_t)dst_linesize[0] * y);
+        if( shift )
+            shift_row( dst, src, shift, width );
+        else
+            memcpy( dst, src, width * sizeof(uint16_t) );
+        int row0;
+        int row1;
+        int weight;
+        get_interlaced_chroma_rows( y, height, &row0, &row1, &weight );
+        for( int i = 1; i < 3; i++ )
+            upsample_row( (uint16_t *)(dst_data[i] + (ptrdiff_t)dst_linesize[i] * y),
+                          (const uint16_t *)(src_data[i] + (ptrdiff_t)src_linesize[i] * row0),
+                          (const uint16_t *)(src_data[i] + (ptrdiff_t)src_linesize[i] * row1),
+                          weight, shift, width );
+    }
+}
+
+static void pack48
+(
+    uint8_t               *dst,
+    int                    dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height,
+    int                    mode
+)
+{
+    pack48_row_func *pack48_row = pack48_row_c;
+    int simd_level = lw_get_simd_level();
+#if HAVE_AVX2_INTRINSICS
+    if( simd_level >= LW_SIMD_LEVEL_AVX2 )
+        pack48_row = pack48_row_avx2;
+    else
+#endif
+    if( simd_level >= LW_SIMD_LEVEL_SSSE3 )
+        pack48_row = pack48_row_ssse3;
+    for( int y = 0; y < height; y++ )
+        pack48_row( dst + (ptrdiff_t)dst_linesize * y,
+                    (const uint16_t *)(src_data[0] + (ptrdiff_t)src_linesize[0] * y),
+                    (const uint16_t *)(src_data[1] + (ptrdiff_t)src_linesize[1] * y),
+                    (const uint16_t *)(src_data[2] + (ptrdiff_t)src_linesize[2] * y),
+                    width, mode );
+}
+
+void LW_FUNC_ALIGN lw_convert_yuv444p16_to_yc48
+(
+    uint8_t               *dst,
+    int                    dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height,
+    int                    full_range
+)
+{
+    pack48( dst, dst_linesize, src_data, src_linesize, width, height, full_range ? PACK48_YC48_FULL : PACK48_YC48_LIMITED );
+}
+
+void LW_FUNC_ALIGN lw_convert_yuv444p16_to_lw48
+(
+    uint8_t               *dst,
+    int                    dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height
+)
+{
+    pack48( dst, dst_linesize, src_data, src_linesize, width, height, PACK48_LW48 );
+}
+
+static void convert_lw48
+(
+    uint8_t       *dst,
+    int            dst_linesize,
+    const uint8_t *src,
+    int            src_linesize,
+    int            width,
+    int            height,
+    lw48_row_func *lw48_row
+)
+{
+    for( int y = 0; y < height; y++ )
+        lw48_row( dst + (ptrdiff_t)dst_linesize * y, (const uint16_t *)(src + (ptrdiff_t)src_linesize * y), width );
+}
+
+void LW_FUNC_ALIGN lw_convert_lw48_to_yuy2
+(
+    uint8_t       *dst,
+    int            dst_linesize,
+    const uint8_t *src,
+    int            src_linesize,
+    int            width,
+    int            height
+)
+{
+    lw48_row_func *lw48_row = lw48_to_yuy2_row_c;
+    int simd_level = lw_get_simd_level();
+#if HAVE_AVX2_INTRINSICS
+    if( simd_level >= LW_SIMD_LEVEL_AVX2 )
+        lw48_row = lw48_to_yuy2_row_avx2;
+    else
+#endif
+    if( simd_level >= LW_SIMD_LEVEL_SSSE3 )
+        lw48_row = lw48_to_yuy2_row_ssse3;
+    convert_lw48( dst, dst_linesize, src, src_linesize, width, height, lw48_row );
+}
+
+void LW_FUNC_ALIGN lw_convert_lw48_to_bgr24
+(
+    uint8_t       *dst,
+    int            dst_linesize,
+    const uint8_t *src,
+    int            src_linesize,
+    int            width,
+    int            height
+)
+{
+    lw48_row_func *lw48_row = lw48_to_bgr24_row_c;
+    int simd_level = lw_get_simd_level();
+#if HAVE_AVX2_INTRINSICS
+    if( simd_level >= LW_SIMD_LEVEL_AVX2 )
+        lw48_row = lw48_to_bgr24_row_avx2;
+    else
+#endif
+    if( simd_level >= LW_SIMD_LEVEL_SSE41 )
+        lw48_row = lw48_to_bgr24_row_sse41;
+    convert_lw48( dst, dst_linesize, src, src_linesize, width, height, lw48_row );
+}
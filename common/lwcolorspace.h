@@ -0,0 +1,115 @@
+/*****************************************************************************
+ * lwcolorspace.h
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+#ifndef LWCOLORSPACE_H
+#define LWCOLORSPACE_H
+
+/* Kernels of the colorspace conversions which swscale doesn't do in the way the outputs expect,
+ * i.e. the chroma upsampling of interlaced YUV 4:2:0 by fields and the packing into and out of the internal formats of AviUtl.
+ * The packing into LW48 is also the interleaving of any three planes of 16 bits, which lwconvert uses for RGB48.
+ * The fastest implementation among C, SSSE3, SSE4.1 and AVX2 is chosen at runtime,
+ * and all of them give identical results. No alignment of pointers or linesizes is required,
+ * and nothing is written beyond the rows of the destination except the last pair of odd widths noted below.
+ * Widths are in pixels. The planes of 16-bit samples are in the native endian. */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  /* __cplusplus */
+
+/* Convert interlaced 8-bit YUV 4:2:0 of width x height into YUY2.
+ * The chroma of each field is interpolated vertically with the weights suggested in the MPEG-2 spec.
+ * YUY2 is written in whole pairs of pixels, so the last pair of an odd width is completed by repeating the luma. */
+void lw_convert_yuv420p_i_to_yuy2
+(
+    uint8_t               *dst,
+    int                    dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height
+);
+
+/* Convert interlaced YUV 4:2:0 of 'bit_depth' bits from 9 to 16 into YUV 4:4:4 of 16 bits.
+ * The chroma is interpolated vertically in the same way as lw_convert_yuv420p_i_to_yuy2()
+ * and then horizontally by averaging the neighbours. */
+void lw_convert_yuv420p_i_to_yuv444p16
+(
+    uint8_t       * const *dst_data,
+    const int             *dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height,
+    int                    bit_depth
+);
+
+/* Pack YUV 4:4:4 of 16 bits into YC48 of AviUtl, the full or the limited range of which is given by 'full_range'. */
+void lw_convert_yuv444p16_to_yc48
+(
+    uint8_t               *dst,
+    int                    dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height,
+    int                    full_range
+);
+
+/* Pack YUV 4:4:4 of 16 bits into LW48, i.e. Y, Cb and Cr of 16 bits interleaved. */
+void lw_convert_yuv444p16_to_lw48
+(
+    uint8_t               *dst,
+    int                    dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height
+);
+
+/* Convert LW48 into YUY2 by taking the upper 8 bits of the samples and the chroma of the first pixel of each pair.
+ * The last pair of an odd width is completed in the same way as lw_convert_yuv420p_i_to_yuy2(). */
+void lw_convert_lw48_to_yuy2
+(
+    uint8_t       *dst,
+    int            dst_linesize,
+    const uint8_t *src,
+    int            src_linesize,
+    int            width,
+    int            height
+);
+
+/* Convert LW48 into BGR24 with the matrix of BT.601 of the limited range which AviUtl uses.
+ * Negative linesizes are allowed, e.g. to write a bottom-up DIB. */
+void lw_convert_lw48_to_bgr24
+(
+    uint8_t       *dst,
+    int            dst_linesize,
+    const uint8_t *src,
+    int            src_linesize,
+    int            width,
+    int            height
+);
+
+#ifdef __cplusplus
+}
+#endif  /* __cplusplus */
+
+#endif /* LWCOLORSPACE_H */
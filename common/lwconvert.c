@@ -0,0 +1,1125 @@
+/*****************************************************************************
+ * lwconvert.c
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+#include "cpp_compat.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "lwsimd.h"
+
+#include <emmintrin.h>  /* SSE2 */
+#include <tmmintrin.h>  /* SSSE3 */
+#if HAVE_AVX2_INTRINSICS || HAVE_AVX512_INTRINSICS
+#include <immintrin.h>  /* AVX2, AVX-512 */
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  /* __cplusplus */
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+#ifdef __cplusplus
+}
+#endif  /* __cplusplus */
+
+#include "utils.h"
+#include "lwcolorspace.h"
+#include "lwconvert.h"
+
+enum
+{
+    LAYOUT_PLANAR = 0,          /* Planes are copied as they are. */
+    LAYOUT_SEMI_PLANAR,         /* The chroma of the input is interleaved on the second plane. */
+    LAYOUT_PACKED,              /* Both are packed and the bytes of every group of pixels are reordered. */
+    LAYOUT_PACKED_TO_PLANAR,    /* The input is packed 4:2:2 such as YUYV and the output is planar. */
+    LAYOUT_PLANAR_TO_PACKED,    /* The input is planar and the output is packed 4:2:2. */
+    LAYOUT_PLANAR_TO_PACKED48   /* The input is planar 16-bit and the output is packed 48-bit RGB such as BGR48. */
+};
+
+typedef void shift_row_func( uint8_t *dst, const uint8_t *src, int width, int shift );
+typedef void deinterleave_row_func( uint8_t *dst0, uint8_t *dst1, const uint8_t *src, int width, int shift );
+typedef void shuffle_row_func( uint8_t *dst, const uint8_t *src, int width, const lw_pixel_converter_t *converter );
+typedef void unpack_row_func( uint8_t *dst_y, uint8_t *dst_u, uint8_t *dst_v, const uint8_t *src, int width, const lw_pixel_converter_t *converter );
+typedef void pack_row_func( uint8_t *dst, const uint8_t *src_y, const uint8_t *src_u, const uint8_t *src_v, int width, const lw_pixel_converter_t *converter );
+
+struct lw_pixel_converter_tag
+{
+    int                    layout;
+    int                    plane_count;         /* the number of the output planes */
+    int                    bytes_per_sample;
+    int                    log2_chroma_w;
+    int                    log2_chroma_h;
+    int                    swap_chroma;         /* The second plane of the input holds Cr first. */
+    int                    shift;               /* the number of the padding bits under the input samples */
+    int                    group_size;          /* the number of the bytes of a group of packed pixels */
+    int                    group_pixels;        /* the number of the pixels of a group of packed pixels */
+    int                    luma_offset;         /* the byte offsets of the first luma, Cb and Cr of packed 4:2:2 */
+    int                    cb_offset;
+    int                    cr_offset;
+    uint8_t                shuffle[16];         /* the source offsets of the bytes of 16 bytes of the output from a whole group */
+    int                    plane_order[3];      /* the input planes of the first, second and third samples of packed 48-bit */
+    shift_row_func        *shift_row;
+    deinterleave_row_func *deinterleave_row;
+    shuffle_row_func      *shuffle_row;         /* NULL if no bytes are reordered */
+    unpack_row_func       *unpack_row;
+    pack_row_func         *pack_row;
+};
+
+/*****************************************************************************
+ * C references
+ *****************************************************************************/
+static void shift_row16_c( uint8_t *dst, const uint8_t *src, int width, int shift )
+{
+    const uint16_t *s = (const uint16_t *)src;
+    uint16_t       *d = (uint16_t *)dst;
+    for( int x = 0; x < width; x++ )
+        d[x] = s[x] >> shift;
+}
+
+static void deinterleave_row8_c( uint8_t *dst0, uint8_t *dst1, const uint8_t *src, int width, int shift )
+{
+    for( int x = 0; x < width; x++ )
+    {
+        dst0[x] = src[2 * x    ];
+        dst1[x] = src[2 * x + 1];
+    }
+}
+
+static void deinterleave_row16_c( uint8_t *dst0, uint8_t *dst1, const uint8_t *src, int width, int shift )
+{
+    const uint16_t *s  = (const uint16_t *)src;
+    uint16_t       *d0 = (uint16_t *)dst0;
+    uint16_t       *d1 = (uint16_t *)dst1;
+    for( int x = 0; x < width; x++ )
+    {
+        d0[x] = s[2 * x    ] >> shift;
+        d1[x] = s[2 * x + 1] >> shift;
+    }
+}
+
+static void extract_row8_c( uint8_t *dst, const uint8_t *src, int width, int offset )
+{
+    for( int x = 0; x < width; x++ )
+        dst[x] = src[4 * x + offset];
+}
+
+static void extract_row16_c( uint8_t *dst, const uint8_t *src, int width, int offset, int big_endian )
+{
+    const uint16_t *s = (const uint16_t *)src + offset;
+    uint16_t       *d = (uint16_t *)dst;
+    for( int x = 0; x < width; x++ )
+        d[x] = big_endian ? (uint16_t)((s[4 * x] >> 8) | (s[4 * x] << 8)) : s[4 * x];
+}
+
+/* 'width' is in bytes and a multiple of the group size. */
+static void shuffle_row_c( uint8_t *dst, const uint8_t *src, int width, const lw_pixel_converter_t *converter )
+{
+    const int      group_size = converter->group_size;
+    const uint8_t *shuffle    = converter->shuffle;
+    for( int x = 0; x < width; x += group_size )
+        for( int i = 0; i < group_size; i++ )
+            dst[x + i] = src[x + shuffle[i]];
+}
+
+/* 'width' is in pixels. The second luma of a pair of pixels follows the first one by 2 bytes. */
+static void unpack_row422_c( uint8_t *dst_y, uint8_t *dst_u, uint8_t *dst_v, const uint8_t *src, int width, const lw_pixel_converter_t *converter )
+{
+    const int luma = converter->luma_offset;
+    const int cb   = converter->cb_offset;
+    const int cr   = converter->cr_offset;
+    for( int x = 0; x < width; x += 2 )
+    {
+        const uint8_t *s = src + 2 * x;
+        dst_y[x] = s[luma];
+        if( x + 1 < width )
+            dst_y[x + 1] = s[luma + 2];
+        dst_u[x >> 1] = s[cb];
+        dst_v[x >> 1] = s[cr];
+    }
+}
+
+/* The pair of the last pixel of an odd width has it as both lumas. */
+static void pack_row422_c( uint8_t *dst, const uint8_t *src_y, const uint8_t *src_u, const uint8_t *src_v, int width, const lw_pixel_converter_t *converter )
+{
+    const int luma = converter->luma_offset;
+    const int cb   = converter->cb_offset;
+    const int cr   = converter->cr_offset;
+    for( int x = 0; x < width; x += 2 )
+    {
+        uint8_t *d = dst + 2 * x;
+        d[luma    ] = src_y[x];
+        d[luma + 2] = src_y[x + 1 < width ? x + 1 : x];
+        d[cb      ] = src_u[x >> 1];
+        d[cr      ] = src_v[x >> 1];
+    }
+}
+
+/* 'width' is in bytes. The pattern is repeated from 'dst' in the native byte order. */
+static void fill_row_c( uint8_t *dst, int width, uint32_t pattern )
+{
+    int x = 0;
+    for( ; x <= width - 4; x += 4 )
+        memcpy( dst + x, &pattern, 4 );
+    if( x < width )
+        memcpy( dst + x, &pattern, width - x );
+}
+
+/*****************************************************************************
+ * SSE2
+ *****************************************************************************/
+/* SSE2 has no unsigned saturation from 32-bit to 16-bit.
+ * The inputs shall be in the range of 0 to 0xFFFF. */
+static LW_FORCEINLINE __m128i packus_epi32_sse2( __m128i low, __m128i high )
+{
+    const __m128i val_32 = _mm_set1_epi32( 0x8000 );
+    const __m128i val_16 = _mm_set1_epi16( (short)0x8000 );
+    low  = _mm_sub_epi32( low,  val_32 );
+    high = _mm_sub_epi32( high, val_32 );
+    return _mm_add_epi16( _mm_packs_epi32( low, high ), val_16 );
+}
+
+static void shift_row16_sse2( uint8_t *dst, const uint8_t *src, int width, int shift )
+{
+    const __m128i count = _mm_cvtsi32_si128( shift );
+    int x = 0;
+    for( ; x <= width - 8; x += 8 )
+    {
+        __m128i s = _mm_loadu_si128( (const __m128i *)(src + 2 * x) );
+        _mm_storeu_si128( (__m128i *)(dst + 2 * x), _mm_srl_epi16( s, count ) );
+    }
+    shift_row16_c( dst + 2 * x, src + 2 * x, width - x, shift );
+}
+
+static void deinterleave_row8_sse2( uint8_t *dst0, uint8_t *dst1, const uint8_t *src, int width, int shift )
+{
+    const __m128i mask = _mm_set1_epi16( 0x00FF );
+    int x = 0;
+    for( ; x <= width - 16; x += 16 )
+    {
+        __m128i a = _mm_loadu_si128( (const __m128i *)(src + 2 * x     ) );
+        __m128i b = _mm_loadu_si128( (const __m128i *)(src + 2 * x + 16) );
+        _mm_storeu_si128( (__m128i *)(dst0 + x), _mm_packus_epi16( _mm_and_si128( a, mask ), _mm_and_si128( b, mask ) ) );
+        _mm_storeu_si128( (__m128i *)(dst1 + x), _mm_packus_epi16( _mm_srli_epi16( a, 8 ), _mm_srli_epi16( b, 8 ) ) );
+    }
+    deinterleave_row8_c( dst0 + x, dst1 + x, src + 2 * x, width - x, shift );
+}
+
+static void deinterleave_row16_sse2( uint8_t *dst0, uint8_t *dst1, const uint8_t *src, int width, int shift )
+{
+    const __m128i mask   = _mm_set1_epi32( 0x0000FFFF );
+    const __m128i count0 = _mm_cvtsi32_si128( shift );
+    const __m128i count1 = _mm_cvtsi32_si128( shift + 16 );
+    int x = 0;
+    for( ; x <= width - 8; x += 8 )
+    {
+        __m128i a  = _mm_loadu_si128( (const __m128i *)(src + 4 * x     ) );
+        __m128i b  = _mm_loadu_si128( (const __m128i *)(src + 4 * x + 16) );
+        __m128i c0 = packus_epi32_sse2( _mm_srl_epi32( _mm_and_si128( a, mask ), count0 ),
+                                        _mm_srl_epi32( _mm_and_si128( b, mask ), count0 ) );
+        __m128i c1 = packus_epi32_sse2( _mm_srl_epi32( a, count1 ),
+                                        _mm_srl_epi32( b, count1 ) );
+        _mm_storeu_si128( (__m128i *)(dst0 + 2 * x), c0 );
+        _mm_storeu_si128( (__m128i *)(dst1 + 2 * x), c1 );
+    }
+    deinterleave_row16_c( dst0 + 2 * x, dst1 + 2 * x, src + 4 * x, width - x, shift );
+}
+
+static void extract_row8_sse2( uint8_t *dst, const uint8_t *src, int width, int offset )
+{
+    const __m128i mask  = _mm_set1_epi32( 0x000000FF );
+    const __m128i count = _mm_cvtsi32_si128( offset * 8 );
+    int x = 0;
+    for( ; x <= width - 16; x += 16 )
+    {
+        __m128i p0 = _mm_and_si128( _mm_srl_epi32( _mm_loadu_si128( (const __m128i *)(src + 4 * x     ) ), count ), mask );
+        __m128i p1 = _mm_and_si128( _mm_srl_epi32( _mm_loadu_si128( (const __m128i *)(src + 4 * x + 16) ), count ), mask );
+        __m128i p2 = _mm_and_si128( _mm_srl_epi32( _mm_loadu_si128( (const __m128i *)(src + 4 * x + 32) ), count ), mask );
+        __m128i p3 = _mm_and_si128( _mm_srl_epi32( _mm_loadu_si128( (const __m128i *)(src + 4 * x + 48) ), count ), mask );
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_packus_epi16( _mm_packs_epi32( p0, p1 ), _mm_packs_epi32( p2, p3 ) ) );
+    }
+    extract_row8_c( dst + x, src + 4 * x, width - x, offset );
+}
+
+static void extract_row16_sse2( uint8_t *dst, const uint8_t *src, int width, int offset, int big_endian )
+{
+    const __m128i mask  = _mm_set_epi32( 0, 0x0000FFFF, 0, 0x0000FFFF );
+    const __m128i count = _mm_cvtsi32_si128( offset * 16 );
+    int x = 0;
+    for( ; x <= width - 8; x += 8 )
+    {
+        /* Move the component to the lowest bits of each pixel, and then gather the lower halves of the pixels. */
+        __m128i p0 = _mm_and_si128( _mm_srl_epi64( _mm_loadu_si128( (const __m128i *)(src + 8 * x     ) ), count ), mask );
+        __m128i p1 = _mm_and_si128( _mm_srl_epi64( _mm_loadu_si128( (const __m128i *)(src + 8 * x + 16) ), count ), mask );
+        __m128i p2 = _mm_and_si128( _mm_srl_epi64( _mm_loadu_si128( (const __m128i *)(src + 8 * x + 32) ), count ), mask );
+        __m128i p3 = _mm_and_si128( _mm_srl_epi64( _mm_loadu_si128( (const __m128i *)(src + 8 * x + 48) ), count ), mask );
+        p0 = _mm_shuffle_epi32( p0, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+        p1 = _mm_shuffle_epi32( p1, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+        p2 = _mm_shuffle_epi32( p2, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+        p3 = _mm_shuffle_epi32( p3, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+        __m128i v = packus_epi32_sse2( _mm_unpacklo_epi64( p0, p1 ), _mm_unpacklo_epi64( p2, p3 ) );
+        if( big_endian )
+            v = _mm_or_si128( _mm_slli_epi16( v, 8 ), _mm_srli_epi16( v, 8 ) );
+        _mm_storeu_si128( (__m128i *)(dst + 2 * x), v );
+    }
+    extract_row16_c( dst + 2 * x, src + 8 * x, width - x, offset, big_endian );
+}
+
+static void fill_row_sse2( uint8_t *dst, int width, uint32_t pattern )
+{
+    const __m128i v = _mm_set1_epi32( (int)pattern );
+    int x = 0;
+    for( ; x <= width - 16; x += 16 )
+        _mm_storeu_si128( (__m128i *)(dst + x), v );
+    fill_row_c( dst + x, width - x, pattern );
+}
+
+static void pack_row422_sse2( uint8_t *dst, const uint8_t *src_y, const uint8_t *src_u, const uint8_t *src_v, int width, const lw_pixel_converter_t *converter )
+{
+    const int luma_first = converter->luma_offset == 0;
+    const int cb_first   = converter->cb_offset < converter->cr_offset;
+    int x = 0;
+    for( ; x <= width - 16; x += 16 )
+    {
+        __m128i y  = _mm_loadu_si128( (const __m128i *)(src_y + x) );
+        __m128i u  = _mm_loadl_epi64( (const __m128i *)(src_u + x / 2) );
+        __m128i v  = _mm_loadl_epi64( (const __m128i *)(src_v + x / 2) );
+        __m128i c  = cb_first ? _mm_unpacklo_epi8( u, v ) : _mm_unpacklo_epi8( v, u );
+        __m128i p0 = luma_first ? _mm_unpacklo_epi8( y, c ) : _mm_unpacklo_epi8( c, y );
+        __m128i p1 = luma_first ? _mm_unpackhi_epi8( y, c ) : _mm_unpackhi_epi8( c, y );
+        _mm_storeu_si128( (__m128i *)(dst + 2 * x     ), p0 );
+        _mm_storeu_si128( (__m128i *)(dst + 2 * x + 16), p1 );
+    }
+    pack_row422_c( dst + 2 * x, src_y + x, src_u + x / 2, src_v + x / 2, width - x, converter );
+}
+
+/*****************************************************************************
+ * SSSE3
+ *****************************************************************************/
+/* Every 16 bytes of the output are gathered from whole groups of the same 16 bytes of the input by pshufb.
+ * The groups of 3 or 6 bytes fill 15 or 12 bytes of them and the rest is overwritten by the next groups,
+ * so stop 16 bytes before the end of the row. */
+static LW_TARGET_SSSE3 void shuffle_row_ssse3( uint8_t *dst, const uint8_t *src, int width, const lw_pixel_converter_t *converter )
+{
+    const __m128i mask = _mm_loadu_si128( (const __m128i *)converter->shuffle );
+    const int     step = 16 - 16 % converter->group_size;
+    int x = 0;
+    for( ; x <= width - 16; x += step )
+    {
+        __m128i s = _mm_loadu_si128( (const __m128i *)(src + x) );
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_shuffle_epi8( s, mask ) );
+    }
+    shuffle_row_c( dst + x, src + x, width - x, converter );
+}
+
+/* Gather 8 lumas, 4 Cbs and 4 Crs of every 16 bytes in this order, and then combine two of them. */
+static LW_TARGET_SSSE3 void unpack_row422_ssse3( uint8_t *dst_y, uint8_t *dst_u, uint8_t *dst_v, const uint8_t *src, int width, const lw_pixel_converter_t *converter )
+{
+    const int luma = converter->luma_offset;
+    const int cb   = converter->cb_offset;
+    const int cr   = converter->cr_offset;
+    const __m128i mask = _mm_setr_epi8( luma, luma + 2, luma + 4, luma +  6, luma + 8, luma + 10, luma + 12, luma + 14,
+                                        cb,   cb   + 4, cb   + 8, cb   + 12, cr,       cr   +  4, cr   +  8, cr   + 12 );
+    int x = 0;
+    for( ; x <= width - 16; x += 16 )
+    {
+        __m128i a = _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i *)(src + 2 * x     ) ), mask );
+        __m128i b = _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i *)(src + 2 * x + 16) ), mask );
+        __m128i c = _mm_unpackhi_epi32( a, b );
+        _mm_storeu_si128( (__m128i *)(dst_y + x), _mm_unpacklo_epi64( a, b ) );
+        _mm_storel_epi64( (__m128i *)(dst_u + x / 2), c );
+        _mm_storel_epi64( (__m128i *)(dst_v + x / 2), _mm_srli_si128( c, 8 ) );
+    }
+    unpack_row422_c( dst_y + x, dst_u + x / 2, dst_v + x / 2, src + 2 * x, width - x, converter );
+}
+
+/*****************************************************************************
+ * AVX2
+ *****************************************************************************/
+#if HAVE_AVX2_INTRINSICS
+static LW_TARGET_AVX2 void shift_row16_avx2( uint8_t *dst, const uint8_t *src, int width, int shift )
+{
+    const __m128i count = _mm_cvtsi32_si128( shift );
+    int x = 0;
+    for( ; x <= width - 16; x += 16 )
+    {
+        __m256i s = _mm256_loadu_si256( (const __m256i *)(src + 2 * x) );
+        _mm256_storeu_si256( (__m256i *)(dst + 2 * x), _mm256_srl_epi16( s, count ) );
+    }
+    shift_row16_c( dst + 2 * x, src + 2 * x, width - x, shift );
+}
+
+/* The packs of AVX2 work in each 128-bit lane, so the 64-bit quarters are reordered from 0, 2, 1, 3 afterwards. */
+static LW_TARGET_AVX2 void deinterleave_row8_avx2( uint8_t *dst0, uint8_t *dst1, const uint8_t *src, int width, int shift )
+{
+    const __m256i mask = _mm256_set1_epi16( 0x00FF );
+    int x = 0;
+    for( ; x <= width - 32; x += 32 )
+    {
+        __m256i a  = _mm256_loadu_si256( (const __m256i *)(src + 2 * x     ) );
+        __m256i b  = _mm256_loadu_si256( (const __m256i *)(src + 2 * x + 32) );
+        __m256i c0 = _mm256_packus_epi16( _mm256_and_si256( a, mask ), _mm256_and_si256( b, mask ) );
+        __m256i c1 = _mm256_packus_epi16( _mm256_srli_epi16( a, 8 ), _mm256_srli_epi16( b, 8 ) );
+        _mm256_storeu_si256( (__m256i *)(dst0 + x), _mm256_permute4x64_epi64( c0, _MM_SHUFFLE( 3, 1, 2, 0 ) ) );
+        _mm256_storeu_si256( (__m256i *)(dst1 + x), _mm256_permute4x64_epi64( c1, _MM_SHUFFLE( 3, 1, 2, 0 ) ) );
+    }
+    deinterleave_row8_c( dst0 + x, dst1 + x, src + 2 * x, width - x, shift );
+}
+
+static LW_TARGET_AVX2 void deinterleave_row16_avx2( uint8_t *dst0, uint8_t *dst1, const uint8_t *src, int width, int shift )
+{
+    const __m256i mask   = _mm256_set1_epi32( 0x0000FFFF );
+    const __m128i count0 = _mm_cvtsi32_si128( shift );
+    const __m128i count1 = _mm_cvtsi32_si128( shift + 16 );
+    int x = 0;
+    for( ; x <= width - 16; x += 16 )
+    {
+        __m256i a  = _mm256_loadu_si256( (const __m256i *)(src + 4 * x     ) );
+        __m256i b  = _mm256_loadu_si256( (const __m256i *)(src + 4 * x + 32) );
+        __m256i c0 = _mm256_packus_epi32( _mm256_srl_epi32( _mm256_and_si256( a, mask ), count0 ),
+                                          _mm256_srl_epi32( _mm256_and_si256( b, mask ), count0 ) );
+        __m256i c1 = _mm256_packus_epi32( _mm256_srl_epi32( a, count1 ),
+                                          _mm256_srl_epi32( b, count1 ) );
+        _mm256_storeu_si256( (__m256i *)(dst0 + 2 * x), _mm256_permute4x64_epi64( c0, _MM_SHUFFLE( 3, 1, 2, 0 ) ) );
+        _mm256_storeu_si256( (__m256i *)(dst1 + 2 * x), _mm256_permute4x64_epi64( c1, _MM_SHUFFLE( 3, 1, 2, 0 ) ) );
+    }
+    deinterleave_row16_c( dst0 + 2 * x, dst1 + 2 * x, src + 4 * x, width - x, shift );
+}
+
+static LW_TARGET_AVX2 void fill_row_avx2( uint8_t *dst, int width, uint32_t pattern )
+{
+    const __m256i v = _mm256_set1_epi32( (int)pattern );
+    int x = 0;
+    for( ; x <= width - 64; x += 64 )
+    {
+        _mm256_storeu_si256( (__m256i *)(dst + x     ), v );
+        _mm256_storeu_si256( (__m256i *)(dst + x + 32), v );
+    }
+    for( ; x <= width - 32; x += 32 )
+        _mm256_storeu_si256( (__m256i *)(dst + x), v );
+    fill_row_c( dst + x, width - x, pattern );
+}
+
+/* Only for groups of 4 or 8 bytes, which never cross 128-bit lanes. */
+static LW_TARGET_AVX2 void extract_row8_avx2( uint8_t *dst, const uint8_t *src, int width, int offset )
+{
+    const __m256i mask  = _mm256_set1_epi32( 0x000000FF );
+    const __m256i order = _mm256_setr_epi32( 0, 4, 1, 5, 2, 6, 3, 7 );
+    const __m128i count = _mm_cvtsi32_si128( offset * 8 );
+    int x = 0;
+    for( ; x <= width - 32; x += 32 )
+    {
+        __m256i p0 = _mm256_and_si256( _mm256_srl_epi32( _mm256_loadu_si256( (const __m256i *)(src + 4 * x     ) ), count ), mask );
+        __m256i p1 = _mm256_and_si256( _mm256_srl_epi32( _mm256_loadu_si256( (const __m256i *)(src + 4 * x + 32) ), count ), mask );
+        __m256i p2 = _mm256_and_si256( _mm256_srl_epi32( _mm256_loadu_si256( (const __m256i *)(src + 4 * x + 64) ), count ), mask );
+        __m256i p3 = _mm256_and_si256( _mm256_srl_epi32( _mm256_loadu_si256( (const __m256i *)(src + 4 * x + 96) ), count ), mask );
+        /* The packs work within each lane, so the groups of 4 pixels end up in the order of 0, 2, 4, 6, 1, 3, 5 and 7. */
+        __m256i v  = _mm256_packus_epi16( _mm256_packs_epi32( p0, p1 ), _mm256_packs_epi32( p2, p3 ) );
+        _mm256_storeu_si256( (__m256i *)(dst + x), _mm256_permutevar8x32_epi32( v, order ) );
+    }
+    extract_row8_sse2( dst + x, src + 4 * x, width - x, offset );
+}
+
+static LW_TARGET_AVX2 void extract_row16_avx2( uint8_t *dst, const uint8_t *src, int width, int offset, int big_endian )
+{
+    const __m256i mask  = _mm256_set1_epi64x( 0x000000000000FFFF );
+    const __m256i order = _mm256_setr_epi32( 0, 4, 1, 5, 2, 6, 3, 7 );
+    const __m128i count = _mm_cvtsi32_si128( offset * 16 );
+    int x = 0;
+    for( ; x <= width - 16; x += 16 )
+    {
+        __m256i p0 = _mm256_and_si256( _mm256_srl_epi64( _mm256_loadu_si256( (const __m256i *)(src + 8 * x     ) ), count ), mask );
+        __m256i p1 = _mm256_and_si256( _mm256_srl_epi64( _mm256_loadu_si256( (const __m256i *)(src + 8 * x + 32) ), count ), mask );
+        __m256i p2 = _mm256_and_si256( _mm256_srl_epi64( _mm256_loadu_si256( (const __m256i *)(src + 8 * x + 64) ), count ), mask );
+        __m256i p3 = _mm256_and_si256( _mm256_srl_epi64( _mm256_loadu_si256( (const __m256i *)(src + 8 * x + 96) ), count ), mask );
+        /* Each component is in the lower half of a 32-bit integer of 0 in the upper half,
+         * so two packs gather them, and the pairs of pixels end up in the same order as extract_row8_avx2(). */
+        __m256i v  = _mm256_packus_epi32( _mm256_packus_epi32( p0, p1 ), _mm256_packus_epi32( p2, p3 ) );
+        v = _mm256_permutevar8x32_epi32( v, order );
+        if( big_endian )
+            v = _mm256_or_si256( _mm256_slli_epi16( v, 8 ), _mm256_srli_epi16( v, 8 ) );
+        _mm256_storeu_si256( (__m256i *)(dst + 2 * x), v );
+    }
+    extract_row16_sse2( dst + 2 * x, src + 8 * x, width - x, offset, big_endian );
+}
+
+static LW_TARGET_AVX2 void shuffle_row_avx2( uint8_t *dst, const uint8_t *src, int width, const lw_pixel_converter_t *converter )
+{
+    const __m256i mask = _mm256_broadcastsi128_si256( _mm_loadu_si128( (const __m128i *)converter->shuffle ) );
+    int x = 0;
+    for( ; x <= width - 32; x += 32 )
+    {
+        __m256i s = _mm256_loadu_si256( (const __m256i *)(src + x) );
+        _mm256_storeu_si256( (__m256i *)(dst + x), _mm256_shuffle_epi8( s, mask ) );
+    }
+    shuffle_row_ssse3( dst + x, src + x, width - x, converter );
+}
+
+/* The same as the SSSE3 version in each 128-bit lane.
+ * The lumas of each lane are put into the lower half and the chroma into the upper half, and then the halves are combined. */
+static LW_TARGET_AVX2 void unpack_row422_avx2( uint8_t *dst_y, uint8_t *dst_u, uint8_t *dst_v, const uint8_t *src, int width, const lw_pixel_converter_t *converter )
+{
+    const int luma = converter->luma_offset;
+    const int cb   = converter->cb_offset;
+    const int cr   = converter->cr_offset;
+    const __m256i mask  = _mm256_setr_epi8( luma, luma + 2, luma + 4, luma +  6, luma + 8, luma + 10, luma + 12, luma + 14,
+                                            cb,   cb   + 4, cb   + 8, cb   + 12, cr,       cr   +  4, cr   +  8, cr   + 12,
+                                            luma, luma + 2, luma + 4, luma +  6, luma + 8, luma + 10, luma + 12, luma + 14,
+                                            cb,   cb   + 4, cb   + 8, cb   + 12, cr,       cr   +  4, cr   +  8, cr   + 12 );
+    const __m256i order = _mm256_setr_epi32( 0, 1, 4, 5, 2, 6, 3, 7 );
+    int x = 0;
+    for( ; x <= width - 32; x += 32 )
+    {
+        __m256i a = _mm256_shuffle_epi8( _mm256_loadu_si256( (const __m256i *)(src + 2 * x     ) ), mask );
+        __m256i b = _mm256_shuffle_epi8( _mm256_loadu_si256( (const __m256i *)(src + 2 * x + 32) ), mask );
+        a = _mm256_permutevar8x32_epi32( a, order );
+        b = _mm256_permutevar8x32_epi32( b, order );
+        __m256i c = _mm256_permute4x64_epi64( _mm256_permute2x128_si256( a, b, 0x31 ), _MM_SHUFFLE( 3, 1, 2, 0 ) );
+        _mm256_storeu_si256( (__m256i *)(dst_y + x), _mm256_permute2x128_si256( a, b, 0x20 ) );
+        _mm_storeu_si128( (__m128i *)(dst_u + x / 2), _mm256_castsi256_si128( c ) );
+        _mm_storeu_si128( (__m128i *)(dst_v + x / 2), _mm256_extracti128_si256( c, 1 ) );
+    }
+    unpack_row422_ssse3( dst_y + x, dst_u + x / 2, dst_v + x / 2, src + 2 * x, width - x, converter );
+}
+
+/* The unpacks work in each 128-bit lane, so the lanes of the results are exchanged afterwards. */
+static LW_TARGET_AVX2 void pack_row422_avx2( uint8_t *dst, const uint8_t *src_y, const uint8_t *src_u, const uint8_t *src_v, int width, const lw_pixel_converter_t *converter )
+{
+    const int luma_first = converter->luma_offset == 0;
+    const int cb_first   = converter->cb_offset < converter->cr_offset;
+    int x = 0;
+    for( ; x <= width - 32; x += 32 )
+    {
+        __m256i y  = _mm256_loadu_si256( (const __m256i *)(src_y + x) );
+        __m128i u  = _mm_loadu_si128( (const __m128i *)(src_u + x / 2) );
+        __m128i v  = _mm_loadu_si128( (const __m128i *)(src_v + x / 2) );
+        __m128i c0 = cb_first ? _mm_unpacklo_epi8( u, v ) : _mm_unpacklo_epi8( v, u );
+        __m128i c1 = cb_first ? _mm_unpackhi_epi8( u, v ) : _mm_unpackhi_epi8( v, u );
+        __m256i c  = _mm256_inserti128_si256( _mm256_castsi128_si256( c0 ), c1, 1 );
+        __m256i p0 = luma_first ? _mm256_unpacklo_epi8( y, c ) : _mm256_unpacklo_epi8( c, y );
+        __m256i p1 = luma_first ? _mm256_unpackhi_epi8( y, c ) : _mm256_unpackhi_epi8( c, y );
+        _mm256_storeu_si256( (__m256i *)(dst + 2 * x     ), _mm256_permute2x128_si256( p0, p1, 0x20 ) );
+        _mm256_storeu_si256( (__m256i *)(dst + 2 * x + 32), _mm256_permute2x128_si256( p0, p1, 0x31 ) );
+    }
+    pack_row422_sse2( dst + 2 * x, src_y + x, src_u + x / 2, src_v + x / 2, width - x, converter );
+}
+#endif  /* HAVE_AVX2_INTRINSICS */
+
+/*****************************************************************************
+ * AVX-512
+ *****************************************************************************/
+#if HAVE_AVX512_INTRINSICS
+static LW_TARGET_AVX512BW void shift_row16_avx512bw( uint8_t *dst, const uint8_t *src, int width, int shift )
+{
+    const __m128i count = _mm_cvtsi32_si128( shift );
+    int x = 0;
+    for( ; x <= width - 32; x += 32 )
+    {
+        __m512i s = _mm512_loadu_si512( (const void *)(src + 2 * x) );
+        _mm512_storeu_si512( (void *)(dst + 2 * x), _mm512_srl_epi16( s, count ) );
+    }
+    shift_row16_c( dst + 2 * x, src + 2 * x, width - x, shift );
+}
+
+/* The packs of AVX-512 work in each 128-bit lane as well as AVX2,
+ * so the 64-bit eighths are reordered from 0, 2, 4, 6, 1, 3, 5, 7 afterwards. */
+static LW_TARGET_AVX512BW void deinterleave_row8_avx512bw( uint8_t *dst0, uint8_t *dst1, const uint8_t *src, int width, int shift )
+{
+    const __m512i mask  = _mm512_set1_epi16( 0x00FF );
+    const __m512i order = _mm512_set_epi64( 7, 5, 3, 1, 6, 4, 2, 0 );
+    int x = 0;
+    for( ; x <= width - 64; x += 64 )
+    {
+        __m512i a  = _mm512_loadu_si512( (const void *)(src + 2 * x     ) );
+        __m512i b  = _mm512_loadu_si512( (const void *)(src + 2 * x + 64) );
+        __m512i c0 = _mm512_packus_epi16( _mm512_and_si512( a, mask ), _mm512_and_si512( b, mask ) );
+        __m512i c1 = _mm512_packus_epi16( _mm512_srli_epi16( a, 8 ), _mm512_srli_epi16( b, 8 ) );
+        _mm512_storeu_si512( (void *)(dst0 + x), _mm512_permutexvar_epi64( order, c0 ) );
+        _mm512_storeu_si512( (void *)(dst1 + x), _mm512_permutexvar_epi64( order, c1 ) );
+    }
+    deinterleave_row8_c( dst0 + x, dst1 + x, src + 2 * x, width - x, shift );
+}
+
+static LW_TARGET_AVX512BW void deinterleave_row16_avx512bw( uint8_t *dst0, uint8_t *dst1, const uint8_t *src, int width, int shift )
+{
+    const __m512i mask   = _mm512_set1_epi32( 0x0000FFFF );
+    const __m512i order  = _mm512_set_epi64( 7, 5, 3, 1, 6, 4, 2, 0 );
+    const __m128i count0 = _mm_cvtsi32_si128( shift );
+    const __m128i count1 = _mm_cvtsi32_si128( shift + 16 );
+    int x = 0;
+    for( ; x <= width - 32; x += 32 )
+    {
+        __m512i a  = _mm512_loadu_si512( (const void *)(src + 4 * x     ) );
+        __m512i b  = _mm512_loadu_si512( (const void *)(src + 4 * x + 64) );
+        __m512i c0 = _mm512_packus_epi32( _mm512_srl_epi32( _mm512_and_si512( a, mask ), count0 ),
+                                          _mm512_srl_epi32( _mm512_and_si512( b, mask ), count0 ) );
+        __m512i c1 = _mm512_packus_epi32( _mm512_srl_epi32( a, count1 ),
+                                          _mm512_srl_epi32( b, count1 ) );
+        _mm512_storeu_si512( (void *)(dst0 + 2 * x), _mm512_permutexvar_epi64( order, c0 ) );
+        _mm512_storeu_si512( (void *)(dst1 + 2 * x), _mm512_permutexvar_epi64( order, c1 ) );
+    }
+    deinterleave_row16_c( dst0 + 2 * x, dst1 + 2 * x, src + 4 * x, width - x, shift );
+}
+#endif  /* HAVE_AVX512_INTRINSICS */
+
+/*****************************************************************************
+ * Converter
+ *****************************************************************************/
+static int is_native_sample_format
+(
+    const AVPixFmtDescriptor *desc
+)
+{
+    return desc
+        && !(desc->flags & (AV_PIX_FMT_FLAG_BE | AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM
+                          | AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BAYER | AV_PIX_FMT_FLAG_FLOAT))
+        && desc->comp[0].depth <= 16;
+}
+
+/* Check if every component lies on its own plane without padding bits. */
+static int is_planar_format
+(
+    const AVPixFmtDescriptor *desc,
+    int                       bytes_per_sample
+)
+{
+    for( int i = 0; i < desc->nb_components; i++ )
+        if( desc->comp[i].step   != bytes_per_sample
+         || desc->comp[i].offset != 0
+         || desc->comp[i].shift  != 0
+         || desc->comp[i].depth  != desc->comp[0].depth )
+            return 0;
+    return 1;
+}
+
+/* Check if the format is YUV with interleaved chroma on the second plane such as NV12 and P010. */
+static int is_semi_planar_format
+(
+    const AVPixFmtDescriptor *desc,
+    int                       bytes_per_sample
+)
+{
+    const AVComponentDescriptor *comp = desc->comp;
+    if( desc->nb_components != 3 || (desc->flags & AV_PIX_FMT_FLAG_RGB)
+     || comp[0].plane != 0 || comp[0].step != bytes_per_sample || comp[0].offset != 0 )
+        return 0;
+    for( int i = 1; i < 3; i++ )
+        if( comp[i].plane != 1
+         || comp[i].step  != 2 * bytes_per_sample
+         || comp[i].shift != comp[0].shift
+         || comp[i].depth != comp[0].depth )
+            return 0;
+    return comp[1].offset + comp[2].offset == bytes_per_sample;
+}
+
+/* Check if the format is 8-bit YUV 4:2:2 packed into 4 bytes per a pair of pixels such as YUYV and UYVY. */
+static int is_packed_yuv422_format
+(
+    const AVPixFmtDescriptor *desc
+)
+{
+    const AVComponentDescriptor *comp = desc->comp;
+    if( desc->nb_components != 3 || (desc->flags & (AV_PIX_FMT_FLAG_RGB | AV_PIX_FMT_FLAG_PLANAR))
+     || desc->log2_chroma_w != 1 || desc->log2_chroma_h != 0
+     || comp[0].step != 2 || comp[1].step != 4 || comp[2].step != 4 )
+        return 0;
+    for( int i = 0; i < 3; i++ )
+        if( comp[i].plane != 0 || comp[i].shift != 0 || comp[i].depth != 8 )
+            return 0;
+    /* The lumas take either the even or the odd bytes, and the chroma the others. */
+    return comp[0].offset <= 1
+        && comp[1].offset != comp[2].offset
+        && (comp[1].offset & 1) != comp[0].offset
+        && (comp[2].offset & 1) != comp[0].offset;
+}
+
+/* Check if the format is 16-bit RGB packed into 6 bytes per pixel without alpha such as RGB48 and BGR48. */
+static int is_packed_rgb48_format
+(
+    const AVPixFmtDescriptor *desc
+)
+{
+    const AVComponentDescriptor *comp = desc->comp;
+    if( desc->nb_components != 3 || !(desc->flags & AV_PIX_FMT_FLAG_RGB) || (desc->flags & AV_PIX_FMT_FLAG_PLANAR) )
+        return 0;
+    for( int i = 0; i < 3; i++ )
+        if( comp[i].plane != 0 || comp[i].step != 6 || comp[i].shift != 0 || comp[i].depth != 16 || (comp[i].offset & 1) )
+            return 0;
+    return comp[0].offset != comp[1].offset && comp[1].offset != comp[2].offset && comp[2].offset != comp[0].offset;
+}
+
+/* Set the source offsets of the bytes of a group of packed pixels, e.g. the 3 bytes of a pixel of RGB24
+ * or the 4 bytes of a pair of pixels of YUYV, to reorder the input pixels into the output ones.
+ * Both formats shall consist of the same components with the same steps and without padding bytes.
+ * Return the size of the group, or 0 if unavailable. */
+static int get_packed_shuffle
+(
+    const AVPixFmtDescriptor *in_desc,
+    const AVPixFmtDescriptor *out_desc,
+    int                       bytes_per_sample,
+    uint8_t                  *shuffle
+)
+{
+    const AVComponentDescriptor *in_comp  = in_desc->comp;
+    const AVComponentDescriptor *out_comp = out_desc->comp;
+    if( in_desc->nb_components != out_desc->nb_components
+     || (in_desc->flags & AV_PIX_FMT_FLAG_PLANAR) || (out_desc->flags & AV_PIX_FMT_FLAG_PLANAR) )
+        return 0;
+    int group_size = 0;
+    for( int i = 0; i < out_desc->nb_components; i++ )
+    {
+        if( in_comp[i].plane != 0 || out_comp[i].plane != 0
+         || in_comp[i].step  != out_comp[i].step
+         || in_comp[i].shift != 0 || out_comp[i].shift != 0
+         || in_comp[i].depth != 8 * bytes_per_sample || out_comp[i].depth != 8 * bytes_per_sample
+         || in_comp[i].offset + bytes_per_sample > in_comp[i].step
+         || out_comp[i].offset + bytes_per_sample > out_comp[i].step )
+            return 0;
+        group_size = MAX( group_size, out_comp[i].step );
+    }
+    if( group_size > 8 )
+        return 0;
+    /* The bytes not assigned by any component remain 0xFF. */
+    memset( shuffle, 0xFF, group_size );
+    for( int i = 0; i < out_desc->nb_components; i++ )
+    {
+        if( group_size % out_comp[i].step )
+            return 0;
+        for( int k = 0; k < group_size; k += out_comp[i].step )
+            for( int b = 0; b < bytes_per_sample; b++ )
+                shuffle[k + out_comp[i].offset + b] = (uint8_t)(k + in_comp[i].offset + b);
+    }
+    for( int i = 0; i < group_size; i++ )
+        if( shuffle[i] == 0xFF )
+            return 0;
+    return group_size;
+}
+
+/* Extend the order of the bytes of a group to the mask of pshufb over 16 bytes.
+ * Return 1 if the order keeps every byte in place. */
+static int setup_packed_shuffle
+(
+    lw_pixel_converter_t *converter
+)
+{
+    const int group_size = converter->group_size;
+    const int step       = 16 - 16 % group_size;
+    uint8_t   shuffle[8];
+    int       identity   = 1;
+    memcpy( shuffle, converter->shuffle, group_size );
+    for( int i = 0; i < group_size; i++ )
+        identity &= shuffle[i] == i;
+    for( int i = 0; i < 16; i++ )
+        converter->shuffle[i] = i < step ? (uint8_t)(i / group_size * group_size + shuffle[i % group_size]) : 0x80;
+    return identity;
+}
+
+static void select_row_functions
+(
+    lw_pixel_converter_t *converter,
+    int                   identity
+)
+{
+    int simd_level = lw_get_simd_level();
+    int is_16bit   = converter->bytes_per_sample == 2;
+    int lane_safe  = 16 % converter->group_size == 0;
+    converter->shift_row        = shift_row16_c;
+    converter->deinterleave_row = is_16bit ? deinterleave_row16_c : deinterleave_row8_c;
+    converter->shuffle_row      = shuffle_row_c;
+    converter->unpack_row       = unpack_row422_c;
+    converter->pack_row         = pack_row422_c;
+    if( simd_level >= LW_SIMD_LEVEL_SSE2 )
+    {
+        converter->shift_row        = shift_row16_sse2;
+        converter->deinterleave_row = is_16bit ? deinterleave_row16_sse2 : deinterleave_row8_sse2;
+        converter->pack_row         = pack_row422_sse2;
+    }
+    if( simd_level >= LW_SIMD_LEVEL_SSSE3 )
+    {
+        converter->shuffle_row = shuffle_row_ssse3;
+        converter->unpack_row  = unpack_row422_ssse3;
+    }
+#if HAVE_AVX2_INTRINSICS
+    if( simd_level >= LW_SIMD_LEVEL_AVX2 )
+    {
+        converter->shift_row        = shift_row16_avx2;
+        converter->deinterleave_row = is_16bit ? deinterleave_row16_avx2 : deinterleave_row8_avx2;
+        converter->unpack_row       = unpack_row422_avx2;
+        converter->pack_row         = pack_row422_avx2;
+        if( lane_safe )
+            converter->shuffle_row = shuffle_row_avx2;
+    }
+#endif
+#if HAVE_AVX512_INTRINSICS
+    if( simd_level >= LW_SIMD_LEVEL_AVX512BW )
+    {
+        converter->shift_row        = shift_row16_avx512bw;
+        converter->deinterleave_row = is_16bit ? deinterleave_row16_avx512bw : deinterleave_row8_avx512bw;
+    }
+#endif
+    if( identity )
+        converter->shuffle_row = NULL;
+}
+
+lw_pixel_converter_t *lw_pixel_converter_open
+(
+    enum AVPixelFormat input_pixel_format,
+    enum AVPixelFormat output_pixel_format
+)
+{
+    const AVPixFmtDescriptor *in_desc  = av_pix_fmt_desc_get( input_pixel_format );
+    const AVPixFmtDescriptor *out_desc = av_pix_fmt_desc_get( output_pixel_format );
+    /* Neither the bit depth nor the chroma subsampling can change.
+     * The YUV range never changes between YUV formats in the scaler configuration and RGB is always full range,
+     * so no sample values change as long as both formats are YUV or RGB.
+     * The alpha of the input is dropped if the output has no alpha as swscale does. */
+    if( !is_native_sample_format( in_desc ) || !is_native_sample_format( out_desc )
+     || in_desc->comp[0].depth != out_desc->comp[0].depth
+     || in_desc->log2_chroma_w != out_desc->log2_chroma_w
+     || in_desc->log2_chroma_h != out_desc->log2_chroma_h
+     || in_desc->nb_components  < out_desc->nb_components
+     || (in_desc->flags & AV_PIX_FMT_FLAG_RGB) != (out_desc->flags & AV_PIX_FMT_FLAG_RGB) )
+        return NULL;
+    int     bytes_per_sample = (out_desc->comp[0].depth + 7) >> 3;
+    int     layout;
+    int     group_size = 1;
+    uint8_t shuffle[16];
+    if( is_planar_format( out_desc, bytes_per_sample ) )
+    {
+        if( is_planar_format( in_desc, bytes_per_sample ) )
+        {
+            for( int i = 0; i < out_desc->nb_components; i++ )
+                if( in_desc->comp[i].plane != out_desc->comp[i].plane )
+                    return NULL;
+            layout = LAYOUT_PLANAR;
+        }
+        else if( out_desc->nb_components == 3 && is_semi_planar_format( in_desc, bytes_per_sample ) )
+            layout = LAYOUT_SEMI_PLANAR;
+        else if( out_desc->nb_components == 3 && is_packed_yuv422_format( in_desc ) )
+            layout = LAYOUT_PACKED_TO_PLANAR;
+        else
+            return NULL;
+    }
+    else if( is_packed_yuv422_format( out_desc ) && is_planar_format( in_desc, bytes_per_sample ) )
+    {
+        for( int i = 0; i < 3; i++ )
+            if( in_desc->comp[i].plane != i )
+                return NULL;
+        layout = LAYOUT_PLANAR_TO_PACKED;
+    }
+    else if( is_packed_rgb48_format( out_desc ) && is_planar_format( in_desc, bytes_per_sample ) )
+        layout = LAYOUT_PLANAR_TO_PACKED48;
+    else if( (group_size = get_packed_shuffle( in_desc, out_desc, bytes_per_sample, shuffle )) > 0 )
+        layout = LAYOUT_PACKED;
+    else
+        return NULL;
+    lw_pixel_converter_t *converter = (lw_pixel_converter_t *)lw_malloc_zero( sizeof(lw_pixel_converter_t) );
+    if( !converter )
+        return NULL;
+    const AVPixFmtDescriptor *packed_desc = layout == LAYOUT_PLANAR_TO_PACKED ? out_desc : in_desc;
+    converter->layout           = layout;
+    converter->plane_count      = layout == LAYOUT_PACKED ? 1 : out_desc->nb_components;
+    converter->bytes_per_sample = bytes_per_sample;
+    converter->log2_chroma_w    = out_desc->log2_chroma_w;
+    converter->log2_chroma_h    = out_desc->log2_chroma_h;
+    converter->swap_chroma      = layout == LAYOUT_SEMI_PLANAR && in_desc->comp[1].offset > in_desc->comp[2].offset;
+    converter->shift            = layout == LAYOUT_SEMI_PLANAR ? in_desc->comp[0].shift : 0;
+    converter->group_size       = group_size;
+    converter->group_pixels     = group_size / out_desc->comp[0].step;
+    converter->luma_offset      = packed_desc->comp[0].offset;
+    converter->cb_offset        = packed_desc->comp[1].offset;
+    converter->cr_offset        = packed_desc->comp[2].offset;
+    if( layout == LAYOUT_PLANAR_TO_PACKED48 )
+        for( int i = 0; i < 3; i++ )
+            converter->plane_order[out_desc->comp[i].offset / 2] = in_desc->comp[i].plane;
+    int identity = 0;
+    if( layout == LAYOUT_PACKED )
+    {
+        memcpy( converter->shuffle, shuffle, group_size );
+        identity = setup_packed_shuffle( converter );
+    }
+    select_row_functions( converter, identity );
+    return converter;
+}
+
+void lw_pixel_converter_close
+(
+    lw_pixel_converter_t **converter
+)
+{
+    lw_freep( converter );
+}
+
+void LW_FUNC_ALIGN lw_pixel_converter_convert_slice
+(
+    lw_pixel_converter_t  *converter,
+    uint8_t       * const *dst_data,
+    const int             *dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height,
+    int                    slice_y,
+    int                    slice_height
+)
+{
+    const int bytes_per_sample = converter->bytes_per_sample;
+    const int chroma_width     = AV_CEIL_RSHIFT( width, converter->log2_chroma_w );
+    const int chroma_y         = slice_y >> converter->log2_chroma_h;
+    const int chroma_height    = AV_CEIL_RSHIFT( MIN( slice_y + slice_height, height ), converter->log2_chroma_h ) - chroma_y;
+    slice_height = MIN( slice_height, height - slice_y );
+    if( slice_height <= 0 )
+        return;
+    if( converter->layout == LAYOUT_PACKED )
+    {
+        /* Whole groups are converted even if the last one is partially out of the picture. */
+        int            row_size = (width + converter->group_pixels - 1) / converter->group_pixels * converter->group_size;
+        uint8_t       *dst      = dst_data[0] + (ptrdiff_t)slice_y * dst_linesize[0];
+        const uint8_t *src      = src_data[0] + (ptrdiff_t)slice_y * src_linesize[0];
+        if( !converter->shuffle_row )
+            av_image_copy_plane( dst, dst_linesize[0], src, src_linesize[0], row_size, slice_height );
+        else
+            for( int y = 0; y < slice_height; y++ )
+            {
+                converter->shuffle_row( dst, src, row_size, converter );
+                dst += dst_linesize[0];
+                src += src_linesize[0];
+            }
+        return;
+    }
+    /* The chroma of packed 4:2:2 is never subsampled vertically. */
+    if( converter->layout == LAYOUT_PACKED_TO_PLANAR )
+    {
+        uint8_t       *dst_y = dst_data[0] + (ptrdiff_t)slice_y * dst_linesize[0];
+        uint8_t       *dst_u = dst_data[1] + (ptrdiff_t)slice_y * dst_linesize[1];
+        uint8_t       *dst_v = dst_data[2] + (ptrdiff_t)slice_y * dst_linesize[2];
+        const uint8_t *src   = src_data[0] + (ptrdiff_t)slice_y * src_linesize[0];
+        for( int y = 0; y < slice_height; y++ )
+        {
+            converter->unpack_row( dst_y, dst_u, dst_v, src, width, converter );
+            dst_y += dst_linesize[0];
+            dst_u += dst_linesize[1];
+            dst_v += dst_linesize[2];
+            src   += src_linesize[0];
+        }
+        return;
+    }
+    if( converter->layout == LAYOUT_PLANAR_TO_PACKED )
+    {
+        uint8_t       *dst   = dst_data[0] + (ptrdiff_t)slice_y * dst_linesize[0];
+        const uint8_t *src_y = src_data[0] + (ptrdiff_t)slice_y * src_linesize[0];
+        const uint8_t *src_u = src_data[1] + (ptrdiff_t)slice_y * src_linesize[1];
+        const uint8_t *src_v = src_data[2] + (ptrdiff_t)slice_y * src_linesize[2];
+        for( int y = 0; y < slice_height; y++ )
+        {
+            converter->pack_row( dst, src_y, src_u, src_v, width, converter );
+            dst   += dst_linesize[0];
+            src_y += src_linesize[0];
+            src_u += src_linesize[1];
+            src_v += src_linesize[2];
+        }
+        return;
+    }
+    if( converter->layout == LAYOUT_PLANAR_TO_PACKED48 )
+    {
+        /* The interleaving of three planes of 16 bits is the same as the packing of YUV 4:4:4 into LW48. */
+        const uint8_t *src[3];
+        int            src_stride[3];
+        for( int i = 0; i < 3; i++ )
+        {
+            int plane = converter->plane_order[i];
+            src       [i] = src_data[plane] + (ptrdiff_t)slice_y * src_linesize[plane];
+            src_stride[i] = src_linesize[plane];
+        }
+        lw_convert_yuv444p16_to_lw48( dst_data[0] + (ptrdiff_t)slice_y * dst_linesize[0], dst_linesize[0],
+                                      src, src_stride, width, slice_height );
+        return;
+    }
+    if( converter->layout == LAYOUT_PLANAR )
+    {
+        for( int i = 0; i < converter->plane_count; i++ )
+        {
+            int is_chroma = (i == 1 || i == 2);
+            int y         = is_chroma ? chroma_y : slice_y;
+            av_image_copy_plane( dst_data[i] + (ptrdiff_t)y * dst_linesize[i], dst_linesize[i],
+                                 src_data[i] + (ptrdiff_t)y * src_linesize[i], src_linesize[i],
+                                 (is_chroma ? chroma_width : width) * bytes_per_sample,
+                                 is_chroma ? chroma_height : slice_height );
+        }
+        return;
+    }
+    /* Luma */
+    uint8_t       *dst_y = dst_data[0] + (ptrdiff_t)slice_y * dst_linesize[0];
+    const uint8_t *src_y = src_data[0] + (ptrdiff_t)slice_y * src_linesize[0];
+    if( converter->shift )
+        for( int y = 0; y < slice_height; y++ )
+        {
+            converter->shift_row( dst_y, src_y, width, converter->shift );
+            dst_y += dst_linesize[0];
+            src_y += src_linesize[0];
+        }
+    else
+        av_image_copy_plane( dst_y, dst_linesize[0], src_y, src_linesize[0], width * bytes_per_sample, slice_height );
+    /* Chroma */
+    const int      first  = converter->swap_chroma ? 2 : 1;
+    const int      second = converter->swap_chroma ? 1 : 2;
+    uint8_t       *dst0   = dst_data[first ] + (ptrdiff_t)chroma_y * dst_linesize[first ];
+    uint8_t       *dst1   = dst_data[second] + (ptrdiff_t)chroma_y * dst_linesize[second];
+    const uint8_t *src    = src_data[1]      + (ptrdiff_t)chroma_y * src_linesize[1];
+    for( int y = 0; y < chroma_height; y++ )
+    {
+        converter->deinterleave_row( dst0, dst1, src, chroma_width, converter->shift );
+        dst0 += dst_linesize[first ];
+        dst1 += dst_linesize[second];
+        src  += src_linesize[1];
+    }
+}
+
+void lw_pixel_converter_convert
+(
+    lw_pixel_converter_t  *converter,
+    uint8_t       * const *dst_data,
+    const int             *dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height
+)
+{
+    lw_pixel_converter_convert_slice( converter, dst_data, dst_linesize, src_data, src_linesize, width, height, 0, height );
+}
+
+void LW_FUNC_ALIGN lw_extract_packed_component8
+(
+    uint8_t       *dst,
+    int            dst_linesize,
+    const uint8_t *src,
+    int            src_linesize,
+    int            width,
+    int            height,
+    int            offset
+)
+{
+    void (*extract_row)( uint8_t *, const uint8_t *, int, int ) = extract_row8_c;
+    int simd_level = lw_get_simd_level();
+#if HAVE_AVX2_INTRINSICS
+    if( simd_level >= LW_SIMD_LEVEL_AVX2 )
+        extract_row = extract_row8_avx2;
+    else
+#endif
+    if( simd_level >= LW_SIMD_LEVEL_SSE2 )
+        extract_row = extract_row8_sse2;
+    for( int y = 0; y < height; y++ )
+    {
+        extract_row( dst, src, width, offset );
+        dst += dst_linesize;
+        src += src_linesize;
+    }
+}
+
+void LW_FUNC_ALIGN lw_extract_packed_component16
+(
+    uint8_t       *dst,
+    int            dst_linesize,
+    const uint8_t *src,
+    int            src_linesize,
+    int            width,
+    int            height,
+    int            offset,
+    int            big_endian
+)
+{
+    void (*extract_row)( uint8_t *, const uint8_t *, int, int, int ) = extract_row16_c;
+    int simd_level = lw_get_simd_level();
+#if HAVE_AVX2_INTRINSICS
+    if( simd_level >= LW_SIMD_LEVEL_AVX2 )
+        extract_row = extract_row16_avx2;
+    else
+#endif
+    if( simd_level >= LW_SIMD_LEVEL_SSE2 )
+        extract_row = extract_row16_sse2;
+    for( int y = 0; y < height; y++ )
+    {
+        extract_row( dst, src, width, offset, big_endian );
+        dst += dst_linesize;
+        src += src_linesize;
+    }
+}
+
+void LW_FUNC_ALIGN lw_fill_plane
+(
+    uint8_t *dst,
+    int      dst_linesize,
+    int      width,
+    int      height,
+    uint32_t pattern
+)
+{
+    if( width <= 0 || height <= 0 )
+        return;
+    if( pattern == (pattern & 0xFF) * 0x01010101U )
+    {
+        /* The C runtime has the fastest fill of a byte. */
+        if( dst_linesize == width )
+            memset( dst, (int)(pattern & 0xFF), (size_t)width * height );
+        else
+            for( int y = 0; y < height; y++ )
+            {
+                memset( dst, (int)(pattern & 0xFF), width );
+                dst += dst_linesize;
+            }
+        return;
+    }
+    void (*fill_row)( uint8_t *, int, uint32_t ) = fill_row_c;
+    int simd_level = lw_get_simd_level();
+#if HAVE_AVX2_INTRINSICS
+    if( simd_level >= LW_SIMD_LEVEL_AVX2 )
+        fill_row = fill_row_avx2;
+    else
+#endif
+    if( simd_level >= LW_SIMD_LEVEL_SSE2 )
+        fill_row = fill_row_sse2;
+    for( int y = 0; y < height; y++ )
+    {
+        fill_row( dst, width, pattern );
+        dst += dst_linesize;
+    }
+}
+
+void lw_fill_plane_border
+(
+    uint8_t *dst,
+    int      dst_linesize,
+    int      plane_width,
+    int      plane_height,
+    int      picture_width,
+    int      picture_height,
+    uint32_t pattern
+)
+{
+    picture_width  = CLIP_VALUE( picture_width,  0, plane_width  );
+    picture_height = CLIP_VALUE( picture_height, 0, plane_height );
+    /* the right of the picture */
+    lw_fill_plane( dst + picture_width, dst_linesize, plane_width - picture_width, picture_height, pattern );
+    /* the bottom of the picture */
+    lw_fill_plane( dst + (ptrdiff_t)picture_height * dst_linesize, dst_linesize, plane_width, plane_height - picture_height, pattern );
+}
@@ -0,0 +1,140 @@
+/*****************************************************************************
+ * lwconvert.h
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+#ifndef LWCONVERT_H
+#define LWCONVERT_H
+
+/* Kernels of the pixel format conversions which only move samples, i.e. plane copies,
+ * deinterleaving semi-planar chroma, dropping the padding bits of P010 like formats,
+ * reordering the components of packed pixels such as RGB24 into BGR24 and RGBA into BGRA,
+ * packing or unpacking 8-bit YUV 4:2:2 such as YUYV and packing 16-bit planar RGB into RGB48 or BGR48.
+ * Their results are identical to the ones of swscale without scaling, range or colorspace conversion,
+ * so they replace swscale whenever applicable. The fastest implementation among C, SSE2, SSSE3, AVX2 and AVX-512
+ * is chosen at runtime. Fills of the padding around pictures are also here. */
+typedef struct lw_pixel_converter_tag lw_pixel_converter_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  /* __cplusplus */
+
+/* Return a converter from 'input_pixel_format' into 'output_pixel_format' at the same resolution.
+ * Return NULL if the conversion is not a simple move of samples or an allocation failed.
+ * Then, the caller should use swscale instead. */
+lw_pixel_converter_t *lw_pixel_converter_open
+(
+    enum AVPixelFormat input_pixel_format,
+    enum AVPixelFormat output_pixel_format
+);
+
+void lw_pixel_converter_close
+(
+    lw_pixel_converter_t **converter
+);
+
+/* Convert a picture of width x height.
+ * The planes of 'dst_data' are in the order of the output pixel format, e.g. G, B and R for GBRP.
+ * Linesizes may be negative. Packed output is written in whole groups of pixels, e.g. pairs of YUYV. */
+void lw_pixel_converter_convert
+(
+    lw_pixel_converter_t  *converter,
+    uint8_t       * const *dst_data,
+    const int             *dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height
+);
+
+/* Convert the rows from 'slice_y' to 'slice_y' + 'slice_height' - 1 of a picture of width x height.
+ * 'slice_y' shall be a multiple of 8 so that slices don't share chroma rows.
+ * Slices can be converted in parallel. */
+void lw_pixel_converter_convert_slice
+(
+    lw_pixel_converter_t  *converter,
+    uint8_t       * const *dst_data,
+    const int             *dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height,
+    int                    slice_y,
+    int                    slice_height
+);
+
+/* Copy a component of packed pixels consisting of 4 components, e.g. the alpha of RGBA, into a plane.
+ * 'offset' is the index of the component in a pixel. */
+void lw_extract_packed_component8
+(
+    uint8_t       *dst,
+    int            dst_linesize,
+    const uint8_t *src,
+    int            src_linesize,
+    int            width,
+    int            height,
+    int            offset
+);
+
+/* The same as lw_extract_packed_component8() but for 16-bit components.
+ * If 'big_endian' is set, the samples are byte-swapped into the native endian. */
+void lw_extract_packed_component16
+(
+    uint8_t       *dst,
+    int            dst_linesize,
+    const uint8_t *src,
+    int            src_linesize,
+    int            width,
+    int            height,
+    int            offset,
+    int            big_endian
+);
+
+/* Fill width x height bytes of a plane by repeating the 4-byte 'pattern' stored in the native byte order
+ * from the start of each row, e.g. 0x00800080 for 16-bit samples of 128.
+ * A pattern of a byte is filled by memset(). */
+void lw_fill_plane
+(
+    uint8_t *dst,
+    int      dst_linesize,
+    int      width,
+    int      height,
+    uint32_t pattern
+);
+
+/* Fill the area of a plane of plane_width x plane_height out of the picture of picture_width x picture_height
+ * placed at the top-left corner, i.e. the right and the bottom borders, in the same way as lw_fill_plane().
+ * Widths are in bytes. The picture width shall be a multiple of the period of the pattern.
+ * Nothing is filled if the picture covers the plane. */
+void lw_fill_plane_border
+(
+    uint8_t *dst,
+    int      dst_linesize,
+    int      plane_width,
+    int      plane_height,
+    int      picture_width,
+    int      picture_height,
+    uint32_t pattern
+);
+
+#ifdef __cplusplus
+}
+#endif  /* __cplusplus */
+
+#endif /* LWCONVERT_H */
@@ -50,12 +50,7 @@ extern "C"
 #include "lwindex_version.h"
 #include "decode.h"
 
-#include <sys/stat.h>
 #include "xxhash.h"
-#ifdef _WIN32
-#define WIN32_LEAN_AND_MEAN
-#include <windows.h>
-#endif
 
 typedef struct
 {
@@ -75,9 +70,26 @@ typedef struct
                                                  * 2: either VC-1 or WMV3 encapsulated in ASF */
     int                         already_decoded;
     int                         random_access_key_frame; /* if 1, then we know the stream contains Recovery Point SEI, and we will only recognize a key frame if parser_ctx->key_frame > 1. */
+    /* for deciding where decoding shall start to reconstruct each picture correctly */
+    int                         leading_type;       /* 1: leading picture decodable from its RAP e.g. RADL
+                                                     * 2: leading picture undecodable from its RAP e.g. RASL
+                                                     * 0: otherwise or unknown */
+    int                         is_reference;       /* 1: the picture may be used for reference
+                                                     * 0: the picture is never used for reference
+                                                     * -1: unknown */
+    int                         hevc_max_temporal_id;   /* the highest TemporalId of HEVC, or -1 if unknown */
+    int                         recovery_frame_cnt; /* recovery_frame_cnt of the recovery point SEI, or -1 if absent */
+    int                         recovery_refs;      /* the number of reference pictures remaining until the recovery point */
+    int                         recovery_pending;   /* if set to non-zero, the next picture is the recovery point */
+    int64_t                     recovery_pts;       /* PTS of the recovery point after the last keyframe */
     int (*decode)(AVCodecContext *, AVFrame *, int *, AVPacket * );
 } lwindex_helper_t;
 
+/* Where decoding shall start to reconstruct a picture correctly. This is stored in the index. */
+#define LW_DECODE_START_CLOSEST_RAP 0   /* the closest preceding RAP, or the one before it for a leading picture */
+#define LW_DECODE_START_OWN_RAP     1   /* the closest preceding RAP even for a leading picture e.g. RADL */
+#define LW_DECODE_START_PRIOR_RAP   2   /* the RAP before the closest one e.g. RASL or a picture before the recovery point */
+
 typedef struct
 {
     int                number_of_helpers;
@@ -678,6 +690,21 @@ static int decide_video_seek_method
     /* Set up keyframe list: presentation order (info) -> decoding order (keyframe_list) */
     for( uint32_t i = 1; i <= sample_count; i++ )
         vdhp->keyframe_list[ info[i].sample_number ] = !!(info[i].flags & LW_VFRAME_FLAG_KEY);
+    /* Set up the sorted list of keyframes in decoding order for binary search of random accessible points. */
+    uint32_t rap_count = 0;
+    for( uint32_t i = 1; i <= sample_count; i++ )
+        rap_count += vdhp->keyframe_list[i];
+    lw_freep( &vdhp->rap_list );
+    vdhp->rap_count = 0;
+    if( rap_count )
+    {
+        vdhp->rap_list = (uint32_t *)lw_malloc_zero( rap_count * sizeof(uint32_t) );
+        if( !vdhp->rap_list )
+            return -1;
+        for( uint32_t i = 1; i <= sample_count; i++ )
+            if( vdhp->keyframe_list[i] )
+                vdhp->rap_list[ vdhp->rap_count++ ] = i;
+    }
     return 0;
 }
 
@@ -946,6 +973,29 @@ static void vfr2cfr_settings
         vohp->frame_count = (uint32_t)(((double)vohp->cfr_num / vohp->cfr_den)
                                      * ((double)vdhp->stream_duration * vdhp->time_base.num / vdhp->time_base.den)
                                      + 0.5);
+        /* Create the map of output frames to source frames. */
+        int64_t *ts = (int64_t *)lw_malloc_zero( (vdhp->frame_count + 1) * sizeof(int64_t) );
+        if( ts )
+        {
+            /* Frames without the timestamp the seek is based on are unknown in time even if they have the other. */
+            int pts_based = !!(vdhp->lw_seek_flags & (SEEK_PTS_GENERATED | SEEK_PTS_BASED));
+            int dts_based = !!(vdhp->lw_seek_flags & SEEK_DTS_BASED);
+            for( uint32_t i = 1; i <= vdhp->frame_count; i++ )
+            {
+                int64_t frame_ts = pts_based ? vdhp->frame_list[i].pts
+                                 : dts_based ? vdhp->frame_list[i].dts
+                                 :             AV_NOPTS_VALUE;
+                ts[i] = frame_ts != AV_NOPTS_VALUE ? frame_ts - vdhp->min_ts : AV_NOPTS_VALUE;
+            }
+        }
+        int ret = ts ? lw_create_vfr2cfr_map( vohp, ts, vdhp->frame_count, vdhp->time_base.num, vdhp->time_base.den ) : -1;
+        lw_free( ts );
+        if( ret < 0 )
+        {
+            lw_log_show( &vdhp->lh, LW_LOG_ERROR, "Failed to create the VFR->CFR conversion map. Disable the conversion." );
+            vohp->vfr2cfr     = 0;
+            vohp->frame_count = vdhp->frame_count;
+        }
     }
     else
         vohp->vfr2cfr = 0;
@@ -1301,6 +1351,62 @@ static int make_vc1_ebdu
     return av_packet_ref( out_pkt, &helper->pkt );
 }
 
+/* Get the highest TemporalId of HEVC from the parameter sets out of band, i.e. the extradata
+ * in HEVCDecoderConfigurationRecord or in byte stream format.
+ * Return -1 if unknown. */
+static int get_hevc_max_temporal_id
+(
+    const uint8_t *extradata,
+    int            extradata_size
+)
+{
+    if( !extradata || extradata_size < 4 )
+        return -1;
+    const uint8_t *p   = extradata;
+    const uint8_t *end = extradata + extradata_size;
+    if( p[0] == 1 )
+    {
+        /* HEVCDecoderConfigurationRecord */
+        if( extradata_size < 23 )
+            return -1;
+        /* numTemporalLayers, 0 meaning unknown */
+        int num_temporal_layers = (p[21] >> 3) & 0x07;
+        int num_of_arrays       = p[22];
+        p += 23;
+        for( int i = 0; i < num_of_arrays && end - p >= 3; i++ )
+        {
+            int nal_unit_type = p[0] & 0x3f;
+            int num_nalus     = (p[1] << 8) | p[2];
+            p += 3;
+            for( int j = 0; j < num_nalus && end - p >= 2; j++ )
+            {
+                int nal_unit_length = (p[0] << 8) | p[1];
+                p += 2;
+                if( nal_unit_length > end - p )
+                    break;
+                if( nal_unit_type == 33 && nal_unit_length >= 3 )
+                    /* sps_max_sub_layers_minus1 of SPS */
+                    return (p[2] >> 1) & 0x07;
+                p += nal_unit_length;
+            }
+        }
+        return num_temporal_layers - 1;
+    }
+    /* byte stream format */
+    while( end - p >= 3 )
+    {
+        if( !(p[0] == 0 && p[1] == 0 && p[2] == 1) )
+        {
+            ++p;
+            continue;
+        }
+        p += 3;
+        if( end - p >= 3 && ((p[0] >> 1) & 0x3f) == 33 )
+            return (p[2] >> 1) & 0x07;
+    }
+    return -1;
+}
+
 static lwindex_helper_t *get_index_helper
 (
     lwindex_indexer_t *indexer,
@@ -1326,12 +1432,18 @@ static lwindex_helper_t *get_index_helper
         if( !helper )
             return NULL;
         indexer->helpers[ stream->index ] = helper;
-        /* Set up the decoder. */
+        helper->recovery_frame_cnt   = -1;
+        helper->recovery_pts         = AV_NOPTS_VALUE;
         AVCodecParameters *codecpar = stream->codecpar;
+        /* SPS in band, if any, overrides this. */
+        helper->hevc_max_temporal_id = codecpar->codec_id == AV_CODEC_ID_HEVC
+                                     ? get_hevc_max_temporal_id( codecpar->extradata, codecpar->extradata_size )
+                                     : -1;
+        /* Set up the decoder. */
         const char **preferred_decoder_names = codecpar->codec_type == AVMEDIA_TYPE_VIDEO
                                              ? indexer->preferred_video_decoder_names
                                              : indexer->preferred_audio_decoder_names;
-        if( find_and_open_decoder( &helper->codec_ctx, codecpar, preferred_decoder_names, indexer->prefer_video_hw_decoder, indexer->thread_count ) < 0 )
+        if( find_and_open_decoder( &helper->codec_ctx, codecpar, preferred_decoder_names, indexer->prefer_video_hw_decoder, indexer->thread_count, 0 ) < 0 )
             /* Failed to find and open an appropriate decoder, but do not abort indexing. */
             return helper;
         helper->mpeg12_video = (codecpar->codec_id == AV_CODEC_ID_MPEG1VIDEO || codecpar->codec_id == AV_CODEC_ID_MPEG2VIDEO);
@@ -1698,7 +1810,8 @@ static void investigate_pix_fmt_by_decoding
 )
 {
     int got_picture;
-    decode_video_packet( video_ctx, picture, &got_picture, pkt );
+    /* Resend the packet while the decoder refuses it. Every refusal outputs a frame, so this ends. */
+    while( decode_video_packet( video_ctx, picture, &got_picture, pkt ) > 0 );
 }
 
 static int make_packet_parsable
@@ -1719,6 +1832,262 @@ static int make_packet_parsable
     return apply_bsf( helper, ctx, out_pkt, in_pkt, NULL );
 }
 
+typedef struct
+{
+    const uint8_t *data;
+    const uint8_t *end;
+    int            zeros;       /* the number of consecutive zero bytes read last */
+    int            cache;
+    int            cache_bits;
+} rbsp_reader_t;
+
+/* Read a byte of RBSP, skipping emulation prevention bytes. */
+static int rbsp_read_byte
+(
+    rbsp_reader_t *reader
+)
+{
+    if( reader->zeros >= 2 && reader->data < reader->end && *reader->data == 0x03 )
+    {
+        ++ reader->data;
+        reader->zeros = 0;
+    }
+    if( reader->data >= reader->end )
+        return -1;
+    int byte = *reader->data++;
+    reader->zeros = byte ? 0 : reader->zeros + 1;
+    return byte;
+}
+
+static int rbsp_read_bit
+(
+    rbsp_reader_t *reader
+)
+{
+    if( reader->cache_bits == 0 )
+    {
+        if( (reader->cache = rbsp_read_byte( reader )) < 0 )
+            return -1;
+        reader->cache_bits = 8;
+    }
+    return (reader->cache >> --reader->cache_bits) & 1;
+}
+
+/* Read an unsigned Exp-Golomb code. Return -1 on error. */
+static int rbsp_read_ue
+(
+    rbsp_reader_t *reader
+)
+{
+    int leading_zeros = 0;
+    int bit;
+    while( (bit = rbsp_read_bit( reader )) == 0 )
+        if( ++leading_zeros > 30 )
+            return -1;
+    if( bit < 0 )
+        return -1;
+    int value = 0;
+    for( int i = 0; i < leading_zeros; i++ )
+    {
+        if( (bit = rbsp_read_bit( reader )) < 0 )
+            return -1;
+        value = (value << 1) | bit;
+    }
+    return (1 << leading_zeros) - 1 + value;
+}
+
+/* Get recovery_frame_cnt from an H.264 SEI RBSP. Return -1 if no recovery point SEI. */
+static int get_h264_recovery_frame_cnt
+(
+    const uint8_t *data,
+    const uint8_t *end
+)
+{
+    rbsp_reader_t reader = { data, end, 0, 0, 0 };
+    while( reader.data < reader.end && *reader.data != 0x80 )   /* rbsp_trailing_bits */
+    {
+        int payload_type = 0;
+        int payload_size = 0;
+        int byte;
+        do
+        {
+            if( (byte = rbsp_read_byte( &reader )) < 0 )
+                return -1;
+            payload_type += byte;
+        } while( byte == 0xff );
+        do
+        {
+            if( (byte = rbsp_read_byte( &reader )) < 0 )
+                return -1;
+            payload_size += byte;
+        } while( byte == 0xff );
+        if( payload_type == 6 )
+            return rbsp_read_ue( &reader );
+        for( int i = 0; i < payload_size; i++ )
+            if( rbsp_read_byte( &reader ) < 0 )
+                return -1;
+    }
+    return -1;
+}
+
+/* Investigate NAL units of an H.264 or HEVC picture to decide where decoding shall start to reconstruct it.
+ * Both byte stream format and length prefixed format are handled. */
+static void investigate_nal_units
+(
+    lwindex_helper_t *helper,
+    AVCodecContext   *ctx,
+    AVPacket         *pkt
+)
+{
+    helper->leading_type       = 0;
+    helper->is_reference       = -1;
+    helper->recovery_frame_cnt = -1;
+    if( (ctx->codec_id != AV_CODEC_ID_H264 && ctx->codec_id != AV_CODEC_ID_HEVC) || !pkt->data )
+        return;
+    const uint8_t *p   = pkt->data;
+    const uint8_t *end = pkt->data + pkt->size;
+    int length_size = 0;
+    if( !(pkt->size >= 4 && p[0] == 0 && p[1] == 0 && (p[2] == 1 || (p[2] == 0 && p[3] == 1))) )
+    {
+        /* lengthSizeMinusOne in AVCDecoderConfigurationRecord or HEVCDecoderConfigurationRecord */
+        length_size = 4;
+        if( ctx->codec_id == AV_CODEC_ID_H264 && ctx->extradata_size >= 5 && ctx->extradata[0] == 1 )
+            length_size = (ctx->extradata[4] & 0x03) + 1;
+        else if( ctx->codec_id == AV_CODEC_ID_HEVC && ctx->extradata_size >= 22 && ctx->extradata[0] == 1 )
+            length_size = (ctx->extradata[21] & 0x03) + 1;
+    }
+    while( p < end )
+    {
+        const uint8_t *nal;
+        const uint8_t *nal_end = NULL;
+        if( length_size )
+        {
+            if( end - p < length_size )
+                return;
+            uint32_t nal_size = 0;
+            for( int i = 0; i < length_size; i++ )
+                nal_size = (nal_size << 8) | *p++;
+            if( nal_size > (uint32_t)(end - p) )
+                return;
+            nal     = p;
+            nal_end = p + nal_size;
+        }
+        else
+        {
+            while( end - p >= 3 && !(p[0] == 0 && p[1] == 0 && p[2] == 1) )
+                ++p;
+            if( end - p < 3 )
+                return;
+            nal = p + 3;
+        }
+        if( end - nal < 2 )
+            return;
+        /* The first slice of the picture tells the rest, so the end of a NAL unit is searched only if needed. */
+        int nal_unit_type = ctx->codec_id == AV_CODEC_ID_H264 ? nal[0] & 0x1f : (nal[0] >> 1) & 0x3f;
+        if( ctx->codec_id == AV_CODEC_ID_H264 && (nal_unit_type == 1 || nal_unit_type == 5) )
+        {
+            helper->is_reference = !!(nal[0] & 0x60);   /* nal_ref_idc */
+            return;
+        }
+        if( ctx->codec_id == AV_CODEC_ID_HEVC && nal_unit_type < 32 )
+        {
+            helper->leading_type = (nal_unit_type == 6 || nal_unit_type == 7) ? 1     /* RADL_N or RADL_R */
+                                 : (nal_unit_type == 8 || nal_unit_type == 9) ? 2     /* RASL_N or RASL_R */
+                                 :                                              0;
+            /* A sub-layer non-reference picture, i.e. *_N, may still be referred by pictures of higher sub-layers,
+             * so it's never used for reference only if it belongs to the highest sub-layer. */
+            int temporal_id = (nal[1] & 0x07) - 1;
+            if( nal_unit_type <= 14 && !(nal_unit_type & 1) )
+                helper->is_reference = helper->hevc_max_temporal_id < 0 || temporal_id < helper->hevc_max_temporal_id;
+            else
+                helper->is_reference = 1;
+            return;
+        }
+        if( ctx->codec_id == AV_CODEC_ID_HEVC && nal_unit_type == 33 && end - nal >= 3 )
+            /* sps_max_sub_layers_minus1 of SPS */
+            helper->hevc_max_temporal_id = (nal[2] >> 1) & 0x07;
+        if( !nal_end )
+        {
+            nal_end = nal;
+            while( end - nal_end >= 3 && !(nal_end[0] == 0 && nal_end[1] == 0 && nal_end[2] == 1) )
+                ++nal_end;
+            if( end - nal_end < 3 )
+                nal_end = end;
+        }
+        if( ctx->codec_id == AV_CODEC_ID_H264 && nal_unit_type == 6 )
+        {
+            int recovery_frame_cnt = get_h264_recovery_frame_cnt( nal + 1, nal_end );
+            if( recovery_frame_cnt >= 0 )
+                helper->recovery_frame_cnt = recovery_frame_cnt;
+        }
+        p = nal_end;
+    }
+}
+
+/* Decide where decoding shall start to reconstruct the picture correctly.
+ * This shall be called for every picture of the stream in decoding order. */
+static int decide_decode_start
+(
+    lwindex_helper_t *helper,
+    AVPacket         *pkt
+)
+{
+    if( pkt->flags & AV_PKT_FLAG_KEY )
+    {
+        /* Decoding from a recovery point SEI with a positive recovery_frame_cnt, e.g. by intra refresh,
+         * reconstructs pictures correctly only at and after the recovery point in output order. */
+        helper->recovery_refs    = MAX( helper->recovery_frame_cnt, 0 );
+        helper->recovery_pending = helper->recovery_refs > 0;
+        helper->recovery_pts     = AV_NOPTS_VALUE;
+    }
+    int unrecovered;
+    if( helper->recovery_refs > 0 )
+    {
+        unrecovered = 1;
+        if( helper->is_reference > 0 )
+            --helper->recovery_refs;
+    }
+    else
+    {
+        if( helper->recovery_pending )
+        {
+            helper->recovery_pts     = pkt->pts;
+            helper->recovery_pending = 0;
+        }
+        unrecovered = pkt->pts != AV_NOPTS_VALUE && helper->recovery_pts != AV_NOPTS_VALUE && pkt->pts < helper->recovery_pts;
+    }
+    if( unrecovered || helper->leading_type == 2 )
+        return LW_DECODE_START_PRIOR_RAP;
+    if( helper->leading_type == 1 )
+        return LW_DECODE_START_OWN_RAP;
+    return LW_DECODE_START_CLOSEST_RAP;
+}
+
+static inline int get_decode_start_flags
+(
+    int decode_start
+)
+{
+    return decode_start == LW_DECODE_START_OWN_RAP   ? LW_VFRAME_FLAG_DECODABLE_LEADING
+         : decode_start == LW_DECODE_START_PRIOR_RAP ? LW_VFRAME_FLAG_PRIOR_RAP
+         :                                             0;
+}
+
+/* Return 1 if nothing refers to the picture, i.e. decoding it is needed only to output it. */
+static inline int is_non_reference_picture
+(
+    lwindex_helper_t *helper,
+    AVCodecContext   *ctx,
+    int               pict_type
+)
+{
+    if( ctx->codec_id == AV_CODEC_ID_H264 || ctx->codec_id == AV_CODEC_ID_HEVC )
+        return helper->is_reference == 0;
+    if( helper->mpeg12_video )
+        return (enum AVPictureType)pict_type == AV_PICTURE_TYPE_B;
+    return 0;
+}
+
 static int get_picture_type
 (
     lwindex_helper_t *helper,
@@ -1726,6 +2095,7 @@ static int get_picture_type
     AVPacket         *pkt
 )
 {
+    helper->is_reference = -1;
     if( !helper->parser_ctx )
         return 0;
     /* Get by the parser. */
@@ -1733,6 +2103,7 @@ static int get_picture_type
     int ret = make_packet_parsable( helper, ctx, &filtered_pkt, pkt );
     if( ret < 0 )
         return ret;
+    investigate_nal_units( helper, ctx, &filtered_pkt );
     uint8_t *dummy;
     int      dummy_size;
     av_parser_parse2( helper->parser_ctx, ctx,
@@ -1971,8 +2342,10 @@ static void disable_video_stream( lwlibav_video_decode_handler_t *vdhp )
 {
     lw_freep( &vdhp->frame_list );
     lw_freep( &vdhp->keyframe_list );
+    lw_freep( &vdhp->rap_list );
     lw_freep( &vdhp->order_converter );
     av_freep( &vdhp->index_entries );
+    vdhp->rap_count           = 0;
     vdhp->stream_index        = -1;
     vdhp->index_entries_count = 0;
     vdhp->frame_count         = 0;
@@ -2003,22 +2376,34 @@ static void cleanup_index_helpers( lwindex_indexer_t *indexer, AVFormatContext *
     av_freep( &indexer->helpers );
 }
 
-static uint64_t xxhash_file( const char *file_path, int64_t file_size )
+/* Get the size of the source and the hash of its head and tail to identify it.
+ * The source is read directly from the same backing store as the demuxer, i.e. the host supplied callbacks if any,
+ * and not through an I/O context since only the first and the last MiB are needed. */
+static int get_source_identity
+(
+    lwlibav_file_handler_t *lwhp,
+    int64_t                *file_size,
+    uint64_t               *file_hash
+)
 {
-    FILE *fp = lw_fopen( file_path, "rb" );
-    if( !fp ) return 0;
+    *file_size = lw_io_get_source_size( lwhp->file_path, lwhp->io_callbacks );
+    *file_hash = 0;
     uint8_t *file_buffer = (uint8_t *)lw_malloc_zero( 1 << 21 );
-    const size_t read_len = 1 << 20;
-    size_t buffer_len = fread( file_buffer, 1, read_len, fp );
-    if( file_size > (1 << 21) )
+    if( !file_buffer )
+        return -1;
+    const int read_len = 1 << 20;
+    int buffer_len = lw_io_read_source( lwhp->file_path, lwhp->io_callbacks, 0, file_buffer, read_len );
+    if( buffer_len < 0 )
     {
-        fseek( fp, -(1 << 20), SEEK_END );
-        buffer_len += fread( file_buffer + buffer_len, 1, read_len, fp );
+        lw_free( file_buffer );
+        return -1;
     }
-    fclose( fp );
-    uint64_t hash = XXH3_64bits( file_buffer, buffer_len );
+    if( *file_size > (1 << 21) )
+        buffer_len += MAX( lw_io_read_source( lwhp->file_path, lwhp->io_callbacks, *file_size - read_len,
+                                              file_buffer + buffer_len, read_len ), 0 );
+    *file_hash = XXH3_64bits( file_buffer, buffer_len );
     lw_free( file_buffer );
-    return hash;
+    return 0;
 }
 
 static char *create_lwi_path
@@ -2109,7 +2494,7 @@ static int create_index
     }
     /*
         # Structure of Libav reader index file
-        <LibavReaderIndexFile=16>
+        <LibavReaderIndexFile=17>
         <InputFilePath>foobar.omo</InputFilePath>
         <FileSize=1048576>
         <FileHash=0x0123456789abcdef>
@@ -2120,7 +2505,7 @@ static int create_index
         Codec=2,TimeBase=1001/24000,Width=1920,Height=1080,Format=yuv420p,ColorSpace=5
         </StreamInfo>
         Index=0,POS=0,PTS=2002,DTS=0,EDI=0
-        Key=1,Pic=1,POC=0,Repeat=1,Field=0
+        Key=1,Pic=1,POC=0,Repeat=1,Field=0,Start=0,Ref=1
         </LibavReaderIndex>
         <StreamDuration=0,0>5000</StreamDuration>
         <StreamIndexEntries=0,0,1>
@@ -2162,19 +2547,11 @@ static int create_index
         /* Write Index file header. */
         fprintf( index, "%s", lwindex_version_header() );
         fprintf( index, "<InputFilePath>%s</InputFilePath>\n", lwhp->file_path );
-#ifdef _WIN32
-        wchar_t *wname;
-        struct _stat64 file_stat;
-        if( lw_string_to_wchar( CP_UTF8, lwhp->file_path, &wname ) )
-            _wstat64( wname, &file_stat );
-        else
-            _stat64( lwhp->file_path, &file_stat );
-#else
-        struct stat file_stat;
-        stat( lwhp->file_path, &file_stat );
-#endif
-        fprintf( index, "<FileSize=%" PRId64 ">\n", file_stat.st_size );
-        fprintf( index, "<FileHash=0x%016" PRIx64 ">\n", xxhash_file( lwhp->file_path, file_stat.st_size ) );
+        int64_t  file_size;
+        uint64_t file_hash;
+        get_source_identity( lwhp, &file_size, &file_hash );
+        fprintf( index, "<FileSize=%" PRId64 ">\n", file_size );
+        fprintf( index, "<FileHash=0x%016" PRIx64 ">\n", file_hash );
         fprintf( index, "<LibavReaderIndex=0x%08x,%d,%s>\n", lwhp->format_flags, lwhp->raw_demuxer, lwhp->format_name );
         video_index_pos = ftell( index );
         fprintf( index, "<ActiveVideoStreamIndex>%+011d</ActiveVideoStreamIndex>\n", -1 );
@@ -2368,6 +2745,8 @@ static int create_index
                 repeat_pict = 1;
                 field_info = helper->last_field_info;
             }
+            int decode_start  = decide_decode_start( helper, &pkt );
+            int non_reference = is_non_reference_picture( helper, pkt_ctx, pict_type );
             /* Set video frame info if this stream is active. */
             if( pkt.stream_index == vdhp->stream_index )
             {
@@ -2383,6 +2762,9 @@ static int create_index
                 info->poc             = poc;
                 info->repeat_pict     = repeat_pict;
                 info->field_info      = field_info;
+                info->flags           = get_decode_start_flags( decode_start );
+                if( non_reference )
+                    info->flags |= LW_VFRAME_FLAG_NON_REFERENCE;
                 if( pkt.pts != AV_NOPTS_VALUE && last_keyframe_pts != AV_NOPTS_VALUE && pkt.pts < last_keyframe_pts )
                     info->flags |= LW_VFRAME_FLAG_LEADING;
                 if( pkt.flags & AV_PKT_FLAG_KEY )
@@ -2451,9 +2833,9 @@ static int create_index
             }
             /* Write a video packet info to the index file. */
             print_index( index, "Index=%d,POS=%" PRId64 ",PTS=%" PRId64 ",DTS=%" PRId64 ",EDI=%d\n"
-                         "Key=%d,Pic=%d,POC=%d,Repeat=%d,Field=%d\n",
+                         "Key=%d,Pic=%d,POC=%d,Repeat=%d,Field=%d,Start=%d,Ref=%d\n",
                          pkt.stream_index, pkt.pos, pkt.pts, pkt.dts, extradata_index,
-                         !!(pkt.flags & AV_PKT_FLAG_KEY), pict_type, poc, repeat_pict, field_info );
+                         !!(pkt.flags & AV_PKT_FLAG_KEY), pict_type, poc, repeat_pict, field_info, decode_start, !non_reference );
         }
         else if( adhp->stream_index != -2 )
         {
@@ -2898,29 +3280,15 @@ static int parse_index
     char format_name[256];
     int active_video_index;
     int active_audio_index;
-#ifdef _WIN32
-    wchar_t *wname;
-    struct _stat64 file_stat;
-    if( lw_string_to_wchar( CP_UTF8, lwhp->file_path, &wname ) )
-    {
-        if( _wstat64( wname, &file_stat ) )
-            return -1;
-    }
-    else
-    {
-        if( _stat64( lwhp->file_path, &file_stat ) )
-            return -1;
-    }
-#else
-    struct stat file_stat;
-    if( stat( lwhp->file_path, &file_stat ) )
+    int64_t  source_size;
+    uint64_t source_hash;
+    if( get_source_identity( lwhp, &source_size, &source_hash ) < 0 )
         return -1;
-#endif
     if( fscanf( index, "<FileSize=%" SCNd64 ">\n", &file_size ) != 1
-     || file_size != file_stat.st_size )
+     || file_size != source_size )
         return -1;
     if( fscanf( index, "<FileHash=0x%" SCNx64 ">\n", &file_hash ) != 1
-     || file_hash != xxhash_file( lwhp->file_path, file_stat.st_size ) )
+     || file_hash != source_hash )
         return -1;
     if( fscanf( index, "<LibavReaderIndex=0x%x,%d,%[^>]>\n",
                 (unsigned int *)&lwhp->format_flags, &lwhp->raw_demuxer, format_name ) != 3 )
@@ -3041,8 +3409,10 @@ static int parse_index
                 int   poc;
                 int   repeat_pict;
                 int   field_info;
-                if( sscanf( buf, "Key=%d,Pic=%d,POC=%d,Repeat=%d,Field=%d",
-                            &key, &pict_type, &poc, &repeat_pict, &field_info ) != 5 )
+                int   decode_start;
+                int   reference;
+                if( sscanf( buf, "Key=%d,Pic=%d,POC=%d,Repeat=%d,Field=%d,Start=%d,Ref=%d",
+                            &key, &pict_type, &poc, &repeat_pict, &field_info, &decode_start, &reference ) != 7 )
                     goto fail_parsing;
                 if( vdhp->codec_id == AV_CODEC_ID_NONE )
                     vdhp->codec_id = (enum AVCodecID)codec_id;
@@ -3083,6 +3453,9 @@ static int parse_index
                     info->poc             = poc;
                     info->repeat_pict     = repeat_pict;
                     info->field_info      = (lw_field_info_t)field_info;
+                    info->flags           = get_decode_start_flags( decode_start );
+                    if( !reference )
+                        info->flags |= LW_VFRAME_FLAG_NON_REFERENCE;
                     if( pts != AV_NOPTS_VALUE && last_keyframe_pts != AV_NOPTS_VALUE && pts < last_keyframe_pts )
                         info->flags |= LW_VFRAME_FLAG_LEADING;
                     if( key )
@@ -3446,6 +3819,12 @@ int lwlibav_construct_index
     progress_handler_t             *php
 )
 {
+    lwhp->io_callbacks = opt->io_callbacks;
+    vdhp->io_callbacks = opt->io_callbacks;
+    adhp->io_callbacks = opt->io_callbacks;
+    lwhp->io_flags     = opt->io_flags;
+    vdhp->io_flags     = opt->io_flags;
+    adhp->io_flags     = opt->io_flags;
     /* Try to open the index file. */
     size_t file_path_length = strlen( opt->file_path );
     const char *ext = file_path_length >= 5 ? &opt->file_path[file_path_length - 4] : NULL;
@@ -3492,7 +3871,7 @@ int lwlibav_construct_index
             lwhp->file_path[file_path_length - 4] = '\0';
     }
     AVFormatContext *format_ctx = NULL;
-    if( lavf_open_file( &format_ctx, lwhp->file_path, lhp ) )
+    if( lavf_open_file( &format_ctx, lwhp->file_path, lwhp->io_callbacks, lwhp->io_flags, lhp ) )
     {
         if( format_ctx )
             lavf_close_file( &format_ctx );
@@ -40,6 +40,8 @@ typedef struct
         uint32_t fps_num;
         uint32_t fps_den;
     } vfr2cfr;
+    const lw_io_callbacks_t *io_callbacks;  /* read the source through them instead of the file if not NULL */
+    int         io_flags;                   /* LW_IO_FLAG_*s to open the file with */
 } lwlibav_option_t;
 
 #ifdef __cplusplus
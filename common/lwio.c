@@ -0,0 +1,488 @@
+/*****************************************************************************
+ * lwio.c
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+#ifndef _WIN32
+/* for fseeko(), fileno(), posix_fadvise() and posix_madvise() */
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include "cpp_compat.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  /* __cplusplus */
+#include <libavformat/avio.h>
+#include <libavutil/error.h>
+#include <libavutil/mem.h>
+#ifdef __cplusplus
+}
+#endif  /* __cplusplus */
+
+#include "osdep.h"
+#include "utils.h"
+#include "lwio.h"
+
+#define LW_IO_BUFFER_SIZE         (1 << 20)     /* the size of the buffer of AVIOContext */
+#define LW_IO_DISTANT_SEEK_COUNT  4             /* the number of distant seeks to switch to the random access hint */
+#define LW_IO_SEQUENTIAL_SIZE     (8 << 20)     /* the bytes read contiguously to switch to the sequential access hint */
+#define LW_IO_MAX_PREFETCH_SIZE   (64 << 20)    /* the maximum size of a prefetch request */
+
+#ifdef _WIN32
+#define lw_fseek   _fseeki64
+#define lw_fileno  _fileno
+typedef struct _stati64 lw_stat_t;
+#define lw_fstat   _fstati64
+#else
+#define lw_fseek   fseeko
+#define lw_fileno  fileno
+typedef struct stat lw_stat_t;
+#define lw_fstat   fstat
+#endif
+
+#ifndef S_ISREG
+#define S_ISREG( m ) (((m) & S_IFMT) == S_IFREG)
+#endif
+
+typedef struct
+{
+    FILE          *fp;
+    const uint8_t *map;                 /* the memory mapping of the whole file if requested and available */
+    int64_t        size;                /* negative if unknown */
+    int64_t        pos;
+    int            random_access;       /* the access pattern hinted to the OS */
+    uint32_t       distant_seeks;
+    int64_t        sequential_bytes;    /* the bytes read since the last distant seek */
+    lw_io_stats_t  stats;
+} lw_io_file_t;
+
+static void set_access_hint
+(
+    lw_io_file_t *io,
+    int           random_access
+)
+{
+    io->random_access = random_access;
+#ifndef _WIN32
+    if( io->map )
+        posix_madvise( (void *)io->map, (size_t)io->size, random_access ? POSIX_MADV_RANDOM : POSIX_MADV_SEQUENTIAL );
+#ifdef POSIX_FADV_SEQUENTIAL
+    else
+        posix_fadvise( lw_fileno( io->fp ), 0, 0, random_access ? POSIX_FADV_RANDOM : POSIX_FADV_SEQUENTIAL );
+#endif
+#endif
+}
+
+static int read_file
+(
+    void    *opaque,
+    uint8_t *buf,
+    int      buf_size
+)
+{
+    lw_io_file_t *io = (lw_io_file_t *)opaque;
+    size_t read_size;
+    if( io->map )
+    {
+        int64_t remain = io->size - io->pos;
+        read_size = remain > 0 ? (size_t)MIN( remain, buf_size ) : 0;
+        memcpy( buf, io->map + io->pos, read_size );
+    }
+    else
+        read_size = fread( buf, 1, buf_size, io->fp );
+    if( read_size == 0 )
+    {
+        if( io->map || !ferror( io->fp ) )
+            return AVERROR_EOF;
+        /* Let the caller retry from the same position after a transient error. */
+        clearerr( io->fp );
+        lw_fseek( io->fp, io->pos, SEEK_SET );
+        return AVERROR( EIO );
+    }
+    io->pos              += read_size;
+    io->sequential_bytes += read_size;
+    io->stats.read_count += 1;
+    io->stats.read_bytes += read_size;
+    if( io->sequential_bytes >= LW_IO_SEQUENTIAL_SIZE )
+    {
+        /* Reading contiguously, e.g. indexing or decoding long GOPs. */
+        io->distant_seeks = 0;
+        if( io->random_access )
+            set_access_hint( io, 0 );
+    }
+    return (int)read_size;
+}
+
+static int64_t seek_file
+(
+    void   *opaque,
+    int64_t offset,
+    int     whence
+)
+{
+    lw_io_file_t *io = (lw_io_file_t *)opaque;
+    whence &= ~AVSEEK_FORCE;
+    if( whence == AVSEEK_SIZE )
+        return io->size >= 0 ? io->size : AVERROR( ENOSYS );
+    int64_t pos = whence == SEEK_SET                   ? offset
+                : whence == SEEK_CUR                   ? io->pos  + offset
+                : whence == SEEK_END && io->size >= 0  ? io->size + offset
+                :                                        -1;
+    if( pos < 0 )
+        return AVERROR( EINVAL );
+    if( pos == io->pos )
+        return pos;
+    if( !io->map && lw_fseek( io->fp, pos, SEEK_SET ) )
+        return AVERROR( EIO );
+    io->stats.seek_count += 1;
+    if( pos > io->pos + LW_IO_BUFFER_SIZE || pos < io->pos - LW_IO_BUFFER_SIZE )
+    {
+        /* Jumping around, e.g. random frame requests. */
+        io->sequential_bytes = 0;
+        if( !io->random_access && ++io->distant_seeks >= LW_IO_DISTANT_SEEK_COUNT )
+            set_access_hint( io, 1 );
+    }
+    io->pos = pos;
+    return pos;
+}
+
+static void close_file
+(
+    lw_io_file_t *io
+)
+{
+#ifndef _WIN32
+    if( io->map )
+        munmap( (void *)io->map, (size_t)io->size );
+#endif
+    if( io->fp )
+        fclose( io->fp );
+    lw_free( io );
+}
+
+static int is_local_file
+(
+    const char *file_path
+)
+{
+    /* Leave URLs and special protocols to libavformat. */
+    return file_path && !strstr( file_path, "://" ) && strcmp( file_path, "-" ) && strncmp( file_path, "pipe:", 5 );
+}
+
+AVIOContext *lw_io_open_file
+(
+    const char *file_path,
+    int         flags
+)
+{
+    if( !is_local_file( file_path ) )
+        return NULL;
+    lw_io_file_t *io = (lw_io_file_t *)lw_malloc_zero( sizeof(lw_io_file_t) );
+    if( !io )
+        return NULL;
+    io->fp = lw_fopen( file_path, "rb" );
+    lw_stat_t st;
+    if( !io->fp
+     || lw_fstat( lw_fileno( io->fp ), &st ) )
+        goto fail;
+    int regular  = S_ISREG( st.st_mode );
+    int seekable = regular || !lw_fseek( io->fp, 0, SEEK_CUR );
+    io->size = regular ? (int64_t)st.st_size : -1;
+    /* The buffering is done by AVIOContext. */
+    setvbuf( io->fp, NULL, _IONBF, 0 );
+#ifndef _WIN32
+    /* Map the whole file only if requested and the address space is enough. */
+    if( (flags & LW_IO_FLAG_MMAP) && regular && sizeof(void *) >= 8 && io->size > 0 )
+    {
+        void *map = mmap( NULL, (size_t)io->size, PROT_READ, MAP_SHARED, lw_fileno( io->fp ), 0 );
+        if( map != MAP_FAILED )
+            io->map = (const uint8_t *)map;
+    }
+#endif
+    if( regular )
+        set_access_hint( io, 0 );
+    uint8_t *buffer = (uint8_t *)av_malloc( LW_IO_BUFFER_SIZE );
+    if( !buffer )
+        goto fail;
+    AVIOContext *pb = avio_alloc_context( buffer, LW_IO_BUFFER_SIZE, 0, io, read_file, NULL, seekable ? seek_file : NULL );
+    if( !pb )
+    {
+        av_free( buffer );
+        goto fail;
+    }
+    return pb;
+fail:
+    close_file( io );
+    return NULL;
+}
+
+typedef struct
+{
+    lw_io_callbacks_t callbacks;
+    int64_t           size;     /* negative if unknown */
+    int64_t           pos;
+    lw_io_stats_t     stats;
+} lw_io_host_t;
+
+static int read_host
+(
+    void    *opaque,
+    uint8_t *buf,
+    int      buf_size
+)
+{
+    lw_io_host_t *io = (lw_io_host_t *)opaque;
+    if( io->size >= 0 )
+        buf_size = (int)MAX( MIN( io->size - io->pos, buf_size ), 0 );
+    int read_size = buf_size > 0 ? io->callbacks.read( io->callbacks.opaque, io->pos, buf, buf_size ) : 0;
+    if( read_size < 0 )
+        return AVERROR( EIO );
+    if( read_size == 0 )
+        return AVERROR_EOF;
+    io->pos              += read_size;
+    io->stats.read_count += 1;
+    io->stats.read_bytes += read_size;
+    return read_size;
+}
+
+static int64_t seek_host
+(
+    void   *opaque,
+    int64_t offset,
+    int     whence
+)
+{
+    lw_io_host_t *io = (lw_io_host_t *)opaque;
+    whence &= ~AVSEEK_FORCE;
+    if( whence == AVSEEK_SIZE )
+        return io->size >= 0 ? io->size : AVERROR( ENOSYS );
+    int64_t pos = whence == SEEK_SET                   ? offset
+                : whence == SEEK_CUR                   ? io->pos  + offset
+                : whence == SEEK_END && io->size >= 0  ? io->size + offset
+                :                                        -1;
+    if( pos < 0 )
+        return AVERROR( EINVAL );
+    if( pos != io->pos )
+        io->stats.seek_count += 1;
+    io->pos = pos;
+    return pos;
+}
+
+AVIOContext *lw_io_open_callbacks
+(
+    const lw_io_callbacks_t *callbacks
+)
+{
+    if( !callbacks || !callbacks->read )
+        return NULL;
+    lw_io_host_t *io = (lw_io_host_t *)lw_malloc_zero( sizeof(lw_io_host_t) );
+    if( !io )
+        return NULL;
+    io->callbacks = *callbacks;
+    io->size      = callbacks->get_size ? callbacks->get_size( callbacks->opaque ) : -1;
+    uint8_t *buffer = (uint8_t *)av_malloc( LW_IO_BUFFER_SIZE );
+    AVIOContext *pb = buffer ? avio_alloc_context( buffer, LW_IO_BUFFER_SIZE, 0, io, read_host, NULL, seek_host ) : NULL;
+    if( !pb )
+    {
+        av_free( buffer );
+        lw_free( io );
+        return NULL;
+    }
+    return pb;
+}
+
+AVIOContext *lw_io_open
+(
+    const char              *file_path,
+    const lw_io_callbacks_t *callbacks,
+    int                      flags
+)
+{
+    return callbacks ? lw_io_open_callbacks( callbacks ) : lw_io_open_file( file_path, flags );
+}
+
+int64_t lw_io_get_source_size
+(
+    const char              *file_path,
+    const lw_io_callbacks_t *callbacks
+)
+{
+    if( callbacks )
+        return callbacks->get_size ? callbacks->get_size( callbacks->opaque ) : -1;
+    if( !is_local_file( file_path ) )
+        return -1;
+    FILE *fp = lw_fopen( file_path, "rb" );
+    if( !fp )
+        return -1;
+    lw_stat_t st;
+    int64_t size = !lw_fstat( lw_fileno( fp ), &st ) && S_ISREG( st.st_mode ) ? (int64_t)st.st_size : -1;
+    fclose( fp );
+    return size;
+}
+
+int lw_io_read_source
+(
+    const char              *file_path,
+    const lw_io_callbacks_t *callbacks,
+    int64_t                  offset,
+    uint8_t                 *buf,
+    int                      size
+)
+{
+    if( offset < 0 || size < 0 )
+        return -1;
+    int read_size = 0;
+    if( callbacks )
+    {
+        if( !callbacks->read )
+            return -1;
+        /* The callbacks may return less than requested before the end. */
+        while( read_size < size )
+        {
+            int ret = callbacks->read( callbacks->opaque, offset + read_size, buf + read_size, size - read_size );
+            if( ret < 0 )
+                return -1;
+            if( ret == 0 )
+                break;
+            read_size += ret;
+        }
+        return read_size;
+    }
+    if( !is_local_file( file_path ) )
+        return -1;
+    FILE *fp = lw_fopen( file_path, "rb" );
+    if( !fp )
+        return -1;
+    if( !lw_fseek( fp, offset, SEEK_SET ) )
+    {
+        read_size = (int)fread( buf, 1, size, fp );
+        if( ferror( fp ) )
+            read_size = -1;
+    }
+    else
+        read_size = -1;
+    fclose( fp );
+    return read_size;
+}
+
+static int read_memory
+(
+    void    *opaque,
+    int64_t  offset,
+    uint8_t *buf,
+    int      size
+)
+{
+    lw_io_memory_t *memory = (lw_io_memory_t *)opaque;
+    if( offset < 0 || offset > memory->size )
+        return -1;
+    size = (int)MIN( memory->size - offset, size );
+    memcpy( buf, memory->data + offset, size );
+    return size;
+}
+
+static int64_t get_memory_size
+(
+    void *opaque
+)
+{
+    return ((lw_io_memory_t *)opaque)->size;
+}
+
+void lw_io_set_memory_callbacks
+(
+    lw_io_callbacks_t *callbacks,
+    lw_io_memory_t    *memory
+)
+{
+    callbacks->opaque   = memory;
+    callbacks->read     = read_memory;
+    callbacks->get_size = get_memory_size;
+}
+
+void lw_io_close
+(
+    AVIOContext **pb
+)
+{
+    if( !pb || !*pb )
+        return;
+    if( (*pb)->read_packet == read_file )
+        close_file( (lw_io_file_t *)(*pb)->opaque );
+    else if( (*pb)->read_packet == read_host )
+        lw_free( (*pb)->opaque );
+    av_freep( &(*pb)->buffer );
+    avio_context_free( pb );
+}
+
+int lw_io_prefetch
+(
+    AVIOContext *pb,
+    int64_t      offset,
+    int64_t      size
+)
+{
+    if( !pb || pb->read_packet != read_file )
+        return -1;
+    lw_io_file_t *io = (lw_io_file_t *)pb->opaque;
+    if( offset < 0 || offset >= io->size )
+        return -1;
+    if( size <= 0 || size > LW_IO_MAX_PREFETCH_SIZE )
+        size = LW_IO_MAX_PREFETCH_SIZE;
+    size = MIN( size, io->size - offset );
+#ifndef _WIN32
+    if( io->map )
+    {
+        /* The address shall be a multiple of the page size. */
+        int64_t page_size = (int64_t)sysconf( _SC_PAGESIZE );
+        int64_t aligned   = page_size > 0 ? offset - offset % page_size : offset;
+        return posix_madvise( (void *)(io->map + aligned), (size_t)(size + offset - aligned), POSIX_MADV_WILLNEED ) ? -1 : 0;
+    }
+#ifdef POSIX_FADV_WILLNEED
+    return posix_fadvise( lw_fileno( io->fp ), offset, size, POSIX_FADV_WILLNEED ) ? -1 : 0;
+#endif
+#endif
+    return -1;
+}
+
+int lw_io_get_stats
+(
+    AVIOContext   *pb,
+    lw_io_stats_t *stats
+)
+{
+    if( pb && pb->read_packet == read_file )
+        *stats = ((lw_io_file_t *)pb->opaque)->stats;
+    else if( pb && pb->read_packet == read_host )
+        *stats = ((lw_io_host_t *)pb->opaque)->stats;
+    else
+        return -1;
+    return 0;
+}
@@ -0,0 +1,147 @@
+/*****************************************************************************
+ * lwio.h
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+#ifndef LWIO_H
+#define LWIO_H
+
+typedef struct
+{
+    uint64_t read_count;    /* the number of reads from the backing store */
+    uint64_t read_bytes;    /* the total bytes read from the backing store */
+    uint64_t seek_count;    /* the number of seeks which moved the position */
+} lw_io_stats_t;
+
+/* I/O callbacks supplied by the host application to read a source which is not a local file,
+ * e.g. a network stream handled by the host or a file already loaded into memory.
+ * The reads are positional so that several I/O contexts, e.g. the indexer and the decoders, can share a source. */
+typedef struct lw_io_callbacks_tag
+{
+    void    *opaque;
+    /* Read up to 'size' bytes at 'offset' into 'buf'.
+     * Return the number of bytes read, 0 at the end of the source, or a negative value on error. */
+    int     (*read)( void *opaque, int64_t offset, uint8_t *buf, int size );
+    /* Return the total size of the source in bytes, or a negative value if unknown.
+     * This can be NULL if the size is unknown. */
+    int64_t (*get_size)( void *opaque );
+} lw_io_callbacks_t;
+
+typedef struct
+{
+    const uint8_t *data;
+    int64_t        size;
+} lw_io_memory_t;
+
+/* Flags to open local files */
+#define LW_IO_FLAG_MMAP 0x00000001  /* Read a regular file through a memory mapping of the whole file if available.
+                                     * This saves copies through the kernel, but the process is killed by SIGBUS
+                                     * instead of getting an I/O error if the file is truncated while mapped
+                                     * or the storage fails, e.g. on network file systems. */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  /* __cplusplus */
+
+/* Open a local file as an I/O context for libavformat.
+ * The context reads through a large buffer with stdio, or from a memory mapping of a regular file if LW_IO_FLAG_MMAP
+ * is specified in 'flags', and hints the access pattern, sequential or random, to the OS as it changes.
+ * Files other than regular files, e.g. FIFOs, are always read with stdio and are not seekable unless the OS can seek them.
+ * Return NULL if the path is a URL or a special protocol of libavformat or an error occurred.
+ * Then, the caller should let libavformat open the path by itself. */
+AVIOContext *lw_io_open_file
+(
+    const char *file_path,
+    int         flags
+);
+
+/* Open a source read through the host supplied callbacks as an I/O context for libavformat.
+ * The callbacks are copied, but 'opaque' shall be alive until the I/O context is closed.
+ * Return NULL if an error occurred. */
+AVIOContext *lw_io_open_callbacks
+(
+    const lw_io_callbacks_t *callbacks
+);
+
+/* Open a source through the callbacks if specified, otherwise through lw_io_open_file() with 'flags'. */
+AVIOContext *lw_io_open
+(
+    const char              *file_path,
+    const lw_io_callbacks_t *callbacks,
+    int                      flags
+);
+
+/* Get the size of a source through the callbacks if specified, otherwise of the local file.
+ * Return a negative value if unknown. */
+int64_t lw_io_get_source_size
+(
+    const char              *file_path,
+    const lw_io_callbacks_t *callbacks
+);
+
+/* Read up to 'size' bytes at 'offset' of a source directly, i.e. without the buffer and the memory mapping of an I/O context,
+ * through the callbacks if specified, otherwise from the local file.
+ * Return the number of bytes read, which is less than 'size' only at the end of the source, or a negative value on error. */
+int lw_io_read_source
+(
+    const char              *file_path,
+    const lw_io_callbacks_t *callbacks,
+    int64_t                  offset,
+    uint8_t                 *buf,
+    int                      size
+);
+
+/* Set up the callbacks to read a source on memory.
+ * The memory shall be alive while the callbacks are used. */
+void lw_io_set_memory_callbacks
+(
+    lw_io_callbacks_t *callbacks,
+    lw_io_memory_t    *memory
+);
+
+void lw_io_close
+(
+    AVIOContext **pb
+);
+
+/* Ask the OS to start reading the given byte range of the file in the background
+ * so that the following reads of the range don't stall on the storage.
+ * A non-positive size or a huge range is clamped to a moderate size from the offset.
+ * Return 0 if the hint is issued.
+ * Return -1 otherwise, e.g. the I/O context was not opened by lw_io_open_file() or it's unsupported. */
+int lw_io_prefetch
+(
+    AVIOContext *pb,
+    int64_t      offset,
+    int64_t      size
+);
+
+/* Return 0 if the I/O context was opened by lw_io_open_file() or lw_io_open_callbacks() and the statistics are set.
+ * Return -1 otherwise. */
+int lw_io_get_stats
+(
+    AVIOContext   *pb,
+    lw_io_stats_t *stats
+);
+
+#ifdef __cplusplus
+}
+#endif  /* __cplusplus */
+
+#endif /* LWIO_H */
@@ -87,6 +87,7 @@ void lwlibav_audio_free_decode_handler
                 av_free( exhp->entries[i].extradata );
         lw_free( exhp->entries );
     }
+    lwlibav_cleanup_decoder_pool( exhp );
     av_packet_unref( &adhp->packet );
     lw_free( adhp->frame_list );
     av_free( adhp->index_entries );
@@ -200,9 +201,9 @@ int lwlibav_audio_get_desired_track
     AVCodecContext *ctx = NULL;
     if( adhp->stream_index < 0
      || adhp->frame_count == 0
-     || lavf_open_file( &adhp->format, file_path, &adhp->lh ) < 0
+     || lavf_open_file( &adhp->format, file_path, adhp->io_callbacks, adhp->io_flags, &adhp->lh ) < 0
      || find_and_open_decoder( &ctx, adhp->format->streams[ adhp->stream_index ]->codecpar,
-                               adhp->preferred_decoder_names, 0, threads ) < 0 )
+                               adhp->preferred_decoder_names, 0, threads, 0 ) < 0 )
     {
         av_freep( &adhp->index_entries );
         lw_freep( &adhp->frame_list );
@@ -54,6 +54,9 @@ struct lwlibav_audio_decode_handler_tag
     AVFrame            *frame_buffer;
     audio_frame_info_t *frame_list;
     int                 soft_reset;
+    const lw_io_callbacks_t *io_callbacks;
+    int                 io_flags;
+    int                 preview;        /* unused */
     /* */
     AVPacket            packet;         /* for getting and freeing */
     AVPacket            alter_packet;   /* for consumed by the decoder instead of 'packet'. */
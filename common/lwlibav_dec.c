@@ -33,10 +33,69 @@ extern "C"
 #endif  /* __cplusplus */
 
 #include "utils.h"
+#include "lwio.h"
 #include "lwlibav_dec.h"
 #include "qsv.h"
 #include "decode.h"
 
+int lavf_open_file
+(
+    AVFormatContext        **format_ctx,
+    const char              *file_path,
+    const lw_io_callbacks_t *io_callbacks,
+    int                      io_flags,
+    lw_log_handler_t        *lhp
+)
+{
+    *format_ctx = avformat_alloc_context();
+    if( !*format_ctx )
+    {
+        lw_log_show( lhp, LW_LOG_FATAL, "Failed to avformat_alloc_context." );
+        return -1;
+    }
+
+    // The default of 5MB is not sufficient for UHD clips, e.g. https://4kmedia.org/lg-new-york-hdr-uhd-4k-demo/.
+    (*format_ctx)->probesize = 50*1024*1024;
+
+    /* Read local files through our own I/O context instead of the file protocol of libavformat.
+     * If the host supplies the I/O callbacks, read through them and use the path only as the name of the source. */
+    AVIOContext *pb = lw_io_open( file_path, io_callbacks, io_flags );
+    if( !pb && io_callbacks )
+    {
+        lw_log_show( lhp, LW_LOG_FATAL, "Failed to open the source through the I/O callbacks." );
+        return -1;
+    }
+    if( pb )
+    {
+        (*format_ctx)->pb     = pb;
+        (*format_ctx)->flags |= AVFMT_FLAG_CUSTOM_IO;
+    }
+    if( avformat_open_input( format_ctx, file_path, NULL, NULL ) )
+    {
+        /* The format context is freed on failure, but the custom I/O context is not. */
+        lw_io_close( &pb );
+        lw_log_show( lhp, LW_LOG_FATAL, "Failed to avformat_open_input." );
+        return -1;
+    }
+    lavf_skip_tc_code( *format_ctx, 0 );
+    if( avformat_find_stream_info( *format_ctx, NULL ) < 0 )
+    {
+        lw_log_show( lhp, LW_LOG_FATAL, "Failed to avformat_find_stream_info." );
+        return -1;
+    }
+    return 0;
+}
+
+void lavf_close_file
+(
+    AVFormatContext **format_ctx
+)
+{
+    AVIOContext *pb = *format_ctx && ((*format_ctx)->flags & AVFMT_FLAG_CUSTOM_IO) ? (*format_ctx)->pb : NULL;
+    avformat_close_input( format_ctx );
+    lw_io_close( &pb );
+}
+
 /* Close and open the new decoder to flush buffers in the decoder even if the decoder implements avcodec_flush_buffers().
  * It seems this brings about more stable composition when seeking.
  * Note that this function could reallocate AVCodecContext.
@@ -57,7 +116,7 @@ void lwlibav_flush_buffers
         const AVCodec           *codec        = dhp->ctx->codec;
         void                    *app_specific = dhp->ctx->opaque;
         AVCodecContext *ctx = NULL;
-        if( open_decoder( &ctx, codecpar, codec, dhp->ctx->thread_count ) < 0 )
+        if( open_decoder( &ctx, codecpar, codec, dhp->ctx->thread_count, dhp->ctx->thread_type, dhp->preview ) < 0 )
         {
             avcodec_flush_buffers( dhp->ctx );
             dhp->error = 1;
@@ -76,6 +135,106 @@ void lwlibav_flush_buffers
     dhp->exh.delay_count = 0;
 }
 
+static int update_extradata
+(
+    AVCodecParameters         *codecpar,
+    const lwlibav_extradata_t *entry
+)
+{
+    av_freep( &codecpar->extradata );
+    codecpar->extradata_size = 0;
+    if( entry->extradata_size > 0 )
+    {
+        codecpar->extradata = (uint8_t *)av_malloc( entry->extradata_size + AV_INPUT_BUFFER_PADDING_SIZE );
+        if( !codecpar->extradata )
+            return -1;
+        codecpar->extradata_size = entry->extradata_size;
+        memcpy( codecpar->extradata, entry->extradata, codecpar->extradata_size );
+        memset( codecpar->extradata + codecpar->extradata_size, 0, AV_INPUT_BUFFER_PADDING_SIZE );
+    }
+    /* This is needed by some CODECs such as UtVideo and raw video. */
+    codecpar->codec_tag = entry->codec_tag;
+    return 0;
+}
+
+static inline void free_pooled_decoder
+(
+    lwlibav_decoder_pool_entry_t *pool_entry
+)
+{
+    if( !pool_entry->ctx )
+        return;
+    pool_entry->ctx->opaque = NULL;
+    avcodec_free_context( &pool_entry->ctx );
+}
+
+/* Move the current decoder context into the pool so that switching back to the current configuration
+ * doesn't need to reopen the decoder. The least recently used context is evicted if the pool is full. */
+static void stash_decoder
+(
+    lwlibav_decode_handler_t *dhp
+)
+{
+    lwlibav_extradata_handler_t *exhp = &dhp->exh;
+    if( !dhp->ctx )
+        return;
+    if( dhp->error || exhp->current_index < 0 || exhp->current_index >= exhp->entry_count )
+    {
+        dhp->ctx->opaque = NULL;
+        avcodec_free_context( &dhp->ctx );
+        return;
+    }
+    lwlibav_decoder_pool_entry_t *pool_entry = &exhp->pool[0];
+    for( int i = 0; i < LWLIBAV_DECODER_POOL_SIZE; i++ )
+    {
+        if( !exhp->pool[i].ctx )
+        {
+            pool_entry = &exhp->pool[i];
+            break;
+        }
+        if( exhp->pool[i].last_used < pool_entry->last_used )
+            pool_entry = &exhp->pool[i];
+    }
+    free_pooled_decoder( pool_entry );
+    pool_entry->ctx             = dhp->ctx;
+    pool_entry->extradata_index = exhp->current_index;
+    pool_entry->width           = dhp->ctx->width;
+    pool_entry->height          = dhp->ctx->height;
+    pool_entry->thread_count    = dhp->ctx->thread_count;
+    pool_entry->thread_type     = dhp->ctx->thread_type;
+    pool_entry->last_used       = ++ exhp->pool_clock;
+    dhp->ctx = NULL;
+}
+
+/* Take the decoder context set up for the extradata out of the pool if present.
+ * The slot is emptied so that stashing the current context afterwards never evicts it.
+ * Return 1 if found, otherwise 0. */
+static int take_pooled_decoder
+(
+    lwlibav_extradata_handler_t  *exhp,
+    int                           extradata_index,
+    lwlibav_decoder_pool_entry_t *taken
+)
+{
+    for( int i = 0; i < LWLIBAV_DECODER_POOL_SIZE; i++ )
+        if( exhp->pool[i].ctx && exhp->pool[i].extradata_index == extradata_index )
+        {
+            *taken = exhp->pool[i];
+            exhp->pool[i].ctx = NULL;
+            return 1;
+        }
+    return 0;
+}
+
+void lwlibav_cleanup_decoder_pool
+(
+    lwlibav_extradata_handler_t *exhp
+)
+{
+    for( int i = 0; i < LWLIBAV_DECODER_POOL_SIZE; i++ )
+        free_pooled_decoder( &exhp->pool[i] );
+}
+
 void lwlibav_update_configuration
 (
     lwlibav_decode_handler_t *dhp,
@@ -96,11 +255,51 @@ void lwlibav_update_configuration
     AVCodecParameters *codecpar          = dhp->format->streams[ dhp->stream_index ]->codecpar;
     void              *app_specific      = dhp->ctx->opaque;
     const int          thread_count      = dhp->ctx->thread_count;
-    /* Close the decoder here. */
-    dhp->ctx->opaque = NULL;
-    avcodec_free_context( &dhp->ctx );
-    /* Find an appropriate decoder. */
+    const int          thread_type       = dhp->ctx->thread_type;
     const lwlibav_extradata_t *entry = &exhp->entries[extradata_index];
+    lwlibav_decoder_pool_entry_t pooled = { 0 };
+    int found = take_pooled_decoder( exhp, extradata_index, &pooled );
+    /* Keep or close the current decoder here. */
+    stash_decoder( dhp );
+    if( found )
+    {
+        /* Swap in the decoder already set up for this configuration.
+         * Only the codec parameters need updating since the hard reset reopens the decoder from them. */
+        dhp->ctx = pooled.ctx;
+        if( codecpar->codec_type == AVMEDIA_TYPE_VIDEO )
+            set_video_basic_settings( dhp, dhp->ctx->codec, frame_number );
+        else
+            set_audio_basic_settings( dhp, dhp->ctx->codec, frame_number );
+        if( update_extradata( codecpar, entry ) < 0 )
+        {
+            strcpy( error_string, "Failed to allocate extradata.\n" );
+            goto fail;
+        }
+        exhp->current_index = extradata_index;
+        if( pooled.thread_count != thread_count
+         || pooled.thread_type  != thread_type )
+        {
+            /* The threading has been changed since the context was pooled. Reopen it with the current settings. */
+            AVCodecContext *ctx = NULL;
+            if( open_decoder( &ctx, codecpar, dhp->ctx->codec, thread_count, thread_type, dhp->preview ) < 0 )
+            {
+                strcpy( error_string, "Failed to reopen the pooled decoder.\n" );
+                goto fail;
+            }
+            dhp->ctx->opaque = NULL;
+            avcodec_free_context( &dhp->ctx );
+            dhp->ctx = ctx;
+            exhp->delay_count = 0;
+        }
+        else
+            lwlibav_flush_buffers( dhp );   /* Note that dhp->ctx could change here. */
+        dhp->ctx->get_buffer2 = exhp->get_buffer ? exhp->get_buffer : avcodec_default_get_buffer2;
+        dhp->ctx->opaque      = app_specific;
+        dhp->ctx->width       = pooled.width;
+        dhp->ctx->height      = pooled.height;
+        return;
+    }
+    /* Find an appropriate decoder. */
     const AVCodec *codec = find_decoder( entry->codec_id, codecpar, dhp->preferred_decoder_names, dhp->prefer_hw_decoder );
     if( !codec )
     {
@@ -113,25 +312,14 @@ void lwlibav_update_configuration
     else
         set_audio_basic_settings( dhp, codec, frame_number );
     /* Update extradata. */
-    av_freep( &codecpar->extradata );
-    codecpar->extradata_size = 0;
-    if( entry->extradata_size > 0 )
+    if( update_extradata( codecpar, entry ) < 0 )
     {
-        codecpar->extradata = (uint8_t *)av_malloc( entry->extradata_size + AV_INPUT_BUFFER_PADDING_SIZE );
-        if( !codecpar->extradata )
-        {
-            strcpy( error_string, "Failed to allocate extradata.\n" );
-            goto fail;
-        }
-        codecpar->extradata_size = entry->extradata_size;
-        memcpy( codecpar->extradata, entry->extradata, codecpar->extradata_size );
-        memset( codecpar->extradata + codecpar->extradata_size, 0, AV_INPUT_BUFFER_PADDING_SIZE );
+        strcpy( error_string, "Failed to allocate extradata.\n" );
+        goto fail;
     }
-    /* This is needed by some CODECs such as UtVideo and raw video. */
-    codecpar->codec_tag = entry->codec_tag;
     /* Open an appropriate decoder.
      * Here, we force single threaded decoding since some decoder doesn't do its proper initialization with multi-threaded decoding. */
-    if( open_decoder( &dhp->ctx, codecpar, codec, 1 ) < 0 )
+    if( open_decoder( &dhp->ctx, codecpar, codec, 1, 0, dhp->preview ) < 0 )
     {
         strcpy( error_string, "Failed to open decoder.\n" );
         goto fail;
@@ -145,6 +333,7 @@ void lwlibav_update_configuration
         goto fail;
     /* Reopen/flush with the requested number of threads. */
     dhp->ctx->thread_count = thread_count;
+    dhp->ctx->thread_type  = thread_type;
     int width  = dhp->ctx->width;
     int height = dhp->ctx->height;
     lwlibav_flush_buffers( dhp );   /* Note that dhp->ctx could change here. */
@@ -171,7 +360,8 @@ int lwlibav_get_av_frame
 {
     av_packet_unref( pkt );
     /* Get a packet as the requested frame physically. */
-    while( read_av_frame( format_ctx, pkt ) >= 0 )
+    int ret;
+    while( (ret = read_av_frame( format_ctx, pkt )) >= 0 )
     {
         if( pkt->stream_index != stream_index )
         {
@@ -185,5 +375,7 @@ int lwlibav_get_av_frame
     /* Return a null packet. */
     pkt->data = NULL;
     pkt->size = 0;
-    return 1;
+    /* Tell the failures which may not recur, e.g. a read error of the source, from the end of the source.
+     * The others, e.g. broken data at the end, are treated as the end as ever. */
+    return ret == AVERROR( EIO ) || ret == AVERROR( ENOMEM ) ? ret : 1;
 }
@@ -19,6 +19,8 @@
  *****************************************************************************/
 #include <stdio.h>
 
+#include "lwio.h"
+
 /* This file is available under an ISC license. */
 
 #define SEEK_DTS_BASED      0x00000001
@@ -35,6 +37,8 @@ typedef struct
     int     raw_demuxer;
     int     threads;
     int64_t av_gap;
+    const lw_io_callbacks_t *io_callbacks;  /* the host supplied I/O callbacks, or NULL if reading the file */
+    int     io_flags;                       /* LW_IO_FLAG_*s to open the file with */
 } lwlibav_file_handler_t;
 
 typedef struct
@@ -56,13 +60,30 @@ typedef struct
     int                 block_align;
 } lwlibav_extradata_t;
 
+#define LWLIBAV_DECODER_POOL_SIZE 4
+
+typedef struct
+{
+    AVCodecContext *ctx;                /* opened decoder context, or NULL if this slot is empty */
+    int             extradata_index;    /* index of extradata which ctx was set up with */
+    int             width;              /* presentation size set up by the actual decoding */
+    int             height;
+    int             thread_count;       /* threading settings which ctx was opened with */
+    int             thread_type;
+    uint32_t        last_used;          /* for eviction of the least recently used context */
+} lwlibav_decoder_pool_entry_t;
+
 typedef struct
 {
-    int                  current_index;
-    int                  entry_count;
-    lwlibav_extradata_t *entries;
-    uint32_t             delay_count;
+    int                          current_index;
+    int                          entry_count;
+    lwlibav_extradata_t         *entries;
+    uint32_t                     delay_count;
     int (*get_buffer)( struct AVCodecContext *, AVFrame *, int );
+    /* Decoder contexts already set up for other extradata than the current.
+     * Switching the decoder configuration reuses them instead of reopening decoders. */
+    lwlibav_decoder_pool_entry_t pool[LWLIBAV_DECODER_POOL_SIZE];
+    uint32_t                     pool_clock;
 } lwlibav_extradata_handler_t;
 
 typedef struct
@@ -89,6 +110,9 @@ typedef struct
     AVFrame                    *frame_buffer;
     void                       *frame_list;
     int                         soft_reset;
+    const lw_io_callbacks_t    *io_callbacks;
+    int                         io_flags;
+    int                         preview;
 } lwlibav_decode_handler_t;
 
 static inline int64_t lavf_skip_tc_code
@@ -127,36 +151,19 @@ static inline int64_t lavf_skip_tc_code
     return timestamp;
 }
 
-static inline int lavf_open_file
+int lavf_open_file
 (
-    AVFormatContext **format_ctx,
-    const char       *file_path,
-    lw_log_handler_t *lhp
-)
-{
-    *format_ctx = avformat_alloc_context();
-
-    // The default of 5MB is not sufficient for UHD clips, e.g. https://4kmedia.org/lg-new-york-hdr-uhd-4k-demo/.
-    (*format_ctx)->probesize = 50*1024*1024;
-
-    if( avformat_open_input( format_ctx, file_path, NULL, NULL ) )
-    {
-        lw_log_show( lhp, LW_LOG_FATAL, "Failed to avformat_open_input." );
-        return -1;
-    }
-    lavf_skip_tc_code( *format_ctx, 0 );
-    if( avformat_find_stream_info( *format_ctx, NULL ) < 0 )
-    {
-        lw_log_show( lhp, LW_LOG_FATAL, "Failed to avformat_find_stream_info." );
-        return -1;
-    }
-    return 0;
-}
+    AVFormatContext        **format_ctx,
+    const char              *file_path,
+    const lw_io_callbacks_t *io_callbacks,
+    int                      io_flags,
+    lw_log_handler_t        *lhp
+);
 
-static inline void lavf_close_file( AVFormatContext **format_ctx )
-{
-    avformat_close_input( format_ctx );
-}
+void lavf_close_file
+(
+    AVFormatContext **format_ctx
+);
 
 static inline int read_av_frame
 (
@@ -179,7 +186,8 @@ int find_and_open_decoder
     const AVCodecParameters *codecpar,
     const char             **preferred_decoder_names,
     const int                prefer_hw_decoder,
-    const int                thread_count
+    const int                thread_count,
+    const int                preview
 );
 
 void lwlibav_flush_buffers
@@ -187,6 +195,10 @@ void lwlibav_flush_buffers
     lwlibav_decode_handler_t *dhp
 );
 
+/* Get the next packet of the stream.
+ * Return 0 if successful.
+ * Return 1 if no more packets. Then, a null packet is set.
+ * Return a negative value if reading failed, e.g. an I/O error of the source. Then, a null packet is set too. */
 int lwlibav_get_av_frame
 (
     AVFormatContext *format_ctx,
@@ -195,6 +207,11 @@ int lwlibav_get_av_frame
     AVPacket        *pkt
 );
 
+void lwlibav_cleanup_decoder_pool
+(
+    lwlibav_extradata_handler_t *exhp
+);
+
 void lwlibav_update_configuration
 (
     lwlibav_decode_handler_t *dhp,
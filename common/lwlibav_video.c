@@ -22,8 +22,6 @@
 
 #include "cpp_compat.h"
 
-#include <float.h>
-
 #ifdef __cplusplus
 extern "C"
 {
@@ -31,11 +29,13 @@ extern "C"
 #include <libavformat/avformat.h>   /* Demuxer */
 #include <libavcodec/avcodec.h>     /* Decoder */
 #include <libavutil/imgutils.h>
+#include <libavutil/time.h>
 #ifdef __cplusplus
 }
 #endif  /* __cplusplus */
 
 #include "utils.h"
+#include "lwio.h"
 #include "video_output.h"
 #include "lwlibav_dec.h"
 #include "lwlibav_video.h"
@@ -46,6 +46,9 @@ extern "C"
 #define SEEK_MODE_UNSAFE     1
 #define SEEK_MODE_AGGRESSIVE 2
 
+#define DEFAULT_PACKET_CACHE_SIZE (64 << 20)
+#define DEFAULT_STREAM_LOOKBACK   16
+
 #if LIBAVCODEC_VERSION_MICRO < 100
 #define avcodec_find_best_pix_fmt_of_list( _0, _1, _2, _3 ) avcodec_find_best_pix_fmt2( (enum AVPixelFormat *)(_0), _1, _2, _3 )
 #endif
@@ -67,6 +70,8 @@ lwlibav_video_decode_handler_t *lwlibav_video_alloc_decode_handler
         lwlibav_video_free_decode_handler( vdhp );
         return NULL;
     }
+    vdhp->packet_cache.max_size = DEFAULT_PACKET_CACHE_SIZE;
+    vdhp->stream_mode.capacity  = DEFAULT_STREAM_LOOKBACK;
     return vdhp;
 }
 
@@ -93,10 +98,30 @@ void lwlibav_video_free_decode_handler
                 av_free( exhp->entries[i].extradata );
         lw_free( exhp->entries );
     }
+    lwlibav_cleanup_decoder_pool( exhp );
+    if( vdhp->packet_cache.packets )
+        for( uint32_t i = 0; i <= vdhp->packet_cache.capacity; i++ )
+            av_packet_free( &vdhp->packet_cache.packets[i] );
+    lw_free( vdhp->packet_cache.packets );
+    lw_free( vdhp->packet_cache.order );
+    if( vdhp->stream_mode.frames )
+        for( uint32_t i = 0; i < vdhp->stream_mode.capacity; i++ )
+            av_frame_free( &vdhp->stream_mode.frames[i] );
+    lw_free( vdhp->stream_mode.frames );
+    if( vdhp->thread_mode.standby )
+    {
+        vdhp->thread_mode.standby->opaque = NULL;
+        avcodec_free_context( &vdhp->thread_mode.standby );
+    }
+    lw_thread_budget_leave( &vdhp->thread_budget );
+    lw_free( vdhp->keyframe_only.frames );
+    lw_free( vdhp->bad_region.raps );
+    lw_free( vdhp->bad_region.undecodable );
     av_packet_unref( &vdhp->packet );
     lw_free( vdhp->frame_list );
     lw_free( vdhp->order_converter );
     lw_free( vdhp->keyframe_list );
+    lw_free( vdhp->rap_list );
     av_free( vdhp->index_entries );
     av_frame_free( &vdhp->frame_buffer );
     av_frame_free( &vdhp->first_valid_frame );
@@ -152,6 +177,15 @@ void lwlibav_video_set_forward_seek_threshold
     vdhp->forward_seek_threshold = forward_seek_threshold;
 }
 
+void lwlibav_video_set_adaptive_seek
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    int                             adaptive_seek
+)
+{
+    vdhp->seek_cost.active = adaptive_seek;
+}
+
 void lwlibav_video_set_seek_mode
 (
     lwlibav_video_decode_handler_t *vdhp,
@@ -161,6 +195,42 @@ void lwlibav_video_set_seek_mode
     vdhp->seek_mode = seek_mode;
 }
 
+void lwlibav_video_set_packet_cache_size
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    size_t                          max_size
+)
+{
+    vdhp->packet_cache.max_size = max_size;
+}
+
+void lwlibav_video_set_stream_lookback
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    uint32_t                        lookback_count
+)
+{
+    vdhp->stream_mode.capacity = MAX( lookback_count, 1 );
+}
+
+void lwlibav_video_set_thread_switch_threshold
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    uint32_t                        threshold
+)
+{
+    vdhp->thread_mode.threshold = threshold;
+}
+
+void lwlibav_video_set_preview
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    int                             preview
+)
+{
+    vdhp->preview = CLIP_VALUE( preview, 0, LW_DECODER_PREVIEW_MAX );
+}
+
 void lwlibav_video_set_preferred_decoder_names
 (
     lwlibav_video_decode_handler_t *vdhp,
@@ -245,7 +315,10 @@ int lwlibav_video_get_max_width
     lwlibav_video_decode_handler_t *vdhp
 )
 {
-    return vdhp ? vdhp->max_width : 0;
+    if( !vdhp )
+        return 0;
+    /* Pictures are decoded at the reduced resolution by lowres. */
+    return vdhp->ctx ? AV_CEIL_RSHIFT( vdhp->max_width, vdhp->ctx->lowres ) : vdhp->max_width;
 }
 
 int lwlibav_video_get_max_height
@@ -253,7 +326,9 @@ int lwlibav_video_get_max_height
     lwlibav_video_decode_handler_t *vdhp
 )
 {
-    return vdhp ? vdhp->max_height : 0;
+    if( !vdhp )
+        return 0;
+    return vdhp->ctx ? AV_CEIL_RSHIFT( vdhp->max_height, vdhp->ctx->lowres ) : vdhp->max_height;
 }
 
 AVFrame *lwlibav_video_get_frame_buffer
@@ -264,6 +339,61 @@ AVFrame *lwlibav_video_get_frame_buffer
     return vdhp ? vdhp->frame_buffer : NULL;
 }
 
+static inline lw_thread_mode_t get_thread_mode
+(
+    AVCodecContext *ctx
+)
+{
+    return ctx && !(ctx->thread_type & FF_THREAD_FRAME) ? LW_THREAD_MODE_LATENCY : LW_THREAD_MODE_THROUGHPUT;
+}
+
+void lwlibav_video_get_stats
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    lwlibav_video_stats_t          *stats
+)
+{
+    memset( stats, 0, sizeof(lwlibav_video_stats_t) );
+    if( !vdhp )
+        return;
+    lwlibav_seek_cost_t *scp = &vdhp->seek_cost;
+    stats->decode_cost  = scp->decode_cost;
+    stats->seek_cost    = scp->seek_cost;
+    stats->forward_cost = scp->forward_cost;
+    stats->reseek_cost  = scp->reseek_cost;
+    stats->seeked       = scp->seeked;
+    stats->thread_mode  = get_thread_mode( vdhp->ctx );
+    stats->thread_switch_threshold = vdhp->thread_mode.threshold;
+    lw_io_stats_t io_stats;
+    if( vdhp->format && lw_io_get_stats( vdhp->format->pb, &io_stats ) == 0 )
+    {
+        stats->read_count = (int64_t)io_stats.read_count;
+        stats->read_bytes = (int64_t)io_stats.read_bytes;
+        stats->seek_count = (int64_t)io_stats.seek_count;
+    }
+}
+
+void lwlibav_video_get_source_frame_info
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    uint32_t                        frame_number,
+    uint32_t                       *source_frame_number,
+    double                         *source_time
+)
+{
+    lwlibav_keyframe_only_t *kfp = &vdhp->keyframe_only;
+    *source_time = -1.0;
+    if( kfp->active )
+        frame_number = kfp->frames[ MIN( frame_number, kfp->count ) ];
+    *source_frame_number = frame_number;
+    if( !vdhp->frame_list || frame_number == 0 || frame_number > vdhp->frame_count || vdhp->min_ts == AV_NOPTS_VALUE )
+        return;
+    int64_t ts = (vdhp->lw_seek_flags & (SEEK_PTS_GENERATED | SEEK_PTS_BASED)) ? vdhp->frame_list[frame_number].pts
+                                                                              : vdhp->frame_list[frame_number].dts;
+    if( ts != AV_NOPTS_VALUE )
+        *source_time = (double)(ts - vdhp->min_ts) * vdhp->time_base.num / vdhp->time_base.den;
+}
+
 /*****************************************************************************
  * Others
  *****************************************************************************/
@@ -274,6 +404,66 @@ void lwlibav_video_force_seek
 {
     /* Force seek before the next reading. */
     vdhp->last_frame_number = vdhp->frame_count + 1;
+    vdhp->keyframe_only.last_frame_number = 0;
+}
+
+/* Register the decoder to the process-wide thread budget and return the number of threads to open it with. */
+static int join_thread_budget
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    AVCodecParameters              *codecpar,
+    int                             threads
+)
+{
+    lw_thread_budget_leave( &vdhp->thread_budget );
+    vdhp->thread_budget = lw_thread_budget_join( threads, codecpar->width, codecpar->height );
+    if( vdhp->thread_budget )
+        threads = lw_thread_budget_get_threads( vdhp->thread_budget );
+    vdhp->budget_threads = threads;
+    return threads;
+}
+
+/* The minimum change of the assigned threads to reopen the decoder.
+ * The share follows the activity of the other decoders, so a smaller change isn't worth rebuilding the decoders. */
+#define MIN_BUDGET_CHANGE( threads ) MAX( 2, (threads) / 4 )
+
+/* Reopen the decoder if the budget assigns a number of threads different enough from the last.
+ * The standby context of the other threading mode and the pooled contexts of the other configurations
+ * are closed then since they were opened with the old number of threads.
+ * This shall be called only just before the decoder is flushed or its configuration is updated for a seek.
+ * Return 1 if reopened, i.e. the decoder has no need of flushing, otherwise 0. */
+static int apply_thread_budget
+(
+    lwlibav_video_decode_handler_t *vdhp
+)
+{
+    if( !vdhp->thread_budget )
+        return 0;
+    int threads = lw_thread_budget_get_threads( vdhp->thread_budget );
+    if( abs( threads - vdhp->budget_threads ) < MIN_BUDGET_CHANGE( vdhp->budget_threads ) )
+        return 0;
+    AVCodecContext *ctx = NULL;
+    if( open_decoder( &ctx, vdhp->format->streams[ vdhp->stream_index ]->codecpar,
+                      vdhp->ctx->codec, threads, vdhp->ctx->thread_type, vdhp->preview ) < 0 )
+        /* Not fatal. Keep the current decoders. */
+        return 0;
+    if( vdhp->thread_mode.standby )
+    {
+        vdhp->thread_mode.standby->opaque = NULL;
+        avcodec_free_context( &vdhp->thread_mode.standby );
+    }
+    lwlibav_cleanup_decoder_pool( &vdhp->exh );
+    ctx->get_buffer2 = vdhp->ctx->get_buffer2;
+    ctx->opaque      = vdhp->ctx->opaque;
+    /* The presentation size is set up by the actual decoding. */
+    ctx->width       = vdhp->ctx->width;
+    ctx->height      = vdhp->ctx->height;
+    vdhp->ctx->opaque = NULL;
+    avcodec_free_context( &vdhp->ctx );
+    vdhp->ctx            = ctx;
+    vdhp->budget_threads = threads;
+    vdhp->exh.delay_count = 0;
+    return 1;
 }
 
 int lwlibav_video_get_desired_track
@@ -286,14 +476,18 @@ int lwlibav_video_get_desired_track
     AVCodecContext *ctx = NULL;
     if( vdhp->stream_index < 0
      || vdhp->frame_count == 0
-     || lavf_open_file( &vdhp->format, file_path, &vdhp->lh ) < 0
+     || lavf_open_file( &vdhp->format, file_path, vdhp->io_callbacks, vdhp->io_flags, &vdhp->lh ) < 0
      || find_and_open_decoder( &ctx, vdhp->format->streams[ vdhp->stream_index ]->codecpar,
-                               vdhp->preferred_decoder_names, vdhp->prefer_hw_decoder, threads ) < 0 )
+                               vdhp->preferred_decoder_names, vdhp->prefer_hw_decoder,
+                               join_thread_budget( vdhp, vdhp->format->streams[ vdhp->stream_index ]->codecpar, threads ),
+                               vdhp->preview ) < 0 )
     {
         av_freep( &vdhp->index_entries );
         lw_freep( &vdhp->frame_list );
         lw_freep( &vdhp->order_converter );
         lw_freep( &vdhp->keyframe_list );
+        lw_freep( &vdhp->rap_list );
+        vdhp->rap_count = 0;
         if( vdhp->format )
             lavf_close_file( &vdhp->format );
         return -1;
@@ -302,6 +496,92 @@ int lwlibav_video_get_desired_track
     return 0;
 }
 
+/* Estimate the number of frames from the header of the container.
+ * Return 0 if unknown. */
+static uint32_t estimate_frame_count
+(
+    AVFormatContext *format_ctx,
+    AVStream        *stream
+)
+{
+    if( stream->nb_frames > 0 && stream->nb_frames <= UINT32_MAX )
+        return (uint32_t)stream->nb_frames;
+    AVRational frame_rate = (stream->avg_frame_rate.num && stream->avg_frame_rate.den)
+                          ? stream->avg_frame_rate
+                          : stream->r_frame_rate;
+    if( frame_rate.num <= 0 || frame_rate.den <= 0 )
+        return 0;
+    int64_t duration = stream->duration != AV_NOPTS_VALUE
+                     ? av_rescale_q( stream->duration, stream->time_base, AV_TIME_BASE_Q )
+                     : format_ctx->duration;
+    if( duration == AV_NOPTS_VALUE || duration <= 0 )
+        return 0;
+    int64_t frame_count = av_rescale_q( duration, AV_TIME_BASE_Q, av_inv_q( frame_rate ) );
+    return frame_count > 0 && frame_count <= UINT32_MAX ? (uint32_t)frame_count : 0;
+}
+
+int lwlibav_video_open_stream
+(
+    const char                     *file_path,
+    const lw_io_callbacks_t        *io_callbacks,
+    int                             io_flags,
+    lwlibav_video_decode_handler_t *vdhp,
+    lwlibav_video_output_handler_t *vohp,
+    int                             stream_index,
+    uint32_t                        frame_count,
+    int                             threads
+)
+{
+    lwlibav_stream_mode_t *stream_mode = &vdhp->stream_mode;
+    AVCodecContext *ctx = NULL;
+    vdhp->io_callbacks = io_callbacks;
+    vdhp->io_flags     = io_flags;
+    if( lavf_open_file( &vdhp->format, file_path, vdhp->io_callbacks, vdhp->io_flags, &vdhp->lh ) < 0 )
+        goto fail;
+    if( stream_index < 0 )
+        stream_index = av_find_best_stream( vdhp->format, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0 );
+    if( stream_index < 0
+     || stream_index >= (int)vdhp->format->nb_streams
+     || vdhp->format->streams[stream_index]->codecpar->codec_type != AVMEDIA_TYPE_VIDEO )
+    {
+        lw_log_show( &vdhp->lh, LW_LOG_FATAL, "Failed to find the video stream." );
+        goto fail;
+    }
+    AVStream          *stream   = vdhp->format->streams[stream_index];
+    AVCodecParameters *codecpar = stream->codecpar;
+    if( frame_count == 0 )
+        frame_count = estimate_frame_count( vdhp->format, stream );
+    if( frame_count == 0 )
+    {
+        lw_log_show( &vdhp->lh, LW_LOG_FATAL, "Failed to estimate the number of frames. Specify it explicitly." );
+        goto fail;
+    }
+    stream_mode->frames = (AVFrame **)lw_malloc_zero( stream_mode->capacity * sizeof(AVFrame *) );
+    if( !stream_mode->frames
+     || find_and_open_decoder( &ctx, codecpar, vdhp->preferred_decoder_names, vdhp->prefer_hw_decoder,
+                               join_thread_budget( vdhp, codecpar, threads ), vdhp->preview ) < 0 )
+        goto fail;
+    vdhp->ctx                = ctx;
+    vdhp->stream_index       = stream_index;
+    vdhp->codec_id           = codecpar->codec_id;
+    vdhp->time_base          = stream->time_base;
+    vdhp->frame_count        = frame_count;
+    vdhp->max_width          = codecpar->width;
+    vdhp->max_height         = codecpar->height;
+    vdhp->initial_width      = codecpar->width;
+    vdhp->initial_height     = codecpar->height;
+    vdhp->initial_pix_fmt    = (enum AVPixelFormat)codecpar->format;
+    vdhp->initial_colorspace = codecpar->color_space;
+    vohp->frame_count        = frame_count;
+    stream_mode->active      = 1;
+    return 0;
+fail:
+    lw_freep( &stream_mode->frames );
+    if( vdhp->format )
+        lavf_close_file( &vdhp->format );
+    return -1;
+}
+
 void lwlibav_video_setup_timestamp_info
 (
     lwlibav_file_handler_t         *lwhp,
@@ -319,7 +599,8 @@ void lwlibav_video_setup_timestamp_info
         *framerate_den = (int64_t)vohp->cfr_den;
         return;
     }
-    if( vdhp->frame_count == 1
+    if( vdhp->stream_mode.active
+     || vdhp->frame_count == 1
      || lwhp->raw_demuxer
      || vdhp->actual_time_base.num == 0
      || vdhp->actual_time_base.den == 0
@@ -368,6 +649,44 @@ use_lavf_frame_rate:
     return;
 }
 
+int lwlibav_video_setup_keyframe_only
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    lwlibav_video_output_handler_t *vohp
+)
+{
+    if( vdhp->stream_mode.active || !vdhp->keyframe_list )
+    {
+        lw_log_show( &vdhp->lh, LW_LOG_FATAL, "The keyframe-only mode requires the index." );
+        return -1;
+    }
+    lwlibav_keyframe_only_t *kfp = &vdhp->keyframe_only;
+    uint32_t count = 0;
+    for( uint32_t i = 1; i <= vdhp->frame_count; i++ )
+        count += vdhp->keyframe_list[ vdhp->frame_list[i].sample_number ];
+    if( count == 0 )
+    {
+        lw_log_show( &vdhp->lh, LW_LOG_FATAL, "No keyframe is found in the video stream." );
+        return -1;
+    }
+    kfp->frames = (uint32_t *)lw_malloc_zero( (count + 1) * sizeof(uint32_t) );
+    if( !kfp->frames )
+    {
+        lw_log_show( &vdhp->lh, LW_LOG_FATAL, "Failed to allocate the keyframe list." );
+        return -1;
+    }
+    /* Number keyframes in presentation order. */
+    for( uint32_t i = 1; i <= vdhp->frame_count; i++ )
+        if( vdhp->keyframe_list[ vdhp->frame_list[i].sample_number ] )
+            kfp->frames[ ++kfp->count ] = i;
+    kfp->active            = 1;
+    kfp->last_frame_number = 0;
+    vohp->frame_count      = kfp->count;
+    vohp->repeat_control   = 0;
+    vohp->vfr2cfr          = 0;
+    return 0;
+}
+
 void lwlibav_video_set_initial_input_format
 (
     lwlibav_video_decode_handler_t *vdhp
@@ -478,23 +797,337 @@ static uint32_t correct_current_frame_number
 #undef MATCH_POS
 }
 
-static int decode_video_picture
+/* Accumulate a measured cost into the moving average.
+ * The first samples are simply averaged, and then older samples decay exponentially
+ * so that the model follows changes of stream characteristics, e.g. resolution. */
+static inline void update_cost_average
+(
+    int64_t  *average,
+    uint32_t *samples,
+    int64_t   sample
+)
+{
+#define COST_AVERAGE_WINDOW 16
+    if( *samples < COST_AVERAGE_WINDOW )
+        ++(*samples);
+    *average += (sample - *average) / (int64_t)*samples;
+#undef COST_AVERAGE_WINDOW
+}
+
+/* Return the index in rap_list of the last keyframe whose decoding number is not greater than
+ * the given one, or -1 if there is no such keyframe. */
+static int64_t search_random_accessible_point
 (
     lwlibav_video_decode_handler_t *vdhp,
-    AVFrame                        *frame,
-    int                            *got_picture,
-    int64_t                        *pkt_pts,
+    uint32_t                        decoding_picture_number
+)
+{
+    int64_t lo = 0;
+    int64_t hi = (int64_t)vdhp->rap_count - 1;
+    while( lo <= hi )
+    {
+        int64_t mid = lo + ((hi - lo) >> 1);
+        if( vdhp->rap_list[mid] <= decoding_picture_number )
+            lo = mid + 1;
+        else
+            hi = mid - 1;
+    }
+    return hi;
+}
+
+static void find_random_accessible_point
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    uint32_t                        presentation_picture_number,
+    uint32_t                        decoding_picture_number,
+    uint32_t                       *rap_number
+)
+{
+    int flags = vdhp->frame_list[presentation_picture_number].flags;
+    if( decoding_picture_number == 0 )
+        decoding_picture_number = vdhp->frame_list[presentation_picture_number].sample_number;
+    int64_t index = search_random_accessible_point( vdhp, decoding_picture_number );
+    /* Leading pictures shall be decoded from more past random access point unless known to be decodable from the closest one.
+     * Pictures before the recovery point also shall be, which the index tells as well as undecodable leading pictures. */
+    if( (flags & LW_VFRAME_FLAG_PRIOR_RAP)
+     || ((flags & LW_VFRAME_FLAG_LEADING) && !(flags & LW_VFRAME_FLAG_DECODABLE_LEADING)) )
+        --index;
+    *rap_number = index >= 0 ? vdhp->rap_list[index] : 1;
+}
+
+static int64_t get_random_accessible_point_position
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    uint32_t                        rap_number
+)
+{
+    uint32_t presentation_rap_number = vdhp->order_converter
+                                     ? vdhp->order_converter[rap_number].decoding_to_presentation
+                                     : rap_number;
+    return (vdhp->lw_seek_flags & SEEK_POS_BASED) ? vdhp->frame_list[presentation_rap_number].file_offset
+         : (vdhp->lw_seek_flags & SEEK_PTS_BASED) ? vdhp->frame_list[presentation_rap_number].pts
+         : (vdhp->lw_seek_flags & SEEK_DTS_BASED) ? vdhp->frame_list[presentation_rap_number].dts
+         :                                          vdhp->frame_list[presentation_rap_number].sample_number;
+}
+
+static inline uint32_t is_half_frame
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    uint32_t                        output_picture_number
+)
+{
+    return (output_picture_number <= vdhp->frame_count
+         && vdhp->frame_list[output_picture_number].repeat_pict == 0);
+}
+
+static void correct_output_delay
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    uint32_t                       *goal_fed_picture_number,
+    uint32_t                        reliable_picture_number,
+    uint32_t                        estimated_picture_number
+)
+{
+    if( reliable_picture_number != estimated_picture_number )
+    {
+        /* If positive, we got a frame earlier than expected.
+         * Otherwise, we got a frame later than expected and it's an error. */
+        int64_t diff = reliable_picture_number - estimated_picture_number;
+        vdhp->exh.delay_count    = (uint32_t)(vdhp->exh.delay_count    - diff);
+        *goal_fed_picture_number = (uint32_t)(*goal_fed_picture_number - diff);
+    }
+}
+
+/* Our wrapper of av_seek_frame that adjusts timestamp for m2ts (if flag contains
+ * AVSEEK_FLAG_BYTE)
+ *
+ * See https://github.com/AkarinVS/L-SMASH-Works/issues/6 for why we need such
+ * adjustments.
+ */
+static int lavf_seek_frame
+(
+    AVFormatContext                *s,
+    int                             stream_index,
+    int64_t                         timestamp,
+    int                             flags
+)
+{
+    if (flags & AVSEEK_FLAG_BYTE) {
+        timestamp = lavf_skip_tc_code(s, timestamp);
+        // There is no need to restore file pointer as we have set AVSEEK_FLAG_BYTE and
+        // so we are going to seek to timestamp anyway.
+    }
+    return av_seek_frame(s, stream_index, timestamp, flags);
+}
+
+static inline int64_t get_file_offset
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    uint32_t                        decoding_picture_number
+)
+{
+    uint32_t p = vdhp->order_converter ? vdhp->order_converter[decoding_picture_number].decoding_to_presentation : decoding_picture_number;
+    return vdhp->frame_list[p].file_offset;
+}
+
+/* Ask the OS to read ahead the packets from the GOP of the given picture through the next GOP,
+ * which are about to be demuxed, so that the demuxer doesn't stall on synchronous reads. */
+static void prefetch_packets
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    uint32_t                        decoding_picture_number
+)
+{
+    int64_t  index      = search_random_accessible_point( vdhp, decoding_picture_number );
+    uint32_t rap_number = index >= 0 ? vdhp->rap_list[index] : 1;
+    if( rap_number == vdhp->last_prefetch_number || !vdhp->format )
+        return;
+    vdhp->last_prefetch_number = rap_number;
+    int64_t start = get_file_offset( vdhp, rap_number );
+    int64_t end   = index + 2 < (int64_t)vdhp->rap_count ? get_file_offset( vdhp, vdhp->rap_list[index + 2] ) : -1;
+    if( start < 0 )
+        return;
+    lw_io_prefetch( vdhp->format->pb, start, end > start ? end - start : 0 );
+}
+
+static void evict_oldest_packet
+(
+    lwlibav_packet_cache_t *cache
+)
+{
+    uint32_t number = cache->order[ cache->head ];
+    cache->size -= cache->packets[number]->size;
+    av_packet_free( &cache->packets[number] );
+    cache->head = (cache->head + 1) % cache->capacity;
+    --cache->count;
+}
+
+/* Return 1 if the packet is surely the one of the picture specified by decoding number, otherwise 0. */
+static int is_packet_identified
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    AVPacket                       *pkt,
+    uint32_t                        picture_number
+)
+{
+    if( picture_number == 0 || picture_number > vdhp->frame_count || !pkt->data )
+        return 0;
+    uint32_t p = vdhp->order_converter ? vdhp->order_converter[picture_number].decoding_to_presentation : picture_number;
+    video_frame_info_t *info = &vdhp->frame_list[p];
+    return ((vdhp->lw_seek_flags & SEEK_DTS_BASED) && pkt->dts != AV_NOPTS_VALUE && pkt->dts == info->dts)
+        || ((vdhp->lw_seek_flags & (SEEK_POS_BASED | SEEK_POS_CORRECTION)) && pkt->pos != -1 && pkt->pos == info->file_offset);
+}
+
+/* Keep a reference to the demuxed packet so that re-seeks into recently decoded GOPs need no demuxer seek.
+ * Packets are evicted in the order of insertion when the byte budget is exceeded. */
+static void store_packet
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    AVPacket                       *pkt,
+    uint32_t                        picture_number
+)
+{
+    lwlibav_packet_cache_t *cache = &vdhp->packet_cache;
+    if( cache->max_size == 0
+     || (size_t)pkt->size > cache->max_size
+     || (cache->packets && picture_number <= vdhp->frame_count && cache->packets[picture_number])
+     || !is_packet_identified( vdhp, pkt, picture_number ) )
+        return;
+    if( !cache->packets )
+    {
+        cache->packets = (AVPacket **)lw_malloc_zero( (vdhp->frame_count + 1) * sizeof(AVPacket *) );
+        cache->order   = (uint32_t *)lw_malloc_zero( vdhp->frame_count * sizeof(uint32_t) );
+        if( !cache->packets || !cache->order )
+        {
+            lw_freep( &cache->packets );
+            lw_freep( &cache->order );
+            cache->max_size = 0;
+            return;
+        }
+        cache->capacity = vdhp->frame_count;
+    }
+    AVPacket *ref = av_packet_clone( pkt );
+    if( !ref )
+        return;
+    while( cache->count && cache->size + ref->size > cache->max_size )
+        evict_oldest_packet( cache );
+    cache->order[ (cache->head + cache->count) % cache->capacity ] = picture_number;
+    cache->packets[picture_number] = ref;
+    cache->size += ref->size;
+    ++cache->count;
+}
+
+/* Seek the demuxer and skip packets until the packet of the picture specified by decoding number.
+ * This is needed when the next packet is missing in the cache while feeding cached packets. */
+static int resync_demuxer
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    AVPacket                       *pkt,
+    uint32_t                        picture_number
+)
+{
+#define MAX_RESYNC_MARGIN 256
+    int64_t  index      = search_random_accessible_point( vdhp, picture_number );
+    uint32_t rap_number = index >= 0 ? vdhp->rap_list[index] : 1;
+    int64_t  rap_pos    = get_random_accessible_point_position( vdhp, rap_number );
+    if( lavf_seek_frame( vdhp->format, vdhp->stream_index, rap_pos, vdhp->av_seek_flags ) < 0 )
+        lavf_seek_frame( vdhp->format, vdhp->stream_index, rap_pos, vdhp->av_seek_flags | AVSEEK_FLAG_ANY );
+    /* libavformat might seek a more backward position than the random accessible picture.
+     * Read packets until the one of the picture is identified, giving up after the pictures from the RAP and a margin. */
+    uint32_t max_attempts = picture_number - rap_number + 1 + MAX_RESYNC_MARGIN;
+    for( uint32_t n = 0; n < max_attempts; n++ )
+    {
+        if( lwlibav_get_av_frame( vdhp->format, vdhp->stream_index, picture_number, pkt ) )
+            break;
+        if( is_packet_identified( vdhp, pkt, picture_number ) )
+            return 0;
+    }
+    lw_log_show( &vdhp->lh, LW_LOG_WARNING, "Failed to resume demuxing after the cached packets." );
+    return -1;
+#undef MAX_RESYNC_MARGIN
+}
+
+/* Get the packet of the picture specified by decoding number.
+ * Return 0 if successful.
+ * Return 1 if no more packets. Then, a null packet is set.
+ * Return a negative value otherwise. */
+static int get_video_packet
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    AVPacket                       *pkt,
+    uint32_t                        picture_number
+)
+{
+    lwlibav_packet_cache_t *cache = &vdhp->packet_cache;
+    if( cache->serving )
+    {
+        if( picture_number <= vdhp->frame_count && cache->packets[picture_number] )
+        {
+            av_packet_unref( pkt );
+            return av_packet_ref( pkt, cache->packets[picture_number] ) < 0 ? -1 : 0;
+        }
+        cache->serving = 0;
+        if( picture_number > vdhp->frame_count )
+        {
+            /* Return a null packet to flush the decoder. */
+            av_packet_unref( pkt );
+            pkt->data = NULL;
+            pkt->size = 0;
+            return 1;
+        }
+        /* The cache has run out, so the following packets are read from the file from here. */
+        prefetch_packets( vdhp, picture_number );
+        return resync_demuxer( vdhp, pkt, picture_number );
+    }
+    return lwlibav_get_av_frame( vdhp->format, vdhp->stream_index, picture_number, pkt );
+}
+
+/* Return 1 if the decoder can discard the picture instead of decoding it.
+ * Nothing refers to a non-reference picture, so decoding it is needed only if it's output at or after 'target'.
+ * Without it, the decoder outputs fewer pictures, so the output pictures shall be identifiable to correct the decoder delay. */
+static inline int is_skippable_picture
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    uint32_t                        coded_picture_number,
+    uint32_t                        target
+)
+{
+    if( coded_picture_number > vdhp->frame_count
+     || !(vdhp->order_converter || (vdhp->lw_seek_flags & SEEK_DTS_BASED)) )
+        return 0;
+    uint32_t picture_number = vdhp->order_converter
+                            ? vdhp->order_converter[coded_picture_number].decoding_to_presentation
+                            : coded_picture_number;
+    video_frame_info_t *info = &vdhp->frame_list[picture_number];
+    /* A field coded picture is excluded since its counterpart might be a reference picture. */
+    return picture_number < target
+        && (info->flags & LW_VFRAME_FLAG_NON_REFERENCE)
+        && info->repeat_pict != 0;
+}
+
+/* Get the packet of the picture '*current' to be fed to the decoder.
+ * '*current' is corrected if libavformat sought a wrong position.
+ * Return 0 if successful.
+ * Return 1 if no more packets.
+ * Return -2 otherwise. */
+static int get_picture_packet
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    AVPacket                       *pkt,
     uint32_t                       *current,
     uint32_t                        goal,
     uint32_t                        rap_number
 )
 {
-    /* Get a packet containing a frame. */
     uint32_t picture_number = *current;
-    AVPacket *pkt = &vdhp->packet;
-    int ret = lwlibav_get_av_frame( vdhp->format, vdhp->stream_index, picture_number, pkt );
+    int ret = get_video_packet( vdhp, pkt, picture_number );
     if( ret > 0 )
         return ret;
+    else if( ret < 0 )
+    {
+        vdhp->bad_region.transient = 1;
+        return -2;
+    }
     /* Correct the current picture number in order to match DTS since libavformat might have sought wrong position. */
     uint32_t correction_distance = 0;
     if( picture_number == rap_number && (vdhp->lw_seek_flags & (SEEK_DTS_BASED | SEEK_PTS_BASED)) )
@@ -508,25 +1141,73 @@ static int decode_video_picture
             correction_distance = *current - picture_number;
         *current = picture_number;
     }
+    store_packet( vdhp, pkt, picture_number );
     if( pkt->flags & AV_PKT_FLAG_KEY )
+    {
         vdhp->last_rap_number = picture_number;
+        /* Entering a new GOP, read ahead the next one unless the packets come from the cache.
+         * get_video_packet() reads ahead when the cache runs out. */
+        if( !vdhp->packet_cache.serving )
+            prefetch_packets( vdhp, picture_number );
+    }
     /* Avoid decoding frames until the seek correction caused by too backward is done. */
     while( correction_distance )
     {
-        ret = lwlibav_get_av_frame( vdhp->format, vdhp->stream_index, ++picture_number, pkt );
+        ret = get_video_packet( vdhp, pkt, ++picture_number );
         if( ret > 0 )
             return ret;
+        else if( ret < 0 )
+        {
+            vdhp->bad_region.transient = 1;
+            return -2;
+        }
+        store_packet( vdhp, pkt, picture_number );
         if( pkt->flags & AV_PKT_FLAG_KEY )
             vdhp->last_rap_number = picture_number;
         *current = picture_number;
         --correction_distance;
     }
+    return 0;
+}
+
+static int decode_video_picture
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    AVFrame                        *frame,
+    int                            *got_picture,
+    int64_t                        *pkt_pts,
+    uint32_t                       *current,
+    uint32_t                        goal,
+    uint32_t                        rap_number,
+    uint32_t                        target      /* non-reference pictures output before this are skipped, 0 to decode all */
+)
+{
+    /* Get a packet containing a frame unless the decoder didn't accept the last one. */
+    int64_t start_time = av_gettime_relative();
+    AVPacket *pkt = &vdhp->packet;
+    int ret;
+    if( !vdhp->packet_pending
+     && (ret = get_picture_packet( vdhp, pkt, current, goal, rap_number )) != 0 )
+        return ret;
+    uint32_t picture_number = *current;
     /* Decode a frame in a packet. */
     AVFrame *mov_frame = vdhp->movable_frame_buffer;
     av_frame_unref( mov_frame );
+    int skip = target && vdhp->ctx->skip_frame == AVDISCARD_DEFAULT && is_skippable_picture( vdhp, picture_number, target );
     set_output_order_id( vdhp, pkt, picture_number );
+    if( skip )
+        vdhp->ctx->skip_frame = AVDISCARD_NONREF;
     ret = decode_video_packet( vdhp->ctx, mov_frame, got_picture, pkt );
-    vdhp->last_fed_picture_number = picture_number;
+    if( skip )
+        vdhp->ctx->skip_frame = AVDISCARD_DEFAULT;
+    /* If the decoder output a frame instead of accepting the packet, send the packet again at the next call.
+     * The caller counts the fed pictures by '*current', so it shall stay at this picture. */
+    vdhp->packet_pending = ret > 0;
+    if( vdhp->packet_pending )
+        --(*current);
+    vdhp->last_fed_picture_number = *current;
+    lwlibav_seek_cost_t *scp = &vdhp->seek_cost;
+    update_cost_average( &scp->decode_cost, &scp->decode_samples, av_gettime_relative() - start_time );
     /* We can't get the requested frame by feeding a picture if that picture is field coded.
      * This branch avoids putting empty data on the frame buffer. */
     if( *got_picture )
@@ -538,102 +1219,64 @@ static int decode_video_picture
     *pkt_pts = pkt->pts;
     if( ret < 0 )
     {
+        /* Only the errors in the bitstream are worth remembering. The others, e.g. running out of memory, may not recur. */
+        if( ret != AVERROR_INVALIDDATA )
+            vdhp->bad_region.transient = 1;
         lw_log_show( &vdhp->lh, LW_LOG_ERROR, "Failed to decode a video frame." );
         return -1;
     }
     return 0;
 }
 
-static void find_random_accessible_point
+/* Switch the decoder to the threading mode suitable for the recent access pattern.
+ * Frame threading adds its threads to the decoder delay every seek must fill, so random access prefers slice threading.
+ * The context for the other mode is kept as the standby to swap them without reopening the decoder.
+ * This shall be called only just before the decoder is flushed for a seek. */
+static void switch_thread_mode
 (
     lwlibav_video_decode_handler_t *vdhp,
-    uint32_t                        presentation_picture_number,
-    uint32_t                        decoding_picture_number,
-    uint32_t                       *rap_number
+    int                             extradata_index
 )
 {
-    int is_leading = !!(vdhp->frame_list[presentation_picture_number].flags & LW_VFRAME_FLAG_LEADING);
-    if( decoding_picture_number == 0 )
-        decoding_picture_number = vdhp->frame_list[presentation_picture_number].sample_number;
-    *rap_number = decoding_picture_number;
-    while( *rap_number )
+    lwlibav_thread_mode_t *tmp = &vdhp->thread_mode;
+    if( tmp->threshold == 0 )
+        return;
+    lw_thread_mode_t mode = tmp->linear_run >= tmp->threshold ? LW_THREAD_MODE_THROUGHPUT : LW_THREAD_MODE_LATENCY;
+    if( mode == get_thread_mode( vdhp->ctx )
+     || extradata_index != vdhp->exh.current_index )
+        /* Switching together with the decoder configuration is left to the next seek. */
+        return;
+    AVCodecContext *ctx = NULL;
+    if( tmp->standby && tmp->standby_index == extradata_index )
     {
-        if( vdhp->keyframe_list[ *rap_number ] )
-        {
-            if( !is_leading )
-                break;
-            /* Shall be decoded from more past random access point. */
-            is_leading = 0;
-        }
-        --(*rap_number);
+        ctx = tmp->standby;
+        tmp->standby = NULL;
     }
-    if( *rap_number == 0 )
-        *rap_number = 1;
-}
-
-static int64_t get_random_accessible_point_position
-(
-    lwlibav_video_decode_handler_t *vdhp,
-    uint32_t                        rap_number
-)
-{
-    uint32_t presentation_rap_number = vdhp->order_converter
-                                     ? vdhp->order_converter[rap_number].decoding_to_presentation
-                                     : rap_number;
-    return (vdhp->lw_seek_flags & SEEK_POS_BASED) ? vdhp->frame_list[presentation_rap_number].file_offset
-         : (vdhp->lw_seek_flags & SEEK_PTS_BASED) ? vdhp->frame_list[presentation_rap_number].pts
-         : (vdhp->lw_seek_flags & SEEK_DTS_BASED) ? vdhp->frame_list[presentation_rap_number].dts
-         :                                          vdhp->frame_list[presentation_rap_number].sample_number;
-}
-
-static inline uint32_t is_half_frame
-(
-    lwlibav_video_decode_handler_t *vdhp,
-    uint32_t                        output_picture_number
-)
-{
-    return (output_picture_number <= vdhp->frame_count
-         && vdhp->frame_list[output_picture_number].repeat_pict == 0);
-}
-
-static void correct_output_delay
-(
-    lwlibav_video_decode_handler_t *vdhp,
-    uint32_t                       *goal_fed_picture_number,
-    uint32_t                        reliable_picture_number,
-    uint32_t                        estimated_picture_number
-)
-{
-    if( reliable_picture_number != estimated_picture_number )
+    else
     {
-        /* If positive, we got a frame earlier than expected.
-         * Otherwise, we got a frame later than expected and it's an error. */
-        int64_t diff = reliable_picture_number - estimated_picture_number;
-        vdhp->exh.delay_count    = (uint32_t)(vdhp->exh.delay_count    - diff);
-        *goal_fed_picture_number = (uint32_t)(*goal_fed_picture_number - diff);
-    }
-}
-
-/* Our wrapper of av_seek_frame that adjusts timestamp for m2ts (if flag contains
- * AVSEEK_FLAG_BYTE)
- *
- * See https://github.com/AkarinVS/L-SMASH-Works/issues/6 for why we need such
- * adjustments.
- */
-static int lavf_seek_frame
-(
-    AVFormatContext                *s,
-    int                             stream_index,
-    int64_t                         timestamp,
-    int                             flags
-)
-{
-    if (flags & AVSEEK_FLAG_BYTE) {
-        timestamp = lavf_skip_tc_code(s, timestamp);
-        // There is no need to restore file pointer as we have set AVSEEK_FLAG_BYTE and
-        // so we are going to seek to timestamp anyway.
+        if( tmp->standby )
+        {
+            tmp->standby->opaque = NULL;
+            avcodec_free_context( &tmp->standby );
+        }
+        int thread_type = mode == LW_THREAD_MODE_LATENCY ? FF_THREAD_SLICE : FF_THREAD_FRAME | FF_THREAD_SLICE;
+        if( open_decoder( &ctx, vdhp->format->streams[ vdhp->stream_index ]->codecpar,
+                          vdhp->ctx->codec, vdhp->ctx->thread_count, thread_type, vdhp->preview ) < 0 )
+        {
+            /* Not fatal. Just keep the current mode. */
+            lw_log_show( &vdhp->lh, LW_LOG_WARNING, "Failed to open the decoder for another threading mode." );
+            tmp->threshold = 0;
+            return;
+        }
+        ctx->get_buffer2 = vdhp->ctx->get_buffer2;
+        ctx->opaque      = vdhp->ctx->opaque;
     }
-    return av_seek_frame(s, stream_index, timestamp, flags);
+    /* The presentation size is set up by the actual decoding. */
+    ctx->width         = vdhp->ctx->width;
+    ctx->height        = vdhp->ctx->height;
+    tmp->standby       = vdhp->ctx;
+    tmp->standby_index = extradata_index;
+    vdhp->ctx          = ctx;
 }
 
 static uint32_t seek_video
@@ -647,17 +1290,32 @@ static uint32_t seek_video
 )
 {
     /* Prepare to decode from random accessible picture. */
+    int64_t start_time = av_gettime_relative();
     lwlibav_extradata_handler_t *exhp = &vdhp->exh;
     int extradata_index = vdhp->frame_list[rap_number].extradata_index;
+    /* Apply the thread budget first so that the decoders opened by the followings get the new number of threads. */
+    int reopened = apply_thread_budget( vdhp );
+    switch_thread_mode( vdhp, extradata_index );
     if( extradata_index != exhp->current_index )
         /* Update the decoder configuration. */
         lwlibav_update_configuration( (lwlibav_decode_handler_t *)vdhp, rap_number, extradata_index, rap_pos );
-    else
+    else if( !reopened )
         lwlibav_flush_buffers( (lwlibav_decode_handler_t *)vdhp );
+    vdhp->packet_pending = 0;
     if( vdhp->error )
         return 0;
-    if( lavf_seek_frame( vdhp->format, vdhp->stream_index, rap_pos, vdhp->av_seek_flags ) < 0 )
+    /* Feed the decoder from the packet cache without seeking the demuxer if the random accessible picture is cached. */
+    lwlibav_packet_cache_t *cache = &vdhp->packet_cache;
+    cache->serving = cache->packets && rap_number <= vdhp->frame_count && cache->packets[rap_number];
+    /* The packets served from the cache need no reads. */
+    if( !cache->serving )
+        prefetch_packets( vdhp, rap_number );
+    if( !cache->serving
+     && lavf_seek_frame( vdhp->format, vdhp->stream_index, rap_pos, vdhp->av_seek_flags ) < 0 )
         lavf_seek_frame( vdhp->format, vdhp->stream_index, rap_pos, vdhp->av_seek_flags | AVSEEK_FLAG_ANY );
+    /* The pre-roll decoding below is measured per picture by decode_video_picture(). */
+    lwlibav_seek_cost_t *scp = &vdhp->seek_cost;
+    update_cost_average( &scp->seek_cost, &scp->seek_samples, av_gettime_relative() - start_time );
     int      got_picture  = 0;
     int      output_ready = 0;
     int64_t  rap_pts = AV_NOPTS_VALUE;
@@ -670,7 +1328,7 @@ static uint32_t seek_video
     for( current = rap_number; current <= goal; current++ )
     {
         int64_t pkt_pts;
-        int ret = decode_video_picture( vdhp, frame, &got_picture, &pkt_pts, &current, goal, rap_number );
+        int ret = decode_video_picture( vdhp, frame, &got_picture, &pkt_pts, &current, goal, rap_number, presentation_picture_number );
         if( ret == -2 )
             return 0;
         else if( ret >= 1 )
@@ -816,6 +1474,15 @@ static int get_frame
 {
 #define REQUESTED_FRAME_IS_ALREADY_ON_OUTPUT_FRAME_BUFFER 0
     uint32_t goal = requested_picture_number + vdhp->exh.delay_count;
+    if( current > goal
+     && requested_picture_number != vdhp->last_frame_number
+     && is_picture_stored_in_frame( vdhp, vdhp->last_dec_frame, requested_picture_number ) == 0 )
+    {
+        /* The decoder delay says the requested picture has been output, but the identifier in output order says not.
+         * The latency of frame threading is not fixed, so trust the identifier and continue feeding.
+         * The delay itself is corrected by the identifiers of the following output pictures. */
+        goal = current;
+    }
     int got_picture = (current > goal);
     if( got_picture )
     {
@@ -828,7 +1495,7 @@ static int get_frame
     while( current <= goal )
     {
         int64_t pkt_pts;    /* unused */
-        int ret = decode_video_picture( vdhp, frame, &got_picture, &pkt_pts, &current, goal, rap_number );
+        int ret = decode_video_picture( vdhp, frame, &got_picture, &pkt_pts, &current, goal, rap_number, requested_picture_number );
         if( ret < 0 )
             return -1;
         else if( ret == 1 )
@@ -973,6 +1640,141 @@ static inline uint32_t get_last_half_offset
          :                     0;
 }
 
+/* Decide whether to continue decoding from the last fed picture or to seek to the random accessible picture.
+ * The cost of each path is estimated from the measured average costs:
+ *   continuing : the number of pictures to be fed to reach the requested picture,
+ *   seeking    : the overhead of a seek and the pre-roll pictures from the random accessible picture.
+ * Continuing can go through the next random accessible picture if the pre-roll from it is long enough.
+ * Until both costs are measured, fall back to forward_seek_threshold. */
+static int is_forward_decoding_cheaper
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    uint32_t                        picture_number,
+    uint32_t                        last_frame_number,
+    uint32_t                        rap_number
+)
+{
+    lwlibav_seek_cost_t *scp = &vdhp->seek_cost;
+    if( scp->decode_samples == 0 || scp->seek_samples == 0 )
+        return picture_number <= last_frame_number + vdhp->forward_seek_threshold;
+    if( vdhp->frame_list[picture_number].extradata_index != vdhp->exh.current_index )
+        /* The decoder configuration must be updated, which is done only by seeking. */
+        return 0;
+    uint32_t decoder_delay   = get_decoder_delay( vdhp->ctx );
+    int64_t  forward_count   = (int64_t)picture_number + vdhp->exh.delay_count - vdhp->last_fed_picture_number;
+    int64_t  pre_roll_count  = (int64_t)picture_number + decoder_delay - rap_number + 1;
+    scp->forward_cost = MAX( forward_count, 0 ) * scp->decode_cost;
+    scp->reseek_cost  = scp->seek_cost + MAX( pre_roll_count, 0 ) * scp->decode_cost;
+    return scp->forward_cost <= scp->reseek_cost;
+}
+
+/* Track the run of sequential requests, and return 1 if the requested picture is a good point to switch
+ * the decoder to the high-throughput threading mode, i.e. a keyframe in a long enough linear run.
+ * Seeking to a keyframe during linear decoding costs no pre-roll except the decoder delay. */
+static int is_thread_mode_switch_point
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    uint32_t                        picture_number,
+    uint32_t                        last_frame_number
+)
+{
+    lwlibav_thread_mode_t *tmp = &vdhp->thread_mode;
+    if( tmp->threshold == 0 )
+        return 0;
+    if( picture_number == last_frame_number + 1 )
+    {
+        if( tmp->linear_run < UINT32_MAX )
+            ++ tmp->linear_run;
+    }
+    else
+        tmp->linear_run = 0;
+    return tmp->linear_run >= tmp->threshold
+        && get_thread_mode( vdhp->ctx ) == LW_THREAD_MODE_LATENCY
+        && (vdhp->frame_list[picture_number].flags & LW_VFRAME_FLAG_KEY);
+}
+
+/* Get the state of the RAP in the bad region map. Return NULL if not a listed RAP or allocation failed. */
+static lwlibav_rap_state_t *get_rap_state
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    uint32_t                        rap_number,
+    int                             alloc
+)
+{
+    int64_t index = search_random_accessible_point( vdhp, rap_number );
+    if( index < 0 || vdhp->rap_list[index] != rap_number )
+        return NULL;
+    lwlibav_bad_region_map_t *map = &vdhp->bad_region;
+    if( !map->raps )
+    {
+        if( !alloc )
+            return NULL;
+        map->raps = (lwlibav_rap_state_t *)lw_malloc_zero( vdhp->rap_count * sizeof(lwlibav_rap_state_t) );
+        if( !map->raps )
+            return NULL;
+    }
+    return &map->raps[index];
+}
+
+/* If decoding the picture from the RAP failed before, replace the RAP with the one known to be good. */
+static void apply_bad_region_map
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    uint32_t                        picture_number,
+    uint32_t                       *rap_number,
+    int                            *seek_mode
+)
+{
+    lwlibav_rap_state_t *state = get_rap_state( vdhp, *rap_number, 0 );
+    if( !state
+     || state->failed_from == 0
+     || state->good_rap    == 0
+     || vdhp->frame_list[picture_number].sample_number < state->failed_from )
+        return;
+    *rap_number = state->good_rap;
+    if( state->aggressive )
+        *seek_mode = SEEK_MODE_AGGRESSIVE;
+}
+
+/* Remember that decoding the picture from 'failed_rap' failed and where it succeeded instead, or 0 if nowhere.
+ * Nothing is remembered if any failure in the current request was not caused by the bitstream,
+ * e.g. an I/O error of the source, since retrying later may succeed. */
+static void record_bad_region
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    uint32_t                        picture_number,
+    uint32_t                        failed_rap,
+    uint32_t                        good_rap,
+    int                             aggressive
+)
+{
+    if( vdhp->bad_region.transient )
+        return;
+    lwlibav_rap_state_t *state = get_rap_state( vdhp, failed_rap, 1 );
+    if( state )
+    {
+        uint32_t decoding_number = vdhp->frame_list[picture_number].sample_number;
+        if( state->failed_from == 0 || state->failed_from > decoding_number )
+            state->failed_from = decoding_number;
+        /* Prefer the more past RAP since it serves more pictures. */
+        if( good_rap && (state->good_rap == 0 || state->good_rap > good_rap) )
+        {
+            state->good_rap   = good_rap;
+            state->aggressive = aggressive;
+        }
+        else if( good_rap && state->good_rap == good_rap )
+            state->aggressive |= aggressive;
+    }
+    if( good_rap == 0 )
+    {
+        lwlibav_bad_region_map_t *map = &vdhp->bad_region;
+        if( !map->undecodable )
+            map->undecodable = (uint8_t *)lw_malloc_zero( vdhp->frame_count + 1 );
+        if( map->undecodable )
+            map->undecodable[picture_number] = 1;
+    }
+}
+
 static int get_requested_picture
 (
     lwlibav_video_decode_handler_t *vdhp,
@@ -1006,12 +1808,23 @@ static int get_requested_picture
         extradata_index = vdhp->frame_list[ vdhp->first_valid_frame_number ].extradata_index;
         goto return_frame;
     }
+    if( vdhp->bad_region.undecodable && vdhp->bad_region.undecodable[picture_number] )
+    {
+        /* Don't repeat the retries which failed for this picture before. */
+        lw_log_show( &vdhp->lh, LW_LOG_ERROR, "The requested video frame is known to be undecodable." );
+        return -1;
+    }
     uint32_t start_number;  /* number of picture, for normal decoding, where decoding starts excluding decoding delay */
     uint32_t rap_number;    /* number of picture, for seeking, where decoding starts excluding decoding delay */
     uint32_t last_frame_number = vdhp->last_frame_number + last_half_offset;
     int      seek_mode         = vdhp->seek_mode;
     int64_t  rap_pos           = INT64_MIN;
+    int      mode_switch_point = is_thread_mode_switch_point( vdhp, picture_number, last_frame_number );
+    vdhp->seek_cost.seeked     = 0;
+    vdhp->bad_region.transient = 0;
     if( picture_number > last_frame_number
+     && !mode_switch_point
+     && !vdhp->seek_cost.active
      && picture_number <= last_frame_number + vdhp->forward_seek_threshold )
     {
         start_number = vdhp->last_fed_picture_number + 1;
@@ -1020,28 +1833,47 @@ static int get_requested_picture
     else
     {
         find_random_accessible_point( vdhp, picture_number, 0, &rap_number );
-        if( rap_number == vdhp->last_rap_number && picture_number > last_frame_number )
+        apply_bad_region_map( vdhp, picture_number, &rap_number, &seek_mode );
+        if( picture_number > last_frame_number
+         && !mode_switch_point
+         && (rap_number == vdhp->last_rap_number
+          || (vdhp->seek_cost.active && is_forward_decoding_cheaper( vdhp, picture_number, last_frame_number, rap_number ))) )
+        {
             start_number = vdhp->last_fed_picture_number + 1;
+            rap_number   = vdhp->last_rap_number;
+        }
         else
         {
             /* Require starting to decode from random accessible picture. */
             rap_pos = get_random_accessible_point_position( vdhp, rap_number );
             vdhp->last_rap_number = rap_number;
+            vdhp->seek_cost.seeked = 1;
             start_number = seek_video( vdhp, frame, picture_number, rap_number, rap_pos, seek_mode != SEEK_MODE_NORMAL );
         }
     }
     /* Get frame containing the requested picture. */
-    int error_count = 0;
+    int      error_count = 0;
+    uint32_t failed_rap  = 0;
     while( start_number == 0
         || get_frame( vdhp, frame, start_number, picture_number, rap_number ) < 0 )
     {
         /* Failed to get requested picture. */
-        if( vdhp->error || seek_mode == SEEK_MODE_AGGRESSIVE )
+        if( failed_rap == 0 )
+            failed_rap = rap_number;
+        if( vdhp->error )
+            goto video_fail;
+        if( seek_mode == SEEK_MODE_AGGRESSIVE )
+        {
+            record_bad_region( vdhp, picture_number, failed_rap, 0, 0 );
             goto video_fail;
+        }
         if( ++error_count > MAX_ERROR_COUNT || rap_number <= 1 )
         {
             if( seek_mode == SEEK_MODE_UNSAFE )
+            {
+                record_bad_region( vdhp, picture_number, failed_rap, 0, 0 );
                 goto video_fail;
+            }
             /* Retry to decode from the same random accessible picture with error ignorance. */
             seek_mode = SEEK_MODE_AGGRESSIVE;
         }
@@ -1052,8 +1884,13 @@ static int get_requested_picture
             rap_pos = get_random_accessible_point_position( vdhp, rap_number );
             vdhp->last_rap_number = rap_number;
         }
+        vdhp->seek_cost.seeked = 1;
         start_number = seek_video( vdhp, frame, picture_number, rap_number, rap_pos, seek_mode != SEEK_MODE_NORMAL );
     }
+    if( failed_rap )
+        /* Later requests around here go straight to the RAP which worked. */
+        record_bad_region( vdhp, picture_number, failed_rap, rap_number,
+                           seek_mode == SEEK_MODE_AGGRESSIVE && vdhp->seek_mode != SEEK_MODE_AGGRESSIVE );
     vdhp->last_frame_number = picture_number;
     extradata_index = vdhp->frame_list[picture_number].extradata_index;
 return_frame:;
@@ -1249,116 +2086,208 @@ static int lwlibav_repeat_control
     }
 }
 
-static int64_t lwlibav_get_ts
+/* The pixel formats described in the index may not match pixel formats supported by the active decoder.
+ * This selects the best pixel format from supported pixel formats with best effort. */
+static void handle_decoder_pix_fmt
 (
-    lwlibav_video_decode_handler_t *vdhp,
-    uint32_t                        frame_number
+    AVCodecParameters *codecpar,
+    const AVCodec     *codec,
+    enum AVPixelFormat pix_fmt
 )
 {
-    return (vdhp->lw_seek_flags & (SEEK_PTS_GENERATED | SEEK_PTS_BASED)) ? vdhp->frame_list[frame_number].pts
-         : (vdhp->lw_seek_flags & SEEK_DTS_BASED)                        ? vdhp->frame_list[frame_number].dts
-         :                                                                 AV_NOPTS_VALUE;
+    assert( codecpar && codec );
+    if( codec->pix_fmts )
+        codecpar->format = (int)avcodec_find_best_pix_fmt_of_list( codec->pix_fmts, pix_fmt, 1, NULL );
+    else
+        codecpar->format = (int)pix_fmt;
 }
 
-static uint32_t lwlibav_vfr2cfr
+/* Decode the next frame in output order and keep it in the lookback buffer of the streaming mode.
+ * Return 0 if successful.
+ * Return 1 if no more frames.
+ * Return a negative value otherwise. */
+static int decode_next_stream_frame
 (
-    lwlibav_video_decode_handler_t *vdhp,
-    lwlibav_video_output_handler_t *vohp,
-    uint32_t                        frame_number
+    lwlibav_video_decode_handler_t *vdhp
 )
 {
-    /* Convert VFR to CFR. */
-    double target_ts  = (double)((uint64_t)(frame_number - 1) * vohp->cfr_den) / vohp->cfr_num;
-    double current_ts = DBL_MAX;
-    AVRational time_base = vdhp->format->streams[ vdhp->stream_index ]->time_base;
-    int64_t ts = lwlibav_get_ts( vdhp, vdhp->last_ts_frame_number );
-    if( ts != AV_NOPTS_VALUE )
-    {
-        current_ts = ((double)(ts - vdhp->min_ts) * time_base.num) / time_base.den;
-        if( target_ts == current_ts )
-            return vdhp->last_ts_frame_number;
-    }
-    uint32_t composition_frame_number = vdhp->last_ts_frame_number;
-    double   prev_ts = current_ts;
-    if( target_ts < current_ts )
+    lwlibav_stream_mode_t *stream_mode = &vdhp->stream_mode;
+    AVPacket *pkt = &vdhp->packet;
+    AVFrame  *picture = vdhp->frame_buffer;
+    while( 1 )
     {
-        for( composition_frame_number--;
-             composition_frame_number;
-             composition_frame_number-- )
+        /* Drain the decoder before sending the next packet not to make the decoder refuse it. */
+        int got_picture;
+        av_frame_unref( picture );
+        decode_video_packet( vdhp->ctx, picture, &got_picture, NULL );
+        if( !got_picture )
         {
-            ts = lwlibav_get_ts( vdhp, composition_frame_number );
-            if( ts != AV_NOPTS_VALUE )
+            if( stream_mode->eof && !vdhp->packet_pending )
+                return 1;
+            /* Take the next packet of the stream unless the decoder didn't accept the last one.
+             * At the end of the stream, an empty packet flushes the decoder. */
+            if( !vdhp->packet_pending )
             {
-                current_ts = ((double)(ts - vdhp->min_ts) * time_base.num) / time_base.den;
-                prev_ts = current_ts;
-                if( current_ts <= target_ts )
-                    break;
+                int ret;
+                while( (ret = av_read_frame( vdhp->format, pkt )) >= 0 && pkt->stream_index != vdhp->stream_index )
+                    av_packet_unref( pkt );
+                if( ret < 0 )
+                    stream_mode->eof = 1;
             }
+            /* Skip the packet if broken. Sequential decoding can't retry it anyway. */
+            vdhp->packet_pending = decode_video_packet( vdhp->ctx, picture, &got_picture, pkt ) > 0;
+            if( !vdhp->packet_pending )
+                av_packet_unref( pkt );
+            if( !got_picture )
+                continue;
         }
-        if( composition_frame_number == 0 )
-            return 0;
+        AVFrame **slot = &stream_mode->frames[ (stream_mode->decoded_count + 1) % stream_mode->capacity ];
+        if( !*slot && !(*slot = av_frame_alloc()) )
+            return -1;
+        av_frame_unref( *slot );
+        av_frame_move_ref( *slot, picture );
+        ++ stream_mode->decoded_count;
+        return 0;
+    }
+}
+
+static int get_stream_frame
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    uint32_t                        frame_number
+)
+{
+    lwlibav_stream_mode_t *stream_mode = &vdhp->stream_mode;
+    while( stream_mode->decoded_count < frame_number )
+    {
+        int ret = decode_next_stream_frame( vdhp );
+        if( ret < 0 )
+            return -1;
+        if( ret > 0 )
+            break;
+    }
+    if( stream_mode->decoded_count == 0 )
+    {
+        lw_log_show( &vdhp->lh, LW_LOG_FATAL, "Failed to decode any frame of the stream." );
+        return -1;
     }
-    double next_target_ts = (double)((uint64_t)frame_number * vohp->cfr_den) / vohp->cfr_num;
-    for( composition_frame_number++;
-         composition_frame_number <= vdhp->frame_count;
-         composition_frame_number++ )
+    /* Repeat the last frame if the stream is shorter than the specified or estimated number of frames. */
+    frame_number = MIN( frame_number, stream_mode->decoded_count );
+    if( stream_mode->decoded_count - frame_number >= stream_mode->capacity )
+    {
+        lw_log_show( &vdhp->lh, LW_LOG_FATAL, "Frame %u is no longer in the lookback buffer of the streaming mode.", frame_number );
+        return -1;
+    }
+    av_frame_unref( vdhp->frame_buffer );
+    if( av_frame_ref( vdhp->frame_buffer, stream_mode->frames[ frame_number % stream_mode->capacity ] ) < 0 )
+        return -1;
+    vdhp->last_frame_number = frame_number;
+    return 0;
+}
+
+/* Decode the keyframe 'picture_number' by itself in the keyframe-only mode.
+ * Only its packet, and the one of the second field if field coded, is fed to the decoder skipping non-keyframes,
+ * and then the decoder is drained, so neither pre-roll nor decoder delay is involved.
+ * Return 0 if successful.
+ * Return 1 if the decoder output nothing, e.g. the keyframe is not intra coded. Then, the caller should seek normally.
+ * Return a negative value otherwise. */
+static int decode_keyframe
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    AVFrame                        *frame,
+    uint32_t                        picture_number
+)
+{
+    uint32_t rap_number      = vdhp->frame_list[picture_number].sample_number;
+    int64_t  rap_pos         = get_random_accessible_point_position( vdhp, rap_number );
+    int      extradata_index = vdhp->frame_list[picture_number].extradata_index;
+    int      reopened        = apply_thread_budget( vdhp );
+    if( extradata_index != vdhp->exh.current_index )
+        lwlibav_update_configuration( (lwlibav_decode_handler_t *)vdhp, rap_number, extradata_index, rap_pos );
+    else if( !reopened )
+        lwlibav_flush_buffers( (lwlibav_decode_handler_t *)vdhp );
+    vdhp->packet_pending = 0;
+    if( vdhp->error )
+        return -1;
+    lwlibav_packet_cache_t *cache = &vdhp->packet_cache;
+    cache->serving = cache->packets && rap_number <= vdhp->frame_count && cache->packets[rap_number];
+    if( !cache->serving
+     && lavf_seek_frame( vdhp->format, vdhp->stream_index, rap_pos, vdhp->av_seek_flags ) < 0 )
+        lavf_seek_frame( vdhp->format, vdhp->stream_index, rap_pos, vdhp->av_seek_flags | AVSEEK_FLAG_ANY );
+    vdhp->ctx->skip_frame = AVDISCARD_NONKEY;
+    vdhp->exh.delay_count = 0;
+    vdhp->last_half_frame = 0;
+    vdhp->last_rap_number = rap_number;
+    int      got_picture = 0;
+    uint32_t last_number = rap_number + (is_half_frame( vdhp, picture_number ) ? 1 : 0);
+    for( uint32_t current = rap_number; current <= last_number && !got_picture; current++ )
     {
-        ts = lwlibav_get_ts( vdhp, composition_frame_number );
-        if( ts != AV_NOPTS_VALUE )
+        int64_t pkt_pts;    /* unused */
+        int ret = decode_video_picture( vdhp, frame, &got_picture, &pkt_pts, &current, rap_number, rap_number, 0 );
+        if( ret == -2 )
         {
-            current_ts = ((double)(ts - vdhp->min_ts) * time_base.num) / time_base.den;
-            if( current_ts >= target_ts )
-            {
-                uint32_t prev_composition_frame_number = composition_frame_number;
-                while( lwlibav_get_ts( vdhp, --prev_composition_frame_number ) == AV_NOPTS_VALUE );
-                if( prev_composition_frame_number == 0 )
-                    frame_number = 1;
-                else
-                {
-                    if( current_ts > next_target_ts )
-                        /* Between the current target and the next target, there are no input frames.
-                         * Therefore, output the previous frame. This is absolutely correct. */
-                        frame_number = prev_composition_frame_number;
-                    else
-                    {
-                        if( current_ts > (next_target_ts + target_ts) / 2 )
-                            /* The current frame is far from the current target and should be a candidate for the next target. */
-                            frame_number = prev_composition_frame_number;
-                        else
-                        {
-                            /* Choose the nearest one. */
-                            if( current_ts - target_ts >= target_ts - prev_ts )
-                                frame_number = prev_composition_frame_number;
-                            else
-                                frame_number = composition_frame_number;
-                        }
-                    }
-                }
-                break;
-            }
-            prev_ts = current_ts;
+            vdhp->ctx->skip_frame = AVDISCARD_DEFAULT;
+            return -1;
         }
+        else if( ret == 1 )
+            /* No more packets. */
+            break;
+    }
+    if( !got_picture )
+    {
+        /* Drain the decoder. */
+        AVPacket pkt = { 0 };
+        av_frame_unref( frame );
+        if( decode_video_packet( vdhp->ctx, frame, &got_picture, &pkt ) < 0 )
+            got_picture = 0;
+        else if( got_picture )
+            vdhp->last_dec_frame = frame;
     }
-    if( composition_frame_number > vdhp->frame_count )
-        frame_number = vdhp->frame_count;
-    vdhp->last_ts_frame_number = frame_number;
-    return frame_number;
+    vdhp->ctx->skip_frame = AVDISCARD_DEFAULT;
+    return got_picture ? 0 : 1;
 }
 
-/* The pixel formats described in the index may not match pixel formats supported by the active decoder.
- * This selects the best pixel format from supported pixel formats with best effort. */
-static void handle_decoder_pix_fmt
+static int get_keyframe
 (
-    AVCodecParameters *codecpar,
-    const AVCodec     *codec,
-    enum AVPixelFormat pix_fmt
+    lwlibav_video_decode_handler_t *vdhp,
+    uint32_t                        frame_number
 )
 {
-    assert( codecpar && codec );
-    if( codec->pix_fmts )
-        codecpar->format = (int)avcodec_find_best_pix_fmt_of_list( codec->pix_fmts, pix_fmt, 1, NULL );
+    lwlibav_keyframe_only_t *kfp = &vdhp->keyframe_only;
+    frame_number = MIN( frame_number, kfp->count );
+    if( frame_number == kfp->last_frame_number )
+        return 1;
+    uint32_t picture_number = kfp->frames[frame_number];
+    AVFrame *frame          = vdhp->frame_buffer;
+    int ret = decode_keyframe( vdhp, frame, picture_number );
+    if( ret < 0 )
+    {
+        lw_log_show( &vdhp->lh, LW_LOG_ERROR, "Couldn't get the requested keyframe." );
+        return -1;
+    }
+    else if( ret == 1 )
+    {
+        /* The decoder doesn't regard the picture as a keyframe, e.g. a recovery point of H.264.
+         * Decode it in the usual way from the random accessible point. */
+        lwlibav_video_force_seek( vdhp );
+        if( get_requested_picture( vdhp, frame, picture_number ) < 0 )
+            return -1;
+    }
     else
-        codecpar->format = (int)pix_fmt;
+    {
+        vdhp->last_req_frame = frame;
+        /* Don't exceed the maximum presentation size specified for each sequence. */
+        lwlibav_extradata_t *entry = &vdhp->exh.entries[ vdhp->frame_list[picture_number].extradata_index ];
+        if( vdhp->ctx->width > entry->width )
+            vdhp->ctx->width = entry->width;
+        if( vdhp->ctx->height > entry->height )
+            vdhp->ctx->height = entry->height;
+        frame->pts = vdhp->frame_list[picture_number].pts;
+    }
+    /* Every keyframe is decoded from scratch, so never continue decoding from the last one. */
+    lwlibav_video_force_seek( vdhp );
+    kfp->last_frame_number = frame_number;
+    return 0;
 }
 
 static int get_video_frame
@@ -1368,6 +2297,10 @@ static int get_video_frame
     uint32_t                        frame_number
 )
 {
+    if( vdhp->stream_mode.active )
+        return get_stream_frame( vdhp, frame_number );
+    if( vdhp->keyframe_only.active )
+        return get_keyframe( vdhp, frame_number );
     if( vohp->repeat_control )
         return lwlibav_repeat_control( vdhp, vohp, frame_number );
     if( frame_number == vdhp->last_frame_number )
@@ -1387,10 +2320,11 @@ int lwlibav_video_get_frame
 {
     if( vohp->vfr2cfr )
     {
-        frame_number = lwlibav_vfr2cfr( vdhp, vohp, frame_number );
+        frame_number = lw_vfr2cfr_get_source_frame_number( vohp, frame_number );
         if( frame_number == 0 )
             return -1;
     }
+    lw_thread_budget_touch( vdhp->thread_budget );
     int ret;
     if( (ret = get_video_frame( vdhp, vohp, frame_number )) != 0
      || (ret = update_scaler_configuration_if_needed( &vohp->scaler, &vdhp->lh, vdhp->frame_buffer )) < 0 )
@@ -1406,8 +2340,16 @@ int lwlibav_video_is_keyframe
 )
 {
     assert( frame_number );
+    if( vdhp->stream_mode.active )
+        return 0;
+    if( vdhp->keyframe_only.active )
+        return 1;
     if( vohp->vfr2cfr )
-        frame_number = lwlibav_vfr2cfr( vdhp, vohp, frame_number );
+    {
+        frame_number = lw_vfr2cfr_get_source_frame_number( vohp, frame_number );
+        if( frame_number == 0 )
+            return 0;
+    }
     if( vohp->repeat_control )
     {
         lw_video_frame_order_t *curr = &vohp->frame_order_list[frame_number    ];
@@ -1426,11 +2368,13 @@ int lwlibav_video_find_first_valid_frame
     vdhp->movable_frame_buffer = av_frame_alloc();
     if( !vdhp->movable_frame_buffer )
         return -1;
+    if( vdhp->stream_mode.active )
+        /* The first decoded frame is the first valid frame in the streaming mode. */
+        return 0;
     const AVCodec       *codec    = vdhp->ctx->codec;
     AVCodecParameters   *codecpar = vdhp->format->streams[ vdhp->stream_index ]->codecpar;
     handle_decoder_pix_fmt( codecpar, codec, (enum AVPixelFormat)codecpar->format );
     vdhp->ctx->pix_fmt = (enum AVPixelFormat)codecpar->format;  /* Correct decoder pixel format. */
-    vdhp->last_ts_frame_number = vdhp->frame_count;
     vdhp->av_seek_flags = (vdhp->lw_seek_flags & SEEK_POS_BASED) ? AVSEEK_FLAG_BYTE
                         : vdhp->lw_seek_flags == 0               ? AVSEEK_FLAG_FRAME
                         : 0;
@@ -1499,7 +2443,7 @@ enum lw_field_info lwlibav_video_get_field_info
     uint32_t                        frame_number
 )
 {
-    return frame_number <= vdhp->frame_count
+    return frame_number <= vdhp->frame_count && vdhp->frame_list
          ? vdhp->frame_list[frame_number].field_info
          : LW_FIELD_INFO_UNKNOWN;
 }
@@ -1563,8 +2507,9 @@ int try_decode_video_frame
         }
         /* Try decode a frame. */
         av_frame_unref( picture );
+        /* Resend the packet while the decoder refuses it. Every refusal outputs a frame, so this ends. */
         int dummy;
-        decode_video_packet( ctx, picture, &dummy, &pkt );
+        while( decode_video_packet( ctx, picture, &dummy, &pkt ) > 0 );
         ++frame_number;
     } while( ctx->width == 0 || ctx->height == 0 || ctx->pix_fmt == AV_PIX_FMT_NONE );
     av_frame_free( &picture );
@@ -38,6 +38,30 @@ typedef enum lw_field_info
     LW_FIELD_INFO_BOTTOM,       /* bottom field first or bottom field coded */
 } lw_field_info_t;
 
+typedef enum lw_thread_mode
+{
+    LW_THREAD_MODE_THROUGHPUT = 0,  /* frame and slice threading for long linear runs */
+    LW_THREAD_MODE_LATENCY,         /* slice threading only for random access, i.e. no decoder delay by frame threading */
+} lw_thread_mode_t;
+
+/*****************************************************************************
+ * Statistics
+ *****************************************************************************/
+typedef struct
+{
+    int64_t decode_cost;    /* estimated time to read and decode a picture in microseconds */
+    int64_t seek_cost;      /* estimated overhead of a seek excluding decoding of pictures in microseconds */
+    int64_t forward_cost;   /* estimated cost of the last request by continuing decoding */
+    int64_t reseek_cost;    /* estimated cost of the last request by seeking */
+    int     seeked;         /* whether the last request was served by seeking */
+    int64_t read_count;     /* the number of reads from the source file */
+    int64_t read_bytes;     /* the total bytes read from the source file */
+    int64_t seek_count;     /* the number of seeks in the source file */
+    int     thread_mode;    /* the current threading mode of the decoder, one of LW_THREAD_MODE_*s */
+    int64_t thread_switch_threshold;    /* the number of sequential requests to switch to LW_THREAD_MODE_THROUGHPUT,
+                                         * 0 if the threading mode is never switched */
+} lwlibav_video_stats_t;
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -85,12 +109,52 @@ void lwlibav_video_set_forward_seek_threshold
     uint32_t                        forward_seek_threshold
 );
 
+void lwlibav_video_set_adaptive_seek
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    int                             adaptive_seek
+);
+
 void lwlibav_video_set_seek_mode
 (
     lwlibav_video_decode_handler_t *vdhp,
     int                             seek_mode
 );
 
+/* Set the byte budget of the cache of demuxed packets for recently decoded pictures.
+ * 0 disables the cache. */
+void lwlibav_video_set_packet_cache_size
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    size_t                          max_size
+);
+
+/* Set the number of the last decoded frames kept for backward requests in the streaming mode. */
+void lwlibav_video_set_stream_lookback
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    uint32_t                        lookback_count
+);
+
+/* Set the number of consecutive sequential requests to switch the decoder from the low-latency threading mode
+ * to the high-throughput one. Any other seek switches it back to the low-latency mode.
+ * Both decoder contexts are kept opened once created, so switching doesn't reopen decoders.
+ * 0 disables switching, i.e. the decoder always runs in the high-throughput mode. */
+void lwlibav_video_set_thread_switch_threshold
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    uint32_t                        threshold
+);
+
+/* Set the preview level of the decoder to trade the fidelity for the decoding speed. (see decode.h)
+ * With lowres, the maximum presentation size reported by the getters is reduced as well.
+ * This must be called before the decoder is opened. */
+void lwlibav_video_set_preview
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    int                             preview
+);
+
 void lwlibav_video_set_preferred_decoder_names
 (
     lwlibav_video_decode_handler_t *vdhp,
@@ -158,6 +222,23 @@ AVFrame *lwlibav_video_get_frame_buffer
     lwlibav_video_decode_handler_t *vdhp
 );
 
+void lwlibav_video_get_stats
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    lwlibav_video_stats_t          *stats
+);
+
+/* Get the frame number in the source stream of the output frame 'frame_number' and its presentation time
+ * in seconds from the first frame. Both are the ones of the keyframe in the keyframe-only mode.
+ * '*source_time' is set to a negative value if unknown. */
+void lwlibav_video_get_source_frame_info
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    uint32_t                        frame_number,
+    uint32_t                       *source_frame_number,
+    double                         *source_time
+);
+
 /*****************************************************************************
  * Others
  *****************************************************************************/
@@ -173,6 +254,26 @@ int lwlibav_video_get_desired_track
     int                             threads
 );
 
+/* Open the video stream in the streaming mode instead of lwlibav_construct_index() and lwlibav_video_get_desired_track().
+ * In this mode, frames are decoded strictly forward without the index and seeking the source,
+ * so non-seekable inputs such as pipes can be read with no indexing latency.
+ * Requests to a frame older than the lookback buffer fail.
+ * If 'stream_index' is negative, the best video stream is chosen.
+ * If 'frame_count' is 0, it is estimated from the header of the container.
+ * The source is read through 'io_callbacks' if not NULL, otherwise the file is opened with 'io_flags'
+ * in the same way as lwlibav_construct_index(). */
+int lwlibav_video_open_stream
+(
+    const char                     *file_path,
+    const lw_io_callbacks_t        *io_callbacks,
+    int                             io_flags,
+    lwlibav_video_decode_handler_t *vdhp,
+    lwlibav_video_output_handler_t *vohp,
+    int                             stream_index,
+    uint32_t                        frame_count,
+    int                             threads
+);
+
 void lwlibav_video_setup_timestamp_info
 (
     lwlibav_file_handler_t         *lwhp,
@@ -183,6 +284,18 @@ void lwlibav_video_setup_timestamp_info
     int                             apply_repeat_flag
 );
 
+/* Switch to the keyframe-only mode, where only the keyframes of the stream are output as frames.
+ * Each keyframe is decoded by feeding only its packet to the decoder, which skips any non-keyframe,
+ * so no pre-roll happens. This overrides the frame count, repeat control and VFR->CFR conversion,
+ * so call this after lwlibav_video_setup_timestamp_info().
+ * Return 0 if successful.
+ * Return -1 otherwise, e.g. in the streaming mode or no keyframe is indexed. */
+int lwlibav_video_setup_keyframe_only
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    lwlibav_video_output_handler_t *vohp
+);
+
 void lwlibav_video_set_initial_input_format
 (
     lwlibav_video_decode_handler_t *vdhp
@@ -20,11 +20,16 @@
 
 /* This file is available under an ISC license. */
 
+#include "lwthreads.h"
+
 #define LW_VFRAME_FLAG_KEY                 0x1
 #define LW_VFRAME_FLAG_LEADING             0x2
 #define LW_VFRAME_FLAG_CORRUPT             0x4
 #define LW_VFRAME_FLAG_INVISIBLE           0x8
 #define LW_VFRAME_FLAG_COUNTERPART_MISSING 0x10
+#define LW_VFRAME_FLAG_DECODABLE_LEADING   0x20     /* a leading picture decodable from the closest preceding RAP */
+#define LW_VFRAME_FLAG_PRIOR_RAP           0x40     /* a picture to be decoded from the RAP before the closest one */
+#define LW_VFRAME_FLAG_NON_REFERENCE       0x80     /* a picture which no other picture refers to */
 
 typedef struct
 {
@@ -45,6 +50,72 @@ typedef struct
     uint32_t decoding_to_presentation;
 } order_converter_t;
 
+typedef struct
+{
+    int      active;            /* if set to non-zero, decide whether to seek or not by the measured costs
+                                 * instead of forward_seek_threshold */
+    int64_t  decode_cost;       /* average time to read and decode a picture in microseconds */
+    int64_t  seek_cost;         /* average overhead of a seek excluding decoding of pictures in microseconds
+                                 * i.e. flushing or reopening the decoder and seeking the demuxer */
+    uint32_t decode_samples;
+    uint32_t seek_samples;
+    int64_t  forward_cost;      /* the estimated cost to get the last requested picture by continuing decoding */
+    int64_t  reseek_cost;       /* the estimated cost to get the last requested picture by seeking */
+    int      seeked;            /* whether the last requested picture was got by seeking or not */
+} lwlibav_seek_cost_t;
+
+typedef struct
+{
+    AVPacket **packets;         /* cached demuxed packets indexed by decoding number */
+    uint32_t  *order;           /* ring buffer of cached decoding numbers in insertion order */
+    uint32_t   capacity;        /* the number of entries of the ring buffer */
+    uint32_t   head;            /* the position of the oldest entry in the ring buffer */
+    uint32_t   count;           /* the number of cached packets */
+    size_t     size;            /* the total size of cached packet data in bytes */
+    size_t     max_size;        /* the byte budget of the cache; 0 disables caching */
+    int        serving;         /* if set to non-zero, packets are fed from the cache instead of the demuxer */
+} lwlibav_packet_cache_t;
+
+typedef struct
+{
+    uint32_t failed_from;       /* the smallest decoding number of the pictures failed to be decoded from this RAP, 0 if none */
+    uint32_t good_rap;          /* the RAP from which such pictures were decoded successfully, 0 if unknown */
+    int      aggressive;        /* if set to non-zero, decoding from good_rap needed error ignorance */
+} lwlibav_rap_state_t;
+
+typedef struct
+{
+    lwlibav_rap_state_t *raps;          /* indexed in the same way as rap_list, allocated at the first failure */
+    uint8_t             *undecodable;   /* flags indexed by presentation number, allocated at the first unrecoverable failure */
+    int                  transient;     /* set if reading or decoding failed for a reason other than the bitstream in the current request */
+} lwlibav_bad_region_map_t;
+
+typedef struct
+{
+    int       active;           /* if set to non-zero, decode sequentially without the index and seeking the source */
+    AVFrame **frames;           /* ring buffer of the last decoded frames indexed by frame number modulo capacity */
+    uint32_t  capacity;         /* the number of the last decoded frames kept for backward requests */
+    uint32_t  decoded_count;    /* the number of frames decoded so far, i.e. the frame number of the newest one */
+    int       eof;              /* if set to non-zero, no more frames can be decoded */
+} lwlibav_stream_mode_t;
+
+typedef struct
+{
+    uint32_t        threshold;      /* the number of consecutive sequential requests to switch to the high-throughput mode;
+                                     * 0 disables switching the threading mode */
+    uint32_t        linear_run;     /* the number of the last consecutive sequential requests */
+    AVCodecContext *standby;        /* the decoder context for the other threading mode, kept opened for reuse */
+    int             standby_index;  /* index of extradata which standby was set up with */
+} lwlibav_thread_mode_t;
+
+typedef struct
+{
+    int       active;           /* if set to non-zero, only keyframes are output and each is decoded by itself */
+    uint32_t  count;            /* the number of output keyframes */
+    uint32_t *frames;           /* presentation numbers of output keyframes indexed by output frame number */
+    uint32_t  last_frame_number;    /* the output frame number of the last requested keyframe */
+} lwlibav_keyframe_only_t;
+
 struct lwlibav_video_decode_handler_tag
 {
     /* common */
@@ -68,8 +139,19 @@ struct lwlibav_video_decode_handler_tag
     video_frame_info_t *frame_list;         /* stored in presentation order */
     int                 soft_reset;         /* if false: close and re-open codecs when seeking (default);
                                                if true:  just calling avcodec_flush_buffers */
+    const lw_io_callbacks_t *io_callbacks;
+    int                 io_flags;           /* LW_IO_FLAG_*s to open the file with */
+    int                 preview;            /* the preview level of the decoder, 0 for the exact decoding */
     /* */
     uint32_t            forward_seek_threshold;
+    lwlibav_seek_cost_t seek_cost;
+    lwlibav_packet_cache_t packet_cache;
+    lwlibav_stream_mode_t stream_mode;
+    lwlibav_bad_region_map_t bad_region;
+    lwlibav_thread_mode_t thread_mode;
+    lwlibav_keyframe_only_t keyframe_only;
+    lw_thread_budget_client_t *thread_budget;       /* the share of the process-wide budget of decoder threads */
+    int                 budget_threads;             /* the number of threads assigned by the budget when the decoder was opened */
     int                 seek_mode;
     int                 max_width;
     int                 max_height;
@@ -78,12 +160,16 @@ struct lwlibav_video_decode_handler_tag
     enum AVPixelFormat  initial_pix_fmt;
     enum AVColorSpace   initial_colorspace;
     AVPacket            packet;
+    int                 packet_pending;             /* set if 'packet' was not accepted by the decoder and shall be sent again */
     order_converter_t  *order_converter;            /* maps of decoding to presentation stored in decoding order */
     uint8_t            *keyframe_list;              /* keyframe list stored in decoding order */
+    uint32_t           *rap_list;                   /* decoding numbers of keyframes sorted in ascending order */
+    uint32_t            rap_count;                  /* the number of entries in rap_list */
     uint32_t            last_half_frame;            /* The last frame consists of complementary field coded picture pair
                                                      * if set to non-zero, otherwise single frame coded picture. */
     uint32_t            last_frame_number;          /* the number of the last requested frame */
     uint32_t            last_rap_number;            /* the number of the last random accessible picture */
+    uint32_t            last_prefetch_number;       /* the number of the random accessible picture prefetched last */
     uint32_t            last_fed_picture_number;    /* the number of the last picture fed to the decoder
                                                      * This number could be larger than frame_count to handle flush. */
     uint32_t            first_valid_frame_number;
@@ -97,7 +183,6 @@ struct lwlibav_video_decode_handler_tag
                                                      * where the decoder outputs temporally stored frame data */
     int64_t             stream_duration;
     int64_t             min_ts;
-    uint32_t            last_ts_frame_number;
     AVRational          actual_time_base;
     int                 strict_cfr;
 };
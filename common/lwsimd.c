@@ -22,17 +22,27 @@
 
 #include <stdint.h>
 
+#include "lwsimd.h"
+
 #ifdef __GNUC__
 static void __cpuid(int CPUInfo[4], int prm)
 {
     __asm volatile ( "cpuid" :"=a"(CPUInfo[0]), "=b"(CPUInfo[1]), "=c"(CPUInfo[2]), "=d"(CPUInfo[3]) :"a"(prm) );
     return;
 }
+
+static void cpuid_count(int CPUInfo[4], int prm, int sub)
+{
+    __asm volatile ( "cpuid" :"=a"(CPUInfo[0]), "=b"(CPUInfo[1]), "=c"(CPUInfo[2]), "=d"(CPUInfo[3]) :"a"(prm), "c"(sub) );
+    return;
+}
 #else
 #include <intrin.h>
+#define cpuid_count __cpuidex
 #endif /* __GNUC__ */
 
-static int check_xgetbv( void )
+/* Check if the OS saves all the register states indicated by 'mask' on context switches. */
+static int check_xgetbv( uint32_t mask )
 {
 #if defined(_MSC_VER) && defined(_XCR_XFEATURE_ENABLED_MASK)
     uint64_t eax = _xgetbv( _XCR_XFEATURE_ENABLED_MASK );
@@ -43,7 +53,7 @@ static int check_xgetbv( void )
 #else
     uint32_t eax = 0;
 #endif
-    return (eax & 0x6) == 0x6;
+    return (eax & mask) == mask;
 }
 
 int lw_check_sse2()
@@ -71,10 +81,51 @@ int lw_check_avx2()
 {
     int CPUInfo[4];
     __cpuid( CPUInfo, 1 );
-    if( (CPUInfo[2] & 0x18000000) == 0x18000000 && check_xgetbv() )
+    if( (CPUInfo[2] & 0x18000000) == 0x18000000 && check_xgetbv( 0x6 ) )
     {
-        __cpuid( CPUInfo, 7 );
+        cpuid_count( CPUInfo, 7, 0 );
         return (CPUInfo[1] & 0x00000020) != 0;
     }
     return 0;
 }
+
+int lw_check_avx512bw()
+{
+    int CPUInfo[4];
+    __cpuid( CPUInfo, 1 );
+    /* The OS shall save the opmask and the upper halves of ZMM registers in addition to YMM registers. */
+    if( (CPUInfo[2] & 0x18000000) == 0x18000000 && check_xgetbv( 0xe6 ) )
+    {
+        cpuid_count( CPUInfo, 7, 0 );
+        /* AVX-512F and AVX-512BW */
+        return (CPUInfo[1] & 0x40010000) == 0x40010000;
+    }
+    return 0;
+}
+
+static int simd_level_limit = LW_SIMD_LEVEL_AVX512BW;
+
+void lw_set_simd_level_limit( int level )
+{
+    simd_level_limit = level;
+}
+
+int lw_get_simd_level( void )
+{
+    /* Every thread detects the same level, so racing on this is harmless. */
+    static int simd_level = -1;
+    if( simd_level < 0 )
+    {
+        if( lw_check_avx512bw() )
+            simd_level = LW_SIMD_LEVEL_AVX512BW;
+        else if( lw_check_avx2() )
+            simd_level = LW_SIMD_LEVEL_AVX2;
+        else if( lw_check_sse41() )
+            simd_level = LW_SIMD_LEVEL_SSE41;
+        else if( lw_check_ssse3() )
+            simd_level = LW_SIMD_LEVEL_SSSE3;
+        else
+            simd_level = lw_check_sse2() ? LW_SIMD_LEVEL_SSE2 : LW_SIMD_LEVEL_C;
+    }
+    return simd_level < simd_level_limit ? simd_level : simd_level_limit;
+}
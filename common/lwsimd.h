@@ -20,16 +20,50 @@
 
 /* This file is available under an ISC license. */
 
+#ifndef LWSIMD_H
+#define LWSIMD_H
+
 #ifdef __GNUC__
 #define LW_ALIGN(x) __attribute__((aligned(x)))
 #define LW_FUNC_ALIGN __attribute__((force_align_arg_pointer))
 #define LW_FORCEINLINE inline __attribute__((always_inline))
+#define LW_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define LW_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define LW_TARGET_AVX2 __attribute__((target("avx2")))
+#define LW_TARGET_AVX512BW __attribute__((target("avx512f,avx512bw")))
 #else
 #define LW_ALIGN(x) __declspec(align(x))
 #define LW_FUNC_ALIGN
 #define LW_FORCEINLINE __forceinline
+#define LW_TARGET_SSSE3
+#define LW_TARGET_SSE41
+#define LW_TARGET_AVX2
+#define LW_TARGET_AVX512BW
+#endif
+
+/* Whether the compiler provides the intrinsics of the instruction sets. */
+#if defined(__GNUC__) || (defined(_MSC_VER) && _MSC_VER >= 1700)
+#define HAVE_AVX2_INTRINSICS 1
+#else
+#define HAVE_AVX2_INTRINSICS 0
+#endif
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5) || (defined(_MSC_VER) && _MSC_VER >= 1910)
+#define HAVE_AVX512_INTRINSICS 1
+#else
+#define HAVE_AVX512_INTRINSICS 0
 #endif
 
+/* Instruction sets in the ascending order, each of which implies the former ones. */
+enum
+{
+    LW_SIMD_LEVEL_C = 0,
+    LW_SIMD_LEVEL_SSE2,
+    LW_SIMD_LEVEL_SSSE3,
+    LW_SIMD_LEVEL_SSE41,
+    LW_SIMD_LEVEL_AVX2,
+    LW_SIMD_LEVEL_AVX512BW
+};
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -39,7 +73,18 @@ int lw_check_sse2();
 int lw_check_ssse3();
 int lw_check_sse41();
 int lw_check_avx2();
+int lw_check_avx512bw();
+
+/* Return the highest level of the instruction sets the CPU and the OS support.
+ * Kernels for a level are still available only if the compiler provides its intrinsics. */
+int lw_get_simd_level( void );
+
+/* Limit the level returned by lw_get_simd_level() to 'level' so that the kernels for the lower levels are chosen,
+ * e.g. to test them against each other. This shall be called before any kernel is chosen. */
+void lw_set_simd_level_limit( int level );
 
 #ifdef __cplusplus
 }
 #endif  /* __cplusplus */
+
+#endif /* LWSIMD_H */
@@ -0,0 +1,501 @@
+/*****************************************************************************
+ * lwthreads.c
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+#include "cpp_compat.h"
+
+#include <stdint.h>
+#include <limits.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  /* __cplusplus */
+#include <libavutil/cpu.h>
+#include <libavutil/time.h>
+#ifdef __cplusplus
+}
+#endif  /* __cplusplus */
+
+#include "utils.h"
+#include "lwthreads.h"
+
+#define LW_THREAD_BUDGET_MAX_AUTO       16          /* the same limit as the automatic thread count of libavcodec */
+#define LW_THREAD_BUDGET_ACTIVE_TIME    2000000     /* microseconds since the last use to regard a decoder as in use */
+#define LW_THREAD_BUDGET_ACTIVE_WEIGHT  8           /* the weight of a decoder in use relative to an idle one */
+
+struct lw_thread_budget_client_tag
+{
+    lw_thread_budget_client_t *next;
+    int                        threads;     /* the requested number of threads, 0 if automatic */
+    int64_t                    pixels;      /* the number of pixels of a picture */
+    int64_t                    last_used;   /* the time of the last use in microseconds */
+};
+
+static lw_thread_budget_client_t *budget_clients = NULL;
+static int                        budget_max_threads = 0;
+
+/* The critical sections are a few dozen instructions, so a spin lock is enough on Windows,
+ * where no lock is statically initializable on every supported version. */
+#ifdef _WIN32
+static volatile LONG budget_lock_word = 0;
+
+static void budget_lock( void )
+{
+    while( InterlockedCompareExchange( &budget_lock_word, 1, 0 ) )
+        Sleep( 0 );
+}
+
+static void budget_unlock( void )
+{
+    InterlockedExchange( &budget_lock_word, 0 );
+}
+#else
+static pthread_mutex_t budget_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void budget_lock( void )
+{
+    pthread_mutex_lock( &budget_mutex );
+}
+
+static void budget_unlock( void )
+{
+    pthread_mutex_unlock( &budget_mutex );
+}
+#endif
+
+static inline int is_client_active
+(
+    lw_thread_budget_client_t *client,
+    int64_t                    now
+)
+{
+    return now - client->last_used < LW_THREAD_BUDGET_ACTIVE_TIME;
+}
+
+static inline int64_t get_client_weight
+(
+    lw_thread_budget_client_t *client,
+    int64_t                    now
+)
+{
+    return client->pixels * (is_client_active( client, now ) ? LW_THREAD_BUDGET_ACTIVE_WEIGHT : 1);
+}
+
+void lw_thread_budget_set_max_threads
+(
+    int max_threads
+)
+{
+    budget_lock();
+    budget_max_threads = MAX( max_threads, 0 );
+    budget_unlock();
+}
+
+lw_thread_budget_client_t *lw_thread_budget_join
+(
+    int threads,
+    int width,
+    int height
+)
+{
+    lw_thread_budget_client_t *client = (lw_thread_budget_client_t *)lw_malloc_zero( sizeof(lw_thread_budget_client_t) );
+    if( !client )
+        return NULL;
+    client->threads   = MAX( threads, 0 );
+    client->pixels    = MAX( (int64_t)width * height, 1 );
+    client->last_used = av_gettime_relative();
+    budget_lock();
+    client->next   = budget_clients;
+    budget_clients = client;
+    budget_unlock();
+    return client;
+}
+
+void lw_thread_budget_leave
+(
+    lw_thread_budget_client_t **client
+)
+{
+    if( !client || !*client )
+        return;
+    budget_lock();
+    for( lw_thread_budget_client_t **p = &budget_clients; *p; p = &(*p)->next )
+        if( *p == *client )
+        {
+            *p = (*client)->next;
+            break;
+        }
+    budget_unlock();
+    lw_freep( client );
+}
+
+void lw_thread_budget_touch
+(
+    lw_thread_budget_client_t *client
+)
+{
+    if( !client )
+        return;
+    int64_t now = av_gettime_relative();
+    budget_lock();
+    client->last_used = now;
+    budget_unlock();
+}
+
+int lw_thread_budget_get_threads
+(
+    lw_thread_budget_client_t *client
+)
+{
+    int total = av_cpu_count();
+    budget_lock();
+    if( budget_max_threads > 0 )
+        total = budget_max_threads;
+    total = MAX( total, 1 );
+    if( client->threads > 0 )
+    {
+        budget_unlock();
+        return MIN( client->threads, total );
+    }
+    /* Decoders with an explicit thread count in use take their threads first,
+     * and then the rest is shared by the ones with the automatic thread count. */
+    int64_t now        = av_gettime_relative();
+    int64_t available  = total;
+    int64_t weight_sum = 0;
+    for( lw_thread_budget_client_t *p = budget_clients; p; p = p->next )
+        if( p->threads == 0 )
+            weight_sum += get_client_weight( p, now );
+        else if( is_client_active( p, now ) )
+            available -= MIN( p->threads, total );
+    int64_t threads = weight_sum > 0 && available > 0
+                    ? (available * get_client_weight( client, now ) + weight_sum / 2) / weight_sum
+                    : 1;
+    budget_unlock();
+    return (int)CLIP_VALUE( threads, 1, MIN( total, LW_THREAD_BUDGET_MAX_AUTO ) );
+}
+
+#ifdef _WIN32
+typedef HANDLE    lw_thread_t;
+#else
+typedef pthread_t lw_thread_t;
+#endif
+
+struct lw_thread_pool_tag
+{
+    int                  threads;       /* the number of threads including the caller of lw_thread_pool_run() */
+    int                  quit;
+    lw_thread_pool_func *func;
+    void                *opaque;
+    int                  job_count;
+    int                  next_job;      /* the number of the next job to be taken */
+    int                  pending;       /* the number of the jobs not finished yet */
+    lw_thread_t         *workers;
+#ifdef _WIN32
+    CRITICAL_SECTION     lock;
+    HANDLE               work_semaphore;
+    HANDLE               done_event;
+#else
+    pthread_mutex_t      mutex;
+    pthread_cond_t       work_cond;
+    pthread_cond_t       done_cond;
+#endif
+};
+
+/* The lock shall be held while waiting, and it's held again on return.
+ * Every wait can wake up spuriously, so the waiter shall check the condition again. */
+#ifdef _WIN32
+static void pool_lock( lw_thread_pool_t *pool )
+{
+    EnterCriticalSection( &pool->lock );
+}
+
+static void pool_unlock( lw_thread_pool_t *pool )
+{
+    LeaveCriticalSection( &pool->lock );
+}
+
+static void pool_wait_work( lw_thread_pool_t *pool )
+{
+    LeaveCriticalSection( &pool->lock );
+    WaitForSingleObject( pool->work_semaphore, INFINITE );
+    EnterCriticalSection( &pool->lock );
+}
+
+static void pool_signal_work( lw_thread_pool_t *pool )
+{
+    ReleaseSemaphore( pool->work_semaphore, pool->threads - 1, NULL );
+}
+
+static void pool_wait_done( lw_thread_pool_t *pool )
+{
+    LeaveCriticalSection( &pool->lock );
+    WaitForSingleObject( pool->done_event, INFINITE );
+    EnterCriticalSection( &pool->lock );
+}
+
+static void pool_signal_done( lw_thread_pool_t *pool )
+{
+    SetEvent( pool->done_event );
+}
+#else
+static void pool_lock( lw_thread_pool_t *pool )
+{
+    pthread_mutex_lock( &pool->mutex );
+}
+
+static void pool_unlock( lw_thread_pool_t *pool )
+{
+    pthread_mutex_unlock( &pool->mutex );
+}
+
+static void pool_wait_work( lw_thread_pool_t *pool )
+{
+    pthread_cond_wait( &pool->work_cond, &pool->mutex );
+}
+
+static void pool_signal_work( lw_thread_pool_t *pool )
+{
+    pthread_cond_broadcast( &pool->work_cond );
+}
+
+static void pool_wait_done( lw_thread_pool_t *pool )
+{
+    pthread_cond_wait( &pool->done_cond, &pool->mutex );
+}
+
+static void pool_signal_done( lw_thread_pool_t *pool )
+{
+    pthread_cond_signal( &pool->done_cond );
+}
+#endif
+
+/* Do the jobs not taken yet. The lock shall be held, and it's held on return. */
+static void pool_do_jobs
+(
+    lw_thread_pool_t *pool,
+    int               is_worker
+)
+{
+    while( pool->next_job < pool->job_count )
+    {
+        int job = pool->next_job++;
+        pool_unlock( pool );
+        pool->func( pool->opaque, job );
+        pool_lock( pool );
+        if( --pool->pending == 0 && is_worker )
+            pool_signal_done( pool );
+    }
+}
+
+#ifdef _WIN32
+static unsigned __stdcall pool_worker( void *arg )
+#else
+static void *pool_worker( void *arg )
+#endif
+{
+    lw_thread_pool_t *pool = (lw_thread_pool_t *)arg;
+    pool_lock( pool );
+    while( !pool->quit )
+    {
+        pool_do_jobs( pool, 1 );
+        if( !pool->quit )
+            pool_wait_work( pool );
+    }
+    pool_unlock( pool );
+    return 0;
+}
+
+static int pool_start_worker
+(
+    lw_thread_pool_t *pool,
+    int               index
+)
+{
+#ifdef _WIN32
+    pool->workers[index] = (HANDLE)_beginthreadex( NULL, 0, pool_worker, pool, 0, NULL );
+    return pool->workers[index] ? 0 : -1;
+#else
+    return pthread_create( &pool->workers[index], NULL, pool_worker, pool ) ? -1 : 0;
+#endif
+}
+
+static void pool_join_worker
+(
+    lw_thread_pool_t *pool,
+    int               index
+)
+{
+#ifdef _WIN32
+    WaitForSingleObject( pool->workers[index], INFINITE );
+    CloseHandle( pool->workers[index] );
+#else
+    pthread_join( pool->workers[index], NULL );
+#endif
+}
+
+static int pool_init_sync
+(
+    lw_thread_pool_t *pool
+)
+{
+#ifdef _WIN32
+    pool->work_semaphore = CreateSemaphore( NULL, 0, LONG_MAX, NULL );
+    pool->done_event     = CreateEvent( NULL, FALSE, FALSE, NULL );
+    if( !pool->work_semaphore || !pool->done_event )
+    {
+        if( pool->work_semaphore )
+            CloseHandle( pool->work_semaphore );
+        if( pool->done_event )
+            CloseHandle( pool->done_event );
+        return -1;
+    }
+    InitializeCriticalSection( &pool->lock );
+    return 0;
+#else
+    if( pthread_mutex_init( &pool->mutex, NULL ) )
+        return -1;
+    if( pthread_cond_init( &pool->work_cond, NULL ) )
+    {
+        pthread_mutex_destroy( &pool->mutex );
+        return -1;
+    }
+    if( pthread_cond_init( &pool->done_cond, NULL ) )
+    {
+        pthread_cond_destroy( &pool->work_cond );
+        pthread_mutex_destroy( &pool->mutex );
+        return -1;
+    }
+    return 0;
+#endif
+}
+
+static void pool_deinit_sync
+(
+    lw_thread_pool_t *pool
+)
+{
+#ifdef _WIN32
+    DeleteCriticalSection( &pool->lock );
+    CloseHandle( pool->work_semaphore );
+    CloseHandle( pool->done_event );
+#else
+    pthread_cond_destroy( &pool->done_cond );
+    pthread_cond_destroy( &pool->work_cond );
+    pthread_mutex_destroy( &pool->mutex );
+#endif
+}
+
+lw_thread_pool_t *lw_thread_pool_create
+(
+    int threads
+)
+{
+    lw_thread_pool_t *pool = (lw_thread_pool_t *)lw_malloc_zero( sizeof(lw_thread_pool_t) );
+    if( !pool )
+        return NULL;
+    threads = MAX( threads, 1 );
+    if( threads > 1 )
+    {
+        pool->workers = (lw_thread_t *)lw_malloc_zero( (threads - 1) * sizeof(lw_thread_t) );
+        if( !pool->workers )
+        {
+            lw_free( pool );
+            return NULL;
+        }
+    }
+    if( pool_init_sync( pool ) < 0 )
+    {
+        lw_free( pool->workers );
+        lw_free( pool );
+        return NULL;
+    }
+    pool->threads = 1;
+    for( int i = 0; i < threads - 1; i++ )
+    {
+        if( pool_start_worker( pool, i ) < 0 )
+            break;
+        ++ pool->threads;
+    }
+    return pool;
+}
+
+void lw_thread_pool_destroy
+(
+    lw_thread_pool_t **pool
+)
+{
+    if( !pool || !*pool )
+        return;
+    lw_thread_pool_t *p = *pool;
+    pool_lock( p );
+    p->quit = 1;
+    pool_signal_work( p );
+    pool_unlock( p );
+    for( int i = 0; i < p->threads - 1; i++ )
+        pool_join_worker( p, i );
+    pool_deinit_sync( p );
+    lw_free( p->workers );
+    lw_freep( pool );
+}
+
+int lw_thread_pool_get_threads
+(
+    lw_thread_pool_t *pool
+)
+{
+    return pool ? pool->threads : 1;
+}
+
+void lw_thread_pool_run
+(
+    lw_thread_pool_t    *pool,
+    lw_thread_pool_func *func,
+    void                *opaque,
+    int                  job_count
+)
+{
+    if( !pool || pool->threads == 1 || job_count <= 1 )
+    {
+        for( int i = 0; i < job_count; i++ )
+            func( opaque, i );
+        return;
+    }
+    pool_lock( pool );
+    pool->func      = func;
+    pool->opaque    = opaque;
+    pool->job_count = job_count;
+    pool->next_job  = 0;
+    pool->pending   = job_count;
+    pool_signal_work( pool );
+    pool_do_jobs( pool, 0 );
+    while( pool->pending )
+        pool_wait_done( pool );
+    pool->job_count = 0;
+    pool->next_job  = 0;
+    pool_unlock( pool );
+}
@@ -0,0 +1,112 @@
+/*****************************************************************************
+ * lwthreads.h
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+#ifndef LWTHREADS_H
+#define LWTHREADS_H
+
+/* The process-wide budget of decoder threads shared by all live decoders.
+ * Without it, every source with the automatic thread count runs as many threads as the CPU cores,
+ * so a script with several sources oversubscribes the CPU.
+ * A decoder with the automatic thread count is assigned a share of the budget weighted by its resolution
+ * and whether it was requested recently. An explicit thread count is kept as is but limited to the budget,
+ * and its threads are taken from the budget while it's requested. */
+typedef struct lw_thread_budget_client_tag lw_thread_budget_client_t;
+
+/* A pool of worker threads to split a job such as the conversion of a picture into slices.
+ * The thread which runs jobs on the pool works as one of the threads, so a pool of one thread has no workers. */
+typedef struct lw_thread_pool_tag lw_thread_pool_t;
+
+typedef void lw_thread_pool_func( void *opaque, int job );
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  /* __cplusplus */
+
+/* Set the total number of decoder threads in the process.
+ * 0 means the number of CPUs, which is the default. */
+void lw_thread_budget_set_max_threads
+(
+    int max_threads
+);
+
+/* Register a decoder which requests 'threads', 0 meaning automatic, to decode pictures of width x height.
+ * Return NULL if an allocation failed. Then, the caller should use 'threads' as is. */
+lw_thread_budget_client_t *lw_thread_budget_join
+(
+    int threads,
+    int width,
+    int height
+);
+
+void lw_thread_budget_leave
+(
+    lw_thread_budget_client_t **client
+);
+
+/* Mark the decoder as in use now. Shares of decoders which are not used for a while decrease. */
+void lw_thread_budget_touch
+(
+    lw_thread_budget_client_t *client
+);
+
+/* Return the number of threads currently assigned to the decoder, which is always positive.
+ * The assignment changes as decoders join, leave and are used, so the caller should reflect it
+ * whenever reopening the decoder is cheap, e.g. when seeking. */
+int lw_thread_budget_get_threads
+(
+    lw_thread_budget_client_t *client
+);
+
+/* Create a pool of 'threads' threads including the caller of lw_thread_pool_run().
+ * If some worker threads could not be started, the pool works with the rest.
+ * Return NULL if an error occurred. */
+lw_thread_pool_t *lw_thread_pool_create
+(
+    int threads
+);
+
+void lw_thread_pool_destroy
+(
+    lw_thread_pool_t **pool
+);
+
+/* Return the number of threads of the pool including the caller. A NULL pool has one thread. */
+int lw_thread_pool_get_threads
+(
+    lw_thread_pool_t *pool
+);
+
+/* Call 'func' for every job number from 0 to 'job_count' - 1 in parallel and wait for all of them.
+ * If 'pool' is NULL, the jobs are done on the calling thread in order.
+ * Only one thread at a time shall run jobs on a pool. */
+void lw_thread_pool_run
+(
+    lw_thread_pool_t    *pool,
+    lw_thread_pool_func *func,
+    void                *opaque,
+    int                  job_count
+);
+
+#ifdef __cplusplus
+}
+#endif  /* __cplusplus */
+
+#endif /* LWTHREADS_H */
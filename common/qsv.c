@@ -113,6 +113,7 @@ bsf_fail:
     if( picture )
     {
         int got_picture;    /* unused */
+        /* The decoder just opened holds no frames, so it never refuses the packet. */
         ret = decode_video_packet( ctx, picture, &got_picture, &initializer );
         av_frame_free( &picture );
     }
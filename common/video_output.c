@@ -26,17 +26,30 @@
 extern "C"
 {
 #endif  /* __cplusplus */
+#include <libavutil/mathematics.h>
 #include <libavutil/opt.h>
 #include <libavutil/pixdesc.h>
 #include <libavcodec/avcodec.h>
 #include <libswscale/swscale.h>
+#include <libswscale/version.h>
 #ifdef __cplusplus
 }
 #endif  /* __cplusplus */
 
 #include "utils.h"
+#include "lwconvert.h"
+#include "lwthreads.h"
 #include "video_output.h"
 
+/* swscale runs slices on its own threads only through sws_scale_frame(). */
+#define HAVE_SWS_THREADS (LIBSWSCALE_VERSION_INT >= AV_VERSION_INT( 6, 1, 100 ))
+
+/* The automatic number of threads for the output conversion is one per this many pixels. */
+#define SCALER_PIXELS_PER_THREAD (1920 * 1080)
+#define SCALER_MAX_AUTO_THREADS  8
+/* Slices start at multiples of this so that they don't share chroma rows. */
+#define SCALER_SLICE_ALIGNMENT   8
+
 /* If YUV is treated as full range, return 1.
  * Otherwise, return 0. */
 int avoid_yuv_scale_conversion( enum AVPixelFormat *pixel_format )
@@ -62,6 +75,25 @@ int avoid_yuv_scale_conversion( enum AVPixelFormat *pixel_format )
     return 0;
 }
 
+int check_dr_exact
+(
+    AVCodecContext    *ctx,
+    enum AVPixelFormat pixel_format,
+    int                width,
+    int                height
+)
+{
+    int aligned_width  = width;
+    int aligned_height = height;
+    int linesize_align[AV_NUM_DATA_POINTERS];
+    /* The alignment depends on the pixel format of the context. */
+    enum AVPixelFormat input_pixel_format = ctx->pix_fmt;
+    ctx->pix_fmt = pixel_format;
+    avcodec_align_dimensions2( ctx, &aligned_width, &aligned_height, linesize_align );
+    ctx->pix_fmt = input_pixel_format;
+    return aligned_width == width && aligned_height == height;
+}
+
 static void initialize_scaler_handler
 (
     lw_video_scaler_handler_t *vshp,
@@ -119,7 +151,8 @@ static struct SwsContext *update_scaler_configuration
     enum AVPixelFormat input_pixel_format,
     enum AVPixelFormat output_pixel_format,
     enum AVColorSpace  colorspace,
-    int                yuv_range
+    int                yuv_range,
+    int                threads
 )
 {
     if( sws_ctx )
@@ -134,6 +167,9 @@ static struct SwsContext *update_scaler_configuration
     av_opt_set_int( sws_ctx, "dsth",       height,              0 );
     av_opt_set_int( sws_ctx, "src_format", input_pixel_format,  0 );
     av_opt_set_int( sws_ctx, "dst_format", output_pixel_format, 0 );
+#if HAVE_SWS_THREADS
+    av_opt_set_int( sws_ctx, "threads",    threads,             0 );
+#endif
     const AVPixFmtDescriptor *out_fmtdesc = av_pix_fmt_desc_get( output_pixel_format );
     // RGB always in full-range, but YUV might also be full-range (e.g. JPEG) as well.
     const int dst_range = yuv_range || ((out_fmtdesc->flags & AV_PIX_FMT_FLAG_RGB) ? 1:0);
@@ -152,6 +188,38 @@ static struct SwsContext *update_scaler_configuration
     return sws_ctx;
 }
 
+/* Decide the number of threads for the output conversion of pictures of width x height
+ * and take them from the process-wide thread budget. */
+static int update_scaler_threads
+(
+    lw_video_scaler_handler_t *vshp,
+    int                        width,
+    int                        height
+)
+{
+    lw_thread_pool_destroy( &vshp->thread_pool );
+    lw_thread_budget_leave( &vshp->thread_budget );
+    int threads = vshp->threads > 0
+                ? vshp->threads
+                : (int)CLIP_VALUE( (int64_t)width * height / SCALER_PIXELS_PER_THREAD, 1, SCALER_MAX_AUTO_THREADS );
+    if( !vshp->converter && !HAVE_SWS_THREADS )
+        threads = 1;
+    if( threads > 1 )
+    {
+        /* The threads are counted as an explicit request so that they are taken from decoders while converting. */
+        vshp->thread_budget = lw_thread_budget_join( threads, width, height );
+        if( vshp->thread_budget )
+            threads = lw_thread_budget_get_threads( vshp->thread_budget );
+    }
+    if( vshp->converter && threads > 1 )
+    {
+        vshp->thread_pool = lw_thread_pool_create( threads );
+        threads = lw_thread_pool_get_threads( vshp->thread_pool );
+    }
+    vshp->active_threads = threads;
+    return threads;
+}
+
 int update_scaler_configuration_if_needed
 (
     lw_video_scaler_handler_t *vshp,
@@ -173,10 +241,14 @@ int update_scaler_configuration_if_needed
     if( !vshp->sws_ctx || vshp->frame_prop_change_flags )
     {
         /* Update scaler. */
+        lw_pixel_converter_close( &vshp->converter );
+        vshp->converter = lw_pixel_converter_open( *input_pixel_format, vshp->output_pixel_format );
+        int threads = update_scaler_threads( vshp, av_frame->width, av_frame->height );
         vshp->sws_ctx = update_scaler_configuration( vshp->sws_ctx, vshp->scaler_flags,
                                                      av_frame->width, av_frame->height,
                                                      *input_pixel_format, vshp->output_pixel_format,
-                                                     av_frame->colorspace, yuv_range );
+                                                     av_frame->colorspace, yuv_range,
+                                                     vshp->converter ? 1 : threads );
         if( !vshp->sws_ctx )
         {
             lw_log_show( lhp, LW_LOG_WARNING, "Failed to update video scaler configuration." );
@@ -192,6 +264,162 @@ int update_scaler_configuration_if_needed
     return 0;
 }
 
+typedef struct
+{
+    lw_video_scaler_handler_t *vshp;
+    const AVFrame             *av_frame;
+    uint8_t * const           *dst_data;
+    const int                 *dst_linesize;
+    int                        slice_height;
+} convert_slice_job_t;
+
+static void convert_slice( void *opaque, int job )
+{
+    convert_slice_job_t *p = (convert_slice_job_t *)opaque;
+    lw_pixel_converter_convert_slice( p->vshp->converter,
+                                      p->dst_data, p->dst_linesize,
+                                      (const uint8_t * const *)p->av_frame->data, p->av_frame->linesize,
+                                      p->av_frame->width, p->av_frame->height,
+                                      job * p->slice_height, p->slice_height );
+}
+
+#if HAVE_SWS_THREADS
+static void free_nothing( void *opaque, uint8_t *data )
+{
+    return;
+}
+
+/* Let swscale convert slices on its own threads.
+ * sws_scale_frame() refers to the destination buffer without allocating it if the frame has a reference to it. */
+static int scale_frame_threaded
+(
+    lw_video_scaler_handler_t *vshp,
+    const AVFrame             *av_frame,
+    uint8_t * const           *dst_data,
+    const int                 *dst_linesize
+)
+{
+    AVFrame *dst = av_frame_alloc();
+    if( !dst )
+        return -1;
+    dst->buf[0] = av_buffer_create( dst_data[0], 1, free_nothing, NULL, 0 );
+    if( !dst->buf[0] )
+    {
+        av_frame_free( &dst );
+        return -1;
+    }
+    for( int i = 0; i < 4; i++ )
+    {
+        dst->data    [i] = dst_data    [i];
+        dst->linesize[i] = dst_linesize[i];
+    }
+    dst->width  = av_frame->width;
+    dst->height = av_frame->height;
+    dst->format = vshp->output_pixel_format;
+    int ret = sws_scale_frame( vshp->sws_ctx, dst, av_frame );
+    av_frame_free( &dst );
+    return ret < 0 ? ret : av_frame->height;
+}
+#endif
+
+int convert_video_picture
+(
+    lw_video_scaler_handler_t *vshp,
+    const AVFrame             *av_frame,
+    uint8_t * const           *dst_data,
+    const int                 *dst_linesize
+)
+{
+    lw_thread_budget_touch( vshp->thread_budget );
+    if( vshp->converter )
+    {
+        int threads = lw_thread_pool_get_threads( vshp->thread_pool );
+        convert_slice_job_t job;
+        job.vshp         = vshp;
+        job.av_frame     = av_frame;
+        job.dst_data     = dst_data;
+        job.dst_linesize = dst_linesize;
+        job.slice_height = FFALIGN( (av_frame->height + threads - 1) / threads, SCALER_SLICE_ALIGNMENT );
+        lw_thread_pool_run( vshp->thread_pool, convert_slice, &job,
+                            (av_frame->height + job.slice_height - 1) / job.slice_height );
+        return av_frame->height;
+    }
+#if HAVE_SWS_THREADS
+    if( vshp->active_threads > 1 )
+        return scale_frame_threaded( vshp, av_frame, dst_data, dst_linesize );
+#endif
+    return sws_scale( vshp->sws_ctx,
+                      (const uint8_t * const *)av_frame->data, av_frame->linesize,
+                      0, av_frame->height,
+                      dst_data, dst_linesize );
+}
+
+int lw_create_vfr2cfr_map
+(
+    lw_video_output_handler_t *vohp,
+    const int64_t             *ts,
+    uint32_t                   ts_count,
+    uint64_t                   ts_num,
+    uint64_t                   ts_den
+)
+{
+    lw_freep( &vohp->vfr2cfr_map );
+    if( ts_count == 0 || ts_num == 0 || ts_den == 0 || vohp->cfr_num == 0 || vohp->cfr_den == 0 )
+        return -1;
+    /* Compare times in units of half the output frame duration.
+     * A source timestamp corresponds to ts * 2 * a / b and the k-th output target to 2 * (k - 1).
+     * The rescaling by av_rescale_rnd() doesn't overflow and is exact in the comparisons with integers
+     * by rounding to the appropriate direction, i.e. x >= m is equivalent to floor( x ) >= m and x > m to ceil( x ) > m. */
+    uint64_t a = ts_num * vohp->cfr_num;
+    uint64_t b = ts_den * vohp->cfr_den;
+    reduce_fraction( &a, &b );
+    if( a > INT64_MAX / 2 || b > INT64_MAX )
+        return -1;
+    uint32_t *map = (uint32_t *)lw_malloc_zero( (vohp->frame_count + 1) * sizeof(uint32_t) );
+    if( !map )
+        return -1;
+    uint32_t current = 1;   /* the first source frame not earlier than the current target */
+    uint32_t prev    = 0;   /* the last source frame earlier than the current target */
+    for( uint32_t k = 1; k <= vohp->frame_count; k++ )
+    {
+        int64_t target = 2 * (int64_t)(k - 1);
+        int64_t middle = 2 * (int64_t)k - 1;
+        for( ; current <= ts_count; current++ )
+        {
+            if( ts[current] == AV_NOPTS_VALUE )
+                continue;
+            if( av_rescale_rnd( ts[current], 2 * (int64_t)a, (int64_t)b, AV_ROUND_DOWN ) >= target )
+                break;
+            prev = current;
+        }
+        if( current > ts_count )
+            map[k] = ts_count;
+        else if( prev == 0 )
+            map[k] = current;
+        else if( av_rescale_rnd( ts[current], 2 * (int64_t)a, (int64_t)b, AV_ROUND_UP ) > middle )
+            /* The current frame is far from the current target and should be a candidate for the next target.
+             * This also covers the case where there are no source frames between the current and the next target. */
+            map[k] = prev;
+        else
+            /* Choose the nearest one, i.e. the previous frame if current - target >= target - prev.
+             * The timestamps are relative to the first frame, so their sum doesn't overflow in practice. */
+            map[k] = av_rescale_rnd( ts[current] + ts[prev], (int64_t)a, (int64_t)b, AV_ROUND_DOWN ) >= target ? prev : current;
+    }
+    vohp->vfr2cfr_map = map;
+    return 0;
+}
+
+uint32_t lw_vfr2cfr_get_source_frame_number
+(
+    lw_video_output_handler_t *vohp,
+    uint32_t                   frame_number
+)
+{
+    if( !vohp->vfr2cfr_map || frame_number == 0 || frame_number > vohp->frame_count )
+        return 0;
+    return vohp->vfr2cfr_map[frame_number];
+}
+
 void lw_cleanup_video_output_handler
 (
     lw_video_output_handler_t *vohp
@@ -201,6 +429,7 @@ void lw_cleanup_video_output_handler
         vohp->free_private_handler( vohp->private_handler );
     vohp->private_handler = NULL;
     lw_freep( &vohp->frame_order_list );
+    lw_freep( &vohp->vfr2cfr_map );
     for( int i = 0; i < REPEAT_CONTROL_CACHE_NUM; i++ )
         av_frame_free( &vohp->frame_cache_buffers[i] );
     if( vohp->scaler.sws_ctx )
@@ -208,4 +437,7 @@ void lw_cleanup_video_output_handler
         sws_freeContext( vohp->scaler.sws_ctx );
         vohp->scaler.sws_ctx = NULL;
     }
+    lw_pixel_converter_close( &vohp->scaler.converter );
+    lw_thread_pool_destroy( &vohp->scaler.thread_pool );
+    lw_thread_budget_leave( &vohp->scaler.thread_budget );
 }
@@ -39,6 +39,12 @@ typedef struct
     enum AVColorSpace  input_colorspace;
     int                input_yuv_range;
     struct SwsContext *sws_ctx;
+    struct lw_pixel_converter_tag *converter;   /* replaces sws_ctx if the conversion only moves samples */
+    /* Slice threading */
+    int                threads;                 /* the requested number of threads; 0 means automatic by resolution */
+    int                active_threads;          /* the number of threads for the current configuration */
+    struct lw_thread_budget_client_tag *thread_budget;
+    struct lw_thread_pool_tag          *thread_pool;    /* for the converter; swscale has its own threads */
 } lw_video_scaler_handler_t;
 
 typedef struct
@@ -56,6 +62,7 @@ typedef struct
     int                       vfr2cfr;
     uint32_t                  cfr_num;
     uint32_t                  cfr_den;
+    uint32_t                 *vfr2cfr_map;          /* output frame number -> source frame number in presentation order */
     /* Repeat control */
     int                       repeat_control;
     int                       repeat_requested;
@@ -77,6 +84,19 @@ extern "C"
 
 int avoid_yuv_scale_conversion( enum AVPixelFormat *pixel_format );
 
+/* Return 1 if the decoder needs no padding of the picture of width x height in the pixel format,
+ * i.e. direct rendering doesn't change the output resolution.
+ * Return 0 otherwise.
+ * The automatic direct rendering of the plugins requires this and no conversion of the pixel format
+ * so that it only removes the copy to the output frame. */
+int check_dr_exact
+(
+    struct AVCodecContext *ctx,
+    enum AVPixelFormat     pixel_format,
+    int                    width,
+    int                    height
+);
+
 void setup_video_rendering
 (
     lw_video_output_handler_t *vohp,
@@ -98,6 +118,41 @@ int update_scaler_configuration_if_needed
     const AVFrame             *av_frame
 );
 
+/* Convert the picture into the output pixel format of the scaler configured by update_scaler_configuration_if_needed().
+ * Return the height of the output picture if successful.
+ * Return a non-positive value otherwise. */
+int convert_video_picture
+(
+    lw_video_scaler_handler_t *vshp,
+    const AVFrame             *av_frame,
+    uint8_t * const           *dst_data,
+    const int                 *dst_linesize
+);
+
+/* Create the map of output frame numbers to source frame numbers for VFR->CFR conversion.
+ * 'ts' holds the presentation timestamps of the source frames in 1-origin presentation order,
+ * relative to the first frame and in units of 'ts_num / ts_den' seconds.
+ * AV_NOPTS_VALUE indicates an unknown timestamp.
+ * frame_count, cfr_num and cfr_den of the output handler shall be set beforehand.
+ * Return 0 if successful.
+ * Return -1 otherwise. */
+int lw_create_vfr2cfr_map
+(
+    lw_video_output_handler_t *vohp,
+    const int64_t             *ts,
+    uint32_t                   ts_count,
+    uint64_t                   ts_num,
+    uint64_t                   ts_den
+);
+
+/* Return the source frame number corresponding to the given output frame number.
+ * Return 0 if out of range. */
+uint32_t lw_vfr2cfr_get_source_frame_number
+(
+    lw_video_output_handler_t *vohp,
+    uint32_t                   frame_number
+);
+
 void lw_cleanup_video_output_handler
 (
     lw_video_output_handler_t *vohp
@@ -0,0 +1,453 @@
+/*****************************************************************************
+ * colorspace.c
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+/* Check the conversions of lwcolorspace at every SIMD level the CPU supports against the C references, bit for bit,
+ * over widths covering the vector loops and their tails and heights covering the fields of odd lengths.
+ * Nothing shall be written out of the rows of the destination, and negative linesizes shall work.
+ * With "--bench", measure the time each implementation takes to convert a picture of 1920x1080 instead. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "lwsimd.h"
+#include "lwcolorspace.h"
+
+#define GUARD_BYTE  0xA5
+/* Kept off the vector alignment, which no kernel shall assume. */
+#define DATA_OFFSET 2
+#define LINE_MARGIN 34
+
+#define MAX_WIDTH   1023
+
+#define BENCH_WIDTH  1920
+#define BENCH_HEIGHT 1080
+#define BENCH_TIME   0.25
+
+static const int widths [] = { 1, 2, 3, 5, 7, 8, 15, 16, 17, 23, 24, 25, 31, 32, 33, 47, 48, 49, 63, 64, 65, 127, 128, 129, MAX_WIDTH };
+static const int heights[] = { 1, 2, 3, 4, 5, 6, 7, 11 };
+
+static const char *simd_level_names[] = { "C", "SSE2", "SSSE3", "SSE4.1", "AVX2", "AVX-512BW" };
+
+typedef struct
+{
+    uint8_t *buffer  [3];
+    uint8_t *data    [3];
+    int      linesize[3];
+    int      row_size[3];   /* the bytes of a row the picture covers */
+    int      height;
+    int      planes;
+} picture_t;
+
+typedef enum
+{
+    KIND_YUV420P_I_TO_YUY2 = 0,
+    KIND_YUV420P_I_TO_YUV444P16,
+    KIND_YUV444P16_TO_YC48,
+    KIND_YUV444P16_TO_LW48,
+    KIND_LW48_TO_YUY2,
+    KIND_LW48_TO_BGR24
+} conversion_kind;
+
+typedef struct
+{
+    const char     *name;
+    conversion_kind kind;
+    int             param;      /* the bit depth of the input of KIND_YUV420P_I_TO_YUV444P16 or 'full_range' of YC48 */
+    int             flip;       /* Write the destination bottom-up with negative linesizes. */
+} conversion_t;
+
+static const conversion_t conversions[] =
+{
+    { "yuv420p interlaced -> yuy2",        KIND_YUV420P_I_TO_YUY2,      0,  0 },
+    { "yuv420p9 interlaced -> yuv444p16",  KIND_YUV420P_I_TO_YUV444P16, 9,  0 },
+    { "yuv420p10 interlaced -> yuv444p16", KIND_YUV420P_I_TO_YUV444P16, 10, 0 },
+    { "yuv420p12 interlaced -> yuv444p16", KIND_YUV420P_I_TO_YUV444P16, 12, 0 },
+    { "yuv420p16 interlaced -> yuv444p16", KIND_YUV420P_I_TO_YUV444P16, 16, 0 },
+    { "yuv444p16 -> yc48 limited",         KIND_YUV444P16_TO_YC48,      0,  0 },
+    { "yuv444p16 -> yc48 full",            KIND_YUV444P16_TO_YC48,      1,  0 },
+    { "yuv444p16 -> lw48",                 KIND_YUV444P16_TO_LW48,      0,  0 },
+    { "lw48 -> yuy2",                      KIND_LW48_TO_YUY2,           0,  0 },
+    { "lw48 -> bgr24",                     KIND_LW48_TO_BGR24,          0,  0 },
+    { "lw48 -> bgr24 bottom-up",           KIND_LW48_TO_BGR24,          0,  1 }
+};
+
+static uint32_t random_state = 1;
+
+static uint32_t next_random
+(
+    void
+)
+{
+    random_state = random_state * 1664525 + 1013904223;
+    return random_state >> 8;
+}
+
+static void free_picture
+(
+    picture_t *picture
+)
+{
+    for( int i = 0; i < 3; i++ )
+    {
+        free( picture->buffer[i] );
+        picture->buffer[i] = NULL;
+    }
+}
+
+/* Allocate the planes surrounded by guard bytes. */
+static int alloc_picture
+(
+    picture_t *picture,
+    int        planes,
+    const int *row_size,
+    int        height,
+    int        flip
+)
+{
+    memset( picture, 0, sizeof(picture_t) );
+    picture->planes = planes;
+    picture->height = height;
+    for( int i = 0; i < planes; i++ )
+    {
+        int    linesize = row_size[i] + LINE_MARGIN;
+        size_t size     = (size_t)linesize * (height + 2);
+        picture->buffer[i] = (uint8_t *)malloc( size );
+        if( !picture->buffer[i] )
+        {
+            free_picture( picture );
+            return -1;
+        }
+        memset( picture->buffer[i], GUARD_BYTE, size );
+        picture->data    [i] = picture->buffer[i] + linesize + DATA_OFFSET;
+        picture->linesize[i] = linesize;
+        picture->row_size[i] = row_size[i];
+        if( flip )
+        {
+            picture->data    [i] += (ptrdiff_t)linesize * (height - 1);
+            picture->linesize[i]  = -linesize;
+        }
+    }
+    return 0;
+}
+
+/* Fill the rows with random samples of 'bit_depth' bits. The samples over 8 bits are in the native endian. */
+static void make_source
+(
+    picture_t *picture,
+    int        bit_depth
+)
+{
+    for( int i = 0; i < picture->planes; i++ )
+        for( int y = 0; y < picture->height; y++ )
+        {
+            uint8_t *row = picture->data[i] + (ptrdiff_t)picture->linesize[i] * y;
+            if( bit_depth <= 8 )
+                for( int x = 0; x < picture->row_size[i]; x++ )
+                    row[x] = (uint8_t)next_random();
+            else
+                for( int x = 0; x < picture->row_size[i] / 2; x++ )
+                {
+                    /* Hit the extremes often to catch overflows. */
+                    uint32_t r = next_random();
+                    uint16_t v = (uint16_t)(r & 0x7 ? r >> 3 : r & 0x8 ? 0xFFFF : 0);
+                    ((uint16_t *)row)[x] = v >> (16 - bit_depth);
+                }
+        }
+}
+
+static int compare_pictures
+(
+    const picture_t *a,
+    const picture_t *b
+)
+{
+    for( int i = 0; i < a->planes; i++ )
+        for( int y = 0; y < a->height; y++ )
+            if( memcmp( a->data[i] + (ptrdiff_t)a->linesize[i] * y,
+                        b->data[i] + (ptrdiff_t)b->linesize[i] * y,
+                        a->row_size[i] ) )
+                return -1;
+    return 0;
+}
+
+/* Check that the bytes out of the rows remain the guard. */
+static int check_guard
+(
+    const picture_t *picture
+)
+{
+    for( int i = 0; i < picture->planes; i++ )
+    {
+        int    linesize = abs( picture->linesize[i] );
+        size_t size     = (size_t)linesize * (picture->height + 2);
+        for( size_t j = 0; j < size; j++ )
+        {
+            ptrdiff_t y = (ptrdiff_t)(j / linesize) - 1;
+            ptrdiff_t x = (ptrdiff_t)(j % linesize) - DATA_OFFSET;
+            if( y >= 0 && y < picture->height && x >= 0 && x < picture->row_size[i] )
+                continue;
+            if( picture->buffer[i][j] != GUARD_BYTE )
+                return -1;
+        }
+    }
+    return 0;
+}
+
+static void get_geometry
+(
+    const conversion_t *conversion,
+    int                 width,
+    int                *src_planes,
+    int                *src_row_size,
+    int                *dst_planes,
+    int                *dst_row_size
+)
+{
+    /* YUY2 is written in whole pairs of pixels. */
+    const int yuy2_row_size = ((width + 1) >> 1) * 4;
+    switch( conversion->kind )
+    {
+        case KIND_YUV420P_I_TO_YUY2 :
+            *src_planes   = 3;
+            src_row_size[0] = width;
+            src_row_size[1] = src_row_size[2] = (width + 1) >> 1;
+            *dst_planes   = 1;
+            dst_row_size[0] = yuy2_row_size;
+            break;
+        case KIND_YUV420P_I_TO_YUV444P16 :
+            *src_planes   = 3;
+            src_row_size[0] = 2 * width;
+            src_row_size[1] = src_row_size[2] = 2 * ((width + 1) >> 1);
+            *dst_planes   = 3;
+            dst_row_size[0] = dst_row_size[1] = dst_row_size[2] = 2 * width;
+            break;
+        case KIND_YUV444P16_TO_YC48 :
+        case KIND_YUV444P16_TO_LW48 :
+            *src_planes   = 3;
+            src_row_size[0] = src_row_size[1] = src_row_size[2] = 2 * width;
+            *dst_planes   = 1;
+            dst_row_size[0] = 6 * width;
+            break;
+        case KIND_LW48_TO_YUY2 :
+            *src_planes   = 1;
+            src_row_size[0] = 6 * width;
+            *dst_planes   = 1;
+            dst_row_size[0] = yuy2_row_size;
+            break;
+        case KIND_LW48_TO_BGR24 :
+            *src_planes   = 1;
+            src_row_size[0] = 6 * width;
+            *dst_planes   = 1;
+            dst_row_size[0] = 3 * width;
+            break;
+    }
+}
+
+static void run_conversion
+(
+    const conversion_t *conversion,
+    picture_t          *dst,
+    const picture_t    *src,
+    int                 width,
+    int                 height
+)
+{
+    const uint8_t * const *src_data = (const uint8_t * const *)src->data;
+    switch( conversion->kind )
+    {
+        case KIND_YUV420P_I_TO_YUY2 :
+            lw_convert_yuv420p_i_to_yuy2( dst->data[0], dst->linesize[0], src_data, src->linesize, width, height );
+            break;
+        case KIND_YUV420P_I_TO_YUV444P16 :
+            lw_convert_yuv420p_i_to_yuv444p16( dst->data, dst->linesize, src_data, src->linesize, width, height, conversion->param );
+            break;
+        case KIND_YUV444P16_TO_YC48 :
+            lw_convert_yuv444p16_to_yc48( dst->data[0], dst->linesize[0], src_data, src->linesize, width, height, conversion->param );
+            break;
+        case KIND_YUV444P16_TO_LW48 :
+            lw_convert_yuv444p16_to_lw48( dst->data[0], dst->linesize[0], src_data, src->linesize, width, height );
+            break;
+        case KIND_LW48_TO_YUY2 :
+            lw_convert_lw48_to_yuy2( dst->data[0], dst->linesize[0], src->data[0], src->linesize[0], width, height );
+            break;
+        case KIND_LW48_TO_BGR24 :
+            lw_convert_lw48_to_bgr24( dst->data[0], dst->linesize[0], src->data[0], src->linesize[0], width, height );
+            break;
+    }
+}
+
+static int get_source_bit_depth
+(
+    const conversion_t *conversion
+)
+{
+    if( conversion->kind == KIND_YUV420P_I_TO_YUY2 )
+        return 8;
+    if( conversion->kind == KIND_YUV420P_I_TO_YUV444P16 )
+        return conversion->param;
+    return 16;
+}
+
+/* Return the number of the failures, or -1 if out of memory. */
+static int test_conversion
+(
+    const conversion_t *conversion,
+    int                 max_simd_level
+)
+{
+    int failures = 0;
+    for( int i = 0; i < (int)(sizeof(widths) / sizeof(widths[0])); i++ )
+        for( int j = 0; j < (int)(sizeof(heights) / sizeof(heights[0])); j++ )
+        {
+            const int width  = widths [i];
+            const int height = heights[j];
+            int src_planes = 0;
+            int dst_planes = 0;
+            int src_row_size[3];
+            int dst_row_size[3];
+            get_geometry( conversion, width, &src_planes, src_row_size, &dst_planes, dst_row_size );
+            picture_t src;
+            picture_t ref;
+            if( alloc_picture( &src, src_planes, src_row_size, height, 0 ) < 0 )
+                return -1;
+            if( alloc_picture( &ref, dst_planes, dst_row_size, height, 0 ) < 0 )
+            {
+                free_picture( &src );
+                return -1;
+            }
+            make_source( &src, get_source_bit_depth( conversion ) );
+            lw_set_simd_level_limit( LW_SIMD_LEVEL_C );
+            run_conversion( conversion, &ref, &src, width, height );
+            if( check_guard( &ref ) < 0 )
+            {
+                fprintf( stderr, "%s: C wrote out of the picture at %dx%d.\n", conversion->name, width, height );
+                ++failures;
+            }
+            for( int level = LW_SIMD_LEVEL_C + 1; level <= max_simd_level; level++ )
+            {
+                picture_t out;
+                if( alloc_picture( &out, dst_planes, dst_row_size, height, conversion->flip ) < 0 )
+                {
+                    free_picture( &src );
+                    free_picture( &ref );
+                    return -1;
+                }
+                lw_set_simd_level_limit( level );
+                run_conversion( conversion, &out, &src, width, height );
+                if( compare_pictures( &ref, &out ) < 0 )
+                {
+                    fprintf( stderr, "%s: %s differs from C at %dx%d.\n",
+                             conversion->name, simd_level_names[level], width, height );
+                    ++failures;
+                }
+                if( check_guard( &out ) < 0 )
+                {
+                    fprintf( stderr, "%s: %s wrote out of the picture at %dx%d.\n",
+                             conversion->name, simd_level_names[level], width, height );
+                    ++failures;
+                }
+                free_picture( &out );
+            }
+            free_picture( &src );
+            free_picture( &ref );
+        }
+    lw_set_simd_level_limit( max_simd_level );
+    return failures;
+}
+
+/* Print the time of a conversion of a picture of BENCH_WIDTH x BENCH_HEIGHT at each SIMD level. */
+static int bench_conversion
+(
+    const conversion_t *conversion,
+    int                 max_simd_level
+)
+{
+    int src_planes = 0;
+    int dst_planes = 0;
+    int src_row_size[3];
+    int dst_row_size[3];
+    get_geometry( conversion, BENCH_WIDTH, &src_planes, src_row_size, &dst_planes, dst_row_size );
+    picture_t src;
+    picture_t dst;
+    if( alloc_picture( &src, src_planes, src_row_size, BENCH_HEIGHT, 0 ) < 0 )
+        return -1;
+    if( alloc_picture( &dst, dst_planes, dst_row_size, BENCH_HEIGHT, conversion->flip ) < 0 )
+    {
+        free_picture( &src );
+        return -1;
+    }
+    make_source( &src, get_source_bit_depth( conversion ) );
+    double c_time = 0.0;
+    printf( "%s:\n", conversion->name );
+    for( int level = LW_SIMD_LEVEL_C; level <= max_simd_level; level++ )
+    {
+        lw_set_simd_level_limit( level );
+        /* Warm up the caches before measuring. */
+        run_conversion( conversion, &dst, &src, BENCH_WIDTH, BENCH_HEIGHT );
+        int     count   = 0;
+        clock_t start   = clock();
+        double  elapsed = 0.0;
+        do
+        {
+            run_conversion( conversion, &dst, &src, BENCH_WIDTH, BENCH_HEIGHT );
+            ++count;
+            elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+        } while( elapsed < BENCH_TIME );
+        double time = elapsed / count;
+        if( level == LW_SIMD_LEVEL_C )
+            c_time = time;
+        printf( "  %-10s %8.3f ms/frame  x%.2f\n", simd_level_names[level], time * 1000.0, c_time / time );
+    }
+    lw_set_simd_level_limit( max_simd_level );
+    free_picture( &src );
+    free_picture( &dst );
+    return 0;
+}
+
+int main
+(
+    int    argc,
+    char **argv
+)
+{
+    const int max_simd_level = lw_get_simd_level();
+    const int bench          = argc > 1 && !strcmp( argv[1], "--bench" );
+    int failures = 0;
+    for( int i = 0; i < (int)(sizeof(conversions) / sizeof(conversions[0])); i++ )
+    {
+        int ret = bench
+                ? bench_conversion( &conversions[i], max_simd_level )
+                : test_conversion ( &conversions[i], max_simd_level );
+        if( ret < 0 )
+        {
+            fprintf( stderr, "Failed to allocate pictures.\n" );
+            return 1;
+        }
+        failures += ret;
+    }
+    if( !bench )
+        printf( "Checked %d conversions up to %s.\n",
+                (int)(sizeof(conversions) / sizeof(conversions[0])), simd_level_names[max_simd_level] );
+    return failures ? 1 : 0;
+}
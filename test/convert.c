@@ -0,0 +1,595 @@
+/*****************************************************************************
+ * convert.c
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+/* Check the pixel format conversions of lwconvert at every SIMD level the CPU supports against swscale
+ * with the flags the plugins use, bit for bit, over widths covering the vector loops and their tails.
+ * Nothing shall be written out of the rows of the destination, whole slices and the whole picture shall agree,
+ * and the conversions left to swscale shall be refused.
+ * The extraction of components and the fills of planes are checked against plain references. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+
+#include "lwsimd.h"
+#include "lwconvert.h"
+
+#define SKIP 77
+
+/* Odd to round the chroma up, and over a slice of 8 rows. */
+#define HEIGHT      11
+#define SLICE_SIZE  8
+#define GUARD_BYTE  0xA5
+/* Kept off the vector alignment, which no kernel shall assume. */
+#define DATA_OFFSET 2
+#define LINE_MARGIN 34
+
+#define MAX_WIDTH   1023
+
+static const int widths[] = { 1, 2, 3, 5, 7, 8, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 128, 129, 255, 256, 257, MAX_WIDTH };
+
+typedef struct
+{
+    const char *input;
+    const char *output;
+} conversion_t;
+
+/* The conversions lwconvert does instead of swscale. The formats unknown to the FFmpeg libraries are skipped. */
+static const conversion_t handled_conversions[] =
+{
+    /* plane copies */
+    { "yuv420p",     "yuv420p"     },
+    { "yuv422p10le", "yuv422p10le" },
+    { "yuv444p16le", "yuv444p16le" },
+    { "yuva444p",    "yuv444p"     },
+    { "gbrp",        "gbrp"        },
+    { "gbrap16le",   "gbrap16le"   },
+    /* semi-planar into planar */
+    { "nv12",        "yuv420p"     },
+    { "nv21",        "yuv420p"     },
+    { "nv16",        "yuv422p"     },
+    { "nv24",        "yuv444p"     },
+    { "nv42",        "yuv444p"     },
+    { "p010le",      "yuv420p10le" },
+    { "p016le",      "yuv420p16le" },
+    { "p210le",      "yuv422p10le" },
+    { "p410le",      "yuv444p10le" },
+    /* packed YUV 4:2:2 */
+    { "yuyv422",     "yuv422p"     },
+    { "uyvy422",     "yuv422p"     },
+    { "yvyu422",     "yuv422p"     },
+    { "yuv422p",     "yuyv422"     },
+    { "yuv422p",     "uyvy422"     },
+    { "yuv422p",     "yvyu422"     },
+    { "yuyv422",     "uyvy422"     },
+    /* reordering of packed pixels */
+    { "rgb24",       "bgr24"       },
+    { "bgr24",       "rgb24"       },
+    { "rgba",        "bgra"        },
+    { "argb",        "bgra"        },
+    { "abgr",        "rgba"        },
+    { "rgba",        "rgba"        },
+    { "rgb48le",     "bgr48le"     },
+    { "rgba64le",    "bgra64le"    },
+    /* planar 16-bit RGB into packed RGB48 */
+    { "gbrp16le",    "bgr48le"     },
+    { "gbrp16le",    "rgb48le"     },
+    { "gbrap16le",   "bgr48le"     }
+};
+
+/* The conversions left to swscale since they change sample values, the bit depth, the chroma subsampling
+ * or the byte order, or since the layouts are not simple moves of samples. */
+static const conversion_t refused_conversions[] =
+{
+    { "yuv420p10le", "yuv420p16le" },
+    { "p010le",      "yuv420p16le" },
+    { "yuv420p",     "yuv420p10le" },
+    { "yuv420p",     "yuv444p"     },
+    { "nv12",        "yuv444p"     },
+    { "yuyv422",     "yuv420p"     },
+    { "yuv420p",     "nv12"        },
+    { "yuv420p",     "rgb24"       },
+    { "gbrp",        "rgb24"       },
+    { "gbrp12le",    "bgr48le"     },
+    { "gbrap16le",   "rgba64le"    },
+    { "rgba",        "rgb24"       },
+    { "rgb24",       "rgba"        },
+    { "rgb0",        "bgr0"        },
+    { "yuv420p16be", "yuv420p16le" },
+    { "rgb48be",     "bgr48le"     },
+    { "y210le",      "yuv422p10le" }
+};
+
+/* The base flags which the plugins extend in the same way as setup_video_rendering() does. */
+static const int base_scaler_flags[] = { SWS_FAST_BILINEAR, SWS_POINT, SWS_BICUBIC };
+
+static const char *simd_level_names[] = { "C", "SSE2", "SSSE3", "SSE4.1", "AVX2", "AVX-512BW" };
+
+typedef struct
+{
+    uint8_t *buffer  [4];
+    uint8_t *data    [4];
+    int      linesize[4];
+    int      row_size[4];   /* the bytes of a row the picture covers */
+    int      height  [4];
+    int      planes;
+} picture_t;
+
+static uint32_t random_state = 1;
+
+static uint32_t next_random
+(
+    void
+)
+{
+    random_state = random_state * 1664525 + 1013904223;
+    return random_state >> 8;
+}
+
+static void free_picture
+(
+    picture_t *picture
+)
+{
+    for( int i = 0; i < 4; i++ )
+        free( picture->buffer[i] );
+    memset( picture, 0, sizeof(picture_t) );
+}
+
+/* Allocate a picture with an extra row below and the margin at the right of every row filled with 'value'. */
+static int alloc_picture
+(
+    picture_t         *picture,
+    enum AVPixelFormat pixel_format,
+    int                width,
+    int                height,
+    uint8_t            value
+)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get( pixel_format );
+    memset( picture, 0, sizeof(picture_t) );
+    picture->planes = av_pix_fmt_count_planes( pixel_format );
+    for( int i = 0; i < picture->planes; i++ )
+    {
+        picture->row_size[i] = av_image_get_linesize( pixel_format, width, i );
+        picture->height  [i] = (i == 1 || i == 2) ? AV_CEIL_RSHIFT( height, desc->log2_chroma_h ) : height;
+        picture->linesize[i] = picture->row_size[i] + LINE_MARGIN;
+        size_t size = (size_t)picture->linesize[i] * (picture->height[i] + 1) + DATA_OFFSET;
+        picture->buffer[i] = (uint8_t *)malloc( size );
+        if( !picture->buffer[i] )
+        {
+            free_picture( picture );
+            return -1;
+        }
+        memset( picture->buffer[i], value, size );
+        picture->data[i] = picture->buffer[i] + DATA_OFFSET;
+    }
+    return 0;
+}
+
+static int get_component_width
+(
+    const AVPixFmtDescriptor *desc,
+    int                       component,
+    int                       width
+)
+{
+    return (component == 1 || component == 2) ? AV_CEIL_RSHIFT( width, desc->log2_chroma_w ) : width;
+}
+
+static int get_component_height
+(
+    const AVPixFmtDescriptor *desc,
+    int                       component,
+    int                       height
+)
+{
+    return (component == 1 || component == 2) ? AV_CEIL_RSHIFT( height, desc->log2_chroma_h ) : height;
+}
+
+/* Write random samples into every component on the zeroed planes, so the padding bits and bytes stay zero. */
+static int make_source
+(
+    picture_t         *picture,
+    enum AVPixelFormat pixel_format,
+    int                width,
+    int                height
+)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get( pixel_format );
+    uint16_t *line = (uint16_t *)malloc( width * sizeof(uint16_t) );
+    if( !line || alloc_picture( picture, pixel_format, width, height, 0 ) < 0 )
+    {
+        free( line );
+        return -1;
+    }
+    for( int c = 0; c < desc->nb_components; c++ )
+    {
+        const int      w    = get_component_width ( desc, c, width  );
+        const int      h    = get_component_height( desc, c, height );
+        const uint32_t mask = (1U << desc->comp[c].depth) - 1;
+        for( int y = 0; y < h; y++ )
+        {
+            for( int x = 0; x < w; x++ )
+                line[x] = (uint16_t)(next_random() & mask);
+            av_write_image_line( line, picture->data, picture->linesize, desc, 0, y, c, w );
+        }
+    }
+    free( line );
+    return 0;
+}
+
+/* Compare the samples of every component of the first 'width' pixels. */
+static int compare_pictures
+(
+    const picture_t          *a,
+    const picture_t          *b,
+    const AVPixFmtDescriptor *desc,
+    int                       width,
+    int                       height
+)
+{
+    uint16_t *line_a = (uint16_t *)malloc( width * sizeof(uint16_t) );
+    uint16_t *line_b = (uint16_t *)malloc( width * sizeof(uint16_t) );
+    int       diff   = -1;
+    if( line_a && line_b )
+    {
+        const uint8_t *data_a[4] = { a->data[0], a->data[1], a->data[2], a->data[3] };
+        const uint8_t *data_b[4] = { b->data[0], b->data[1], b->data[2], b->data[3] };
+        diff = 0;
+        for( int c = 0; c < desc->nb_components && !diff; c++ )
+        {
+            const int w = get_component_width ( desc, c, width  );
+            const int h = get_component_height( desc, c, height );
+            for( int y = 0; y < h && !diff; y++ )
+            {
+                av_read_image_line( line_a, data_a, a->linesize, desc, 0, y, c, w, 0 );
+                av_read_image_line( line_b, data_b, b->linesize, desc, 0, y, c, w, 0 );
+                for( int x = 0; x < w; x++ )
+                    if( line_a[x] != line_b[x] )
+                    {
+                        fprintf( stderr, "the sample (%d, %d) of the component %d is %d instead of %d.\n",
+                                 x, y, c, line_a[x], line_b[x] );
+                        diff = 1;
+                        break;
+                    }
+            }
+        }
+    }
+    free( line_a );
+    free( line_b );
+    return diff;
+}
+
+/* Check that nothing is written out of the rows of the picture. */
+static int check_guard
+(
+    const picture_t *picture
+)
+{
+    for( int i = 0; i < picture->planes; i++ )
+    {
+        if( picture->buffer[i][DATA_OFFSET - 1] != GUARD_BYTE )
+        {
+            fprintf( stderr, "the plane %d is overwritten before the first row.\n", i );
+            return 1;
+        }
+        for( int y = 0; y <= picture->height[i]; y++ )
+        {
+            const uint8_t *row = picture->data[i] + (size_t)y * picture->linesize[i];
+            for( int x = y < picture->height[i] ? picture->row_size[i] : 0; x < picture->linesize[i]; x++ )
+                if( row[x] != GUARD_BYTE )
+                {
+                    fprintf( stderr, "the byte %d of the row %d of the plane %d is overwritten.\n", x, y, i );
+                    return 1;
+                }
+        }
+    }
+    return 0;
+}
+
+static int scale_by_swscale
+(
+    picture_t         *dst,
+    const picture_t   *src,
+    enum AVPixelFormat input_pixel_format,
+    enum AVPixelFormat output_pixel_format,
+    int                width,
+    int                height,
+    int                flags
+)
+{
+    if( flags != SWS_FAST_BILINEAR )
+        flags |= SWS_FULL_CHR_H_INT | SWS_FULL_CHR_H_INP | SWS_ACCURATE_RND | SWS_BITEXACT;
+    struct SwsContext *sws_ctx = sws_getContext( width, height, input_pixel_format,
+                                                 width, height, output_pixel_format,
+                                                 flags, NULL, NULL, NULL );
+    if( !sws_ctx )
+        return -1;
+    if( alloc_picture( dst, output_pixel_format, width, height, 0 ) < 0 )
+    {
+        sws_freeContext( sws_ctx );
+        return -1;
+    }
+    const uint8_t *src_data[4] = { src->data[0], src->data[1], src->data[2], src->data[3] };
+    sws_scale( sws_ctx, src_data, src->linesize, 0, height, dst->data, dst->linesize );
+    sws_freeContext( sws_ctx );
+    return 0;
+}
+
+static int convert_by_lwconvert
+(
+    picture_t         *dst,
+    const picture_t   *src,
+    enum AVPixelFormat input_pixel_format,
+    enum AVPixelFormat output_pixel_format,
+    int                width,
+    int                height,
+    int                slice_size
+)
+{
+    lw_pixel_converter_t *converter = lw_pixel_converter_open( input_pixel_format, output_pixel_format );
+    if( !converter )
+    {
+        fprintf( stderr, "the conversion is refused.\n" );
+        return -1;
+    }
+    if( alloc_picture( dst, output_pixel_format, width, height, GUARD_BYTE ) < 0 )
+    {
+        lw_pixel_converter_close( &converter );
+        return -1;
+    }
+    const uint8_t *src_data[4] = { src->data[0], src->data[1], src->data[2], src->data[3] };
+    if( slice_size >= height )
+        lw_pixel_converter_convert( converter, dst->data, dst->linesize, src_data, src->linesize, width, height );
+    else
+        for( int y = 0; y < height; y += slice_size )
+            lw_pixel_converter_convert_slice( converter, dst->data, dst->linesize, src_data, src->linesize,
+                                              width, height, y, slice_size );
+    lw_pixel_converter_close( &converter );
+    return 0;
+}
+
+/* Return the number of failures, or -1 if skipped. */
+static int test_conversion
+(
+    const conversion_t *conversion,
+    int                 max_simd_level
+)
+{
+    enum AVPixelFormat input_pixel_format  = av_get_pix_fmt( conversion->input  );
+    enum AVPixelFormat output_pixel_format = av_get_pix_fmt( conversion->output );
+    if( input_pixel_format  == AV_PIX_FMT_NONE || !sws_isSupportedInput ( input_pixel_format  )
+     || output_pixel_format == AV_PIX_FMT_NONE || !sws_isSupportedOutput( output_pixel_format ) )
+        return -1;
+    const AVPixFmtDescriptor *out_desc = av_pix_fmt_desc_get( output_pixel_format );
+    /* swscale doesn't define the last pair of an odd width of packed YUV 4:2:2. */
+    const int packed_pairs = out_desc->log2_chroma_w == 1 && !(out_desc->flags & AV_PIX_FMT_FLAG_PLANAR);
+    int failures = 0;
+    for( int i = 0; i < (int)(sizeof(widths) / sizeof(widths[0])); i++ )
+    {
+        const int width         = widths[i];
+        const int compare_width = packed_pairs ? width & ~1 : width;
+        picture_t src;
+        picture_t reference[sizeof(base_scaler_flags) / sizeof(base_scaler_flags[0])];
+        if( make_source( &src, input_pixel_format, width, HEIGHT ) < 0 )
+            return failures + 1;
+        for( int j = 0; j < (int)(sizeof(base_scaler_flags) / sizeof(base_scaler_flags[0])); j++ )
+            if( scale_by_swscale( &reference[j], &src, input_pixel_format, output_pixel_format, width, HEIGHT, base_scaler_flags[j] ) < 0 )
+            {
+                fprintf( stderr, "%s -> %s: swscale failed at the width %d.\n", conversion->input, conversion->output, width );
+                while( j-- )
+                    free_picture( &reference[j] );
+                free_picture( &src );
+                return failures + 1;
+            }
+        for( int level = LW_SIMD_LEVEL_C; level <= max_simd_level; level++ )
+        {
+            lw_set_simd_level_limit( level );
+            picture_t whole;
+            picture_t sliced;
+            int failed = 0;
+            if( convert_by_lwconvert( &whole,  &src, input_pixel_format, output_pixel_format, width, HEIGHT, HEIGHT     ) < 0
+             || convert_by_lwconvert( &sliced, &src, input_pixel_format, output_pixel_format, width, HEIGHT, SLICE_SIZE ) < 0 )
+                failed = 1;
+            else
+            {
+                failed = check_guard( &whole )
+                      || check_guard( &sliced )
+                      || compare_pictures( &sliced, &whole, out_desc, width, HEIGHT );
+                for( int j = 0; !failed && j < (int)(sizeof(base_scaler_flags) / sizeof(base_scaler_flags[0])); j++ )
+                    failed = compare_width > 0 && compare_pictures( &whole, &reference[j], out_desc, compare_width, HEIGHT );
+            }
+            if( failed )
+            {
+                fprintf( stderr, "%s -> %s: %s differs at the width %d.\n",
+                         conversion->input, conversion->output, simd_level_names[level], width );
+                ++failures;
+            }
+            free_picture( &whole );
+            free_picture( &sliced );
+        }
+        lw_set_simd_level_limit( max_simd_level );
+        for( int j = 0; j < (int)(sizeof(base_scaler_flags) / sizeof(base_scaler_flags[0])); j++ )
+            free_picture( &reference[j] );
+        free_picture( &src );
+    }
+    return failures;
+}
+
+/* Extract the alpha of packed RGBA formats. */
+static int test_extraction
+(
+    const char *format_name,
+    int         max_simd_level
+)
+{
+    enum AVPixelFormat pixel_format = av_get_pix_fmt( format_name );
+    if( pixel_format == AV_PIX_FMT_NONE )
+        return 0;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get( pixel_format );
+    const int bytes_per_sample = (desc->comp[3].depth + 7) >> 3;
+    const int offset           = desc->comp[3].offset / bytes_per_sample;
+    const int big_endian       = !!(desc->flags & AV_PIX_FMT_FLAG_BE);
+    const enum AVPixelFormat plane_format = bytes_per_sample == 2 ? AV_PIX_FMT_GRAY16 : AV_PIX_FMT_GRAY8;
+    const AVPixFmtDescriptor *plane_desc = av_pix_fmt_desc_get( plane_format );
+    int failures = 0;
+    for( int i = 0; i < (int)(sizeof(widths) / sizeof(widths[0])); i++ )
+    {
+        const int width = widths[i];
+        picture_t src;
+        picture_t reference;
+        if( make_source( &src, pixel_format, width, HEIGHT ) < 0 )
+            return failures + 1;
+        if( alloc_picture( &reference, plane_format, width, HEIGHT, 0 ) < 0 )
+        {
+            free_picture( &src );
+            return failures + 1;
+        }
+        const uint8_t *src_data[4] = { src.data[0], NULL, NULL, NULL };
+        for( int y = 0; y < HEIGHT; y++ )
+        {
+            uint16_t line[MAX_WIDTH];
+            av_read_image_line( line, src_data, src.linesize, desc, 0, y, 3, width, 0 );
+            av_write_image_line( line, reference.data, reference.linesize, plane_desc, 0, y, 0, width );
+        }
+        for( int level = LW_SIMD_LEVEL_C; level <= max_simd_level; level++ )
+        {
+            lw_set_simd_level_limit( level );
+            picture_t dst;
+            if( alloc_picture( &dst, plane_format, width, HEIGHT, GUARD_BYTE ) < 0 )
+            {
+                ++failures;
+                continue;
+            }
+            if( bytes_per_sample == 2 )
+                lw_extract_packed_component16( dst.data[0], dst.linesize[0], src.data[0], src.linesize[0],
+                                               width, HEIGHT, offset, big_endian );
+            else
+                lw_extract_packed_component8( dst.data[0], dst.linesize[0], src.data[0], src.linesize[0],
+                                              width, HEIGHT, offset );
+            if( check_guard( &dst )
+             || compare_pictures( &dst, &reference, plane_desc, width, HEIGHT ) )
+            {
+                fprintf( stderr, "alpha of %s: %s differs at the width %d.\n", format_name, simd_level_names[level], width );
+                ++failures;
+            }
+            free_picture( &dst );
+        }
+        lw_set_simd_level_limit( max_simd_level );
+        free_picture( &reference );
+        free_picture( &src );
+    }
+    return failures;
+}
+
+static int test_fill
+(
+    uint32_t pattern,
+    int      max_simd_level
+)
+{
+    int failures = 0;
+    for( int i = 0; i < (int)(sizeof(widths) / sizeof(widths[0])); i++ )
+    {
+        const int width = widths[i];
+        for( int level = LW_SIMD_LEVEL_C; level <= max_simd_level; level++ )
+        {
+            lw_set_simd_level_limit( level );
+            picture_t dst;
+            if( alloc_picture( &dst, AV_PIX_FMT_GRAY8, width, HEIGHT, GUARD_BYTE ) < 0 )
+            {
+                ++failures;
+                continue;
+            }
+            lw_fill_plane( dst.data[0], dst.linesize[0], width, HEIGHT, pattern );
+            int failed = check_guard( &dst );
+            for( int y = 0; y < HEIGHT && !failed; y++ )
+                for( int x = 0; x < width; x++ )
+                    if( dst.data[0][(size_t)y * dst.linesize[0] + x] != ((const uint8_t *)&pattern)[x & 3] )
+                    {
+                        failed = 1;
+                        break;
+                    }
+            if( failed )
+            {
+                fprintf( stderr, "fill of 0x%08x: %s differs at the width %d.\n", pattern, simd_level_names[level], width );
+                ++failures;
+            }
+            free_picture( &dst );
+        }
+        lw_set_simd_level_limit( max_simd_level );
+    }
+    return failures;
+}
+
+int main
+(
+    void
+)
+{
+    const int max_simd_level = lw_get_simd_level();
+    int failures = 0;
+    int tested   = 0;
+    for( int i = 0; i < (int)(sizeof(handled_conversions) / sizeof(handled_conversions[0])); i++ )
+    {
+        int ret = test_conversion( &handled_conversions[i], max_simd_level );
+        if( ret < 0 )
+        {
+            printf( "%s -> %s: skipped since unsupported by the libraries.\n",
+                    handled_conversions[i].input, handled_conversions[i].output );
+            continue;
+        }
+        failures += ret;
+        ++tested;
+    }
+    if( tested == 0 )
+    {
+        fprintf( stderr, "swscale supports none of the conversions.\n" );
+        return SKIP;
+    }
+    for( int i = 0; i < (int)(sizeof(refused_conversions) / sizeof(refused_conversions[0])); i++ )
+    {
+        enum AVPixelFormat input_pixel_format  = av_get_pix_fmt( refused_conversions[i].input  );
+        enum AVPixelFormat output_pixel_format = av_get_pix_fmt( refused_conversions[i].output );
+        if( input_pixel_format == AV_PIX_FMT_NONE || output_pixel_format == AV_PIX_FMT_NONE )
+            continue;
+        lw_pixel_converter_t *converter = lw_pixel_converter_open( input_pixel_format, output_pixel_format );
+        if( converter )
+        {
+            fprintf( stderr, "%s -> %s: the conversion is not refused.\n", refused_conversions[i].input, refused_conversions[i].output );
+            lw_pixel_converter_close( &converter );
+            ++failures;
+        }
+    }
+    static const char *alpha_formats[] = { "rgba", "argb", "bgra", "rgba64le", "rgba64be" };
+    for( int i = 0; i < (int)(sizeof(alpha_formats) / sizeof(alpha_formats[0])); i++ )
+        failures += test_extraction( alpha_formats[i], max_simd_level );
+    static const uint32_t fill_patterns[] = { 0x10101010, 0x00800080, 0x03020100 };
+    for( int i = 0; i < (int)(sizeof(fill_patterns) / sizeof(fill_patterns[0])); i++ )
+        failures += test_fill( fill_patterns[i], max_simd_level );
+    printf( "Checked %d conversions up to %s.\n", tested, simd_level_names[max_simd_level] );
+    return failures ? 1 : 0;
+}
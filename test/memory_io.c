@@ -0,0 +1,362 @@
+/*****************************************************************************
+ * memory_io.c
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+/* Index and decode a clip through the file path and through the memory callbacks,
+ * and check that both routes identify the source in the same way and output the same frames as the source.
+ * The streaming mode is also checked to read the source through the callbacks. */
+
+#define NO_PROGRESS_HANDLER
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+#include <libswresample/swresample.h>
+
+#include "utils.h"
+#include "video_output.h"
+#include "audio_output.h"
+#include "lwlibav_dec.h"
+#include "lwlibav_video.h"
+#include "lwlibav_audio.h"
+#include "progress.h"
+#include "lwindex.h"
+
+#define SKIP 77
+
+#define SOURCE_PATH       "memory_io.y4m"
+#define FILE_INDEX_PATH   "memory_io.file.lwi"
+#define MEMORY_INDEX_PATH "memory_io.memory.lwi"
+#define ABSENT_PATH       "memory_io.absent.y4m"
+
+/* Odd dimensions to exercise the rounding of the chroma planes and the tails of rows. */
+#define WIDTH         66
+#define HEIGHT        38
+#define CHROMA_WIDTH  (WIDTH  / 2)
+#define CHROMA_HEIGHT (HEIGHT / 2)
+#define FRAME_COUNT   24
+
+static uint8_t source_sample
+(
+    int plane,
+    int frame,
+    int x,
+    int y
+)
+{
+    return (uint8_t)(x * (3 + plane) + y * (5 + 2 * plane) + frame * 7 + plane * 64);
+}
+
+static int write_source
+(
+    void
+)
+{
+    FILE *fp = fopen( SOURCE_PATH, "wb" );
+    if( !fp )
+        return -1;
+    fprintf( fp, "YUV4MPEG2 W%d H%d F24:1 Ip A1:1 C420jpeg\n", WIDTH, HEIGHT );
+    for( int frame = 0; frame < FRAME_COUNT; frame++ )
+    {
+        fprintf( fp, "FRAME\n" );
+        for( int plane = 0; plane < 3; plane++ )
+        {
+            int width  = plane ? CHROMA_WIDTH  : WIDTH;
+            int height = plane ? CHROMA_HEIGHT : HEIGHT;
+            for( int y = 0; y < height; y++ )
+                for( int x = 0; x < width; x++ )
+                    fputc( source_sample( plane, frame, x, y ), fp );
+        }
+    }
+    return fclose( fp ) ? -1 : 0;
+}
+
+static uint8_t *load_source
+(
+    int64_t *size
+)
+{
+    FILE *fp = fopen( SOURCE_PATH, "rb" );
+    if( !fp )
+        return NULL;
+    uint8_t *data = NULL;
+    if( !fseek( fp, 0, SEEK_END ) && (*size = ftell( fp )) > 0 && !fseek( fp, 0, SEEK_SET ) )
+    {
+        data = (uint8_t *)malloc( (size_t)*size );
+        if( data && fread( data, 1, (size_t)*size, fp ) != (size_t)*size )
+        {
+            free( data );
+            data = NULL;
+        }
+    }
+    fclose( fp );
+    return data;
+}
+
+/* Get the line of the index file which starts with 'key'. */
+static int get_index_line
+(
+    const char *index_file_path,
+    const char *key,
+    char       *line,
+    int         line_size
+)
+{
+    FILE *fp = fopen( index_file_path, "rb" );
+    if( !fp )
+        return -1;
+    int ret = -1;
+    while( fgets( line, line_size, fp ) )
+        if( !strncmp( line, key, strlen( key ) ) )
+        {
+            ret = 0;
+            break;
+        }
+    fclose( fp );
+    return ret;
+}
+
+static int check_frame
+(
+    const AVFrame *frame,
+    int            frame_number
+)
+{
+    if( frame->width != WIDTH || frame->height != HEIGHT )
+    {
+        fprintf( stderr, "frame %d: %dx%d is output instead of %dx%d.\n", frame_number, frame->width, frame->height, WIDTH, HEIGHT );
+        return -1;
+    }
+    for( int plane = 0; plane < 3; plane++ )
+    {
+        int width  = plane ? CHROMA_WIDTH  : WIDTH;
+        int height = plane ? CHROMA_HEIGHT : HEIGHT;
+        for( int y = 0; y < height; y++ )
+            for( int x = 0; x < width; x++ )
+                if( frame->data[plane][y * frame->linesize[plane] + x] != source_sample( plane, frame_number - 1, x, y ) )
+                {
+                    fprintf( stderr, "frame %d: the sample (%d, %d) of the plane %d differs from the source.\n", frame_number, x, y, plane );
+                    return -1;
+                }
+    }
+    return 0;
+}
+
+/* Set up the decoding as a plugin does and decode all frames in the forward, backward and a scattered order. */
+static int decode_frames
+(
+    lwlibav_video_decode_handler_t *vdhp,
+    lwlibav_video_output_handler_t *vohp,
+    const char                     *name
+)
+{
+    if( lwlibav_import_av_index_entry( (lwlibav_decode_handler_t *)vdhp ) < 0 )
+        return -1;
+    lwlibav_video_set_initial_input_format( vdhp );
+    AVCodecContext *ctx = lwlibav_video_get_codec_context( vdhp );
+    /* Output in the decoded format so that nothing but the decoder changes the samples. */
+    setup_video_rendering( vohp, SWS_POINT, WIDTH, HEIGHT, ctx->pix_fmt, ctx, NULL );
+    lwlibav_video_set_get_buffer_func( vdhp );
+    if( lwlibav_video_find_first_valid_frame( vdhp ) < 0 )
+        return -1;
+    lwlibav_video_force_seek( vdhp );
+    for( int pass = 0; pass < 3; pass++ )
+        for( int i = 0; i < FRAME_COUNT; i++ )
+        {
+            int frame_number = pass == 0 ? i + 1
+                             : pass == 1 ? FRAME_COUNT - i
+                             :             (i * 7) % FRAME_COUNT + 1;
+            if( lwlibav_video_get_frame( vdhp, vohp, frame_number ) < 0 )
+            {
+                fprintf( stderr, "%s: failed to get the frame %d.\n", name, frame_number );
+                return -1;
+            }
+            if( check_frame( lwlibav_video_get_frame_buffer( vdhp ), frame_number ) < 0 )
+                return -1;
+        }
+    return 0;
+}
+
+/* Open the source through the index as a plugin does. */
+static int index_and_decode
+(
+    const char        *index_file_path,
+    lw_io_callbacks_t *io_callbacks
+)
+{
+    lwlibav_file_handler_t          lwh = { 0 };
+    lw_log_handler_t                lh  = { 0 };
+    progress_indicator_t            indicator = { NULL, NULL, NULL };
+    lwlibav_video_decode_handler_t *vdhp = lwlibav_video_alloc_decode_handler();
+    lwlibav_video_output_handler_t *vohp = lwlibav_video_alloc_output_handler();
+    lwlibav_audio_decode_handler_t *adhp = lwlibav_audio_alloc_decode_handler();
+    lwlibav_audio_output_handler_t *aohp = lwlibav_audio_alloc_output_handler();
+    int ret = -1;
+    if( !vdhp || !vohp || !adhp || !aohp )
+        goto end;
+    lwlibav_option_t opt = { 0 };
+    opt.file_path         = SOURCE_PATH;
+    opt.index_file_path   = index_file_path;
+    opt.threads           = 1;
+    opt.force_video       = 0;
+    opt.force_video_index = -1;
+    opt.force_audio       = 0;
+    opt.force_audio_index = -2;
+    opt.apply_repeat_flag = 0;
+    opt.io_callbacks      = io_callbacks;
+    opt.io_flags          = 0;
+    lwlibav_video_set_seek_mode( vdhp, 0 );
+    lwlibav_video_set_forward_seek_threshold( vdhp, 10 );
+    if( lwlibav_construct_index( &lwh, vdhp, vohp, adhp, aohp, &lh, &opt, &indicator, NULL ) < 0 )
+    {
+        fprintf( stderr, "%s: failed to construct the index.\n", index_file_path );
+        goto end;
+    }
+    lwlibav_audio_free_decode_handler_ptr( &adhp );
+    lwlibav_audio_free_output_handler_ptr( &aohp );
+    lwlibav_video_set_log_handler( vdhp, &lh );
+    if( lwlibav_video_get_desired_track( lwh.file_path, vdhp, lwh.threads ) < 0 )
+    {
+        fprintf( stderr, "%s: failed to get the video track.\n", index_file_path );
+        goto end;
+    }
+    int64_t fps_num = 25;
+    int64_t fps_den = 1;
+    lwlibav_video_setup_timestamp_info( &lwh, vdhp, vohp, &fps_num, &fps_den, 0 );
+    if( vohp->frame_count != FRAME_COUNT )
+    {
+        fprintf( stderr, "%s: %" PRIu32 " frames are indexed instead of %d.\n", index_file_path, vohp->frame_count, FRAME_COUNT );
+        goto end;
+    }
+    if( decode_frames( vdhp, vohp, index_file_path ) < 0 )
+        goto end;
+    ret = 0;
+end:
+    lwlibav_video_free_decode_handler( vdhp );
+    lwlibav_video_free_output_handler( vohp );
+    lwlibav_audio_free_decode_handler( adhp );
+    lwlibav_audio_free_output_handler( aohp );
+    lw_free( lwh.file_path );
+    return ret;
+}
+
+/* Open the source in the streaming mode.
+ * The path doesn't exist so that the source can be read only through the callbacks. */
+static int stream_and_decode
+(
+    lw_io_callbacks_t *io_callbacks
+)
+{
+    lwlibav_file_handler_t          lwh = { 0 };
+    lw_log_handler_t                lh  = { 0 };
+    lwlibav_video_decode_handler_t *vdhp = lwlibav_video_alloc_decode_handler();
+    lwlibav_video_output_handler_t *vohp = lwlibav_video_alloc_output_handler();
+    int ret = -1;
+    if( !vdhp || !vohp )
+        goto end;
+    lwlibav_video_set_log_handler( vdhp, &lh );
+    /* Keep all frames for the backward requests. */
+    lwlibav_video_set_stream_lookback( vdhp, FRAME_COUNT );
+    if( lwlibav_video_open_stream( ABSENT_PATH, io_callbacks, 0, vdhp, vohp, -1, FRAME_COUNT, 1 ) < 0 )
+    {
+        fprintf( stderr, "streaming: failed to open the source through the callbacks.\n" );
+        goto end;
+    }
+    int64_t fps_num = 25;
+    int64_t fps_den = 1;
+    lwlibav_video_setup_timestamp_info( &lwh, vdhp, vohp, &fps_num, &fps_den, 0 );
+    if( decode_frames( vdhp, vohp, "streaming" ) < 0 )
+        goto end;
+    ret = 0;
+end:
+    lwlibav_video_free_decode_handler( vdhp );
+    lwlibav_video_free_output_handler( vohp );
+    return ret;
+}
+
+int main
+(
+    void
+)
+{
+    av_log_set_level( AV_LOG_QUIET );
+    if( !av_find_input_format( "yuv4mpegpipe" ) || !avcodec_find_decoder( AV_CODEC_ID_RAWVIDEO ) )
+    {
+        fprintf( stderr, "The yuv4mpegpipe demuxer or the rawvideo decoder is unavailable.\n" );
+        return SKIP;
+    }
+    remove( FILE_INDEX_PATH );
+    remove( MEMORY_INDEX_PATH );
+    if( write_source() < 0 )
+    {
+        fprintf( stderr, "Failed to write the source.\n" );
+        return 1;
+    }
+    lw_io_memory_t memory;
+    uint8_t *data = load_source( &memory.size );
+    if( !data )
+    {
+        fprintf( stderr, "Failed to load the source.\n" );
+        return 1;
+    }
+    memory.data = data;
+    lw_io_callbacks_t io_callbacks;
+    lw_io_set_memory_callbacks( &io_callbacks, &memory );
+    int ret = 1;
+    /* Create the index through each route. */
+    if( index_and_decode( FILE_INDEX_PATH,   NULL )          < 0
+     || index_and_decode( MEMORY_INDEX_PATH, &io_callbacks ) < 0 )
+        goto end;
+    /* Both routes shall identify the source in the same way. */
+    static const char *keys[2] = { "<FileSize=", "<FileHash=" };
+    for( int i = 0; i < 2; i++ )
+    {
+        char file_line[256];
+        char memory_line[256];
+        if( get_index_line( FILE_INDEX_PATH,   keys[i], file_line,   sizeof(file_line) )   < 0
+         || get_index_line( MEMORY_INDEX_PATH, keys[i], memory_line, sizeof(memory_line) ) < 0 )
+        {
+            fprintf( stderr, "%s is not written to the index.\n", keys[i] );
+            goto end;
+        }
+        if( strcmp( file_line, memory_line ) )
+        {
+            fprintf( stderr, "The source is identified as %s through the file path but %s through the callbacks.\n", file_line, memory_line );
+            goto end;
+        }
+    }
+    /* Reopen through the existing index, which is parsed only if the identity matches. */
+    if( index_and_decode( FILE_INDEX_PATH,   &io_callbacks ) < 0
+     || index_and_decode( MEMORY_INDEX_PATH, NULL )          < 0 )
+        goto end;
+    if( stream_and_decode( &io_callbacks ) < 0 )
+        goto end;
+    ret = 0;
+end:
+    free( data );
+    remove( SOURCE_PATH );
+    remove( FILE_INDEX_PATH );
+    remove( MEMORY_INDEX_PATH );
+    return ret;
+}